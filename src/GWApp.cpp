@@ -7,6 +7,7 @@
 
 #include "GWSys.hpp"
 #include "GWApp.hpp"
+#include "GWTask.hpp"
 
 using namespace std;
 
@@ -73,6 +74,7 @@ namespace GWApp {
  	}
 
 	void reset() {
+		GWTask::reset();
 		s_CmdLine.reset();
 	}
 
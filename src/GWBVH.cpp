@@ -0,0 +1,580 @@
+/*
+ * Author: Gleb Novodran <novodran@gmail.com>
+ */
+
+#include <atomic>
+#include <cfloat>
+#include <vector>
+#include "groundwork.hpp"
+
+namespace GWBVH {
+
+	static const int NUM_BINS = 16;
+	// ranges larger than this are reduced and binned in parallel
+	static const int PAR_RANGE_MIN = 0x4000;
+	// ranges up to this size are built as independent subtree tasks
+	static const int SUBTREE_MAX = 0x1000;
+
+	struct Bounds {
+		GWVectorF mMin;
+		GWVectorF mMax;
+
+		void reset() {
+			mMin.fill(FLT_MAX);
+			mMax.fill(-FLT_MAX);
+		}
+		void add(const GWVectorF& min, const GWVectorF& max) {
+			GWTuple::min(mMin, mMin, min);
+			GWTuple::max(mMax, mMax, max);
+		}
+		void add(const Bounds& bb) { add(bb.mMin, bb.mMax); }
+		float half_area() const {
+			GWVectorF e = mMax - mMin;
+			return e.x*e.y + e.y*e.z + e.z*e.x;
+		}
+	};
+
+	struct BinSet {
+		Bounds mBins[3][NUM_BINS];
+		int mCounts[3][NUM_BINS];
+
+		void reset() {
+			for (int i = 0; i < 3; ++i) {
+				for (int j = 0; j < NUM_BINS; ++j) {
+					mBins[i][j].reset();
+					mCounts[i][j] = 0;
+				}
+			}
+		}
+
+		void add(const BinSet& set) {
+			for (int i = 0; i < 3; ++i) {
+				for (int j = 0; j < NUM_BINS; ++j) {
+					mBins[i][j].add(set.mBins[i][j]);
+					mCounts[i][j] += set.mCounts[i][j];
+				}
+			}
+		}
+	};
+
+	template<typename FUNC_T> static void exec_range(int count, bool parallel, const FUNC_T& func) {
+		if (parallel) {
+			GWTask::parallel_for(count, func);
+		} else {
+			func(0, count);
+		}
+	}
+
+	static int calc_num_chunks(int count) {
+		return std::max(std::min(GWTask::get_num_threads() * 4, count / 0x400), 1);
+	}
+
+	class Builder {
+	public:
+		struct Task {
+			int32_t mNodeIdx;
+			int32_t mBegin;
+			int32_t mEnd;
+		};
+
+		Node* mpNodes;
+		const GWVectorF* mpMin;
+		const GWVectorF* mpMax;
+		const GWVectorF* mpCtr;
+		int32_t* mpIdx;
+		bool mParallel;
+		std::vector<Task> mTasks;
+
+		static int calc_bin(float c, float org, float scl) {
+			return GWBase::clamp(int((c - org) * scl), 0, NUM_BINS - 1);
+		}
+
+		void calc_bounds(int begin, int end, Bounds& bb, Bounds& cb) const {
+			bb.reset();
+			cb.reset();
+			for (int i = begin; i < end; ++i) {
+				int32_t prim = mpIdx[i];
+				bb.add(mpMin[prim], mpMax[prim]);
+				cb.add(mpCtr[prim], mpCtr[prim]);
+			}
+		}
+
+		void calc_bins(int begin, int end, const Bounds& cb, const GWVectorF& scl, BinSet& bins) const {
+			bins.reset();
+			for (int i = begin; i < end; ++i) {
+				int32_t prim = mpIdx[i];
+				for (int a = 0; a < 3; ++a) {
+					int k = calc_bin(mpCtr[prim][a], cb.mMin[a], scl[a]);
+					bins.mBins[a][k].add(mpMin[prim], mpMax[prim]);
+					++bins.mCounts[a][k];
+				}
+			}
+		}
+
+		// parallel versions reduce per-chunk results in chunk order
+		void calc_bounds_par(int begin, int end, Bounds& bb, Bounds& cb) const {
+			int count = end - begin;
+			int nchunk = calc_num_chunks(count);
+			std::vector<Bounds> chunks(nchunk * 2);
+			GWTask::parallel_for(nchunk, [&](int c0, int c1) {
+				for (int c = c0; c < c1; ++c) {
+					int i0 = begin + int(int64_t(count) * c / nchunk);
+					int i1 = begin + int(int64_t(count) * (c + 1) / nchunk);
+					calc_bounds(i0, i1, chunks[c * 2], chunks[c * 2 + 1]);
+				}
+			}, 1);
+			bb.reset();
+			cb.reset();
+			for (int c = 0; c < nchunk; ++c) {
+				bb.add(chunks[c * 2]);
+				cb.add(chunks[c * 2 + 1]);
+			}
+		}
+
+		void calc_bins_par(int begin, int end, const Bounds& cb, const GWVectorF& scl, BinSet& bins) const {
+			int count = end - begin;
+			int nchunk = calc_num_chunks(count);
+			std::vector<BinSet> chunks(nchunk);
+			GWTask::parallel_for(nchunk, [&](int c0, int c1) {
+				for (int c = c0; c < c1; ++c) {
+					int i0 = begin + int(int64_t(count) * c / nchunk);
+					int i1 = begin + int(int64_t(count) * (c + 1) / nchunk);
+					calc_bins(i0, i1, cb, scl, chunks[c]);
+				}
+			}, 1);
+			bins.reset();
+			for (int c = 0; c < nchunk; ++c) {
+				bins.add(chunks[c]);
+			}
+		}
+
+		// partitions the range and returns the start of the right half
+		int split(int begin, int end, const Bounds& cb, bool parallel) {
+			GWVectorF ext = cb.mMax - cb.mMin;
+			GWVectorF scl;
+			for (int a = 0; a < 3; ++a) {
+				scl[a] = ext[a] > 0.0f ? float(NUM_BINS) * (1.0f - 1.0e-6f) / ext[a] : 0.0f;
+			}
+			BinSet bins;
+			if (parallel) {
+				calc_bins_par(begin, end, cb, scl, bins);
+			} else {
+				calc_bins(begin, end, cb, scl, bins);
+			}
+
+			int bestAxis = -1;
+			int bestBin = -1;
+			float bestCost = FLT_MAX;
+			for (int a = 0; a < 3; ++a) {
+				if (!(ext[a] > 0.0f)) { continue; }
+				float rightArea[NUM_BINS];
+				int rightCount[NUM_BINS];
+				Bounds acc;
+				acc.reset();
+				int cnt = 0;
+				for (int i = NUM_BINS - 1; i > 0; --i) {
+					if (bins.mCounts[a][i] > 0) {
+						acc.add(bins.mBins[a][i]);
+						cnt += bins.mCounts[a][i];
+					}
+					rightArea[i] = cnt > 0 ? acc.half_area() : 0.0f;
+					rightCount[i] = cnt;
+				}
+				acc.reset();
+				cnt = 0;
+				for (int i = 0; i < NUM_BINS - 1; ++i) {
+					if (bins.mCounts[a][i] > 0) {
+						acc.add(bins.mBins[a][i]);
+						cnt += bins.mCounts[a][i];
+					}
+					if (cnt > 0 && rightCount[i + 1] > 0) {
+						float cost = float(cnt) * acc.half_area() + float(rightCount[i + 1]) * rightArea[i + 1];
+						if (cost < bestCost) {
+							bestCost = cost;
+							bestAxis = a;
+							bestBin = i;
+						}
+					}
+				}
+			}
+
+			if (bestAxis < 0) {
+				// all centroids coincide
+				return (begin + end) / 2;
+			}
+			float org = cb.mMin[bestAxis];
+			float axisScl = scl[bestAxis];
+			const GWVectorF* pCtr = mpCtr;
+			int32_t* pMid = std::partition(mpIdx + begin, mpIdx + end, [=](int32_t prim) {
+				return calc_bin(pCtr[prim][bestAxis], org, axisScl) <= bestBin;
+			});
+			return int(pMid - mpIdx);
+		}
+
+		// with collectTasks set, small ranges are deferred to mTasks instead of being built
+		void build_range(const Task& root, bool collectTasks) {
+			std::vector<Task> stk;
+			stk.push_back(root);
+			while (!stk.empty()) {
+				Task task = stk.back();
+				stk.pop_back();
+				int count = task.mEnd - task.mBegin;
+				Node& node = mpNodes[task.mNodeIdx];
+				if (count == 1) {
+					int32_t prim = mpIdx[task.mBegin];
+					node.mBBoxMin = mpMin[prim];
+					node.mBBoxMax = mpMax[prim];
+					node.mLeft = prim;
+					node.mRight = -1;
+					continue;
+				}
+				if (collectTasks && count <= SUBTREE_MAX) {
+					mTasks.push_back(task);
+					continue;
+				}
+				bool parallel = collectTasks && count >= PAR_RANGE_MIN;
+				Bounds bb, cb;
+				if (parallel) {
+					calc_bounds_par(task.mBegin, task.mEnd, bb, cb);
+				} else {
+					calc_bounds(task.mBegin, task.mEnd, bb, cb);
+				}
+				int mid = split(task.mBegin, task.mEnd, cb, parallel);
+				int nleft = mid - task.mBegin;
+				node.mBBoxMin = bb.mMin;
+				node.mBBoxMax = bb.mMax;
+				node.mLeft = task.mNodeIdx + 1;
+				node.mRight = task.mNodeIdx + nleft * 2;
+				Task left = { node.mLeft, task.mBegin, mid };
+				Task right = { node.mRight, mid, task.mEnd };
+				stk.push_back(right);
+				stk.push_back(left);
+			}
+		}
+
+		void build(int nprim) {
+			Task root = { 0, 0, nprim };
+			if (!mParallel) {
+				build_range(root, false);
+				return;
+			}
+			mTasks.clear();
+			build_range(root, true);
+			// biggest subtrees first for a better balance
+			std::sort(mTasks.begin(), mTasks.end(), [](const Task& a, const Task& b) {
+				return (a.mEnd - a.mBegin) > (b.mEnd - b.mBegin);
+			});
+			GWTask::parallel_for(int(mTasks.size()), [this](int t0, int t1) {
+				for (int t = t0; t < t1; ++t) {
+					build_range(mTasks[t], false);
+				}
+			}, 1);
+		}
+	};
+
+	bool build(Node* pNodes, const GWVectorF* pPrimMin, const GWVectorF* pPrimMax, int nprim, bool parallel) {
+		if (pNodes == nullptr || pPrimMin == nullptr || pPrimMax == nullptr || nprim <= 0) { return false; }
+		int32_t* pIdx = reinterpret_cast<int32_t*>(GWSys::alloc_temp_mem(nprim * sizeof(int32_t)));
+		GWVectorF* pCtr = reinterpret_cast<GWVectorF*>(GWSys::alloc_temp_mem(nprim * sizeof(GWVectorF)));
+		exec_range(nprim, parallel, [&](int i0, int i1) {
+			for (int i = i0; i < i1; ++i) {
+				pIdx[i] = i;
+				pCtr[i] = (pPrimMin[i] + pPrimMax[i]) * 0.5f;
+			}
+		});
+
+		Builder bld;
+		bld.mpNodes = pNodes;
+		bld.mpMin = pPrimMin;
+		bld.mpMax = pPrimMax;
+		bld.mpCtr = pCtr;
+		bld.mpIdx = pIdx;
+		bld.mParallel = parallel;
+		bld.build(nprim);
+
+		GWSys::free_temp_mem(pCtr);
+		GWSys::free_temp_mem(pIdx);
+		return true;
+	}
+
+	static void calc_poly_bounds(const GWCollisionResource& cls, GWVectorF* pMin, GWVectorF* pMax, bool parallel) {
+		const GWCollisionResource::Poly* pPols = cls.get_pols_top();
+		const GWVectorF* pPnts = cls.get_pnts_top();
+		const int32_t* pIdx = cls.get_idx_top();
+		exec_range(cls.mNumPol, parallel, [&](int i0, int i1) {
+			for (int i = i0; i < i1; ++i) {
+				const GWCollisionResource::Poly& pol = pPols[i];
+				pMin[i] = pPnts[pIdx[pol.mOffsIdx]];
+				pMax[i] = pMin[i];
+				for (int j = 1; j < pol.mNumVtx; ++j) {
+					const GWVectorF& pnt = pPnts[pIdx[pol.mOffsIdx + j]];
+					GWTuple::min(pMin[i], pMin[i], pnt);
+					GWTuple::max(pMax[i], pMax[i], pnt);
+				}
+			}
+		});
+	}
+
+	static bool build_cls_nodes(Node* pNodes, const GWCollisionResource& cls, GWVectorF* pMin, GWVectorF* pMax, bool parallel) {
+		calc_poly_bounds(cls, pMin, pMax, parallel);
+		return build(pNodes, pMin, pMax, cls.mNumPol, parallel);
+	}
+
+	Node* build(const GWCollisionResource& cls, bool parallel) {
+		int npol = cls.mNumPol;
+		if (npol <= 0 || !cls.get_pols_top() || !cls.get_pnts_top() || !cls.get_idx_top()) { return nullptr; }
+		Node* pNodes = reinterpret_cast<Node*>(GWSys::alloc_rsrc_mem(calc_num_nodes(npol) * sizeof(Node)));
+		GWVectorF* pMin = reinterpret_cast<GWVectorF*>(GWSys::alloc_temp_mem(npol * sizeof(GWVectorF) * 2));
+		GWVectorF* pMax = pMin + npol;
+		build_cls_nodes(pNodes, cls, pMin, pMax, parallel);
+		GWSys::free_temp_mem(pMin);
+		return pNodes;
+	}
+
+	// fills 3 point indices per triangle, returns the number of triangles
+	static int gather_tri_pnts(GWModelResource& mdr, uint32_t* pTriPnts) {
+		int ntri = int(mdr.mNumTri);
+		int triOrg = 0;
+		for (uint32_t i = 0; i < mdr.mNumMtl; ++i) {
+			GWModelResource::Material* pMtl = mdr.get_mtl(i);
+			int mtlTris = std::min(int(pMtl->mIdx.mNumTri), ntri - triOrg);
+			for (int j = 0; j < mtlTris; ++j) {
+				mdr.get_mtl_tri_pnt_indices(i, j, &pTriPnts[(triOrg + j) * 3]);
+			}
+			triOrg += mtlTris;
+		}
+		return triOrg;
+	}
+
+	static inline void calc_tri_bounds(const uint32_t* pTri, const GWVectorF* pPnts, GWVectorF& bbMin, GWVectorF& bbMax) {
+		bbMin = pPnts[pTri[0]];
+		bbMax = bbMin;
+		for (int k = 1; k < 3; ++k) {
+			GWTuple::min(bbMin, bbMin, pPnts[pTri[k]]);
+			GWTuple::max(bbMax, bbMax, pPnts[pTri[k]]);
+		}
+	}
+
+	static void build_tri_nodes(Node* pNodes, const uint32_t* pTriPnts, const GWVectorF* pPnts, int ntri, bool parallel) {
+		GWVectorF* pMin = reinterpret_cast<GWVectorF*>(GWSys::alloc_temp_mem(ntri * sizeof(GWVectorF) * 2));
+		GWVectorF* pMax = pMin + ntri;
+		exec_range(ntri, parallel, [&](int i0, int i1) {
+			for (int i = i0; i < i1; ++i) {
+				calc_tri_bounds(&pTriPnts[i * 3], pPnts, pMin[i], pMax[i]);
+			}
+		});
+		build(pNodes, pMin, pMax, ntri, parallel);
+		GWSys::free_temp_mem(pMin);
+	}
+
+	Node* build(GWModelResource& mdr, bool parallel) {
+		int ntri = int(mdr.mNumTri);
+		if (ntri <= 0 || mdr.mNumPnt == 0) { return nullptr; }
+		uint32_t* pTriPnts = reinterpret_cast<uint32_t*>(GWSys::alloc_temp_mem(ntri * 3 * sizeof(uint32_t)));
+		ntri = gather_tri_pnts(mdr, pTriPnts);
+		Node* pNodes = nullptr;
+		if (ntri > 0) {
+			pNodes = reinterpret_cast<Node*>(GWSys::alloc_rsrc_mem(calc_num_nodes(ntri) * sizeof(Node)));
+			build_tri_nodes(pNodes, pTriPnts, reinterpret_cast<const GWVectorF*>(mdr.get_pnt_ptr(0)), ntri, parallel);
+		}
+		GWSys::free_temp_mem(pTriPnts);
+		return pNodes;
+	}
+
+	void release(Node* pNodes) {
+		if (pNodes) {
+			GWSys::free_rsrc_mem(pNodes);
+		}
+	}
+
+	bool rebuild(GWCollisionResource& cls, bool parallel) {
+		if (!cls.has_bvh()) { return false; }
+		int npol = cls.mNumPol;
+		GWVectorF* pMin = reinterpret_cast<GWVectorF*>(GWSys::alloc_temp_mem(npol * sizeof(GWVectorF) * 2));
+		GWVectorF* pMax = pMin + npol;
+		Node* pNodes = cls.get_bvh_top();
+		bool res = build_cls_nodes(pNodes, cls, pMin, pMax, parallel);
+		if (res) {
+			// keep the stored boxes in sync with the edited geometry
+			GWCollisionResource::Poly* pPols = cls.get_pols_top();
+			for (int i = 0; i < npol; ++i) {
+				pPols[i].mBBoxMin = pMin[i];
+				pPols[i].mBBoxMax = pMax[i];
+			}
+			cls.mBBoxMin = pNodes[0].mBBoxMin;
+			cls.mBBoxMax = pNodes[0].mBBoxMax;
+		}
+		GWSys::free_temp_mem(pMin);
+		return res;
+	}
+
+	GWCollisionResource* clone_with_bvh(const GWCollisionResource& cls, bool parallel) {
+		int npol = cls.mNumPol;
+		if (npol <= 0) { return nullptr; }
+		uint32_t offsBVH = uint32_t(GWBase::align(cls.mDataSize, 0x10));
+		uint32_t dataSize = offsBVH + uint32_t(calc_num_nodes(npol) * sizeof(Node));
+		size_t memSize = dataSize + sizeof(GWResource::Binding); // unaligned, as in GWResource::load
+		char* pMem = reinterpret_cast<char*>(GWSys::alloc_rsrc_mem(memSize));
+		std::memcpy(pMem, &cls, cls.mDataSize);
+		std::fill_n(pMem + cls.mDataSize, memSize - cls.mDataSize, 0);
+		GWCollisionResource* pCls = reinterpret_cast<GWCollisionResource*>(pMem);
+		pCls->mDataSize = dataSize;
+		pCls->mOffsBVH = int32_t(offsBVH);
+		if (!rebuild(*pCls, parallel)) {
+			GWSys::free_rsrc_mem(pMem);
+			return nullptr;
+		}
+		return pCls;
+	}
+
+	// Every leaf walks up towards the root; the first child to reach a node stops there,
+	// the second one finds both child boxes done, so each node is updated once and after its children.
+	template<typename LEAF_FUNC> static void refit_nodes(Node* pNodes, int nnodes, const LEAF_FUNC& leaf, bool parallel) {
+		int32_t* pParents = reinterpret_cast<int32_t*>(GWSys::alloc_temp_mem(nnodes * sizeof(int32_t)));
+		std::atomic<int32_t>* pVisits = reinterpret_cast<std::atomic<int32_t>*>(GWSys::alloc_temp_mem(nnodes * sizeof(std::atomic<int32_t>)));
+		pParents[0] = -1;
+		exec_range(nnodes, parallel, [&](int i0, int i1) {
+			for (int i = i0; i < i1; ++i) {
+				new (&pVisits[i]) std::atomic<int32_t>(0);
+				const Node& node = pNodes[i];
+				if (!node.is_leaf()) {
+					pParents[node.mLeft] = i;
+					pParents[node.mRight] = i;
+				}
+			}
+		});
+		exec_range(nnodes, parallel, [&](int i0, int i1) {
+			for (int i = i0; i < i1; ++i) {
+				Node& node = pNodes[i];
+				if (!node.is_leaf()) { continue; }
+				leaf(node.mLeft, node.mBBoxMin, node.mBBoxMax);
+				int32_t idx = pParents[i];
+				while (idx >= 0 && pVisits[idx].fetch_add(1, std::memory_order_acq_rel) > 0) {
+					Node& parent = pNodes[idx];
+					GWTuple::min(parent.mBBoxMin, pNodes[parent.mLeft].mBBoxMin, pNodes[parent.mRight].mBBoxMin);
+					GWTuple::max(parent.mBBoxMax, pNodes[parent.mLeft].mBBoxMax, pNodes[parent.mRight].mBBoxMax);
+					idx = pParents[idx];
+				}
+			}
+		});
+		GWSys::free_temp_mem(pVisits);
+		GWSys::free_temp_mem(pParents);
+	}
+
+	bool refit(Node* pNodes, int nnodes, const GWVectorF* pPrimMin, const GWVectorF* pPrimMax, bool parallel) {
+		if (pNodes == nullptr || pPrimMin == nullptr || pPrimMax == nullptr || nnodes <= 0) { return false; }
+		refit_nodes(pNodes, nnodes, [=](int32_t prim, GWVectorF& bbMin, GWVectorF& bbMax) {
+			bbMin = pPrimMin[prim];
+			bbMax = pPrimMax[prim];
+		}, parallel);
+		return true;
+	}
+
+	bool refit(GWCollisionResource& cls, bool parallel) {
+		if (!cls.has_bvh()) { return false; }
+		int npol = cls.mNumPol;
+		GWCollisionResource::Poly* pPols = cls.get_pols_top();
+		GWVectorF* pMin = reinterpret_cast<GWVectorF*>(GWSys::alloc_temp_mem(npol * sizeof(GWVectorF) * 2));
+		GWVectorF* pMax = pMin + npol;
+		calc_poly_bounds(cls, pMin, pMax, parallel);
+		exec_range(npol, parallel, [&](int i0, int i1) {
+			for (int i = i0; i < i1; ++i) {
+				pPols[i].mBBoxMin = pMin[i];
+				pPols[i].mBBoxMax = pMax[i];
+			}
+		});
+		Node* pNodes = cls.get_bvh_top();
+		bool res = refit(pNodes, cls.get_num_bvh_nodes(), pMin, pMax, parallel);
+		if (res) {
+			cls.mBBoxMin = pNodes[0].mBBoxMin;
+			cls.mBBoxMax = pNodes[0].mBBoxMax;
+		}
+		GWSys::free_temp_mem(pMin);
+		return res;
+	}
+
+	ModelBVH* ModelBVH::create(GWModelResource* pMdr, bool parallel) {
+		if (pMdr == nullptr || pMdr->mNumTri == 0 || pMdr->mNumPnt == 0) { return nullptr; }
+		uint32_t* pTriPnts = reinterpret_cast<uint32_t*>(GWSys::alloc_temp_mem(pMdr->mNumTri * 3 * sizeof(uint32_t)));
+		int ntri = gather_tri_pnts(*pMdr, pTriPnts);
+		if (ntri <= 0) {
+			GWSys::free_temp_mem(pTriPnts);
+			return nullptr;
+		}
+		uint32_t numPnt = pMdr->mNumPnt;
+		uint32_t numSph = pMdr->has_skin() ? pMdr->mNumSkinNodes : 0;
+		size_t memSz = GWBase::align(sizeof(ModelBVH), 0x10);
+		size_t offsNodes = memSz;
+		memSz += GWBase::align(calc_num_nodes(ntri) * sizeof(Node), 0x10);
+		size_t offsTriPnts = memSz;
+		memSz += GWBase::align(ntri * 3 * sizeof(uint32_t), 0x10);
+		size_t offsPnts = memSz;
+		memSz += GWBase::align(numPnt * sizeof(GWVectorF), 0x10);
+		size_t offsSph = memSz;
+		memSz += numSph * sizeof(GWSphereF) * 2;
+
+		uint8_t* pMem = reinterpret_cast<uint8_t*>(GWSys::alloc_rsrc_mem(memSz));
+		ModelBVH* pMBVH = reinterpret_cast<ModelBVH*>(pMem);
+		pMBVH->mpMdr = pMdr;
+		pMBVH->mNumTri = ntri;
+		pMBVH->mpNodes = reinterpret_cast<Node*>(pMem + offsNodes);
+		pMBVH->mpTriPnts = reinterpret_cast<uint32_t*>(pMem + offsTriPnts);
+		pMBVH->mpPnts = reinterpret_cast<GWVectorF*>(pMem + offsPnts);
+		std::copy_n(pTriPnts, ntri * 3, pMBVH->mpTriPnts);
+		GWSys::free_temp_mem(pTriPnts);
+		std::copy_n(reinterpret_cast<const GWVectorF*>(pMdr->get_pnt_ptr(0)), numPnt, pMBVH->mpPnts);
+		if (numSph > 0) {
+			pMBVH->mpRestSph = reinterpret_cast<GWSphereF*>(pMem + offsSph);
+			pMBVH->mpSph = pMBVH->mpRestSph + numSph;
+			pMdr->calc_skin_spheres_of_influence(pMBVH->mpRestSph);
+			std::copy_n(pMBVH->mpRestSph, numSph, pMBVH->mpSph);
+		} else {
+			pMBVH->mpRestSph = nullptr;
+			pMBVH->mpSph = nullptr;
+		}
+		// the topology comes from the bind pose and is kept through the refits
+		build_tri_nodes(pMBVH->mpNodes, pMBVH->mpTriPnts, pMBVH->mpPnts, ntri, parallel);
+		return pMBVH;
+	}
+
+	void ModelBVH::destroy(ModelBVH* pMBVH) {
+		if (pMBVH) {
+			GWSys::free_rsrc_mem(pMBVH);
+		}
+	}
+
+	void ModelBVH::update_spheres(const GWModel& mdl) {
+		if (mpSph) {
+			mdl.calc_posed_skin_spheres(mpRestSph, mpSph);
+		}
+	}
+
+	void ModelBVH::update(const GWModel& mdl, bool parallel) {
+		update_spheres(mdl);
+		exec_range(int(mpMdr->mNumPnt), parallel, [&](int i0, int i1) {
+			mdl.calc_posed_pnts(mpPnts, uint32_t(i0), uint32_t(i1 - i0));
+		});
+		refit(parallel);
+	}
+
+	void ModelBVH::refit(bool parallel) {
+		const uint32_t* pTriPnts = mpTriPnts;
+		const GWVectorF* pPnts = mpPnts;
+		refit_nodes(mpNodes, get_num_nodes(), [=](int32_t tri, GWVectorF& bbMin, GWVectorF& bbMax) {
+			calc_tri_bounds(&pTriPnts[tri * 3], pPnts, bbMin, bbMax);
+		}, parallel);
+	}
+
+	bool ModelBVH::calc_sphere_bounds(GWVectorF& bbMin, GWVectorF& bbMax) const {
+		int nsph = get_num_spheres();
+		if (nsph <= 0) { return false; }
+		bbMin.fill(FLT_MAX);
+		bbMax.fill(-FLT_MAX);
+		for (int i = 0; i < nsph; ++i) {
+			GWVectorF r(mpSph[i].r);
+			GWTuple::min(bbMin, bbMin, mpSph[i].c - r);
+			GWTuple::max(bbMax, bbMax, mpSph[i].c + r);
+		}
+		return true;
+	}
+}
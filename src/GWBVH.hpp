@@ -0,0 +1,67 @@
+/*
+ * Author: Gleb Novodran <novodran@gmail.com>
+ */
+
+// Binned SAH BVH builder producing the GWCollisionResource::BVHNode layout:
+// one primitive per leaf, 2n-1 nodes stored depth-first with the root at 0.
+namespace GWBVH {
+	typedef GWCollisionResource::BVHNode Node;
+
+	inline int calc_num_nodes(int nprim) { return nprim > 0 ? nprim * 2 - 1 : 0; }
+
+	// pNodes must hold calc_num_nodes(nprim) entries, leaves refer to primitives by their index in the input arrays.
+	// The result doesn't depend on the parallel flag or on the number of threads.
+	bool build(Node* pNodes, const GWVectorF* pPrimMin, const GWVectorF* pPrimMax, int nprim, bool parallel = true);
+
+	// Leaves refer to polygons; the returned array is to be freed with release().
+	Node* build(const GWCollisionResource& cls, bool parallel = true);
+	// Leaves refer to triangles, numbered through the materials in order.
+	Node* build(GWModelResource& mdr, bool parallel = true);
+	void release(Node* pNodes);
+
+	// Rebuilds the BVH stored in the resource, fails if the resource has none.
+	bool rebuild(GWCollisionResource& cls, bool parallel = true);
+	// Copy of the resource with a newly built BVH appended, to be released with GWResource::unload().
+	GWCollisionResource* clone_with_bvh(const GWCollisionResource& cls, bool parallel = true);
+
+	// Recomputes the node boxes from new primitive bounds keeping the topology, the boxes are propagated
+	// bottom-up in parallel. Any node order with the root at 0 is accepted, including the exported BVHs.
+	bool refit(Node* pNodes, int nnodes, const GWVectorF* pPrimMin, const GWVectorF* pPrimMax, bool parallel = true);
+	// Refits the BVH stored in the resource to its edited points, poly boxes and the resource bbox are updated too.
+	bool refit(GWCollisionResource& cls, bool parallel = true);
+
+	// Triangle BVH of a model instance. The topology is built once from the bind pose,
+	// then the nodes are refitted to the deformed points instead of being rebuilt every frame.
+	// The posed skin spheres of influence give a cheap conservative bound for each joint.
+	class ModelBVH {
+	private:
+		ModelBVH() {}
+
+	public:
+		GWModelResource* mpMdr;
+		Node* mpNodes;
+		uint32_t* mpTriPnts; // 3 point indices per triangle, triangles are numbered through the materials in order
+		GWVectorF* mpPnts; // current points, one per resource point
+		GWSphereF* mpRestSph; // bind pose spheres, one per skin node; nullptr for models without skin
+		GWSphereF* mpSph; // spheres posed by the last update
+		int32_t mNumTri;
+
+		int get_num_nodes() const { return calc_num_nodes(mNumTri); }
+		const uint32_t* get_tri_pnt_indices(int triIdx) const { return &mpTriPnts[triIdx * 3]; }
+		bool has_spheres() const { return mpSph != nullptr; }
+		int get_num_spheres() const { return mpSph ? int(mpMdr->mNumSkinNodes) : 0; }
+
+		// Poses the spheres only, cheap enough for every instance on every frame.
+		void update_spheres(const GWModel& mdl);
+		// Poses the points and the spheres with the current model transforms and refits the nodes.
+		void update(const GWModel& mdl, bool parallel = true);
+		// Refits the nodes to mpPnts, for points deformed by other means.
+		void refit(bool parallel = true);
+		// Box of the posed spheres; it encloses the whole deformed mesh as long as all points are skinned.
+		bool calc_sphere_bounds(GWVectorF& bbMin, GWVectorF& bbMax) const;
+
+		// returns nullptr if the model has no triangles
+		static ModelBVH* create(GWModelResource* pMdr, bool parallel = true);
+		static void destroy(ModelBVH* pMBVH);
+	};
+}
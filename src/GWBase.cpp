@@ -5,6 +5,7 @@
 
 #include "GWSys.hpp"
 #include "GWBase.hpp"
+#include "GWTask.hpp"
 
 namespace GWBase {
 	const long double pi = ::acos((long double)-1);
@@ -87,6 +88,490 @@ namespace GWBase {
 		vx = v.x; vy = v.y; vz = v.z;
 	}
 
+	// func(pOut0, pOut1, x) on GWLane::WIDTH values at a time, either output may be null.
+	// The tail goes through a padded block, so every element sees the lane code.
+	template<typename FUNC_T> static void exec_lanes(float* pDst0, float* pDst1, const float* pSrc, int n, const FUNC_T& func) {
+		int i = 0;
+		for (; i + GWLane::WIDTH <= n; i += GWLane::WIDTH) {
+			func(pDst0 ? &pDst0[i] : nullptr, pDst1 ? &pDst1[i] : nullptr, GWLane::load(&pSrc[i]));
+		}
+		if (i < n) {
+			float src[GWLane::WIDTH];
+			float dst0[GWLane::WIDTH];
+			float dst1[GWLane::WIDTH];
+			std::fill_n(src, GWLane::WIDTH, 1.0f);
+			std::copy(&pSrc[i], &pSrc[n], src);
+			func(dst0, dst1, GWLane::load(src));
+			if (pDst0) { std::copy(dst0, dst0 + (n - i), &pDst0[i]); }
+			if (pDst1) { std::copy(dst1, dst1 + (n - i), &pDst1[i]); }
+		}
+	}
+
+	template<GWMathTier TIER> static void sincos_lanes(float* pSin, float* pCos, const float* pSrc, int n) {
+		exec_lanes(pSin, pCos, pSrc, n, [](float* pOutS, float* pOutC, GWLane::F x) {
+			GWLane::F s, c;
+			sincos_approx<TIER>(x, s, c);
+			if (pOutS) { GWLane::store(pOutS, s); }
+			if (pOutC) { GWLane::store(pOutC, c); }
+		});
+	}
+
+	void approx_sincos(float* pSin, float* pCos, const float* pSrc, int n, GWMathTier tier) {
+		switch (tier) {
+		case GWMathTier::FAST: sincos_lanes<GWMathTier::FAST>(pSin, pCos, pSrc, n); break;
+		case GWMathTier::COARSE: sincos_lanes<GWMathTier::COARSE>(pSin, pCos, pSrc, n); break;
+		default:
+			for (int i = 0; i < n; ++i) {
+				float x = pSrc[i];
+				if (pSin) { pSin[i] = ::sinf(x); }
+				if (pCos) { pCos[i] = ::cosf(x); }
+			}
+			break;
+		}
+	}
+
+	void approx_sin(float* pDst, const float* pSrc, int n, GWMathTier tier) {
+		approx_sincos(pDst, nullptr, pSrc, n, tier);
+	}
+
+	void approx_cos(float* pDst, const float* pSrc, int n, GWMathTier tier) {
+		approx_sincos(nullptr, pDst, pSrc, n, tier);
+	}
+
+	void approx_exp(float* pDst, const float* pSrc, int n, GWMathTier tier) {
+		switch (tier) {
+		case GWMathTier::FAST:
+			exec_lanes(pDst, nullptr, pSrc, n, [](float* pOut, float*, GWLane::F x) { GWLane::store(pOut, exp_approx<GWMathTier::FAST>(x)); });
+			break;
+		case GWMathTier::COARSE:
+			exec_lanes(pDst, nullptr, pSrc, n, [](float* pOut, float*, GWLane::F x) { GWLane::store(pOut, exp_approx<GWMathTier::COARSE>(x)); });
+			break;
+		default:
+			for (int i = 0; i < n; ++i) { pDst[i] = ::expf(pSrc[i]); }
+			break;
+		}
+	}
+
+	void approx_log(float* pDst, const float* pSrc, int n, GWMathTier tier) {
+		switch (tier) {
+		case GWMathTier::FAST:
+			exec_lanes(pDst, nullptr, pSrc, n, [](float* pOut, float*, GWLane::F x) { GWLane::store(pOut, log_approx<GWMathTier::FAST>(x)); });
+			break;
+		case GWMathTier::COARSE:
+			exec_lanes(pDst, nullptr, pSrc, n, [](float* pOut, float*, GWLane::F x) { GWLane::store(pOut, log_approx<GWMathTier::COARSE>(x)); });
+			break;
+		default:
+			for (int i = 0; i < n; ++i) { pDst[i] = ::logf(pSrc[i]); }
+			break;
+		}
+	}
+
+	void approx_pow(float* pDst, const float* pSrc, float y, int n, GWMathTier tier) {
+		switch (tier) {
+		case GWMathTier::FAST:
+			exec_lanes(pDst, nullptr, pSrc, n, [y](float* pOut, float*, GWLane::F x) { GWLane::store(pOut, pow_approx<GWMathTier::FAST>(x, GWLane::F(y))); });
+			break;
+		case GWMathTier::COARSE:
+			exec_lanes(pDst, nullptr, pSrc, n, [y](float* pOut, float*, GWLane::F x) { GWLane::store(pOut, pow_approx<GWMathTier::COARSE>(x, GWLane::F(y))); });
+			break;
+		default:
+			for (int i = 0; i < n; ++i) { pDst[i] = ::powf(pSrc[i], y); }
+			break;
+		}
+	}
+
+	void approx_acos(float* pDst, const float* pSrc, int n, GWMathTier tier) {
+		switch (tier) {
+		case GWMathTier::FAST:
+			exec_lanes(pDst, nullptr, pSrc, n, [](float* pOut, float*, GWLane::F x) { GWLane::store(pOut, acos_approx<GWMathTier::FAST>(x)); });
+			break;
+		case GWMathTier::COARSE:
+			exec_lanes(pDst, nullptr, pSrc, n, [](float* pOut, float*, GWLane::F x) { GWLane::store(pOut, acos_approx<GWMathTier::COARSE>(x)); });
+			break;
+		default:
+			for (int i = 0; i < n; ++i) { pDst[i] = ::acosf(pSrc[i]); }
+			break;
+		}
+	}
+
+	// items handed out as one piece of work by the reductions
+	static const int REDUCE_CHUNK = 0x4000;
+
+	struct ReducePart {
+		float mMin[4];
+		float mMax[4];
+		int32_t mMinIdx[4];
+		int32_t mMaxIdx[4];
+	};
+
+	// Calls func(part, i0, i1) per chunk of items, the serial run goes through the same code.
+	// A single chunk or a serial run doesn't touch GWTask, so small inputs don't start the worker pool.
+	template<typename FUNC_T> static ReducePart* exec_reduce(int num, bool parallel, ReducePart* pLocal, int& nchunks, const FUNC_T& func) {
+		nchunks = (num + REDUCE_CHUNK - 1) / REDUCE_CHUNK;
+		ReducePart* pParts = nchunks > 1 ? reinterpret_cast<ReducePart*>(GWSys::alloc_temp_mem(nchunks * sizeof(ReducePart))) : pLocal;
+		auto exec = [&](int c0, int c1) {
+			for (int c = c0; c < c1; ++c) {
+				func(pParts[c], c * REDUCE_CHUNK, std::min((c + 1) * REDUCE_CHUNK, num));
+			}
+		};
+		if (parallel && nchunks > 1) {
+			GWTask::parallel_for(nchunks, exec, 1);
+		} else {
+			exec(0, nchunks);
+		}
+		return pParts;
+	}
+
+	// The flat array is scanned by periods of lcm(ncomp, WIDTH) floats, a GWLane accumulator per WIDTH floats
+	// of the period; the float j of a period belongs to the component j % ncomp.
+	static int calc_period(int ncomp) {
+		int per = ncomp;
+		while (per % GWLane::WIDTH) { per += ncomp; }
+		return per;
+	}
+
+	static void range_chunk(ReducePart& part, const float* pSrc, int i0, int i1, int ncomp) {
+		const float* pData = &pSrc[i0 * ncomp];
+		int nflt = (i1 - i0) * ncomp;
+		int per = calc_period(ncomp);
+		int nacc = per / GWLane::WIDTH;
+		int nper = nflt / per;
+		std::copy(pData, pData + ncomp, part.mMin);
+		std::copy(pData, pData + ncomp, part.mMax);
+		if (nper > 0) {
+			GWLane::F vmin[4];
+			GWLane::F vmax[4];
+			for (int a = 0; a < nacc; ++a) {
+				vmin[a] = GWLane::load(&pData[a * GWLane::WIDTH]);
+				vmax[a] = vmin[a];
+			}
+			for (int k = 1; k < nper; ++k) {
+				const float* pPer = &pData[k * per];
+				for (int a = 0; a < nacc; ++a) {
+					GWLane::F v = GWLane::load(&pPer[a * GWLane::WIDTH]);
+					vmin[a] = GWLane::min(vmin[a], v);
+					vmax[a] = GWLane::max(vmax[a], v);
+				}
+			}
+			float lmin[4 * GWLane::WIDTH];
+			float lmax[4 * GWLane::WIDTH];
+			for (int a = 0; a < nacc; ++a) {
+				GWLane::store(&lmin[a * GWLane::WIDTH], vmin[a]);
+				GWLane::store(&lmax[a * GWLane::WIDTH], vmax[a]);
+			}
+			for (int j = 0; j < per; ++j) {
+				part.mMin[j % ncomp] = std::min(part.mMin[j % ncomp], lmin[j]);
+				part.mMax[j % ncomp] = std::max(part.mMax[j % ncomp], lmax[j]);
+			}
+		}
+		for (int j = nper * per; j < nflt; ++j) {
+			part.mMin[j % ncomp] = std::min(part.mMin[j % ncomp], pData[j]);
+			part.mMax[j % ncomp] = std::max(part.mMax[j % ncomp], pData[j]);
+		}
+	}
+
+	void calc_range(float* pMin, float* pMax, const float* pSrc, int num, int ncomp, bool parallel) {
+		if (num <= 0) { return; }
+		ReducePart local;
+		int nchunks = 0;
+		ReducePart* pParts = exec_reduce(num, parallel, &local, nchunks, [pSrc, ncomp](ReducePart& part, int i0, int i1) {
+			range_chunk(part, pSrc, i0, i1, ncomp);
+		});
+		std::copy(pParts[0].mMin, pParts[0].mMin + ncomp, pMin);
+		std::copy(pParts[0].mMax, pParts[0].mMax + ncomp, pMax);
+		for (int c = 1; c < nchunks; ++c) {
+			for (int i = 0; i < ncomp; ++i) {
+				pMin[i] = std::min(pMin[i], pParts[c].mMin[i]);
+				pMax[i] = std::max(pMax[i], pParts[c].mMax[i]);
+			}
+		}
+		if (pParts != &local) { GWSys::free_temp_mem(pParts); }
+	}
+
+	// Per accumulator lane the first smallest and largest value and the period where it was seen, the lanes are
+	// merged preferring the lower item index on equal values.
+	static void extremes_chunk(ReducePart& part, const float* pSrc, int i0, int i1, int ncomp) {
+		const float* pData = &pSrc[i0 * ncomp];
+		int nflt = (i1 - i0) * ncomp;
+		int per = calc_period(ncomp);
+		int nacc = per / GWLane::WIDTH;
+		int nper = nflt / per;
+		std::copy(pData, pData + ncomp, part.mMin);
+		std::copy(pData, pData + ncomp, part.mMax);
+		std::fill_n(part.mMinIdx, ncomp, i0);
+		std::fill_n(part.mMaxIdx, ncomp, i0);
+		if (nper > 0) {
+			GWLane::F vmin[4];
+			GWLane::F vmax[4];
+			GWLane::F pmin[4];
+			GWLane::F pmax[4];
+			for (int a = 0; a < nacc; ++a) {
+				vmin[a] = GWLane::load(&pData[a * GWLane::WIDTH]);
+				vmax[a] = vmin[a];
+				pmin[a] = GWLane::F(0.0f);
+				pmax[a] = GWLane::F(0.0f);
+			}
+			for (int k = 1; k < nper; ++k) {
+				const float* pPer = &pData[k * per];
+				GWLane::F vk = GWLane::F(float(k));
+				for (int a = 0; a < nacc; ++a) {
+					GWLane::F v = GWLane::load(&pPer[a * GWLane::WIDTH]);
+					auto lt = v < vmin[a];
+					auto gt = v > vmax[a];
+					vmin[a] = GWLane::sel(lt, v, vmin[a]);
+					pmin[a] = GWLane::sel(lt, vk, pmin[a]);
+					vmax[a] = GWLane::sel(gt, v, vmax[a]);
+					pmax[a] = GWLane::sel(gt, vk, pmax[a]);
+				}
+			}
+			float lval[2][4 * GWLane::WIDTH];
+			float lper[2][4 * GWLane::WIDTH];
+			for (int a = 0; a < nacc; ++a) {
+				GWLane::store(&lval[0][a * GWLane::WIDTH], vmin[a]);
+				GWLane::store(&lval[1][a * GWLane::WIDTH], vmax[a]);
+				GWLane::store(&lper[0][a * GWLane::WIDTH], pmin[a]);
+				GWLane::store(&lper[1][a * GWLane::WIDTH], pmax[a]);
+			}
+			int itemsPerPeriod = per / ncomp;
+			for (int j = 0; j < per; ++j) {
+				int comp = j % ncomp;
+				int idx = i0 + int(lper[0][j]) * itemsPerPeriod + j / ncomp;
+				if (lval[0][j] < part.mMin[comp] || (lval[0][j] == part.mMin[comp] && idx < part.mMinIdx[comp])) {
+					part.mMin[comp] = lval[0][j];
+					part.mMinIdx[comp] = idx;
+				}
+				idx = i0 + int(lper[1][j]) * itemsPerPeriod + j / ncomp;
+				if (lval[1][j] > part.mMax[comp] || (lval[1][j] == part.mMax[comp] && idx < part.mMaxIdx[comp])) {
+					part.mMax[comp] = lval[1][j];
+					part.mMaxIdx[comp] = idx;
+				}
+			}
+		}
+		for (int j = nper * per; j < nflt; ++j) {
+			int comp = j % ncomp;
+			if (pData[j] < part.mMin[comp]) {
+				part.mMin[comp] = pData[j];
+				part.mMinIdx[comp] = i0 + j / ncomp;
+			}
+			if (pData[j] > part.mMax[comp]) {
+				part.mMax[comp] = pData[j];
+				part.mMaxIdx[comp] = i0 + j / ncomp;
+			}
+		}
+	}
+
+	void calc_extremes(int* pMinIdx, int* pMaxIdx, const float* pSrc, int num, int ncomp, bool parallel) {
+		if (num <= 0) { return; }
+		ReducePart local;
+		int nchunks = 0;
+		ReducePart* pParts = exec_reduce(num, parallel, &local, nchunks, [pSrc, ncomp](ReducePart& part, int i0, int i1) {
+			extremes_chunk(part, pSrc, i0, i1, ncomp);
+		});
+		// the chunks come in the order of the items, so the first of equal values wins
+		for (int i = 0; i < ncomp; ++i) {
+			int cmin = 0;
+			int cmax = 0;
+			for (int c = 1; c < nchunks; ++c) {
+				if (pParts[c].mMin[i] < pParts[cmin].mMin[i]) { cmin = c; }
+				if (pParts[c].mMax[i] > pParts[cmax].mMax[i]) { cmax = c; }
+			}
+			pMinIdx[i] = pParts[cmin].mMinIdx[i];
+			pMaxIdx[i] = pParts[cmax].mMaxIdx[i];
+		}
+		if (pParts != &local) { GWSys::free_temp_mem(pParts); }
+	}
+
+	// Points are gathered GWLane::WIDTH at a time, the last group is padded with its last point.
+	static float max_dist_sq_chunk(const float* pPnts, int i0, int i1, const float* pCenter) {
+		GWLane::F cx(pCenter[0]);
+		GWLane::F cy(pCenter[1]);
+		GWLane::F cz(pCenter[2]);
+		GWLane::F vmax(0.0f);
+		for (int i = i0; i < i1; i += GWLane::WIDTH) {
+			float xyz[3][GWLane::WIDTH];
+			for (int k = 0; k < GWLane::WIDTH; ++k) {
+				const float* pPnt = &pPnts[std::min(i + k, i1 - 1) * 3];
+				xyz[0][k] = pPnt[0];
+				xyz[1][k] = pPnt[1];
+				xyz[2][k] = pPnt[2];
+			}
+			GWLane::F dx = GWLane::load(xyz[0]) - cx;
+			GWLane::F dy = GWLane::load(xyz[1]) - cy;
+			GWLane::F dz = GWLane::load(xyz[2]) - cz;
+			vmax = GWLane::max(vmax, dx * dx + dy * dy + dz * dz);
+		}
+		float lmax[GWLane::WIDTH];
+		GWLane::store(lmax, vmax);
+		return *std::max_element(lmax, lmax + GWLane::WIDTH);
+	}
+
+	float calc_max_dist_sq(const float* pPnts, int num, const float* pCenter, bool parallel) {
+		if (num <= 0) { return 0.0f; }
+		ReducePart local;
+		int nchunks = 0;
+		ReducePart* pParts = exec_reduce(num, parallel, &local, nchunks, [pPnts, pCenter](ReducePart& part, int i0, int i1) {
+			part.mMax[0] = max_dist_sq_chunk(pPnts, i0, i1, pCenter);
+		});
+		float res = 0.0f;
+		for (int c = 0; c < nchunks; ++c) {
+			res = std::max(res, pParts[c].mMax[0]);
+		}
+		if (pParts != &local) { GWSys::free_temp_mem(pParts); }
+		return res;
+	}
+
+	static const uint32_t PHILOX_M0 = 0xD2511F53;
+	static const uint32_t PHILOX_M1 = 0xCD9E8D57;
+	static const uint32_t PHILOX_W0 = 0x9E3779B9;
+	static const uint32_t PHILOX_W1 = 0xBB67AE85;
+	static const int PHILOX_ROUNDS = 10;
+
+	void Philox::gen_block(uint32_t* pDst, const uint32_t ctr[4], const uint32_t key[2]) {
+		uint32_t c0 = ctr[0];
+		uint32_t c1 = ctr[1];
+		uint32_t c2 = ctr[2];
+		uint32_t c3 = ctr[3];
+		uint32_t k0 = key[0];
+		uint32_t k1 = key[1];
+		for (int r = 0; r < PHILOX_ROUNDS; ++r) {
+			uint64_t p0 = uint64_t(PHILOX_M0) * c0;
+			uint64_t p1 = uint64_t(PHILOX_M1) * c2;
+			c0 = uint32_t(p1 >> 32) ^ c1 ^ k0;
+			c1 = uint32_t(p1);
+			c2 = uint32_t(p0 >> 32) ^ c3 ^ k1;
+			c3 = uint32_t(p0);
+			k0 += PHILOX_W0;
+			k1 += PHILOX_W1;
+		}
+		pDst[0] = c0;
+		pDst[1] = c1;
+		pDst[2] = c2;
+		pDst[3] = c3;
+	}
+
+#if defined(GW_SIMD_SSE)
+	GW_FORCEINLINE static void philox_mulhilo(__m128i a, __m128i m, __m128i& hi, __m128i& lo) {
+		__m128i even = _mm_mul_epu32(a, m);
+		__m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), m);
+		__m128i lowMask = _mm_set_epi32(0, -1, 0, -1);
+		lo = _mm_or_si128(_mm_and_si128(even, lowMask), _mm_slli_epi64(odd, 32));
+		hi = _mm_or_si128(_mm_srli_epi64(even, 32), _mm_andnot_si128(lowMask, odd));
+	}
+
+	// 4 consecutive blocks side by side, word i of every block in c[i]; stored as the scalar blocks would be.
+	static void philox_gen_x4(uint32_t* pDst, const uint32_t ctr[4], const uint32_t key[2]) {
+		uint32_t lo[4];
+		uint32_t hi[4];
+		for (int i = 0; i < 4; ++i) {
+			lo[i] = ctr[0] + uint32_t(i);
+			hi[i] = ctr[1] + (lo[i] < ctr[0] ? 1 : 0);
+		}
+		__m128i c0 = _mm_loadu_si128((const __m128i*)lo);
+		__m128i c1 = _mm_loadu_si128((const __m128i*)hi);
+		__m128i c2 = _mm_set1_epi32(int32_t(ctr[2]));
+		__m128i c3 = _mm_set1_epi32(int32_t(ctr[3]));
+		__m128i k0 = _mm_set1_epi32(int32_t(key[0]));
+		__m128i k1 = _mm_set1_epi32(int32_t(key[1]));
+		__m128i m0 = _mm_set1_epi32(int32_t(PHILOX_M0));
+		__m128i m1 = _mm_set1_epi32(int32_t(PHILOX_M1));
+		__m128i w0 = _mm_set1_epi32(int32_t(PHILOX_W0));
+		__m128i w1 = _mm_set1_epi32(int32_t(PHILOX_W1));
+		for (int r = 0; r < PHILOX_ROUNDS; ++r) {
+			__m128i hi0, lo0, hi1, lo1;
+			philox_mulhilo(c0, m0, hi0, lo0);
+			philox_mulhilo(c2, m1, hi1, lo1);
+			c0 = _mm_xor_si128(_mm_xor_si128(hi1, c1), k0);
+			c1 = lo1;
+			c2 = _mm_xor_si128(_mm_xor_si128(hi0, c3), k1);
+			c3 = lo0;
+			k0 = _mm_add_epi32(k0, w0);
+			k1 = _mm_add_epi32(k1, w1);
+		}
+		__m128i t0 = _mm_unpacklo_epi32(c0, c1);
+		__m128i t1 = _mm_unpacklo_epi32(c2, c3);
+		__m128i t2 = _mm_unpackhi_epi32(c0, c1);
+		__m128i t3 = _mm_unpackhi_epi32(c2, c3);
+		_mm_storeu_si128((__m128i*)pDst, _mm_unpacklo_epi64(t0, t1));
+		_mm_storeu_si128((__m128i*)(pDst + 4), _mm_unpackhi_epi64(t0, t1));
+		_mm_storeu_si128((__m128i*)(pDst + 8), _mm_unpacklo_epi64(t2, t3));
+		_mm_storeu_si128((__m128i*)(pDst + 12), _mm_unpackhi_epi64(t2, t3));
+	}
+#endif
+
+	void Philox::fill_u32(uint32_t* pDst, int num) {
+		mIdx = BLOCK_SIZE;
+		int i = 0;
+#if defined(GW_SIMD_SSE)
+		for (; i + BLOCK_SIZE * 4 <= num; i += BLOCK_SIZE * 4) {
+			philox_gen_x4(&pDst[i], mCtr, mKey);
+			seek(get_block() + 4);
+		}
+#endif
+		for (; i + BLOCK_SIZE <= num; i += BLOCK_SIZE) {
+			gen_block(&pDst[i], mCtr, mKey);
+			seek(get_block() + 1);
+		}
+		if (i < num) {
+			uint32_t blk[BLOCK_SIZE];
+			gen_block(blk, mCtr, mKey);
+			seek(get_block() + 1);
+			std::copy(blk, blk + (num - i), &pDst[i]);
+		}
+	}
+
+	void Philox::fill_f01(float* pDst, int num) {
+		uint32_t* pBits = reinterpret_cast<uint32_t*>(pDst);
+		fill_u32(pBits, num);
+		for (int i = 0; i < num; ++i) {
+			pDst[i] = float(pBits[i] >> 8) * (1.0f / 16777216.0f);
+		}
+	}
+
+	// Chunks of pairs mapped a GWLane at a time, u and v come in the same order as from the dir_* calls.
+	template<typename FUNC_T> static void fill_dirs(Philox& rnd, float* pDst, int num, const FUNC_T& func) {
+		const int CHUNK = 0x100;
+		float uv[CHUNK * 2];
+		float u[CHUNK];
+		float v[CHUNK];
+		float xyz[3][CHUNK];
+		for (int org = 0; org < num; org += CHUNK) {
+			int cnt = std::min(CHUNK, num - org);
+			rnd.fill_f01(uv, cnt * 2);
+			for (int i = 0; i < cnt; ++i) {
+				u[i] = uv[i * 2];
+				v[i] = uv[i * 2 + 1];
+			}
+			int npad = (cnt + GWLane::WIDTH - 1) / GWLane::WIDTH * GWLane::WIDTH;
+			std::fill(u + cnt, u + npad, 0.0f);
+			std::fill(v + cnt, v + npad, 0.0f);
+			for (int i = 0; i < npad; i += GWLane::WIDTH) {
+				GWLane::F x, y, z;
+				func(GWLane::load(&u[i]), GWLane::load(&v[i]), x, y, z);
+				GWLane::store(&xyz[0][i], x);
+				GWLane::store(&xyz[1][i], y);
+				GWLane::store(&xyz[2][i], z);
+			}
+			float* pOut = &pDst[org * 3];
+			for (int i = 0; i < cnt; ++i) {
+				pOut[i * 3] = xyz[0][i];
+				pOut[i * 3 + 1] = xyz[1][i];
+				pOut[i * 3 + 2] = xyz[2][i];
+			}
+		}
+	}
+
+	void Philox::fill_sphere(float* pDst, int num) {
+		fill_dirs(*this, pDst, num, [](GWLane::F u, GWLane::F v, GWLane::F& x, GWLane::F& y, GWLane::F& z) { sample_sphere(u, v, x, y, z); });
+	}
+
+	void Philox::fill_hemisphere(float* pDst, int num) {
+		fill_dirs(*this, pDst, num, [](GWLane::F u, GWLane::F v, GWLane::F& x, GWLane::F& y, GWLane::F& z) { sample_hemisphere(u, v, x, y, z); });
+	}
+
+	void Philox::fill_cosine(float* pDst, int num) {
+		fill_dirs(*this, pDst, num, [](GWLane::F u, GWLane::F v, GWLane::F& x, GWLane::F& y, GWLane::F& z) { sample_cosine(u, v, x, y, z); });
+	}
+
 	// http://www.isthe.com/chongo/tech/comp/fnv/index.html
 	void StrHash::calculate(const char* pStr) {
 		len = 0;
@@ -27,6 +27,16 @@
 #	endif
 #endif
 
+#ifndef GW_NO_SIMD
+#	if defined(__AVX__)
+#		define GW_SIMD_AVX
+#	endif
+#	if defined(__AVX__) || defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#		define GW_SIMD_SSE
+#		include <immintrin.h>
+#	endif
+#endif
+
 enum class GWTransformOrder : uint8_t {
 	SRT = 0,
 	STR = 1,
@@ -63,6 +73,177 @@ enum class GWTrackKind : uint8_t {
 	MAX = SCL,
 };
 
+// Accuracy of the approximate math functions, FULL is the C library.
+enum class GWMathTier : uint8_t {
+	FULL = 0,
+	FAST = 1, // ~1e-6 relative
+	COARSE = 2 // ~1e-3 relative
+};
+
+// Float lanes of the widest enabled instruction set. Kernels written against these operations as templates
+// also take plain floats, the masks are then bools.
+namespace GWLane {
+#if defined(GW_SIMD_AVX)
+	static const int WIDTH = 8;
+	struct F {
+		__m256 v;
+		F() = default;
+		F(__m256 x) : v(x) {}
+		F(float x) : v(_mm256_set1_ps(x)) {}
+	};
+	GW_FORCEINLINE F load(const float* p) { return _mm256_loadu_ps(p); }
+	GW_FORCEINLINE void store(float* p, F a) { _mm256_storeu_ps(p, a.v); }
+	GW_FORCEINLINE F operator + (F a, F b) { return _mm256_add_ps(a.v, b.v); }
+	GW_FORCEINLINE F operator - (F a, F b) { return _mm256_sub_ps(a.v, b.v); }
+	GW_FORCEINLINE F operator * (F a, F b) { return _mm256_mul_ps(a.v, b.v); }
+	GW_FORCEINLINE F operator / (F a, F b) { return _mm256_div_ps(a.v, b.v); }
+	GW_FORCEINLINE F operator - (F a) { return _mm256_xor_ps(a.v, _mm256_set1_ps(-0.0f)); }
+	GW_FORCEINLINE F operator < (F a, F b) { return _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ); }
+	GW_FORCEINLINE F operator > (F a, F b) { return _mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ); }
+	GW_FORCEINLINE F operator <= (F a, F b) { return _mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ); }
+	GW_FORCEINLINE F operator == (F a, F b) { return _mm256_cmp_ps(a.v, b.v, _CMP_EQ_OQ); }
+	GW_FORCEINLINE F mask_and(F a, F b) { return _mm256_and_ps(a.v, b.v); }
+	GW_FORCEINLINE bool any(F mask) { return _mm256_movemask_ps(mask.v) != 0; }
+	// GCC scalarizes blendv on compare masks without AVX2
+	GW_FORCEINLINE F sel(F mask, F a, F b) { return _mm256_or_ps(_mm256_and_ps(mask.v, a.v), _mm256_andnot_ps(mask.v, b.v)); }
+	GW_FORCEINLINE F neg_if(F mask, F a) { return _mm256_xor_ps(a.v, _mm256_and_ps(mask.v, _mm256_set1_ps(-0.0f))); }
+	GW_FORCEINLINE F sqrt(F a) { return _mm256_sqrt_ps(a.v); }
+	GW_FORCEINLINE F abs(F a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v); }
+	GW_FORCEINLINE F min(F a, F b) { return _mm256_min_ps(a.v, b.v); }
+	GW_FORCEINLINE F max(F a, F b) { return _mm256_max_ps(a.v, b.v); }
+	GW_FORCEINLINE F round(F a) { return _mm256_round_ps(a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+	// 2^n for integral n in [-126, 127]
+	GW_FORCEINLINE F exp2i(F n) {
+		__m128i bias = _mm_set1_epi32(127);
+		__m128i lo = _mm_slli_epi32(_mm_add_epi32(_mm_cvtps_epi32(_mm256_castps256_ps128(n.v)), bias), 23);
+		__m128i hi = _mm_slli_epi32(_mm_add_epi32(_mm_cvtps_epi32(_mm256_extractf128_ps(n.v, 1)), bias), 23);
+		return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_castsi128_ps(lo)), _mm_castsi128_ps(hi), 1);
+	}
+	// x = m * 2^e, m in [1, 2) for positive normal x
+	GW_FORCEINLINE F frexp(F x, F& e) {
+		__m128i mmask = _mm_set1_epi32(0x007FFFFF);
+		__m128i one = _mm_set1_epi32(0x3F800000);
+		__m128i lo = _mm_castps_si128(_mm256_castps256_ps128(x.v));
+		__m128i hi = _mm_castps_si128(_mm256_extractf128_ps(x.v, 1));
+		__m128 elo = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(lo, 23), _mm_set1_epi32(127)));
+		__m128 ehi = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(hi, 23), _mm_set1_epi32(127)));
+		e = _mm256_insertf128_ps(_mm256_castps128_ps256(elo), ehi, 1);
+		__m128 mlo = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(lo, mmask), one));
+		__m128 mhi = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(hi, mmask), one));
+		return _mm256_insertf128_ps(_mm256_castps128_ps256(mlo), mhi, 1);
+	}
+#elif defined(GW_SIMD_SSE)
+	static const int WIDTH = 4;
+	struct F {
+		__m128 v;
+		F() = default;
+		F(__m128 x) : v(x) {}
+		F(float x) : v(_mm_set1_ps(x)) {}
+	};
+	GW_FORCEINLINE F load(const float* p) { return _mm_loadu_ps(p); }
+	GW_FORCEINLINE void store(float* p, F a) { _mm_storeu_ps(p, a.v); }
+	GW_FORCEINLINE F operator + (F a, F b) { return _mm_add_ps(a.v, b.v); }
+	GW_FORCEINLINE F operator - (F a, F b) { return _mm_sub_ps(a.v, b.v); }
+	GW_FORCEINLINE F operator * (F a, F b) { return _mm_mul_ps(a.v, b.v); }
+	GW_FORCEINLINE F operator / (F a, F b) { return _mm_div_ps(a.v, b.v); }
+	GW_FORCEINLINE F operator - (F a) { return _mm_xor_ps(a.v, _mm_set1_ps(-0.0f)); }
+	GW_FORCEINLINE F operator < (F a, F b) { return _mm_cmplt_ps(a.v, b.v); }
+	GW_FORCEINLINE F operator > (F a, F b) { return _mm_cmpgt_ps(a.v, b.v); }
+	GW_FORCEINLINE F operator <= (F a, F b) { return _mm_cmple_ps(a.v, b.v); }
+	GW_FORCEINLINE F operator == (F a, F b) { return _mm_cmpeq_ps(a.v, b.v); }
+	GW_FORCEINLINE F mask_and(F a, F b) { return _mm_and_ps(a.v, b.v); }
+	GW_FORCEINLINE bool any(F mask) { return _mm_movemask_ps(mask.v) != 0; }
+	GW_FORCEINLINE F sel(F mask, F a, F b) { return _mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v)); }
+	GW_FORCEINLINE F neg_if(F mask, F a) { return _mm_xor_ps(a.v, _mm_and_ps(mask.v, _mm_set1_ps(-0.0f))); }
+	GW_FORCEINLINE F sqrt(F a) { return _mm_sqrt_ps(a.v); }
+	GW_FORCEINLINE F abs(F a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a.v); }
+	GW_FORCEINLINE F min(F a, F b) { return _mm_min_ps(a.v, b.v); }
+	GW_FORCEINLINE F max(F a, F b) { return _mm_max_ps(a.v, b.v); }
+	// SSE2 has no rounding instruction, the conversion rounds to nearest
+	GW_FORCEINLINE F round(F a) { return _mm_cvtepi32_ps(_mm_cvtps_epi32(a.v)); }
+	GW_FORCEINLINE F exp2i(F n) {
+		return _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(_mm_cvtps_epi32(n.v), _mm_set1_epi32(127)), 23));
+	}
+	GW_FORCEINLINE F frexp(F x, F& e) {
+		__m128i bits = _mm_castps_si128(x.v);
+		e = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(127)));
+		return _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x007FFFFF)), _mm_set1_epi32(0x3F800000)));
+	}
+#else
+	static const int WIDTH = 1;
+	struct F {
+		float v;
+		F() = default;
+		F(float x) : v(x) {}
+	};
+	GW_FORCEINLINE F load(const float* p) { return *p; }
+	GW_FORCEINLINE void store(float* p, F a) { *p = a.v; }
+	GW_FORCEINLINE F operator + (F a, F b) { return a.v + b.v; }
+	GW_FORCEINLINE F operator - (F a, F b) { return a.v - b.v; }
+	GW_FORCEINLINE F operator * (F a, F b) { return a.v * b.v; }
+	GW_FORCEINLINE F operator / (F a, F b) { return a.v / b.v; }
+	GW_FORCEINLINE F operator - (F a) { return -a.v; }
+	GW_FORCEINLINE bool operator < (F a, F b) { return a.v < b.v; }
+	GW_FORCEINLINE bool operator > (F a, F b) { return a.v > b.v; }
+	GW_FORCEINLINE bool operator <= (F a, F b) { return a.v <= b.v; }
+	GW_FORCEINLINE bool operator == (F a, F b) { return a.v == b.v; }
+	GW_FORCEINLINE F sel(bool mask, F a, F b) { return mask ? a : b; }
+	GW_FORCEINLINE F neg_if(bool mask, F a) { return mask ? -a.v : a.v; }
+	GW_FORCEINLINE F sqrt(F a) { return ::sqrtf(a.v); }
+	GW_FORCEINLINE F abs(F a) { return ::fabsf(a.v); }
+	GW_FORCEINLINE F min(F a, F b) { return a.v < b.v ? a : b; }
+	GW_FORCEINLINE F max(F a, F b) { return a.v > b.v ? a : b; }
+	GW_FORCEINLINE F round(F a) { return ::nearbyintf(a.v); }
+	GW_FORCEINLINE F exp2i(F n) { return ::ldexpf(1.0f, int(n.v)); }
+	GW_FORCEINLINE F frexp(F x, F& e) {
+		int ie;
+		float m = ::frexpf(x.v, &ie) * 2.0f;
+		e = float(ie - 1);
+		return m;
+	}
+#endif
+
+	template<typename FUNC_T> GW_FORCEINLINE F map(F x, const FUNC_T& func) {
+		float tmp[WIDTH];
+		store(tmp, x);
+		for (int i = 0; i < WIDTH; ++i) {
+			tmp[i] = func(tmp[i]);
+		}
+		return load(tmp);
+	}
+
+	template<typename FUNC_T> GW_FORCEINLINE F map(F x, F y, const FUNC_T& func) {
+		float tmpX[WIDTH];
+		float tmpY[WIDTH];
+		store(tmpX, x);
+		store(tmpY, y);
+		for (int i = 0; i < WIDTH; ++i) {
+			tmpX[i] = func(tmpX[i], tmpY[i]);
+		}
+		return load(tmpX);
+	}
+
+	// plain floats
+	GW_FORCEINLINE bool mask_and(bool a, bool b) { return a && b; }
+	GW_FORCEINLINE bool any(bool mask) { return mask; }
+	GW_FORCEINLINE float sel(bool mask, float a, float b) { return mask ? a : b; }
+	GW_FORCEINLINE float neg_if(bool mask, float a) { return mask ? -a : a; }
+	GW_FORCEINLINE float sqrt(float a) { return ::sqrtf(a); }
+	GW_FORCEINLINE float abs(float a) { return ::fabsf(a); }
+	GW_FORCEINLINE float min(float a, float b) { return a < b ? a : b; }
+	GW_FORCEINLINE float max(float a, float b) { return a > b ? a : b; }
+	GW_FORCEINLINE float round(float a) { return ::nearbyintf(a); }
+	GW_FORCEINLINE float exp2i(float n) { return ::ldexpf(1.0f, int(n)); }
+	GW_FORCEINLINE float frexp(float x, float& e) {
+		int ie;
+		float m = ::frexpf(x, &ie) * 2.0f;
+		e = float(ie - 1);
+		return m;
+	}
+	template<typename FUNC_T> GW_FORCEINLINE float map(float x, const FUNC_T& func) { return func(x); }
+	template<typename FUNC_T> GW_FORCEINLINE float map(float x, float y, const FUNC_T& func) { return func(x, y); }
+}
+
 namespace GWBase {
 	extern const long double pi;
 
@@ -187,6 +368,198 @@ namespace GWBase {
 		return rad;
 	}
 
+	// Approximations of the GWMathTier tiers, V is float or GWLane::F; FULL goes to the C library lane by lane.
+	// Errors of the FAST and COARSE tiers:
+	// sin, cos: absolute, below 2e-7 and 3e-4 for |x| <= 2pi. x is reduced by the nearest multiple of pi/2,
+	//   past 2pi the error grows by up to 6e-8 per radian in fast math builds.
+	// exp: relative, below 6e-7 for |x| < 10 (4.5e-6 further out) and 1.5e-4; 0 under -87.3, inf over 88.72.
+	// log: relative to max(1, |log x|), below 1.7e-7 and 6.1e-5 for positive normal x; -inf at 0, NaN below.
+	// pow: x >= 0, relative, below 2.5e-7 and 1.1e-4 times 1 + |y log x|.
+	// acos: absolute, below 6e-7 and 7e-5; x is clamped to [-1, 1].
+	template<GWMathTier TIER, typename V> GW_FORCEINLINE void sincos_approx(V x, V& s, V& c) {
+		if (TIER == GWMathTier::FULL) {
+			s = GWLane::map(x, [](float a) { return ::sinf(a); });
+			c = GWLane::map(x, [](float a) { return ::cosf(a); });
+			return;
+		}
+		// Cody-Waite split of pi/2
+		V j = GWLane::round(x * V(0.636619772f));
+		V r = x - j * V(1.5703125f);
+		r = r - j * V(4.837512969970703125e-4f);
+		r = r - j * V(7.54978995489188216e-8f);
+		V r2 = r * r;
+		V ps;
+		V pc;
+		if (TIER == GWMathTier::FAST) {
+			// Cephes sinf/cosf
+			ps = r + r * r2 * ((V(-1.9515295891e-4f) * r2 + V(8.3321608736e-3f)) * r2 + V(-1.6666654611e-1f));
+			pc = V(1.0f) - r2 * V(0.5f) + r2 * r2 * ((V(2.443315711809948e-5f) * r2 + V(-1.388731625493765e-3f)) * r2 + V(4.166664568298827e-2f));
+		} else {
+			ps = r * (V(0.99956652f) + V(-0.16147850f) * r2);
+			pc = V(1.0f) + r2 * (V(-0.49977627f) + V(0.04048887f) * r2);
+		}
+		// quadrant j mod 4, the offsets keep the rounding away from ties
+		V quad = j - GWLane::round(j * V(0.25f) - V(0.375f)) * V(4.0f);
+		V odd = quad - GWLane::round(quad * V(0.5f) - V(0.25f)) * V(2.0f);
+		auto swap = odd > V(0.5f);
+		s = GWLane::neg_if(quad > V(1.5f), GWLane::sel(swap, pc, ps));
+		c = GWLane::neg_if(GWLane::mask_and(quad > V(0.5f), quad < V(2.5f)), GWLane::sel(swap, ps, pc));
+	}
+
+	template<GWMathTier TIER, typename V> GW_FORCEINLINE V exp_approx(V x) {
+		if (TIER == GWMathTier::FULL) {
+			return GWLane::map(x, [](float a) { return ::expf(a); });
+		}
+		V xc = GWLane::min(GWLane::max(x, V(-87.3f)), V(88.72f));
+		V n = GWLane::round(xc * V(1.44269504f));
+		V r = xc - n * V(0.693359375f);
+		r = r - n * V(-2.12194440e-4f);
+		V p;
+		if (TIER == GWMathTier::FAST) {
+			// Cephes expf
+			p = (((V(1.9875691500e-4f) * r + V(1.3981999507e-3f)) * r + V(8.3334519073e-3f)) * r + V(4.1665795894e-2f)) * r;
+			p = ((p + V(1.6666665459e-1f)) * r + V(0.5f)) * r * r + r + V(1.0f);
+		} else {
+			p = (V(0.16760625f) * r + V(0.50414598f)) * r * r + r + V(1.0f);
+		}
+		// 2^128 is out of range, it is applied in two steps
+		auto top = n > V(127.0f);
+		V res = p * GWLane::exp2i(GWLane::sel(top, n - V(1.0f), n));
+		res = GWLane::sel(top, res * V(2.0f), res);
+		res = GWLane::sel(x > V(88.72f), V(HUGE_VALF), res);
+		return GWLane::sel(x < V(-87.3f), V(0.0f), res);
+	}
+
+	template<GWMathTier TIER, typename V> GW_FORCEINLINE V log_approx(V x) {
+		if (TIER == GWMathTier::FULL) {
+			return GWLane::map(x, [](float a) { return ::logf(a); });
+		}
+		V e;
+		V m = GWLane::frexp(x, e);
+		// m in [sqrt(1/2), sqrt(2))
+		auto big = m > V(1.41421356f);
+		m = GWLane::sel(big, m * V(0.5f), m);
+		e = GWLane::sel(big, e + V(1.0f), e);
+		V f = m - V(1.0f);
+		V res;
+		if (TIER == GWMathTier::FAST) {
+			// Cephes logf
+			V z = f * f;
+			V p = ((V(7.0376836292e-2f) * f + V(-1.1514610310e-1f)) * f + V(1.1676998740e-1f)) * f + V(-1.2420140846e-1f);
+			p = ((p * f + V(1.4249322787e-1f)) * f + V(-1.6668057665e-1f)) * f + V(2.0000714765e-1f);
+			p = (p * f + V(-2.4999993993e-1f)) * f + V(3.3333331174e-1f);
+			V y = f * z * p + e * V(-2.12194440e-4f) - z * V(0.5f);
+			res = f + y + e * V(0.693359375f);
+		} else {
+			// 2 atanh(f / (m + 1))
+			V t = f / (m + V(1.0f));
+			res = t * (V(2.0f) + t * t * V(0.66666667f)) + e * V(0.693147181f);
+		}
+		res = GWLane::sel(x == V(0.0f), V(-HUGE_VALF), res);
+		return GWLane::sel(x < V(0.0f), V(NAN), res);
+	}
+
+	template<GWMathTier TIER, typename V> GW_FORCEINLINE V pow_approx(V x, V y) {
+		if (TIER == GWMathTier::FULL) {
+			return GWLane::map(x, y, [](float a, float b) { return ::powf(a, b); });
+		}
+		V res = exp_approx<TIER>(y * log_approx<TIER>(GWLane::max(x, V(1.17549435e-38f))));
+		res = GWLane::sel(x == V(0.0f), GWLane::sel(y == V(0.0f), V(1.0f), V(0.0f)), res);
+		return GWLane::sel(x < V(0.0f), V(NAN), res);
+	}
+
+	template<GWMathTier TIER, typename V> GW_FORCEINLINE V acos_approx(V x) {
+		if (TIER == GWMathTier::FULL) {
+			return GWLane::map(x, [](float a) { return ::acosf(GWBase::clamp(a, -1.0f, 1.0f)); });
+		}
+		V a = GWLane::min(GWLane::abs(x), V(1.0f));
+		V p;
+		// Abramowitz & Stegun 4.4.46 and 4.4.45
+		if (TIER == GWMathTier::FAST) {
+			p = ((V(-0.0012624911f) * a + V(0.0066700901f)) * a + V(-0.0170881256f)) * a + V(0.0308918810f);
+			p = (((p * a + V(-0.0501743046f)) * a + V(0.0889789874f)) * a + V(-0.2145988016f)) * a + V(1.5707963050f);
+		} else {
+			p = ((V(-0.0187293f) * a + V(0.0742610f)) * a + V(-0.2121144f)) * a + V(1.5707288f);
+		}
+		V r = p * GWLane::sqrt(V(1.0f) - a);
+		return GWLane::sel(x < V(0.0f), V(3.14159265f) - r, r);
+	}
+
+	inline void approx_sincos(float x, float& s, float& c, GWMathTier tier) {
+		switch (tier) {
+		case GWMathTier::FAST: sincos_approx<GWMathTier::FAST>(x, s, c); break;
+		case GWMathTier::COARSE: sincos_approx<GWMathTier::COARSE>(x, s, c); break;
+		default: s = ::sinf(x); c = ::cosf(x); break;
+		}
+	}
+	inline float approx_sin(float x, GWMathTier tier) {
+		if (tier == GWMathTier::FULL) { return ::sinf(x); }
+		float s, c;
+		approx_sincos(x, s, c, tier);
+		return s;
+	}
+	inline float approx_cos(float x, GWMathTier tier) {
+		if (tier == GWMathTier::FULL) { return ::cosf(x); }
+		float s, c;
+		approx_sincos(x, s, c, tier);
+		return c;
+	}
+	inline float approx_exp(float x, GWMathTier tier) {
+		switch (tier) {
+		case GWMathTier::FAST: return exp_approx<GWMathTier::FAST>(x);
+		case GWMathTier::COARSE: return exp_approx<GWMathTier::COARSE>(x);
+		default: return ::expf(x);
+		}
+	}
+	inline float approx_log(float x, GWMathTier tier) {
+		switch (tier) {
+		case GWMathTier::FAST: return log_approx<GWMathTier::FAST>(x);
+		case GWMathTier::COARSE: return log_approx<GWMathTier::COARSE>(x);
+		default: return ::logf(x);
+		}
+	}
+	inline float approx_pow(float x, float y, GWMathTier tier) {
+		switch (tier) {
+		case GWMathTier::FAST: return pow_approx<GWMathTier::FAST>(x, y);
+		case GWMathTier::COARSE: return pow_approx<GWMathTier::COARSE>(x, y);
+		default: return ::powf(x, y);
+		}
+	}
+	inline float approx_acos(float x, GWMathTier tier) {
+		switch (tier) {
+		case GWMathTier::FAST: return acos_approx<GWMathTier::FAST>(x);
+		case GWMathTier::COARSE: return acos_approx<GWMathTier::COARSE>(x);
+		default: return ::acosf(x);
+		}
+	}
+	// double stays with the C library
+	inline void approx_sincos(double x, double& s, double& c, GWMathTier) { s = std::sin(x); c = std::cos(x); }
+	inline double approx_sin(double x, GWMathTier) { return std::sin(x); }
+	inline double approx_cos(double x, GWMathTier) { return std::cos(x); }
+	inline double approx_exp(double x, GWMathTier) { return std::exp(x); }
+	inline double approx_log(double x, GWMathTier) { return std::log(x); }
+	inline double approx_pow(double x, double y, GWMathTier) { return std::pow(x, y); }
+	inline double approx_acos(double x, GWMathTier) { return std::acos(x); }
+
+	// Array forms, GWLane::WIDTH values at a time; pDst may be pSrc.
+	void approx_sin(float* pDst, const float* pSrc, int n, GWMathTier tier);
+	void approx_cos(float* pDst, const float* pSrc, int n, GWMathTier tier);
+	void approx_sincos(float* pSin, float* pCos, const float* pSrc, int n, GWMathTier tier);
+	void approx_exp(float* pDst, const float* pSrc, int n, GWMathTier tier);
+	void approx_log(float* pDst, const float* pSrc, int n, GWMathTier tier);
+	void approx_pow(float* pDst, const float* pSrc, float y, int n, GWMathTier tier);
+	void approx_acos(float* pDst, const float* pSrc, int n, GWMathTier tier);
+
+	// Reductions over num items of ncomp (1 to 4) floats each, such as GWVectorF or GWColorF arrays. The items are
+	// split into fixed chunks among the GWTask workers and scanned GWLane::WIDTH floats at a time, the results
+	// don't depend on the parallel flag. Nothing is written for num <= 0.
+	// Per component minimum and maximum.
+	void calc_range(float* pMin /*[ncomp]*/, float* pMax /*[ncomp]*/, const float* pSrc, int num, int ncomp, bool parallel = true);
+	// Per component index of the first item with the smallest and with the largest value.
+	void calc_extremes(int* pMinIdx /*[ncomp]*/, int* pMaxIdx /*[ncomp]*/, const float* pSrc, int num, int ncomp, bool parallel = true);
+	// The largest squared distance from a point of pPnts (x, y, z per point) to pCenter.
+	float calc_max_dist_sq(const float* pPnts /*[num*3]*/, int num, const float* pCenter /*[3]*/, bool parallel = true);
+
 	// Ranq1, Numerical Recipes 3d ed., chapter 7.1.3
 	class Random {
 	private:
@@ -218,6 +591,102 @@ namespace GWBase {
 	double random_d01();
 	float random_f01();
 
+	// Directions from two uniform numbers in [0, 1): over the sphere, over the hemisphere around +z, or over it
+	// weighted by the cosine to +z. V is float or GWLane::F, the angles go through the FAST tier.
+	template<typename V> GW_FORCEINLINE void sample_sphere(V u, V v, V& x, V& y, V& z) {
+		V s, c;
+		sincos_approx<GWMathTier::FAST>(v * V(6.28318531f), s, c);
+		z = V(1.0f) - u * V(2.0f);
+		V r = GWLane::sqrt(GWLane::max(V(1.0f) - z * z, V(0.0f)));
+		x = r * c;
+		y = r * s;
+	}
+
+	template<typename V> GW_FORCEINLINE void sample_hemisphere(V u, V v, V& x, V& y, V& z) {
+		V s, c;
+		sincos_approx<GWMathTier::FAST>(v * V(6.28318531f), s, c);
+		z = V(1.0f) - u;
+		V r = GWLane::sqrt(GWLane::max(V(1.0f) - z * z, V(0.0f)));
+		x = r * c;
+		y = r * s;
+	}
+
+	template<typename V> GW_FORCEINLINE void sample_cosine(V u, V v, V& x, V& y, V& z) {
+		V s, c;
+		sincos_approx<GWMathTier::FAST>(v * V(6.28318531f), s, c);
+		V r = GWLane::sqrt(u);
+		z = GWLane::sqrt(V(1.0f) - u);
+		x = r * c;
+		y = r * s;
+	}
+
+	// Philox4x32-10 (Salmon et al., "Parallel Random Numbers: As Easy as 1, 2, 3"). Every block of 4 words is
+	// a function of (seed, stream, block index) only, so each task or thread gets its own stream without any
+	// shared state, and seek() gives the same numbers whatever the order the work is done in.
+	// The fill_* forms generate GWLane blocks at a time and continue from the next whole block.
+	class Philox {
+	public:
+		static const int BLOCK_SIZE = 4;
+
+	private:
+		uint32_t mKey[2];
+		uint32_t mCtr[4]; // block index, stream
+		uint32_t mBuf[BLOCK_SIZE];
+		int mIdx;
+
+		void next_block() {
+			gen_block(mBuf, mCtr, mKey);
+			if (++mCtr[0] == 0) ++mCtr[1];
+			mIdx = 0;
+		}
+
+	public:
+		Philox(uint64_t seed = 0ULL, uint64_t stream = 0ULL) { set(seed, stream); }
+
+		void set(uint64_t seed, uint64_t stream) {
+			mKey[0] = uint32_t(seed);
+			mKey[1] = uint32_t(seed >> 32);
+			mCtr[2] = uint32_t(stream);
+			mCtr[3] = uint32_t(stream >> 32);
+			seek(0);
+		}
+
+		void seek(uint64_t block) {
+			mCtr[0] = uint32_t(block);
+			mCtr[1] = uint32_t(block >> 32);
+			mIdx = BLOCK_SIZE;
+		}
+
+		uint64_t get_block() const { return (uint64_t(mCtr[1]) << 32) | mCtr[0]; }
+
+		static void gen_block(uint32_t* pDst, const uint32_t ctr[4], const uint32_t key[2]);
+
+		uint32_t u32() {
+			if (mIdx == BLOCK_SIZE) next_block();
+			return mBuf[mIdx++];
+		}
+
+		uint64_t u64() {
+			uint64_t lo = u32();
+			return (uint64_t(u32()) << 32) | lo;
+		}
+
+		// 24 and 53 bits, in [0, 1)
+		float f01() { return float(u32() >> 8) * (1.0f / 16777216.0f); }
+		double d01() { return double(u64() >> 11) * (1.0 / 9007199254740992.0); }
+
+		void dir_sphere(float& x, float& y, float& z) { float u = f01(); sample_sphere(u, f01(), x, y, z); }
+		void dir_hemisphere(float& x, float& y, float& z) { float u = f01(); sample_hemisphere(u, f01(), x, y, z); }
+		void dir_cosine(float& x, float& y, float& z) { float u = f01(); sample_cosine(u, f01(), x, y, z); }
+
+		void fill_u32(uint32_t* pDst, int num);
+		void fill_f01(float* pDst, int num);
+		// x, y, z per direction, as in GWVectorF
+		void fill_sphere(float* pDst /*[num*3]*/, int num);
+		void fill_hemisphere(float* pDst /*[num*3]*/, int num);
+		void fill_cosine(float* pDst /*[num*3]*/, int num);
+	};
+
 	struct StrHash {
 		union {
 			uint64_t val;
@@ -614,15 +1083,25 @@ namespace GWTuple {
 		normalize_fast(dst);
 	}
 
-	template<typename TUPLE_T> inline void calc_bbox(const TUPLE_T* pData, uint32_t len, TUPLE_T& minVal, TUPLE_T& maxVal) {
-		for (uint32_t i = 0; i < len; ++i) {
-			if (i == 0) {
-				minVal = pData[i];
-				maxVal = pData[i];
-			} else {
-				GWTuple::max(maxVal, pData[i], maxVal);
-				GWTuple::min(minVal, pData[i], minVal);
-			}
+	template<typename T> inline bool calc_range_elems(T*, T*, const T*, uint32_t, int, bool) { return false; }
+	inline bool calc_range_elems(float* pMin, float* pMax, const float* pSrc, uint32_t len, int n, bool parallel) {
+		GWBase::calc_range(pMin, pMax, pSrc, int(len), n, parallel);
+		return true;
+	}
+
+	// Tuples of up to 4 floats without padding go through GWBase::calc_range.
+	template<typename TUPLE_T> inline void calc_bbox(const TUPLE_T* pData, uint32_t len, TUPLE_T& minVal, TUPLE_T& maxVal, bool parallel = true) {
+		typedef typename TUPLE_T::elem_t elem_t;
+		const int n = (int)TUPLE_T::ELEMS_NUM;
+		if (len == 0) { return; }
+		if (n <= 4 && sizeof(TUPLE_T) == n * sizeof(elem_t) && calc_range_elems(minVal.elems, maxVal.elems, pData->elems, len, n, parallel)) {
+			return;
+		}
+		minVal = pData[0];
+		maxVal = pData[0];
+		for (uint32_t i = 1; i < len; ++i) {
+			GWTuple::max(maxVal, pData[i], maxVal);
+			GWTuple::min(minVal, pData[i], minVal);
 		}
 	}
 	template<typename TUPLE_SRC_T, typename SCALAR_T>
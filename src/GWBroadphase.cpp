@@ -0,0 +1,578 @@
+/*
+ * Author: Gleb Novodran <novodran@gmail.com>
+ */
+
+#include <atomic>
+#include <cstring>
+#include <vector>
+#include "groundwork.hpp"
+
+namespace GWBroadphase {
+
+	// buckets or objects handed out as one piece of work when collecting pairs
+	static const int PAIR_CHUNK = 0x100;
+	// moved objects are tested against each other directly, past this count the grid is rebuilt
+	static const int MOVED_MIN = 64;
+	static const int RADIX_BITS = 11;
+	static const int RADIX_SIZE = 1 << RADIX_BITS;
+	// keys per chunk at least, for the parallel radix passes
+	static const int RADIX_CHUNK_MIN = 0x4000;
+	// insertion sort swaps per object before the sweep list is sorted from scratch
+	static const int SAP_SWAPS_MAX = 8;
+
+#if defined(GW_SIMD_AVX)
+	static const int SWEEP_WIDTH = 8;
+#else
+	static const int SWEEP_WIDTH = 4;
+#endif
+
+	template<typename FUNC_T> static void exec_range(int count, bool parallel, const FUNC_T& func) {
+		if (parallel) {
+			GWTask::parallel_for(count, func);
+		} else {
+			func(0, count);
+		}
+	}
+
+	template<typename T> static void reserve(T*& pMem, int32_t& capacity, int32_t num) {
+		if (num <= capacity) { return; }
+		if (pMem) {
+			GWSys::free_rsrc_mem(pMem);
+		}
+		capacity = std::max(num, capacity + capacity / 2);
+		pMem = reinterpret_cast<T*>(GWSys::alloc_rsrc_mem(capacity * sizeof(T)));
+	}
+
+	static inline bool overlap(const GWSphereF& a, const GWSphereF& b) {
+		float r = a.r + b.r;
+		return (a.c - b.c).length_sq() <= r * r;
+	}
+
+	static inline void calc_home(const SpatialHash::CellRange& a, const SpatialHash::CellRange& b, int32_t home[3]) {
+		for (int i = 0; i < 3; ++i) {
+			home[i] = std::max(a.mMin[i], b.mMin[i]);
+		}
+	}
+
+	static inline Pair make_pair(int32_t a, int32_t b) {
+		Pair pair;
+		pair.mA = std::min(a, b);
+		pair.mB = std::max(a, b);
+		return pair;
+	}
+
+	// Stable LSD radix sort of the keys on bits [shift, shift + nbits), pTmp holds n keys.
+	// Every pass counts the digits per chunk, so the result doesn't depend on the parallel flag.
+	static void radix_sort(uint64_t* pKeys, uint64_t* pTmp, int n, int shift, int nbits, bool parallel) {
+		const int nchunks = parallel ? std::max(std::min(GWTask::get_num_threads() * 4, n / RADIX_CHUNK_MIN), 1) : 1;
+		std::vector<int32_t> counts(nchunks * RADIX_SIZE);
+		uint64_t* pSrc = pKeys;
+		uint64_t* pDst = pTmp;
+		for (int s = shift; s < shift + nbits; s += RADIX_BITS) {
+			std::fill(counts.begin(), counts.end(), 0);
+			exec_range(nchunks, parallel, [&](int c0, int c1) {
+				for (int c = c0; c < c1; ++c) {
+					int32_t* pCount = &counts[c * RADIX_SIZE];
+					for (int i = int(int64_t(n) * c / nchunks); i < int(int64_t(n) * (c + 1) / nchunks); ++i) {
+						++pCount[(pSrc[i] >> s) & (RADIX_SIZE - 1)];
+					}
+				}
+			});
+			int32_t org = 0;
+			for (int d = 0; d < RADIX_SIZE; ++d) {
+				for (int c = 0; c < nchunks; ++c) {
+					int32_t cnt = counts[c * RADIX_SIZE + d];
+					counts[c * RADIX_SIZE + d] = org;
+					org += cnt;
+				}
+			}
+			exec_range(nchunks, parallel, [&](int c0, int c1) {
+				for (int c = c0; c < c1; ++c) {
+					int32_t* pOffs = &counts[c * RADIX_SIZE];
+					for (int i = int(int64_t(n) * c / nchunks); i < int(int64_t(n) * (c + 1) / nchunks); ++i) {
+						pDst[pOffs[(pSrc[i] >> s) & (RADIX_SIZE - 1)]++] = pSrc[i];
+					}
+				}
+			});
+			std::swap(pSrc, pDst);
+		}
+		if (pSrc != pKeys) {
+			std::copy(pSrc, pSrc + n, pKeys);
+		}
+	}
+
+	// Runs func(item, pairs) over the items in chunks and appends the pairs chunk by chunk,
+	// so the output order is the same for the serial and the parallel runs.
+	template<typename FUNC_T> static void collect_pairs(std::vector<Pair>& pairs, int nitems, bool parallel, const FUNC_T& func) {
+		if (nitems <= 0) { return; }
+		int nchunks = (nitems + PAIR_CHUNK - 1) / PAIR_CHUNK;
+		if (!parallel || nchunks == 1) {
+			for (int i = 0; i < nitems; ++i) {
+				func(i, pairs);
+			}
+			return;
+		}
+		std::vector<std::vector<Pair>> chunks(nchunks);
+		GWTask::parallel_for(nchunks, [&](int c0, int c1) {
+			for (int c = c0; c < c1; ++c) {
+				int end = std::min((c + 1) * PAIR_CHUNK, nitems);
+				for (int i = c * PAIR_CHUNK; i < end; ++i) {
+					func(i, chunks[c]);
+				}
+			}
+		}, 1);
+		for (const std::vector<Pair>& chunk : chunks) {
+			pairs.insert(pairs.end(), chunk.begin(), chunk.end());
+		}
+	}
+
+	SpatialHash::CellRange SpatialHash::calc_range(const GWSphereF& sph) const {
+		CellRange rng;
+		for (int i = 0; i < 3; ++i) {
+			rng.mMin[i] = int32_t(std::floor((sph.c.elems[i] - sph.r) * mInvCellSize));
+			rng.mMax[i] = int32_t(std::floor((sph.c.elems[i] + sph.r) * mInvCellSize));
+		}
+		return rng;
+	}
+
+	float SpatialHash::suggest_cell_size(const GWSphereF* pSph, int num) {
+		if (pSph == nullptr || num <= 0) { return 1.0f; }
+		double sum = 0.0;
+		for (int i = 0; i < num; ++i) {
+			sum += pSph[i].r;
+		}
+		// twice the mean diameter: a typical sphere touches a few cells, a cell holds a few spheres
+		float size = float(4.0 * sum / num);
+		return size > 0.0f ? size : 1.0f;
+	}
+
+	void SpatialHash::build(const GWSphereF* pSph, int num, bool parallel) {
+		num = pSph ? std::max(num, 0) : 0;
+		if (num > mObjCapacity) {
+			// pSph can't be mpSph here, rebuilds from update() never grow
+			void* ppMem[] = { mpSph, mpRanges, mpState, mpLarge, mpMoved };
+			for (void* pMem : ppMem) {
+				if (pMem) {
+					GWSys::free_rsrc_mem(pMem);
+				}
+			}
+			mObjCapacity = num;
+			mpSph = reinterpret_cast<GWSphereF*>(GWSys::alloc_rsrc_mem(num * sizeof(GWSphereF)));
+			mpRanges = reinterpret_cast<CellRange*>(GWSys::alloc_rsrc_mem(num * sizeof(CellRange)));
+			mpState = reinterpret_cast<uint8_t*>(GWSys::alloc_rsrc_mem(num * sizeof(uint8_t)));
+			mpLarge = reinterpret_cast<int32_t*>(GWSys::alloc_rsrc_mem(num * sizeof(int32_t)));
+			mpMoved = reinterpret_cast<int32_t*>(GWSys::alloc_rsrc_mem(num * sizeof(int32_t)));
+		}
+		if (pSph != mpSph && num > 0) {
+			std::copy(pSph, pSph + num, mpSph);
+		}
+		mNumObj = num;
+		mNumMoved = 0;
+		mNumLarge = 0;
+		mNumPairs = 0;
+		if (mCellSize <= 0.0f) {
+			mCellSize = suggest_cell_size(mpSph, num);
+		}
+		mInvCellSize = 1.0f / mCellSize;
+
+		// cells of every object as (bucket, object) keys; an object whose cells share a bucket
+		// gets repeated keys, they end up adjacent after the sort and are dropped there
+		int32_t* pObjOrg = reinterpret_cast<int32_t*>(GWSys::alloc_temp_mem((num + 1) * sizeof(int32_t)));
+		exec_range(num, parallel, [&](int i0, int i1) {
+			for (int i = i0; i < i1; ++i) {
+				mpRanges[i] = calc_range(mpSph[i]);
+				int ncells = mpRanges[i].get_num_cells();
+				bool large = ncells > MAX_OBJ_CELLS;
+				mpState[i] = large ? LARGE : IN_GRID;
+				pObjOrg[i] = large ? 0 : ncells;
+			}
+		});
+		int32_t numKeys = 0;
+		for (int i = 0; i < num; ++i) {
+			int32_t ncells = pObjOrg[i];
+			pObjOrg[i] = numKeys;
+			numKeys += ncells;
+			if (mpState[i] == LARGE) {
+				mpLarge[mNumLarge++] = i;
+			}
+		}
+		pObjOrg[num] = numKeys;
+
+		int tableBits = 6;
+		while ((1 << tableBits) < numKeys && tableBits < 30) {
+			++tableBits;
+		}
+		uint32_t tableSize = 1U << tableBits;
+		mTableSize = tableSize;
+		if (mTableCapacity < tableSize) {
+			if (mpBucketOrg) {
+				GWSys::free_rsrc_mem(mpBucketOrg);
+			}
+			mTableCapacity = tableSize;
+			mpBucketOrg = reinterpret_cast<int32_t*>(GWSys::alloc_rsrc_mem((tableSize + 1) * sizeof(int32_t)));
+		}
+
+		uint64_t* pKeys = reinterpret_cast<uint64_t*>(GWSys::alloc_temp_mem((numKeys + 1) * sizeof(uint64_t) * 2));
+		exec_range(num, parallel, [&](int i0, int i1) {
+			for (int i = i0; i < i1; ++i) {
+				if (mpState[i] == LARGE) { continue; }
+				const CellRange& rng = mpRanges[i];
+				uint64_t* pKey = pKeys + pObjOrg[i];
+				for (int32_t z = rng.mMin[2]; z <= rng.mMax[2]; ++z) {
+					for (int32_t y = rng.mMin[1]; y <= rng.mMax[1]; ++y) {
+						for (int32_t x = rng.mMin[0]; x <= rng.mMax[0]; ++x) {
+							*pKey++ = (uint64_t(calc_bucket(x, y, z)) << 32) | uint32_t(i);
+						}
+					}
+				}
+			}
+		});
+		// keys are written in object order and the sort is stable, so every bucket lists its objects in order
+		radix_sort(pKeys, pKeys + numKeys + 1, numKeys, 32, tableBits, parallel);
+
+		reserve(mpEntries, mEntryCapacity, std::max(numKeys, 1));
+		int32_t nent = 0;
+		uint32_t bucket = 0;
+		uint64_t prev = ~0ULL;
+		for (int32_t i = 0; i < numKeys; ++i) {
+			uint64_t key = pKeys[i];
+			if (key == prev) { continue; }
+			prev = key;
+			uint32_t b = uint32_t(key >> 32);
+			while (bucket <= b) {
+				mpBucketOrg[bucket++] = nent;
+			}
+			mpEntries[nent++] = int32_t(key & 0xFFFFFFFFU);
+		}
+		while (bucket <= tableSize) {
+			mpBucketOrg[bucket++] = nent;
+		}
+		mNumEntries = nent;
+		GWSys::free_temp_mem(pKeys);
+		GWSys::free_temp_mem(pObjOrg);
+	}
+
+	void SpatialHash::update(const int32_t* pIdx, const GWSphereF* pSph, int num, bool parallel) {
+		if (pIdx == nullptr || pSph == nullptr) { return; }
+		bool rebuild = false;
+		for (int i = 0; i < num; ++i) {
+			int32_t idx = pIdx[i];
+			if (idx < 0 || idx >= mNumObj) { continue; }
+			mpSph[idx] = pSph[i];
+			CellRange rng = calc_range(pSph[i]);
+			if (mpState[idx] != LARGE && !rng.same(mpRanges[idx])) {
+				if (rng.get_num_cells() > MAX_OBJ_CELLS) {
+					rebuild = true;
+				} else if (mpState[idx] == IN_GRID) {
+					// the old entries stay in the table and are skipped until the next build
+					mpState[idx] = MOVED;
+					mpMoved[mNumMoved++] = idx;
+				}
+			}
+			mpRanges[idx] = rng;
+		}
+		if (rebuild || mNumMoved > std::max(MOVED_MIN, mNumObj / 64)) {
+			build(mpSph, mNumObj, parallel);
+		}
+	}
+
+	int SpatialHash::find_pairs(bool parallel) {
+		std::vector<Pair> pairs;
+
+		// in-grid pairs, reported from the bucket of their home cell only
+		int nbucketChunks = int((mTableSize + PAIR_CHUNK - 1) / PAIR_CHUNK);
+		collect_pairs(pairs, mNumEntries > 0 ? nbucketChunks : 0, parallel, [&](int chunk, std::vector<Pair>& out) {
+			uint32_t end = std::min(uint32_t(chunk + 1) * PAIR_CHUNK, mTableSize);
+			for (uint32_t b = uint32_t(chunk) * PAIR_CHUNK; b < end; ++b) {
+				int32_t org = mpBucketOrg[b];
+				int32_t lim = mpBucketOrg[b + 1];
+				for (int32_t i = org; i < lim; ++i) {
+					int32_t ia = mpEntries[i];
+					if (mpState[ia] != IN_GRID) { continue; }
+					for (int32_t j = i + 1; j < lim; ++j) {
+						int32_t ib = mpEntries[j];
+						if (mpState[ib] != IN_GRID) { continue; }
+						if (!overlap(mpSph[ia], mpSph[ib])) { continue; }
+						int32_t home[3];
+						calc_home(mpRanges[ia], mpRanges[ib], home);
+						if (calc_bucket(home[0], home[1], home[2]) == b) {
+							out.push_back(make_pair(ia, ib));
+						}
+					}
+				}
+			}
+		});
+
+		// moved objects scan the buckets of their new cells, the home cell check is exact here
+		// since the cells of one object can share a bucket
+		collect_pairs(pairs, mNumMoved, parallel, [&](int k, std::vector<Pair>& out) {
+			int32_t ia = mpMoved[k];
+			const CellRange& rng = mpRanges[ia];
+			for (int32_t z = rng.mMin[2]; z <= rng.mMax[2]; ++z) {
+				for (int32_t y = rng.mMin[1]; y <= rng.mMax[1]; ++y) {
+					for (int32_t x = rng.mMin[0]; x <= rng.mMax[0]; ++x) {
+						uint32_t b = calc_bucket(x, y, z);
+						for (int32_t i = mpBucketOrg[b]; i < mpBucketOrg[b + 1]; ++i) {
+							int32_t ib = mpEntries[i];
+							if (mpState[ib] != IN_GRID) { continue; }
+							if (!overlap(mpSph[ia], mpSph[ib])) { continue; }
+							int32_t home[3];
+							calc_home(rng, mpRanges[ib], home);
+							if (home[0] == x && home[1] == y && home[2] == z) {
+								out.push_back(make_pair(ia, ib));
+							}
+						}
+					}
+				}
+			}
+			for (int32_t j = k + 1; j < mNumMoved; ++j) {
+				int32_t ib = mpMoved[j];
+				if (overlap(mpSph[ia], mpSph[ib])) {
+					out.push_back(make_pair(ia, ib));
+				}
+			}
+		});
+
+		// large objects against everything else
+		collect_pairs(pairs, mNumLarge, parallel, [&](int k, std::vector<Pair>& out) {
+			int32_t ia = mpLarge[k];
+			for (int32_t ib = 0; ib < mNumObj; ++ib) {
+				if (ib == ia || (mpState[ib] == LARGE && ib < ia)) { continue; }
+				if (overlap(mpSph[ia], mpSph[ib])) {
+					out.push_back(make_pair(ia, ib));
+				}
+			}
+		});
+
+		mNumPairs = int32_t(pairs.size());
+		reserve(mpPairs, mPairCapacity, std::max(mNumPairs, 1));
+		std::copy(pairs.begin(), pairs.end(), mpPairs);
+		return mNumPairs;
+	}
+
+	SpatialHash* SpatialHash::create(float cellSize) {
+		SpatialHash* pHash = reinterpret_cast<SpatialHash*>(GWSys::alloc_rsrc_mem(sizeof(SpatialHash)));
+		std::memset(reinterpret_cast<void*>(pHash), 0, sizeof(SpatialHash));
+		pHash->set_cell_size(cellSize);
+		pHash->mInvCellSize = cellSize > 0.0f ? 1.0f / cellSize : 1.0f;
+		pHash->mTableSize = 1;
+		return pHash;
+	}
+
+	void SpatialHash::destroy(SpatialHash* pHash) {
+		if (pHash == nullptr) { return; }
+		void* ppMem[] = {
+			pHash->mpSph, pHash->mpRanges, pHash->mpState, pHash->mpLarge, pHash->mpMoved,
+			pHash->mpBucketOrg, pHash->mpEntries, pHash->mpPairs
+		};
+		for (void* pMem : ppMem) {
+			if (pMem) {
+				GWSys::free_rsrc_mem(pMem);
+			}
+		}
+		GWSys::free_rsrc_mem(pHash);
+	}
+
+	uint32_t SweepAndPrune::calc_key(float val) {
+		uint32_t bits;
+		std::memcpy(&bits, &val, sizeof(bits));
+		return (bits & 0x80000000U) ? ~bits : (bits | 0x80000000U);
+	}
+
+	void SweepAndPrune::sort(bool parallel) {
+		int n = mNumObj;
+		uint64_t* pKeys = reinterpret_cast<uint64_t*>(GWSys::alloc_temp_mem((n + 1) * sizeof(uint64_t) * 2));
+		exec_range(n, parallel, [&](int i0, int i1) {
+			for (int i = i0; i < i1; ++i) {
+				pKeys[i] = (uint64_t(calc_key(mpBoxMin[i].x)) << 32) | uint32_t(i);
+			}
+		});
+		radix_sort(pKeys, pKeys + n + 1, n, 32, 32, parallel);
+		exec_range(n, parallel, [&](int i0, int i1) {
+			for (int i = i0; i < i1; ++i) {
+				mpKeys[i] = uint32_t(pKeys[i] >> 32);
+				mpOrder[i] = int32_t(pKeys[i] & 0xFFFFFFFFU);
+			}
+		});
+		GWSys::free_temp_mem(pKeys);
+	}
+
+	// Ties are ordered by the object index as in sort(), so both give the same list.
+	void SweepAndPrune::resort(bool parallel) {
+		int n = mNumObj;
+		exec_range(n, parallel, [&](int i0, int i1) {
+			for (int i = i0; i < i1; ++i) {
+				mpKeys[i] = calc_key(mpBoxMin[mpOrder[i]].x);
+			}
+		});
+		int64_t swapsMax = int64_t(n) * SAP_SWAPS_MAX;
+		int64_t nswaps = 0;
+		for (int i = 1; i < n; ++i) {
+			uint32_t key = mpKeys[i];
+			int32_t obj = mpOrder[i];
+			int j = i;
+			while (j > 0 && (mpKeys[j - 1] > key || (mpKeys[j - 1] == key && mpOrder[j - 1] > obj))) {
+				mpKeys[j] = mpKeys[j - 1];
+				mpOrder[j] = mpOrder[j - 1];
+				--j;
+			}
+			mpKeys[j] = key;
+			mpOrder[j] = obj;
+			nswaps += i - j;
+			if (nswaps > swapsMax) {
+				sort(parallel);
+				break;
+			}
+		}
+		mNumSwaps = int32_t(std::min(nswaps, int64_t(0x7FFFFFFF)));
+	}
+
+	void SweepAndPrune::gather(bool parallel) {
+		exec_range(mNumObj, parallel, [&](int i0, int i1) {
+			for (int i = i0; i < i1; ++i) {
+				const GWVectorF& bbMin = mpBoxMin[mpOrder[i]];
+				const GWVectorF& bbMax = mpBoxMax[mpOrder[i]];
+				mpMinX[i] = bbMin.x;
+				mpMaxX[i] = bbMax.x;
+				mpMinY[i] = bbMin.y;
+				mpMaxY[i] = bbMax.y;
+				mpMinZ[i] = bbMin.z;
+				mpMaxZ[i] = bbMax.z;
+			}
+		});
+	}
+
+	void SweepAndPrune::build(const GWVectorF* pMin, const GWVectorF* pMax, int num, bool parallel) {
+		num = (pMin && pMax) ? std::max(num, 0) : 0;
+		if (num > mObjCapacity) {
+			void* ppMem[] = { mpBoxMin, mpBoxMax, mpOrder, mpKeys, mpMinX, mpMaxX, mpMinY, mpMaxY, mpMinZ, mpMaxZ };
+			for (void* pMem : ppMem) {
+				if (pMem) {
+					GWSys::free_rsrc_mem(pMem);
+				}
+			}
+			mObjCapacity = num;
+			mpBoxMin = reinterpret_cast<GWVectorF*>(GWSys::alloc_rsrc_mem(num * sizeof(GWVectorF)));
+			mpBoxMax = reinterpret_cast<GWVectorF*>(GWSys::alloc_rsrc_mem(num * sizeof(GWVectorF)));
+			mpOrder = reinterpret_cast<int32_t*>(GWSys::alloc_rsrc_mem(num * sizeof(int32_t)));
+			mpKeys = reinterpret_cast<uint32_t*>(GWSys::alloc_rsrc_mem(num * sizeof(uint32_t)));
+			// the sweep reads whole blocks past the last slot
+			float** ppSoA[] = { &mpMinX, &mpMaxX, &mpMinY, &mpMaxY, &mpMinZ, &mpMaxZ };
+			for (float** ppArr : ppSoA) {
+				*ppArr = reinterpret_cast<float*>(GWSys::alloc_rsrc_mem((num + SWEEP_WIDTH) * sizeof(float)));
+				std::fill(*ppArr + num, *ppArr + num + SWEEP_WIDTH, 0.0f);
+			}
+		}
+		if (num > 0) {
+			std::copy(pMin, pMin + num, mpBoxMin);
+			std::copy(pMax, pMax + num, mpBoxMax);
+		}
+		mNumObj = num;
+		mNumSwaps = 0;
+		mNumPairs = 0;
+		sort(parallel);
+		gather(parallel);
+	}
+
+	void SweepAndPrune::update(const GWVectorF* pMin, const GWVectorF* pMax, bool parallel) {
+		if (pMin == nullptr || pMax == nullptr) { return; }
+		std::copy(pMin, pMin + mNumObj, mpBoxMin);
+		std::copy(pMax, pMax + mNumObj, mpBoxMax);
+		resort(parallel);
+		gather(parallel);
+	}
+
+	void SweepAndPrune::update(const int32_t* pIdx, const GWVectorF* pMin, const GWVectorF* pMax, int num, bool parallel) {
+		if (pIdx == nullptr || pMin == nullptr || pMax == nullptr) { return; }
+		for (int i = 0; i < num; ++i) {
+			int32_t idx = pIdx[i];
+			if (idx < 0 || idx >= mNumObj) { continue; }
+			mpBoxMin[idx] = pMin[i];
+			mpBoxMax[idx] = pMax[i];
+		}
+		resort(parallel);
+		gather(parallel);
+	}
+
+	// Slots after i are tested a block at a time until one starts past the max x of slot i.
+	static void sweep_slot(const SweepAndPrune& sap, int i, std::vector<Pair>& out) {
+		int n = sap.mNumObj;
+		int32_t objA = sap.mpOrder[i];
+		for (int j = i + 1; j < n; j += SWEEP_WIDTH) {
+			uint32_t maskX = 0;
+			uint32_t mask = 0;
+#if defined(GW_SIMD_AVX)
+			__m256 minX = _mm256_loadu_ps(sap.mpMinX + j);
+			__m256 inX = _mm256_cmp_ps(minX, _mm256_set1_ps(sap.mpMaxX[i]), _CMP_LE_OQ);
+			__m256 inY = _mm256_and_ps(
+				_mm256_cmp_ps(_mm256_loadu_ps(sap.mpMinY + j), _mm256_set1_ps(sap.mpMaxY[i]), _CMP_LE_OQ),
+				_mm256_cmp_ps(_mm256_loadu_ps(sap.mpMaxY + j), _mm256_set1_ps(sap.mpMinY[i]), _CMP_GE_OQ));
+			__m256 inZ = _mm256_and_ps(
+				_mm256_cmp_ps(_mm256_loadu_ps(sap.mpMinZ + j), _mm256_set1_ps(sap.mpMaxZ[i]), _CMP_LE_OQ),
+				_mm256_cmp_ps(_mm256_loadu_ps(sap.mpMaxZ + j), _mm256_set1_ps(sap.mpMinZ[i]), _CMP_GE_OQ));
+			maskX = uint32_t(_mm256_movemask_ps(inX));
+			mask = uint32_t(_mm256_movemask_ps(_mm256_and_ps(inX, _mm256_and_ps(inY, inZ))));
+#elif defined(GW_SIMD_SSE)
+			__m128 minX = _mm_loadu_ps(sap.mpMinX + j);
+			__m128 inX = _mm_cmple_ps(minX, _mm_set1_ps(sap.mpMaxX[i]));
+			__m128 inY = _mm_and_ps(
+				_mm_cmple_ps(_mm_loadu_ps(sap.mpMinY + j), _mm_set1_ps(sap.mpMaxY[i])),
+				_mm_cmpge_ps(_mm_loadu_ps(sap.mpMaxY + j), _mm_set1_ps(sap.mpMinY[i])));
+			__m128 inZ = _mm_and_ps(
+				_mm_cmple_ps(_mm_loadu_ps(sap.mpMinZ + j), _mm_set1_ps(sap.mpMaxZ[i])),
+				_mm_cmpge_ps(_mm_loadu_ps(sap.mpMaxZ + j), _mm_set1_ps(sap.mpMinZ[i])));
+			maskX = uint32_t(_mm_movemask_ps(inX));
+			mask = uint32_t(_mm_movemask_ps(_mm_and_ps(inX, _mm_and_ps(inY, inZ))));
+#else
+			for (int k = 0; k < SWEEP_WIDTH; ++k) {
+				int s = j + k;
+				if (sap.mpMinX[s] > sap.mpMaxX[i]) { continue; }
+				maskX |= 1U << k;
+				if (sap.mpMinY[s] > sap.mpMaxY[i] || sap.mpMaxY[s] < sap.mpMinY[i]) { continue; }
+				if (sap.mpMinZ[s] > sap.mpMaxZ[i] || sap.mpMaxZ[s] < sap.mpMinZ[i]) { continue; }
+				mask |= 1U << k;
+			}
+#endif
+			int nlanes = std::min(SWEEP_WIDTH, n - j);
+			uint32_t lanes = (1U << nlanes) - 1;
+			mask &= lanes;
+			for (int k = 0; k < nlanes; ++k) {
+				if (mask & (1U << k)) {
+					out.push_back(make_pair(objA, sap.mpOrder[j + k]));
+				}
+			}
+			if ((maskX & lanes) != lanes) { break; }
+		}
+	}
+
+	int SweepAndPrune::find_pairs(bool parallel) {
+		std::vector<Pair> pairs;
+		collect_pairs(pairs, mNumObj, parallel, [&](int i, std::vector<Pair>& out) {
+			sweep_slot(*this, i, out);
+		});
+		mNumPairs = int32_t(pairs.size());
+		reserve(mpPairs, mPairCapacity, std::max(mNumPairs, 1));
+		std::copy(pairs.begin(), pairs.end(), mpPairs);
+		return mNumPairs;
+	}
+
+	SweepAndPrune* SweepAndPrune::create() {
+		SweepAndPrune* pSAP = reinterpret_cast<SweepAndPrune*>(GWSys::alloc_rsrc_mem(sizeof(SweepAndPrune)));
+		std::memset(reinterpret_cast<void*>(pSAP), 0, sizeof(SweepAndPrune));
+		return pSAP;
+	}
+
+	void SweepAndPrune::destroy(SweepAndPrune* pSAP) {
+		if (pSAP == nullptr) { return; }
+		void* ppMem[] = {
+			pSAP->mpBoxMin, pSAP->mpBoxMax, pSAP->mpOrder, pSAP->mpKeys,
+			pSAP->mpMinX, pSAP->mpMaxX, pSAP->mpMinY, pSAP->mpMaxY, pSAP->mpMinZ, pSAP->mpMaxZ, pSAP->mpPairs
+		};
+		for (void* pMem : ppMem) {
+			if (pMem) {
+				GWSys::free_rsrc_mem(pMem);
+			}
+		}
+		GWSys::free_rsrc_mem(pSAP);
+	}
+}
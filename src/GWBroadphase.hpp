@@ -0,0 +1,160 @@
+/*
+ * Author: Gleb Novodran <novodran@gmail.com>
+ */
+
+// Broadphase structures reporting the overlapping pairs among many dynamic spheres.
+namespace GWBroadphase {
+
+	// mA < mB
+	struct Pair {
+		int32_t mA;
+		int32_t mB;
+	};
+
+	// Uniform grid hashed into a table of buckets. The entries are a flat array sorted by bucket and then by object,
+	// every object is listed once in each bucket its box touches. A pair is reported only from the bucket of the cell
+	// holding the min corner of the boxes' intersection, so no pair comes out twice.
+	// Objects covering more than MAX_OBJ_CELLS cells are kept out of the grid and tested against everything.
+	class SpatialHash {
+	public:
+		static const int MAX_OBJ_CELLS = 64;
+
+		struct CellRange {
+			int32_t mMin[3];
+			int32_t mMax[3];
+
+			int get_num_cells() const {
+				int64_t n = 1;
+				for (int i = 0; i < 3; ++i) {
+					n *= int64_t(mMax[i]) - mMin[i] + 1;
+					if (n > MAX_OBJ_CELLS) { return MAX_OBJ_CELLS + 1; }
+				}
+				return int(n);
+			}
+			bool same(const CellRange& rng) const {
+				for (int i = 0; i < 3; ++i) {
+					if (mMin[i] != rng.mMin[i] || mMax[i] != rng.mMax[i]) { return false; }
+				}
+				return true;
+			}
+		};
+
+		enum State : uint8_t {
+			IN_GRID = 0,
+			LARGE = 1,
+			MOVED = 2
+		};
+
+		float mCellSize;
+		float mInvCellSize;
+		GWSphereF* mpSph;
+		CellRange* mpRanges;
+		uint8_t* mpState;
+		int32_t* mpLarge;
+		int32_t* mpMoved;
+		int32_t mNumObj;
+		int32_t mNumLarge;
+		int32_t mNumMoved;
+		int32_t mObjCapacity;
+
+		int32_t* mpBucketOrg; // mTableSize + 1 entries
+		int32_t* mpEntries; // object indices sorted by bucket, then by index
+		uint32_t mTableSize;
+		uint32_t mTableCapacity;
+		int32_t mNumEntries;
+		int32_t mEntryCapacity;
+
+		Pair* mpPairs;
+		int32_t mNumPairs;
+		int32_t mPairCapacity;
+
+	private:
+		SpatialHash() {}
+
+	public:
+		CellRange calc_range(const GWSphereF& sph) const;
+		uint32_t calc_bucket(int32_t x, int32_t y, int32_t z) const {
+			uint32_t h = (uint32_t(x) * 73856093U) ^ (uint32_t(y) * 19349663U) ^ (uint32_t(z) * 83492791U);
+			return h & (mTableSize - 1);
+		}
+
+		// cell size <= 0 : picked from the spheres at the next build
+		void set_cell_size(float size) { mCellSize = size; }
+		float get_cell_size() const { return mCellSize; }
+		static float suggest_cell_size(const GWSphereF* pSph, int num);
+		int get_num_moved() const { return mNumMoved; }
+		int get_num_large() const { return mNumLarge; }
+
+		void build(const GWSphereF* pSph, int num, bool parallel = true);
+		// Objects that stay in their cells are updated in place, the ones that leave them are handled separately
+		// until the next build, which happens on its own once too many have moved.
+		void update(const int32_t* pIdx, const GWSphereF* pSph, int num, bool parallel = true);
+		void update(int32_t idx, const GWSphereF& sph, bool parallel = true) { update(&idx, &sph, 1, parallel); }
+
+		// Collects the overlapping pairs, the order doesn't depend on the parallel flag.
+		int find_pairs(bool parallel = true);
+		const Pair* get_pairs() const { return mpPairs; }
+		int get_num_pairs() const { return mNumPairs; }
+
+		int get_num_objects() const { return mNumObj; }
+		const GWSphereF& get_sphere(int idx) const { return mpSph[idx]; }
+
+		static SpatialHash* create(float cellSize = 0.0f);
+		static void destroy(SpatialHash* pHash);
+	};
+
+	// Sort-and-sweep over boxes, for sets where the sizes vary too much for one grid cell size.
+	// The boxes are kept sorted by min x, each one is swept against the boxes starting before its max x
+	// and those are tested on y and z in SIMD blocks. Overlap is inclusive, as in GWOverlap::aabb_aabb.
+	// Boxes are expected to be finite.
+	class SweepAndPrune {
+	public:
+		// per object
+		GWVectorF* mpBoxMin;
+		GWVectorF* mpBoxMax;
+		// per sorted slot: object index, min x key and the box in SoA form
+		int32_t* mpOrder;
+		uint32_t* mpKeys;
+		float* mpMinX;
+		float* mpMaxX;
+		float* mpMinY;
+		float* mpMaxY;
+		float* mpMinZ;
+		float* mpMaxZ;
+		int32_t mNumObj;
+		int32_t mObjCapacity;
+		int32_t mNumSwaps; // done by the last update
+
+		Pair* mpPairs;
+		int32_t mNumPairs;
+		int32_t mPairCapacity;
+
+	private:
+		SweepAndPrune() {}
+
+		void sort(bool parallel);
+		void resort(bool parallel);
+		void gather(bool parallel);
+
+	public:
+		// Order preserving integer key of a float, keys compare as the values do.
+		static uint32_t calc_key(float val);
+
+		void build(const GWVectorF* pMin, const GWVectorF* pMax, int num, bool parallel = true);
+		// The order is restored by insertion sort, which is close to linear when the objects move a little
+		// between the calls; a full sort is done instead when the order changes too much.
+		void update(const GWVectorF* pMin, const GWVectorF* pMax, bool parallel = true);
+		void update(const int32_t* pIdx, const GWVectorF* pMin, const GWVectorF* pMax, int num, bool parallel = true);
+
+		// Collects the overlapping pairs, the order doesn't depend on the parallel flag.
+		int find_pairs(bool parallel = true);
+		const Pair* get_pairs() const { return mpPairs; }
+		int get_num_pairs() const { return mNumPairs; }
+
+		int get_num_objects() const { return mNumObj; }
+		int get_num_swaps() const { return mNumSwaps; }
+
+		static SweepAndPrune* create();
+		static void destroy(SweepAndPrune* pSAP);
+	};
+}
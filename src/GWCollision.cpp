@@ -0,0 +1,1512 @@
+/*
+ * Author: Gleb Novodran <novodran@gmail.com>
+ */
+
+#include <atomic>
+#include <cfloat>
+#include <vector>
+#include "groundwork.hpp"
+
+namespace GWCollision {
+
+	template<typename T> class QueryStack {
+	protected:
+		static const int INLINE_SIZE = 64;
+		T mInline[INLINE_SIZE];
+		T* mpItems;
+		int mSize;
+		int mCapacity;
+
+	public:
+		QueryStack() : mpItems(mInline), mSize(0), mCapacity(INLINE_SIZE) {}
+		~QueryStack() {
+			if (mpItems != mInline) {
+				GWSys::free_temp_mem(mpItems);
+			}
+		}
+
+		bool empty() const { return mSize == 0; }
+		T pop() { return mpItems[--mSize]; }
+
+		void push(const T& item) {
+			if (mSize >= mCapacity) {
+				int newCapacity = mCapacity * 2;
+				T* pNew = reinterpret_cast<T*>(GWSys::alloc_temp_mem(newCapacity * sizeof(T)));
+				std::memcpy(pNew, mpItems, mSize * sizeof(T));
+				if (mpItems != mInline) {
+					GWSys::free_temp_mem(mpItems);
+				}
+				mpItems = pNew;
+				mCapacity = newCapacity;
+			}
+			mpItems[mSize++] = item;
+		}
+	};
+
+	typedef QueryStack<int32_t> NodeStack;
+
+	// FUNC_T(v0, v1, v2, polIdx, triIdx) returns false to stop
+	template<typename FUNC_T> static void for_poly_tris(const GWCollisionResource& cls, int polIdx, const FUNC_T& func) {
+		const GWCollisionResource::Poly* pPol = &cls.get_pols_top()[polIdx];
+		const GWVectorF* pPnts = cls.get_pnts_top();
+		const int32_t* pIdx = cls.get_idx_top() + pPol->mOffsIdx;
+		const int32_t* pTris = pPol->mNumVtx > 3 ? cls.get_tris_top() + pPol->mOffsTris : nullptr;
+		int ntri = pPol->mNumVtx - 2;
+		for (int i = 0; i < ntri; ++i) {
+			const GWVectorF* pVtx[3];
+			for (int j = 0; j < 3; ++j) {
+				pVtx[j] = &pPnts[pIdx[pTris ? pTris[i * 3 + j] : j]];
+			}
+			if (!func(*pVtx[0], *pVtx[1], *pVtx[2], polIdx, i)) { return; }
+		}
+	}
+
+	// Ordered BVH traversal, QRY_T provides test_box() against its current span and done() for early exits.
+	template<typename QRY_T, typename LEAF_FUNC> static void traverse_bvh(QRY_T& qry, const GWCollisionResource::BVHNode* pNodes, const LEAF_FUNC& leaf) {
+		if (!pNodes) { return; }
+		if (!qry.test_box(pNodes[0].mBBoxMin, pNodes[0].mBBoxMax)) { return; }
+		NodeStack stk;
+		stk.push(0);
+		while (!stk.empty()) {
+			const GWCollisionResource::BVHNode* pNode = &pNodes[stk.pop()];
+			if (pNode->is_leaf()) {
+				// the leaf box is tested when the node is pushed, re-check against the current best hit
+				if (qry.test_box(pNode->mBBoxMin, pNode->mBBoxMax)) {
+					leaf(pNode->get_poly_id());
+					if (qry.done()) { return; }
+				}
+			} else {
+				float tl, tr;
+				const GWCollisionResource::BVHNode* pLeft = &pNodes[pNode->mLeft];
+				const GWCollisionResource::BVHNode* pRight = &pNodes[pNode->mRight];
+				bool hitL = qry.test_box(pLeft->mBBoxMin, pLeft->mBBoxMax, &tl);
+				bool hitR = qry.test_box(pRight->mBBoxMin, pRight->mBBoxMax, &tr);
+				if (hitL && hitR) {
+					// far child first, so that the near one is popped next
+					if (tl <= tr) {
+						stk.push(pNode->mRight);
+						stk.push(pNode->mLeft);
+					} else {
+						stk.push(pNode->mLeft);
+						stk.push(pNode->mRight);
+					}
+				} else if (hitL) {
+					stk.push(pNode->mLeft);
+				} else if (hitR) {
+					stk.push(pNode->mRight);
+				}
+			}
+		}
+	}
+
+	struct SegQuery {
+		GWVectorF mOrg;
+		GWVectorF mEnd;
+		GWVectorF mInvDir;
+		bool mAnyHit;
+
+		bool mFound;
+		float mBestT;
+		GWVectorF mPos;
+		GWVectorF mNrm;
+		int32_t mPolIdx;
+		int32_t mTriIdx;
+
+		SegQuery() {}
+		SegQuery(const GWVectorF& p, const GWVectorF& q, bool anyHit) { init(p, q, anyHit); }
+
+		void init(const GWVectorF& p, const GWVectorF& q, bool anyHit) {
+			mOrg = p;
+			mEnd = q;
+			mInvDir = GWOverlap::calc_inv_dir(q - p);
+			mAnyHit = anyHit;
+			mFound = false;
+			mBestT = 1.0f;
+			mPolIdx = -1;
+			mTriIdx = -1;
+		}
+
+		// ties are resolved by poly and triangle index, so the result doesn't depend on the traversal order
+		bool is_closer(float t, int32_t polIdx, int32_t triIdx) const {
+			if (!mFound) { return true; }
+			if (t != mBestT) { return t < mBestT; }
+			return polIdx != mPolIdx ? polIdx < mPolIdx : triIdx < mTriIdx;
+		}
+
+		bool done() const { return mAnyHit && mFound; }
+
+		bool test_box(const GWVectorF& bbMin, const GWVectorF& bbMax, float* pTEntry = nullptr) const {
+			return GWOverlap::seg_aabb_slab(mOrg, mInvDir, 0.0f, mBestT, bbMin, bbMax, pTEntry);
+		}
+
+		void test_tri(const GWVectorF& v0, const GWVectorF& v1, const GWVectorF& v2, int32_t polIdx, int32_t triIdx) {
+			GWVectorF pos;
+			GWVectorF nrm;
+			float t;
+			// collision and model geometry are stored with clockwise winding
+			if (GWIntersect::seg_tri_cw(mOrg, mEnd, v0, v1, v2, &pos, &nrm, &t)) {
+				if (is_closer(t, polIdx, triIdx)) {
+					mFound = true;
+					mBestT = t;
+					mPos = pos;
+					mNrm = nrm;
+					mPolIdx = polIdx;
+					mTriIdx = triIdx;
+				}
+			}
+		}
+
+		void test_poly(const GWCollisionResource& cls, int polIdx) {
+			for_poly_tris(cls, polIdx, [this](const GWVectorF& v0, const GWVectorF& v1, const GWVectorF& v2, int32_t pol, int32_t tri) {
+				test_tri(v0, v1, v2, pol, tri);
+				return !done();
+			});
+		}
+
+		void exec(const GWCollisionResource& cls) {
+			if (cls.has_bvh()) {
+				traverse_bvh(*this, cls.get_bvh_top(), [&](int32_t polIdx) { test_poly(cls, polIdx); });
+			} else {
+				exec_brute(cls);
+			}
+		}
+
+		void exec(const GWBVH::ModelBVH& mbvh) {
+			traverse_bvh(*this, mbvh.mpNodes, [&](int32_t triIdx) {
+				const uint32_t* pTri = mbvh.get_tri_pnt_indices(triIdx);
+				test_tri(mbvh.mpPnts[pTri[0]], mbvh.mpPnts[pTri[1]], mbvh.mpPnts[pTri[2]], triIdx, 0);
+			});
+		}
+
+		void exec_brute(const GWCollisionResource& cls) {
+			const GWCollisionResource::Poly* pPols = cls.get_pols_top();
+			if (!pPols) { return; }
+			for (int i = 0; i < cls.mNumPol; ++i) {
+				if (test_box(pPols[i].mBBoxMin, pPols[i].mBBoxMax)) {
+					test_poly(cls, i);
+					if (done()) { return; }
+				}
+			}
+		}
+
+		void get_hit(HitInfo* pHit, float tScale) const {
+			if (pHit) {
+				if (!mFound) {
+					pHit->reset();
+					return;
+				}
+				pHit->mPos = mPos;
+				pHit->mNrm = mNrm;
+				pHit->mT = mBestT * tScale;
+				pHit->mPolIdx = mPolIdx;
+				pHit->mTriIdx = mTriIdx;
+			}
+		}
+	};
+
+#if defined(GW_SIMD_AVX)
+	static const int PACKET_SIZE = 8;
+#else
+	static const int PACKET_SIZE = 4;
+#endif
+
+	// Up to PACKET_SIZE segments traversing the BVH together: node boxes are tested for all lanes at once,
+	// leaf polygons are tested per lane with the scalar code, so the hits are identical to the single queries.
+	struct SegPacket {
+		alignas(32) float mOrg[3][PACKET_SIZE];
+		alignas(32) float mInvDir[3][PACKET_SIZE];
+		alignas(32) float mTMax[PACKET_SIZE];
+		SegQuery mQry[PACKET_SIZE];
+		uint32_t mActive;
+		int mNum;
+
+		void init(int num) {
+			mNum = num;
+			mActive = 0;
+			for (int i = 0; i < PACKET_SIZE; ++i) {
+				bool valid = i < num;
+				for (int j = 0; j < 3; ++j) {
+					mOrg[j][i] = valid ? mQry[i].mOrg[j] : 0.0f;
+					mInvDir[j][i] = valid ? mQry[i].mInvDir[j] : 1.0f;
+				}
+				// inactive lanes get an empty span
+				mTMax[i] = valid ? mQry[i].mBestT : -1.0f;
+				if (valid) { mActive |= 1U << i; }
+			}
+		}
+
+		uint32_t test_box(const GWVectorF& bbMin, const GWVectorF& bbMax, float* pTEntry) const {
+			uint32_t mask = 0;
+#if defined(GW_SIMD_AVX)
+			__m256 tmin = _mm256_setzero_ps();
+			__m256 tmax = _mm256_load_ps(mTMax);
+			for (int i = 0; i < 3; ++i) {
+				__m256 org = _mm256_load_ps(mOrg[i]);
+				__m256 inv = _mm256_load_ps(mInvDir[i]);
+				__m256 t0 = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(bbMin[i]), org), inv);
+				__m256 t1 = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(bbMax[i]), org), inv);
+				tmin = _mm256_max_ps(tmin, _mm256_min_ps(t0, t1));
+				tmax = _mm256_min_ps(tmax, _mm256_max_ps(t0, t1));
+			}
+			_mm256_storeu_ps(pTEntry, tmin);
+			mask = uint32_t(_mm256_movemask_ps(_mm256_cmp_ps(tmin, tmax, _CMP_LE_OQ)));
+#elif defined(GW_SIMD_SSE)
+			__m128 tmin = _mm_setzero_ps();
+			__m128 tmax = _mm_load_ps(mTMax);
+			for (int i = 0; i < 3; ++i) {
+				__m128 org = _mm_load_ps(mOrg[i]);
+				__m128 inv = _mm_load_ps(mInvDir[i]);
+				__m128 t0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(bbMin[i]), org), inv);
+				__m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(bbMax[i]), org), inv);
+				tmin = _mm_max_ps(tmin, _mm_min_ps(t0, t1));
+				tmax = _mm_min_ps(tmax, _mm_max_ps(t0, t1));
+			}
+			_mm_storeu_ps(pTEntry, tmin);
+			mask = uint32_t(_mm_movemask_ps(_mm_cmple_ps(tmin, tmax)));
+#else
+			for (int i = 0; i < PACKET_SIZE; ++i) {
+				float tmin = 0.0f;
+				float tmax = mTMax[i];
+				for (int j = 0; j < 3; ++j) {
+					float t0 = (bbMin[j] - mOrg[j][i]) * mInvDir[j][i];
+					float t1 = (bbMax[j] - mOrg[j][i]) * mInvDir[j][i];
+					tmin = std::max(tmin, std::min(t0, t1));
+					tmax = std::min(tmax, std::max(t0, t1));
+				}
+				pTEntry[i] = tmin;
+				if (tmin <= tmax) { mask |= 1U << i; }
+			}
+#endif
+			return mask & mActive;
+		}
+
+		static float min_entry(const float* pTEntry, uint32_t mask) {
+			float tmin = 1.0f;
+			for (int i = 0; i < PACKET_SIZE; ++i) {
+				if (mask & (1U << i)) { tmin = std::min(tmin, pTEntry[i]); }
+			}
+			return tmin;
+		}
+
+		void test_poly(const GWCollisionResource& cls, int polIdx, uint32_t mask) {
+			for (int i = 0; i < PACKET_SIZE; ++i) {
+				if (mask & (1U << i)) {
+					SegQuery& qry = mQry[i];
+					qry.test_poly(cls, polIdx);
+					mTMax[i] = qry.mBestT;
+					if (qry.done()) {
+						mActive &= ~(1U << i);
+						mTMax[i] = -1.0f;
+					}
+				}
+			}
+		}
+
+		void exec(const GWCollisionResource& cls) {
+			if (!cls.has_bvh()) {
+				for (int i = 0; i < mNum; ++i) {
+					mQry[i].exec_brute(cls);
+				}
+				return;
+			}
+			const GWCollisionResource::BVHNode* pNodes = cls.get_bvh_top();
+			if (!pNodes) { return; }
+			float tl[PACKET_SIZE];
+			float tr[PACKET_SIZE];
+			if (!test_box(pNodes[0].mBBoxMin, pNodes[0].mBBoxMax, tl)) { return; }
+			NodeStack stk;
+			stk.push(0);
+			while (!stk.empty() && mActive) {
+				const GWCollisionResource::BVHNode* pNode = &pNodes[stk.pop()];
+				if (pNode->is_leaf()) {
+					uint32_t mask = test_box(pNode->mBBoxMin, pNode->mBBoxMax, tl);
+					if (mask) {
+						test_poly(cls, pNode->get_poly_id(), mask);
+					}
+				} else {
+					const GWCollisionResource::BVHNode* pLeft = &pNodes[pNode->mLeft];
+					const GWCollisionResource::BVHNode* pRight = &pNodes[pNode->mRight];
+					uint32_t maskL = test_box(pLeft->mBBoxMin, pLeft->mBBoxMax, tl);
+					uint32_t maskR = test_box(pRight->mBBoxMin, pRight->mBBoxMax, tr);
+					if (maskL && maskR) {
+						if (min_entry(tl, maskL) <= min_entry(tr, maskR)) {
+							stk.push(pNode->mRight);
+							stk.push(pNode->mLeft);
+						} else {
+							stk.push(pNode->mLeft);
+							stk.push(pNode->mRight);
+						}
+					} else if (maskL) {
+						stk.push(pNode->mLeft);
+					} else if (maskR) {
+						stk.push(pNode->mRight);
+					}
+				}
+			}
+		}
+	};
+
+	// Coherence key: direction octant in the high bits, Morton code of the origin within the resource bbox below,
+	// the segment index in the low 32 bits keeps the order stable.
+	static uint32_t spread_bits(uint32_t x) {
+		x &= 0x1FF;
+		x = (x | (x << 16)) & 0x030000FF;
+		x = (x | (x << 8)) & 0x0300F00F;
+		x = (x | (x << 4)) & 0x030C30C3;
+		x = (x | (x << 2)) & 0x09249249;
+		return x;
+	}
+
+	template<typename SEG_FUNC> static void sort_segs(uint32_t* pOrder, int nseg, const GWCollisionResource& cls, const SEG_FUNC& seg) {
+		uint64_t* pKeys = reinterpret_cast<uint64_t*>(GWSys::alloc_temp_mem(nseg * sizeof(uint64_t)));
+		GWVectorF bbMin = cls.mBBoxMin;
+		GWVectorF ext = cls.mBBoxMax - cls.mBBoxMin;
+		GWVectorF scl;
+		for (int i = 0; i < 3; ++i) {
+			scl[i] = ext[i] > 0.0f ? 511.0f / ext[i] : 0.0f;
+		}
+		for (int i = 0; i < nseg; ++i) {
+			GWVectorF p, q;
+			seg(i, p, q);
+			GWVectorF d = q - p;
+			uint32_t octant = (d.x < 0.0f ? 1 : 0) | (d.y < 0.0f ? 2 : 0) | (d.z < 0.0f ? 4 : 0);
+			uint32_t code = 0;
+			for (int j = 0; j < 3; ++j) {
+				float c = GWBase::clamp((p[j] - bbMin[j]) * scl[j], 0.0f, 511.0f);
+				code |= spread_bits(uint32_t(c)) << j;
+			}
+			uint64_t key = (uint64_t(octant) << 27) | code;
+			pKeys[i] = (key << 32) | uint64_t(i);
+		}
+		std::sort(pKeys, pKeys + nseg);
+		for (int i = 0; i < nseg; ++i) {
+			pOrder[i] = uint32_t(pKeys[i] & 0xFFFFFFFF);
+		}
+		GWSys::free_temp_mem(pKeys);
+	}
+
+	template<typename SEG_FUNC> static int exec_batch(const GWCollisionResource& cls, int nseg, const SEG_FUNC& seg, bool anyHit, bool sort,
+		HitInfo* pHits, bool* pRes, float tScale) {
+		if (nseg <= 0) { return 0; }
+		uint32_t* pOrder = nullptr;
+		if (sort) {
+			pOrder = reinterpret_cast<uint32_t*>(GWSys::alloc_temp_mem(nseg * sizeof(uint32_t)));
+			sort_segs(pOrder, nseg, cls, seg);
+		}
+		int nhit = 0;
+		SegPacket pkt;
+		for (int org = 0; org < nseg; org += PACKET_SIZE) {
+			int num = std::min(PACKET_SIZE, nseg - org);
+			uint32_t idx[PACKET_SIZE];
+			for (int i = 0; i < num; ++i) {
+				idx[i] = pOrder ? pOrder[org + i] : uint32_t(org + i);
+				GWVectorF p, q;
+				seg(idx[i], p, q);
+				pkt.mQry[i].init(p, q, anyHit);
+			}
+			pkt.init(num);
+			pkt.exec(cls);
+			for (int i = 0; i < num; ++i) {
+				const SegQuery& qry = pkt.mQry[i];
+				if (qry.mFound) { ++nhit; }
+				if (pHits) { qry.get_hit(&pHits[idx[i]], tScale); }
+				if (pRes) { pRes[idx[i]] = qry.mFound; }
+			}
+		}
+		if (pOrder) {
+			GWSys::free_temp_mem(pOrder);
+		}
+		return nhit;
+	}
+
+	struct SegArraySrc {
+		const GWVectorF* mpSegs;
+		void operator ()(int i, GWVectorF& p, GWVectorF& q) const {
+			p = mpSegs[i * 2];
+			q = mpSegs[i * 2 + 1];
+		}
+	};
+
+	struct RayArraySrc {
+		const GWRayF* mpRays;
+		float mMaxDist;
+		void operator ()(int i, GWVectorF& p, GWVectorF& q) const {
+			p = mpRays[i].origin();
+			q = mpRays[i].at(mMaxDist);
+		}
+	};
+
+	bool seg_first_hit(const GWCollisionResource& cls, const GWVectorF& p, const GWVectorF& q, HitInfo* pHit) {
+		SegQuery qry(p, q, false);
+		qry.exec(cls);
+		if (qry.mFound) {
+			qry.get_hit(pHit, 1.0f);
+		}
+		return qry.mFound;
+	}
+
+	bool seg_any_hit(const GWCollisionResource& cls, const GWVectorF& p, const GWVectorF& q) {
+		SegQuery qry(p, q, true);
+		qry.exec(cls);
+		return qry.mFound;
+	}
+
+	bool ray_first_hit(const GWCollisionResource& cls, const GWRayF& ray, float maxDist, HitInfo* pHit) {
+		GWVectorF p = ray.origin();
+		GWVectorF q = ray.at(maxDist);
+		SegQuery qry(p, q, false);
+		qry.exec(cls);
+		if (qry.mFound) {
+			qry.get_hit(pHit, maxDist);
+		}
+		return qry.mFound;
+	}
+
+	bool ray_any_hit(const GWCollisionResource& cls, const GWRayF& ray, float maxDist) {
+		return seg_any_hit(cls, ray.origin(), ray.at(maxDist));
+	}
+
+	int segs_first_hit(const GWCollisionResource& cls, const GWVectorF* pSegs, int nseg, HitInfo* pHits, bool sort) {
+		SegArraySrc src = { pSegs };
+		return exec_batch(cls, nseg, src, false, sort, pHits, nullptr, 1.0f);
+	}
+
+	int segs_any_hit(const GWCollisionResource& cls, const GWVectorF* pSegs, int nseg, bool* pRes, bool sort) {
+		SegArraySrc src = { pSegs };
+		return exec_batch(cls, nseg, src, true, sort, nullptr, pRes, 1.0f);
+	}
+
+	int rays_first_hit(const GWCollisionResource& cls, const GWRayF* pRays, int nray, float maxDist, HitInfo* pHits, bool sort) {
+		RayArraySrc src = { pRays, maxDist };
+		return exec_batch(cls, nray, src, false, sort, pHits, nullptr, maxDist);
+	}
+
+	int rays_any_hit(const GWCollisionResource& cls, const GWRayF* pRays, int nray, float maxDist, bool* pRes, bool sort) {
+		RayArraySrc src = { pRays, maxDist };
+		return exec_batch(cls, nray, src, true, sort, nullptr, pRes, maxDist);
+	}
+
+	size_t QBVH::get_node_size(QBVHKind kind) {
+		switch (kind) {
+			case QBVHKind::Q16: return sizeof(NodeQ16);
+			case QBVHKind::Q8: return sizeof(NodeQ8);
+			default: break;
+		}
+		return sizeof(Node);
+	}
+
+	static inline float calc_qscl(float min, float max, uint32_t qmax) {
+		return (max - min) * (1.0f / float(qmax));
+	}
+
+	static inline float dequant(float org, float scl, uint32_t q) {
+		return org + float(q) * scl;
+	}
+
+	// Conservative quantization of [cmin, cmax]: the decoded span is widened by a fraction of the step
+	// (at least eps) to absorb rounding differences between the build and the traversal.
+	static void quantize_span(float cmin, float cmax, float org, float scl, uint32_t qmax, float eps, uint32_t* pQMin, uint32_t* pQMax) {
+		uint32_t q0 = 0;
+		uint32_t q1 = qmax;
+		if (scl > 0.0f) {
+			float margin = std::max(scl * 0.01f, eps);
+			float rcp = 1.0f / scl;
+			q0 = uint32_t(GWBase::clamp(std::floor((cmin - margin - org) * rcp), 0.0f, float(qmax)));
+			q1 = uint32_t(GWBase::clamp(std::ceil((cmax + margin - org) * rcp), 0.0f, float(qmax)));
+			if (q1 <= q0) {
+				if (q1 < qmax) { q1 = q0 + 1; } else { q0 = q1 - 1; }
+			}
+		}
+		*pQMin = q0;
+		*pQMax = q1;
+	}
+
+	struct QBVHBuilder {
+		const GWCollisionResource::BVHNode* mpBin;
+		std::vector<QBVH::Node> mNodes;
+
+		static float calc_half_area(const GWCollisionResource::BVHNode& node) {
+			GWVectorF e = node.mBBoxMax - node.mBBoxMin;
+			return e.x*e.y + e.y*e.z + e.z*e.x;
+		}
+
+		int32_t emit(int32_t binIdx) {
+			int32_t children[4];
+			int n = 0;
+			const GWCollisionResource::BVHNode& bin = mpBin[binIdx];
+			if (bin.is_leaf()) {
+				// single poly tree
+				children[n++] = binIdx;
+			} else {
+				children[n++] = bin.mLeft;
+				children[n++] = bin.mRight;
+				// pull up the grandchildren of the largest inner children
+				while (n < 4) {
+					int best = -1;
+					float bestArea = -1.0f;
+					for (int i = 0; i < n; ++i) {
+						const GWCollisionResource::BVHNode& child = mpBin[children[i]];
+						if (!child.is_leaf()) {
+							float area = calc_half_area(child);
+							if (area > bestArea) {
+								bestArea = area;
+								best = i;
+							}
+						}
+					}
+					if (best < 0) { break; }
+					const GWCollisionResource::BVHNode& split = mpBin[children[best]];
+					children[best] = split.mLeft;
+					children[n++] = split.mRight;
+				}
+			}
+
+			int32_t nodeIdx = int32_t(mNodes.size());
+			mNodes.push_back(QBVH::Node());
+			int32_t codes[4];
+			for (int i = 0; i < 4; ++i) {
+				if (i < n) {
+					const GWCollisionResource::BVHNode& child = mpBin[children[i]];
+					codes[i] = child.is_leaf() ? -1 - child.get_poly_id() : emit(children[i]);
+				} else {
+					codes[i] = QBVH::EMPTY;
+				}
+			}
+			QBVH::Node& node = mNodes[nodeIdx];
+			for (int i = 0; i < 4; ++i) {
+				for (int j = 0; j < 3; ++j) {
+					node.mBounds[j][i] = i < n ? mpBin[children[i]].mBBoxMin[j] : 0.0f;
+					node.mBounds[j + 3][i] = i < n ? mpBin[children[i]].mBBoxMax[j] : 0.0f;
+				}
+				node.mChild[i] = codes[i];
+				node.mReserved[i] = 0;
+			}
+			return nodeIdx;
+		}
+
+		void calc_bbox(const QBVH::Node& node, float* pBox) const {
+			for (int j = 0; j < 3; ++j) {
+				pBox[j] = FLT_MAX;
+				pBox[j + 3] = -FLT_MAX;
+			}
+			for (int i = 0; i < 4; ++i) {
+				if (node.mChild[i] == QBVH::EMPTY) { continue; }
+				for (int j = 0; j < 3; ++j) {
+					pBox[j] = std::min(pBox[j], node.mBounds[j][i]);
+					pBox[j + 3] = std::max(pBox[j + 3], node.mBounds[j + 3][i]);
+				}
+			}
+		}
+
+		void make_q8(QBVH::NodeQ8* pDst, float eps) const {
+			for (size_t n = 0; n < mNodes.size(); ++n) {
+				const QBVH::Node& src = mNodes[n];
+				QBVH::NodeQ8& dst = pDst[n];
+				float box[6];
+				calc_bbox(src, box);
+				for (int j = 0; j < 3; ++j) {
+					dst.mOrg[j] = box[j] - eps;
+					dst.mScl[j] = calc_qscl(dst.mOrg[j], box[j + 3] + eps, 0xFF);
+				}
+				for (int i = 0; i < 4; ++i) {
+					for (int j = 0; j < 3; ++j) {
+						uint32_t q0 = 0;
+						uint32_t q1 = 0;
+						if (src.mChild[i] != QBVH::EMPTY) {
+							quantize_span(src.mBounds[j][i], src.mBounds[j + 3][i], dst.mOrg[j], dst.mScl[j], 0xFF, eps, &q0, &q1);
+						}
+						dst.mBounds[j][i] = uint8_t(q0);
+						dst.mBounds[j + 3][i] = uint8_t(q1);
+					}
+					dst.mChild[i] = src.mChild[i];
+				}
+			}
+		}
+
+		void make_q16(QBVH::NodeQ16* pDst, const float* pRootBox, float eps) const {
+			struct Entry {
+				int32_t mIdx;
+				float mBox[6];
+			};
+			std::vector<Entry> stk;
+			Entry root;
+			root.mIdx = 0;
+			std::memcpy(root.mBox, pRootBox, sizeof(root.mBox));
+			stk.push_back(root);
+			while (!stk.empty()) {
+				Entry ent = stk.back();
+				stk.pop_back();
+				const QBVH::Node& src = mNodes[ent.mIdx];
+				QBVH::NodeQ16& dst = pDst[ent.mIdx];
+				for (int i = 0; i < 4; ++i) {
+					Entry child;
+					child.mIdx = src.mChild[i];
+					for (int j = 0; j < 3; ++j) {
+						float org = ent.mBox[j];
+						float scl = calc_qscl(ent.mBox[j], ent.mBox[j + 3], 0xFFFF);
+						uint32_t q0 = 0;
+						uint32_t q1 = 0;
+						if (src.mChild[i] != QBVH::EMPTY) {
+							quantize_span(src.mBounds[j][i], src.mBounds[j + 3][i], org, scl, 0xFFFF, eps, &q0, &q1);
+						}
+						dst.mBounds[j][i] = uint16_t(q0);
+						dst.mBounds[j + 3][i] = uint16_t(q1);
+						child.mBox[j] = dequant(org, scl, q0);
+						child.mBox[j + 3] = dequant(org, scl, q1);
+					}
+					dst.mChild[i] = src.mChild[i];
+					if (child.mIdx >= 0) {
+						stk.push_back(child);
+					}
+				}
+			}
+		}
+	};
+
+	QBVH* QBVH::create(const GWCollisionResource& cls, QBVHKind kind) {
+		if (!cls.has_bvh()) { return nullptr; }
+		const GWCollisionResource::BVHNode* pBin = cls.get_bvh_top();
+		if (!pBin) { return nullptr; }
+
+		QBVHBuilder bld;
+		bld.mpBin = pBin;
+		bld.mNodes.reserve(cls.mNumPol / 2 + 1);
+		bld.emit(0);
+
+		float rootBox[6];
+		bld.calc_bbox(bld.mNodes[0], rootBox);
+		float eps = 0.0f;
+		if (kind != QBVHKind::FLOAT) {
+			float mag = 0.0f;
+			for (int j = 0; j < 6; ++j) {
+				mag = std::max(mag, std::fabs(rootBox[j]));
+			}
+			eps = mag * 1.0e-5f + 1.0e-12f;
+			for (int j = 0; j < 3; ++j) {
+				rootBox[j] -= eps;
+				rootBox[j + 3] += eps;
+			}
+		}
+
+		int32_t numNodes = int32_t(bld.mNodes.size());
+		size_t nodeSize = get_node_size(kind);
+		size_t memSz = sizeof(QBVH) + NODE_ALIGN + nodeSize * numNodes;
+		uint8_t* pMem = new uint8_t[memSz];
+		QBVH* pQBVH = reinterpret_cast<QBVH*>(pMem);
+		pQBVH->mpCls = &cls;
+		pQBVH->mpNodes = reinterpret_cast<void*>(GWBase::align(reinterpret_cast<uintptr_t>(pMem + sizeof(QBVH)), int(NODE_ALIGN)));
+		pQBVH->mNumNodes = numNodes;
+		pQBVH->mKind = kind;
+		GWTuple::set(pQBVH->mBBoxMin, rootBox[0], rootBox[1], rootBox[2]);
+		GWTuple::set(pQBVH->mBBoxMax, rootBox[3], rootBox[4], rootBox[5]);
+
+		switch (kind) {
+			case QBVHKind::Q16:
+				bld.make_q16(reinterpret_cast<NodeQ16*>(pQBVH->mpNodes), rootBox, eps);
+				break;
+			case QBVHKind::Q8:
+				bld.make_q8(reinterpret_cast<NodeQ8*>(pQBVH->mpNodes), eps);
+				break;
+			default:
+				std::memcpy(pQBVH->mpNodes, bld.mNodes.data(), nodeSize * numNodes);
+				break;
+		}
+		return pQBVH;
+	}
+
+	void QBVH::destroy(QBVH* pQBVH) {
+		if (pQBVH) {
+			delete[] reinterpret_cast<uint8_t*>(pQBVH);
+		}
+	}
+
+	static const int32_t* decode_qnode(const QBVH& qbvh, int32_t idx, const float* pBox, float bnd[6][4]) {
+		switch (qbvh.mKind) {
+			case QBVHKind::Q16: {
+				const QBVH::NodeQ16& node = qbvh.get_nodes_q16()[idx];
+				for (int j = 0; j < 3; ++j) {
+					float org = pBox[j];
+					float scl = calc_qscl(pBox[j], pBox[j + 3], 0xFFFF);
+					for (int i = 0; i < 4; ++i) {
+						bnd[j][i] = dequant(org, scl, node.mBounds[j][i]);
+						bnd[j + 3][i] = dequant(org, scl, node.mBounds[j + 3][i]);
+					}
+				}
+				return node.mChild;
+			}
+			case QBVHKind::Q8: {
+				const QBVH::NodeQ8& node = qbvh.get_nodes_q8()[idx];
+				for (int j = 0; j < 3; ++j) {
+					for (int i = 0; i < 4; ++i) {
+						bnd[j][i] = dequant(node.mOrg[j], node.mScl[j], node.mBounds[j][i]);
+						bnd[j + 3][i] = dequant(node.mOrg[j], node.mScl[j], node.mBounds[j + 3][i]);
+					}
+				}
+				return node.mChild;
+			}
+			default:
+				break;
+		}
+		const QBVH::Node& node = qbvh.get_nodes()[idx];
+		std::memcpy(bnd, node.mBounds, sizeof(node.mBounds));
+		return node.mChild;
+	}
+
+	static uint32_t test_box4(const SegQuery& qry, const float bnd[6][4], float* pTEntry) {
+#if defined(GW_SIMD_SSE)
+		__m128 tmin = _mm_setzero_ps();
+		__m128 tmax = _mm_set1_ps(qry.mBestT);
+		for (int i = 0; i < 3; ++i) {
+			__m128 org = _mm_set1_ps(qry.mOrg[i]);
+			__m128 inv = _mm_set1_ps(qry.mInvDir[i]);
+			__m128 t0 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(bnd[i]), org), inv);
+			__m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(bnd[i + 3]), org), inv);
+			tmin = _mm_max_ps(tmin, _mm_min_ps(t0, t1));
+			tmax = _mm_min_ps(tmax, _mm_max_ps(t0, t1));
+		}
+		_mm_store_ps(pTEntry, tmin);
+		return uint32_t(_mm_movemask_ps(_mm_cmple_ps(tmin, tmax)));
+#else
+		uint32_t mask = 0;
+		for (int i = 0; i < 4; ++i) {
+			float tmin = 0.0f;
+			float tmax = qry.mBestT;
+			for (int j = 0; j < 3; ++j) {
+				float t0 = (bnd[j][i] - qry.mOrg[j]) * qry.mInvDir[j];
+				float t1 = (bnd[j + 3][i] - qry.mOrg[j]) * qry.mInvDir[j];
+				tmin = std::max(tmin, std::min(t0, t1));
+				tmax = std::min(tmax, std::max(t0, t1));
+			}
+			pTEntry[i] = tmin;
+			if (tmin <= tmax) { mask |= 1U << i; }
+		}
+		return mask;
+#endif
+	}
+
+	static void exec_qbvh(SegQuery& qry, const QBVH& qbvh) {
+		struct Entry {
+			int32_t mIdx;
+			float mBox[6];
+		};
+		const GWCollisionResource& cls = *qbvh.mpCls;
+		Entry root;
+		root.mIdx = 0;
+		for (int j = 0; j < 3; ++j) {
+			root.mBox[j] = qbvh.mBBoxMin[j];
+			root.mBox[j + 3] = qbvh.mBBoxMax[j];
+		}
+		QueryStack<Entry> stk;
+		stk.push(root);
+		alignas(16) float bnd[6][4];
+		alignas(16) float tEntry[4];
+		while (!stk.empty()) {
+			Entry ent = stk.pop();
+			GWVectorF bbMin(ent.mBox[0], ent.mBox[1], ent.mBox[2]);
+			GWVectorF bbMax(ent.mBox[3], ent.mBox[4], ent.mBox[5]);
+			if (!qry.test_box(bbMin, bbMax)) { continue; }
+			if (QBVH::is_leaf(ent.mIdx)) {
+				qry.test_poly(cls, QBVH::get_poly_id(ent.mIdx));
+				if (qry.done()) { return; }
+				continue;
+			}
+			const int32_t* pChild = decode_qnode(qbvh, ent.mIdx, ent.mBox, bnd);
+			uint32_t mask = test_box4(qry, bnd, tEntry);
+			// hit children sorted far to near, so that the nearest one is popped first
+			int order[4];
+			int n = 0;
+			for (int i = 0; i < 4; ++i) {
+				if ((mask & (1U << i)) && pChild[i] != QBVH::EMPTY) {
+					int k = n++;
+					while (k > 0 && tEntry[order[k - 1]] < tEntry[i]) {
+						order[k] = order[k - 1];
+						--k;
+					}
+					order[k] = i;
+				}
+			}
+			for (int k = 0; k < n; ++k) {
+				int i = order[k];
+				Entry child;
+				child.mIdx = pChild[i];
+				for (int j = 0; j < 6; ++j) {
+					child.mBox[j] = bnd[j][i];
+				}
+				stk.push(child);
+			}
+		}
+	}
+
+	bool seg_first_hit(const QBVH& qbvh, const GWVectorF& p, const GWVectorF& q, HitInfo* pHit) {
+		SegQuery qry(p, q, false);
+		exec_qbvh(qry, qbvh);
+		if (qry.mFound) {
+			qry.get_hit(pHit, 1.0f);
+		}
+		return qry.mFound;
+	}
+
+	bool seg_any_hit(const QBVH& qbvh, const GWVectorF& p, const GWVectorF& q) {
+		SegQuery qry(p, q, true);
+		exec_qbvh(qry, qbvh);
+		return qry.mFound;
+	}
+
+	bool ray_first_hit(const QBVH& qbvh, const GWRayF& ray, float maxDist, HitInfo* pHit) {
+		SegQuery qry(ray.origin(), ray.at(maxDist), false);
+		exec_qbvh(qry, qbvh);
+		if (qry.mFound) {
+			qry.get_hit(pHit, maxDist);
+		}
+		return qry.mFound;
+	}
+
+	bool ray_any_hit(const QBVH& qbvh, const GWRayF& ray, float maxDist) {
+		return seg_any_hit(qbvh, ray.origin(), ray.at(maxDist));
+	}
+
+	bool seg_first_hit(const GWBVH::ModelBVH& mbvh, const GWVectorF& p, const GWVectorF& q, HitInfo* pHit) {
+		SegQuery qry(p, q, false);
+		qry.exec(mbvh);
+		if (qry.mFound) {
+			qry.get_hit(pHit, 1.0f);
+		}
+		return qry.mFound;
+	}
+
+	bool seg_any_hit(const GWBVH::ModelBVH& mbvh, const GWVectorF& p, const GWVectorF& q) {
+		SegQuery qry(p, q, true);
+		qry.exec(mbvh);
+		return qry.mFound;
+	}
+
+	bool ray_first_hit(const GWBVH::ModelBVH& mbvh, const GWRayF& ray, float maxDist, HitInfo* pHit) {
+		SegQuery qry(ray.origin(), ray.at(maxDist), false);
+		qry.exec(mbvh);
+		if (qry.mFound) {
+			qry.get_hit(pHit, maxDist);
+		}
+		return qry.mFound;
+	}
+
+	bool ray_any_hit(const GWBVH::ModelBVH& mbvh, const GWRayF& ray, float maxDist) {
+		return seg_any_hit(mbvh, ray.origin(), ray.at(maxDist));
+	}
+
+	int ray_skin_spheres(const GWBVH::ModelBVH& mbvh, const GWRayF& ray, float maxDist, float* pT) {
+		int nsph = mbvh.get_num_spheres();
+		GWVectorF org = ray.origin();
+		GWVectorF dir = ray.direction();
+		float a = dir.length_sq();
+		if (a <= 0.0f) { return -1; }
+		int hitIdx = -1;
+		float hitT = maxDist;
+		for (int i = 0; i < nsph; ++i) {
+			const GWSphereF& sph = mbvh.mpSph[i];
+			if (sph.r <= 0.0f) { continue; }
+			GWVectorF oc = org - sph.c;
+			float b = oc.dot(dir);
+			float c = oc.length_sq() - sph.r * sph.r;
+			float disc = b*b - a*c;
+			if (disc < 0.0f) { continue; }
+			// an origin inside the sphere counts as a hit at 0
+			float t = std::max((-b - GWBase::tsqrt(disc)) / a, 0.0f);
+			if (c > 0.0f && b > 0.0f) { continue; }
+			if (hitIdx < 0 ? t <= hitT : t < hitT) {
+				hitT = t;
+				hitIdx = i;
+			}
+		}
+		if (hitIdx >= 0 && pT) {
+			*pT = hitT;
+		}
+		return hitIdx;
+	}
+
+	// Earliest t in [0, tmax] at which org + t*dir is at distance r from v; org is expected outside.
+	static bool ray_sphere_toi(const GWVectorF& org, const GWVectorF& dir, const GWVectorF& v, float r, float tmax, float* pT) {
+		GWVectorF m = org - v;
+		float a = dir.length_sq();
+		float b = m.dot(dir);
+		float c = m.length_sq() - r*r;
+		if (b >= 0.0f || a <= 0.0f) { return false; }
+		float disc = b*b - a*c;
+		if (disc < 0.0f) { return false; }
+		float t = (-b - GWBase::tsqrt(disc)) / a;
+		if (t < 0.0f || t > tmax) { return false; }
+		*pT = t;
+		return true;
+	}
+
+	// Same for the lateral surface of the cylinder around segment e0-e1, pS receives the axis parameter.
+	static bool ray_cylinder_toi(const GWVectorF& org, const GWVectorF& dir, const GWVectorF& e0, const GWVectorF& e1, float r, float tmax, float* pT, float* pS) {
+		GWVectorF ev = e1 - e0;
+		GWVectorF m = org - e0;
+		float ee = ev.length_sq();
+		float md = m.dot(ev);
+		float nd = dir.dot(ev);
+		float a = ee * dir.length_sq() - nd*nd;
+		// moving along the axis: the end spheres are hit first
+		if (a <= 1.0e-12f * ee) { return false; }
+		float b = ee * m.dot(dir) - nd*md;
+		float c = ee * (m.length_sq() - r*r) - md*md;
+		if (b >= 0.0f) { return false; }
+		float disc = b*b - a*c;
+		if (disc < 0.0f) { return false; }
+		float t = (-b - GWBase::tsqrt(disc)) / a;
+		if (t < 0.0f || t > tmax) { return false; }
+		float s = (md + t*nd) / ee;
+		if (s < 0.0f || s > 1.0f) { return false; }
+		*pT = t;
+		*pS = s;
+		return true;
+	}
+
+	struct SweepContact {
+		float mT;
+		GWVectorF mPos;
+		GWVectorF mNrm;
+
+		void set(float t, const GWVectorF& pos, const GWVectorF& nrm) {
+			mT = t;
+			mPos = pos;
+			mNrm = nrm;
+		}
+	};
+
+	// Capsule a-b of radius r moving by d against triangle v[3], both sides of the triangle collide.
+	// The contact is the earliest of: capsule ends vs face, edges and vertices; axis vs triangle edges;
+	// triangle vertices vs the axis cylinder. For a sphere a == b.
+	static bool sweep_capsule_tri(const GWVectorF& a, const GWVectorF& b, float r, const GWVectorF& d, const GWVectorF v[3], float tmax, SweepContact* pCt) {
+		GWVectorF segPnt, triPnt;
+		float distSq = GWOverlap::seg_tri_dist_sq(a, b, v[0], v[1], v[2], &segPnt, &triPnt);
+		GWVectorF n;
+		n.cross(v[1] - v[0], v[2] - v[0]);
+		float nlen = n.length();
+		if (nlen <= 0.0f) { return false; }
+		n.scl(1.0f / nlen);
+		if (distSq <= r*r) {
+			// already touching
+			GWVectorF nrm = segPnt - triPnt;
+			float len = nrm.length();
+			if (len > 1.0e-6f) {
+				nrm.scl(1.0f / len);
+			} else {
+				nrm = n.dot(d) > 0.0f ? -n : n;
+			}
+			pCt->set(0.0f, triPnt, nrm);
+			return true;
+		}
+
+		bool found = false;
+		float best = tmax;
+		float t, s;
+		bool capsule = (b - a).length_sq() > 0.0f;
+		const GWVectorF* pEnds[2] = { &a, &b };
+		for (int i = 0; i < (capsule ? 2 : 1); ++i) {
+			const GWVectorF& p = *pEnds[i];
+			float s0 = (p - v[0]).dot(n);
+			float sd = d.dot(n);
+			float side = s0 > 0.0f ? 1.0f : -1.0f;
+			if (std::fabs(s0) > r && side * sd < 0.0f) {
+				t = (side * r - s0) / sd;
+				if (t >= 0.0f && t <= best) {
+					GWVectorF x = p + d * t - n * (side * r);
+					bool inside = true;
+					for (int j = 0; j < 3 && inside; ++j) {
+						GWVectorF e;
+						e.cross(v[(j + 1) % 3] - v[j], x - v[j]);
+						inside = e.dot(n) >= 0.0f;
+					}
+					if (inside) {
+						// the face is reached before its edges and vertices
+						best = t;
+						found = true;
+						pCt->set(t, x, n * side);
+					}
+				}
+			}
+			for (int j = 0; j < 3; ++j) {
+				const GWVectorF& e0 = v[j];
+				const GWVectorF& e1 = v[(j + 1) % 3];
+				if (ray_cylinder_toi(p, d, e0, e1, r, best, &t, &s)) {
+					GWVectorF x = e0 + (e1 - e0) * s;
+					best = t;
+					found = true;
+					pCt->set(t, x, (p + d * t - x) * (1.0f / r));
+				}
+				if (ray_sphere_toi(p, d, e0, r, best, &t)) {
+					best = t;
+					found = true;
+					pCt->set(t, e0, (p + d * t - e0) * (1.0f / r));
+				}
+			}
+		}
+
+		if (capsule) {
+			GWVectorF u = b - a;
+			GWVectorF nd = -d;
+			for (int j = 0; j < 3; ++j) {
+				const GWVectorF& e0 = v[j];
+				const GWVectorF& e1 = v[(j + 1) % 3];
+				// axis interior vs edge interior, separated along the common perpendicular
+				GWVectorF w = e1 - e0;
+				GWVectorF m;
+				m.cross(u, w);
+				float mlen = m.length();
+				if (mlen > 1.0e-6f * GWBase::tsqrt(u.length_sq() * w.length_sq())) {
+					m.scl(1.0f / mlen);
+					float m0 = (a - e0).dot(m);
+					float md = d.dot(m);
+					float side = m0 > 0.0f ? 1.0f : -1.0f;
+					if (std::fabs(m0) > r && side * md < 0.0f) {
+						t = (side * r - m0) / md;
+						if (t >= 0.0f && t <= best) {
+							float su, sw;
+							GWVectorF cu, cw;
+							GWVectorF at = a + d * t;
+							GWOverlap::seg_seg_closest(at, at + u, e0, e1, su, sw, cu, cw);
+							if (su > 0.0f && su < 1.0f && sw > 0.0f && sw < 1.0f) {
+								best = t;
+								found = true;
+								pCt->set(t, cw, m * side);
+							}
+						}
+					}
+				}
+				// triangle vertex vs the axis cylinder, in the capsule's frame the vertex moves by -d
+				if (ray_cylinder_toi(e0, nd, a, b, r, best, &t, &s)) {
+					GWVectorF axisPnt = a + u * s + d * t;
+					best = t;
+					found = true;
+					pCt->set(t, e0, (axisPnt - e0) * (1.0f / r));
+				}
+			}
+		}
+		return found;
+	}
+
+	struct SweepQuery {
+		GWVectorF mA;
+		GWVectorF mB;
+		GWVectorF mMove;
+		float mRadius;
+		// the box test sweeps the capsule center against boxes inflated by the capsule extents
+		GWVectorF mCtr;
+		GWVectorF mExt;
+		GWVectorF mInvDir;
+
+		bool mFound;
+		float mBestT;
+		GWVectorF mPos;
+		GWVectorF mNrm;
+		int32_t mPolIdx;
+		int32_t mTriIdx;
+
+		void init(const GWVectorF& a, const GWVectorF& b, float radius, const GWVectorF& move) {
+			mA = a;
+			mB = b;
+			mMove = move;
+			mRadius = radius;
+			mCtr = (a + b) * 0.5f;
+			GWTuple::abs(mExt, b - mCtr);
+			mExt += GWVectorF(radius);
+			mInvDir = GWOverlap::calc_inv_dir(move);
+			mFound = false;
+			mBestT = 1.0f;
+			mPolIdx = -1;
+			mTriIdx = -1;
+		}
+
+		bool is_closer(float t, int32_t polIdx, int32_t triIdx) const {
+			if (!mFound) { return true; }
+			if (t != mBestT) { return t < mBestT; }
+			return polIdx != mPolIdx ? polIdx < mPolIdx : triIdx < mTriIdx;
+		}
+
+		bool done() const { return false; }
+
+		bool test_box(const GWVectorF& bbMin, const GWVectorF& bbMax, float* pTEntry = nullptr) const {
+			return GWOverlap::seg_aabb_slab(mCtr, mInvDir, 0.0f, mBestT, bbMin - mExt, bbMax + mExt, pTEntry);
+		}
+
+		void test_poly(const GWCollisionResource& cls, int polIdx) {
+			for_poly_tris(cls, polIdx, [this](const GWVectorF& v0, const GWVectorF& v1, const GWVectorF& v2, int32_t pol, int32_t tri) {
+				GWVectorF vtx[3] = { v0, v1, v2 };
+				SweepContact ct;
+				if (sweep_capsule_tri(mA, mB, mRadius, mMove, vtx, mBestT, &ct) && is_closer(ct.mT, pol, tri)) {
+					mFound = true;
+					mBestT = ct.mT;
+					mPos = ct.mPos;
+					mNrm = ct.mNrm;
+					mPolIdx = pol;
+					mTriIdx = tri;
+				}
+				return true;
+			});
+		}
+
+		void exec(const GWCollisionResource& cls) {
+			if (cls.has_bvh()) {
+				traverse_bvh(*this, cls.get_bvh_top(), [&](int32_t polIdx) { test_poly(cls, polIdx); });
+			} else {
+				const GWCollisionResource::Poly* pPols = cls.get_pols_top();
+				for (int i = 0; pPols && i < cls.mNumPol; ++i) {
+					if (test_box(pPols[i].mBBoxMin, pPols[i].mBBoxMax)) {
+						test_poly(cls, i);
+					}
+				}
+			}
+		}
+
+		void get_hit(HitInfo* pHit) const {
+			if (pHit) {
+				if (!mFound) {
+					pHit->reset();
+					return;
+				}
+				pHit->mPos = mPos;
+				pHit->mNrm = mNrm;
+				pHit->mT = mBestT;
+				pHit->mPolIdx = mPolIdx;
+				pHit->mTriIdx = mTriIdx;
+			}
+		}
+	};
+
+	bool sphere_sweep(const GWCollisionResource& cls, const GWSphereF& sph, const GWVectorF& move, HitInfo* pHit) {
+		SweepQuery qry;
+		qry.init(sph.c, sph.c, sph.r, move);
+		qry.exec(cls);
+		if (qry.mFound) {
+			qry.get_hit(pHit);
+		}
+		return qry.mFound;
+	}
+
+	bool capsule_sweep(const GWCollisionResource& cls, const Capsule& cap, const GWVectorF& move, HitInfo* pHit) {
+		SweepQuery qry;
+		qry.init(cap.mA, cap.mB, cap.mRadius, move);
+		qry.exec(cls);
+		if (qry.mFound) {
+			qry.get_hit(pHit);
+		}
+		return qry.mFound;
+	}
+
+	template<typename INIT_FUNC> static int exec_sweeps(const GWCollisionResource& cls, int num, HitInfo* pHits, bool parallel, const INIT_FUNC& init) {
+		std::atomic<int> nhit(0);
+		auto func = [&](int i0, int i1) {
+			int cnt = 0;
+			for (int i = i0; i < i1; ++i) {
+				SweepQuery qry;
+				init(qry, i);
+				qry.exec(cls);
+				qry.get_hit(&pHits[i]);
+				cnt += qry.mFound ? 1 : 0;
+			}
+			nhit += cnt;
+		};
+		if (parallel) {
+			GWTask::parallel_for(num, func);
+		} else {
+			func(0, num);
+		}
+		return nhit;
+	}
+
+	int sphere_sweeps(const GWCollisionResource& cls, const GWSphereF* pSph, const GWVectorF* pMoves, int num, HitInfo* pHits, bool parallel) {
+		if (!pSph || !pMoves || !pHits || num <= 0) { return 0; }
+		return exec_sweeps(cls, num, pHits, parallel, [=](SweepQuery& qry, int i) {
+			qry.init(pSph[i].c, pSph[i].c, pSph[i].r, pMoves[i]);
+		});
+	}
+
+	int capsule_sweeps(const GWCollisionResource& cls, const Capsule* pCaps, const GWVectorF* pMoves, int num, HitInfo* pHits, bool parallel) {
+		if (!pCaps || !pMoves || !pHits || num <= 0) { return 0; }
+		return exec_sweeps(cls, num, pHits, parallel, [=](SweepQuery& qry, int i) {
+			qry.init(pCaps[i].mA, pCaps[i].mB, pCaps[i].mRadius, pMoves[i]);
+		});
+	}
+
+	// squared distances within this relative margin are treated as the same, see ClosestQuery::pick()
+	static const float TIE_EPS = 1.0e-4f;
+
+	struct ClosestQuery {
+		GWVectorF mOrg;
+		bool mFound;
+		float mBestDistSq;
+		float mBestCos;
+		GWVectorF mPos;
+		GWVectorF mNrm;
+		int32_t mPolIdx;
+		int32_t mTriIdx;
+
+		ClosestQuery(const GWVectorF& pos, float maxDist) : mOrg(pos), mFound(false), mBestDistSq(maxDist * maxDist), mBestCos(0.0f), mPolIdx(-1), mTriIdx(-1) {}
+
+		bool done() const { return false; }
+
+		bool test_box(const GWVectorF& bbMin, const GWVectorF& bbMax, float* pTEntry = nullptr) const {
+			float distSq = GWOverlap::pnt_aabb_dist_sq(mOrg, bbMin, bbMax);
+			if (pTEntry) { *pTEntry = distSq; }
+			return distSq <= mBestDistSq * (1.0f + TIE_EPS);
+		}
+
+		void test_tri(const GWVectorF& v0, const GWVectorF& v1, const GWVectorF& v2, int32_t polIdx, int32_t triIdx) {
+			GWVectorF pos = GWOverlap::closest_pnt_tri(mOrg, v0, v1, v2);
+			GWVectorF dir = mOrg - pos;
+			float distSq = dir.length_sq();
+			if (distSq > mBestDistSq * (1.0f + TIE_EPS)) { return; }
+			// clockwise winding
+			GWVectorF nrm = GWVector::cross(v2 - v0, v1 - v0);
+			float nlen = nrm.length();
+			if (nlen <= 0.0f) { return; }
+			nrm *= 1.0f / nlen;
+			float cos = distSq > 0.0f ? dir.dot(nrm) / GWBase::tsqrt(distSq) : 0.0f;
+			if (pick(distSq, cos, polIdx, triIdx)) {
+				mFound = true;
+				mBestDistSq = std::min(distSq, mBestDistSq);
+				mBestCos = cos;
+				mPos = pos;
+				mNrm = nrm;
+				mPolIdx = polIdx;
+				mTriIdx = triIdx;
+			}
+		}
+
+		// The triangles meeting at the closest point are told apart by how squarely they face the query point,
+		// the most facing one gives the right side at both convex and concave edges.
+		bool pick(float distSq, float cos, int32_t polIdx, int32_t triIdx) const {
+			if (!mFound) { return true; }
+			if (distSq < mBestDistSq * (1.0f - TIE_EPS)) { return true; }
+			float absCos = std::fabs(cos);
+			float bestAbsCos = std::fabs(mBestCos);
+			if (absCos != bestAbsCos) { return absCos > bestAbsCos; }
+			return polIdx != mPolIdx ? polIdx < mPolIdx : triIdx < mTriIdx;
+		}
+
+		void get_hit(HitInfo* pHit) const {
+			if (pHit) {
+				if (!mFound) {
+					pHit->reset();
+					return;
+				}
+				pHit->mPos = mPos;
+				pHit->mNrm = mNrm;
+				pHit->mT = (mOrg - mPos).length();
+				pHit->mPolIdx = mPolIdx;
+				pHit->mTriIdx = mTriIdx;
+			}
+		}
+	};
+
+	bool closest_pnt(const GWCollisionResource& cls, const GWVectorF& pos, float maxDist, HitInfo* pHit) {
+		ClosestQuery qry(pos, maxDist);
+		auto poly = [&qry, &cls](int32_t polIdx) {
+			for_poly_tris(cls, polIdx, [&qry](const GWVectorF& v0, const GWVectorF& v1, const GWVectorF& v2, int32_t pol, int32_t tri) {
+				qry.test_tri(v0, v1, v2, pol, tri);
+				return true;
+			});
+		};
+		if (cls.has_bvh()) {
+			traverse_bvh(qry, cls.get_bvh_top(), poly);
+		} else {
+			const GWCollisionResource::Poly* pPols = cls.get_pols_top();
+			for (int i = 0; pPols && i < cls.mNumPol; ++i) {
+				if (qry.test_box(pPols[i].mBBoxMin, pPols[i].mBBoxMax)) {
+					poly(i);
+				}
+			}
+		}
+		qry.get_hit(pHit);
+		return qry.mFound;
+	}
+
+	bool closest_pnt(const GWBVH::ModelBVH& mbvh, const GWVectorF& pos, float maxDist, HitInfo* pHit) {
+		ClosestQuery qry(pos, maxDist);
+		traverse_bvh(qry, mbvh.mpNodes, [&](int32_t triIdx) {
+			const uint32_t* pTri = mbvh.get_tri_pnt_indices(triIdx);
+			qry.test_tri(mbvh.mpPnts[pTri[0]], mbvh.mpPnts[pTri[1]], mbvh.mpPnts[pTri[2]], triIdx, 0);
+		});
+		qry.get_hit(pHit);
+		return qry.mFound;
+	}
+
+	static const float NRM_QSCL = 32767.0f;
+
+	GWVectorF GroundCache::Column::get_nrm(int layer) const {
+		float x = float(mNrm[layer][0]) / NRM_QSCL;
+		float z = float(mNrm[layer][1]) / NRM_QSCL;
+		return GWVectorF(x, GWBase::tsqrt(std::max(1.0f - x * x - z * z, 0.0f)), z);
+	}
+
+	GroundCache* GroundCache::create(const GWCollisionResource& cls, const BakeParams& params) {
+		if (cls.mNumPol <= 0) { return nullptr; }
+		float cellSize = params.mCellSize > 0.0f ? params.mCellSize : BakeParams().mCellSize;
+		GWVectorF ext = cls.mBBoxMax - cls.mBBoxMin;
+		int32_t nx = std::max(int32_t(std::ceil(ext.x / cellSize)) + 1, 2);
+		int32_t nz = std::max(int32_t(std::ceil(ext.z / cellSize)) + 1, 2);
+		size_t memSize = sizeof(GroundCache) + 0x40 + nx * nz * sizeof(Column);
+		char* pMem = reinterpret_cast<char*>(GWSys::alloc_rsrc_mem(memSize));
+		GroundCache* pCache = reinterpret_cast<GroundCache*>(pMem);
+		pCache->mOrg = cls.mBBoxMin;
+		pCache->mCellSize = cellSize;
+		pCache->mInvCellSize = 1.0f / cellSize;
+		// the diagonal of a cell at the steepest walkable slope
+		float minNrmY = GWBase::clamp(params.mMinNrmY, 0.01f, 1.0f);
+		pCache->mMaxRise = cellSize * 1.4142136f * GWBase::tsqrt(1.0f - minNrmY * minNrmY) / minNrmY;
+		pCache->mNumX = nx;
+		pCache->mNumZ = nz;
+		pCache->mpColumns = reinterpret_cast<Column*>(GWBase::align(reinterpret_cast<uintptr_t>(pMem + sizeof(GroundCache)), 0x40));
+
+		// every row is cast in packets: all columns from the top, then the ones that hit again from just below their hit
+		// relative to the coordinates too, a small mesh far from the origin has coarser floats than its extent suggests
+		float crdMax = std::max(ext.max_elem(), 1.0f);
+		for (int i = 0; i < 3; ++i) {
+			crdMax = std::max(crdMax, std::max(std::fabs(cls.mBBoxMin[i]), std::fabs(cls.mBBoxMax[i])));
+		}
+		float eps = crdMax * 1.0e-5f;
+		float yTop = cls.mBBoxMax.y + eps;
+		float yBottom = cls.mBBoxMin.y - eps;
+		auto bake_rows = [&](int z0, int z1) {
+			float* pStart = reinterpret_cast<float*>(GWSys::alloc_temp_mem(nx * sizeof(float)));
+			float* pLastHit = reinterpret_cast<float*>(GWSys::alloc_temp_mem(nx * sizeof(float)));
+			int32_t* pActive = reinterpret_cast<int32_t*>(GWSys::alloc_temp_mem(nx * sizeof(int32_t)));
+			HitInfo* pHits = reinterpret_cast<HitInfo*>(GWSys::alloc_temp_mem(nx * sizeof(HitInfo)));
+			for (int iz = z0; iz < z1; ++iz) {
+				Column* pRow = pCache->mpColumns + iz * nx;
+				float z = pCache->mOrg.z + float(iz) * cellSize;
+				for (int ix = 0; ix < nx; ++ix) {
+					pRow[ix].mNumLayers = 0;
+					pStart[ix] = yTop;
+					pLastHit[ix] = FLT_MAX;
+					pActive[ix] = ix;
+				}
+				int nact = nx;
+				while (nact > 0) {
+					exec_batch(cls, nact, [&](int i, GWVectorF& p, GWVectorF& q) {
+						float x = pCache->mOrg.x + float(pActive[i]) * cellSize;
+						GWTuple::set(p, x, pStart[pActive[i]], z);
+						GWTuple::set(q, x, yBottom, z);
+					}, false, false, pHits, nullptr, 1.0f);
+					int nnext = 0;
+					for (int i = 0; i < nact; ++i) {
+						const HitInfo& hit = pHits[i];
+						if (hit.mPolIdx < 0) { continue; }
+						int ix = pActive[i];
+						Column& col = pRow[ix];
+						float y = hit.mPos.y;
+						// the headroom is measured from the nearest surface above, walkable or not
+						if (hit.mNrm.y >= params.mMinNrmY && pLastHit[ix] - y >= params.mClearance) {
+							int l = col.mNumLayers++;
+							col.mY[l] = y;
+							col.mNrm[l][0] = int16_t(std::round(GWBase::clamp(hit.mNrm.x, -1.0f, 1.0f) * NRM_QSCL));
+							col.mNrm[l][1] = int16_t(std::round(GWBase::clamp(hit.mNrm.z, -1.0f, 1.0f) * NRM_QSCL));
+						}
+						// a cast that got no lower ends the column instead of hitting the same surface forever
+						bool lower = y < pLastHit[ix];
+						pLastHit[ix] = y;
+						if (lower && col.mNumLayers < MAX_LAYERS) {
+							pStart[ix] = std::min(y - eps, std::nextafter(y, -FLT_MAX));
+							pActive[nnext++] = ix;
+						}
+					}
+					nact = nnext;
+				}
+				for (int ix = 0; ix < nx; ++ix) {
+					for (int l = pRow[ix].mNumLayers; l < MAX_LAYERS; ++l) {
+						pRow[ix].mY[l] = 0.0f;
+						pRow[ix].mNrm[l][0] = 0;
+						pRow[ix].mNrm[l][1] = 0;
+					}
+				}
+			}
+			GWSys::free_temp_mem(pHits);
+			GWSys::free_temp_mem(pActive);
+			GWSys::free_temp_mem(pLastHit);
+			GWSys::free_temp_mem(pStart);
+		};
+		if (params.mParallel) {
+			GWTask::parallel_for(nz, bake_rows);
+		} else {
+			bake_rows(0, nz);
+		}
+		return pCache;
+	}
+
+	void GroundCache::destroy(GroundCache* pCache) {
+		if (pCache) {
+			GWSys::free_rsrc_mem(pCache);
+		}
+	}
+
+	bool GroundCache::sample_ground(float x, float z, float y, float maxStep, GroundHit* pHit) const {
+		float gx = GWBase::clamp((x - mOrg.x) * mInvCellSize, 0.0f, float(mNumX - 1));
+		float gz = GWBase::clamp((z - mOrg.z) * mInvCellSize, 0.0f, float(mNumZ - 1));
+		int ix = std::min(int(gx), mNumX - 2);
+		int iz = std::min(int(gz), mNumZ - 2);
+		float fx = gx - float(ix);
+		float fz = gz - float(iz);
+		float wgt[4] = { (1.0f - fx) * (1.0f - fz), fx * (1.0f - fz), (1.0f - fx) * fz, fx * fz };
+		float ylim = y + maxStep;
+		int layer[4];
+		float ybest = -FLT_MAX;
+		for (int k = 0; k < 4; ++k) {
+			layer[k] = -1;
+			if (wgt[k] <= 0.0f) { continue; }
+			const Column& col = get_column(ix + (k & 1), iz + (k >> 1));
+			for (int l = 0; l < col.mNumLayers; ++l) {
+				if (col.mY[l] <= ylim) {
+					layer[k] = l;
+					ybest = std::max(ybest, col.mY[l]);
+					break;
+				}
+			}
+		}
+		float ymin = ybest - std::max(maxStep, mMaxRise);
+		float wsum = 0.0f;
+		float ysum = 0.0f;
+		GWVectorF nrm(0.0f);
+		for (int k = 0; k < 4; ++k) {
+			if (layer[k] < 0) { continue; }
+			const Column& col = get_column(ix + (k & 1), iz + (k >> 1));
+			float ycol = col.mY[layer[k]];
+			if (ycol >= ymin) {
+				wsum += wgt[k];
+				ysum += ycol * wgt[k];
+				nrm += col.get_nrm(layer[k]) * wgt[k];
+			}
+		}
+		if (wsum <= 0.0f) { return false; }
+		if (pHit) {
+			pHit->mY = ysum / wsum;
+			nrm.normalize();
+			pHit->mNrm = nrm;
+		}
+		return true;
+	}
+
+	bool GroundCache::sample_ground(float x, float z, GroundHit* pHit) const {
+		return sample_ground(x, z, FLT_MAX * 0.5f, 0.0f, pHit);
+	}
+
+	int GroundCache::sample_ground(const GWVectorF* pPos, float maxStep, GroundHit* pHits, bool* pFound, int num, bool parallel) const {
+		if (!pPos || !pHits || num <= 0) { return 0; }
+		std::atomic<int> nhit(0);
+		auto func = [&](int i0, int i1) {
+			int cnt = 0;
+			for (int i = i0; i < i1; ++i) {
+				bool found = sample_ground(pPos[i].x, pPos[i].z, pPos[i].y, maxStep, &pHits[i]);
+				if (pFound) { pFound[i] = found; }
+				cnt += found ? 1 : 0;
+			}
+			nhit += cnt;
+		};
+		if (parallel) {
+			GWTask::parallel_for(num, func);
+		} else {
+			func(0, num);
+		}
+		return nhit;
+	}
+}
@@ -0,0 +1,198 @@
+/*
+ * Author: Gleb Novodran <novodran@gmail.com>
+ */
+
+// Segment and ray queries against GWCollisionResource.
+// All state is kept on the caller's stack, so concurrent queries on the same resource are safe.
+namespace GWCollision {
+
+	struct HitInfo {
+		GWVectorF mPos;
+		GWVectorF mNrm;
+		float mT; // segment: [0, 1] fraction of p->q, ray: distance in units of the ray direction
+		int32_t mPolIdx;
+		int32_t mTriIdx;
+
+		void reset() {
+			mPos.fill(0.0f);
+			mNrm.fill(0.0f);
+			mT = 0.0f;
+			mPolIdx = -1;
+			mTriIdx = -1;
+		}
+	};
+
+	bool seg_first_hit(const GWCollisionResource& cls, const GWVectorF& p, const GWVectorF& q, HitInfo* pHit = nullptr);
+	bool seg_any_hit(const GWCollisionResource& cls, const GWVectorF& p, const GWVectorF& q);
+
+	bool ray_first_hit(const GWCollisionResource& cls, const GWRayF& ray, float maxDist, HitInfo* pHit = nullptr);
+	bool ray_any_hit(const GWCollisionResource& cls, const GWRayF& ray, float maxDist);
+
+	// Batched queries, traversed in SIMD packets. Segments are given as (p, q) pairs.
+	// The results are identical to the single queries, misses are reported with mPolIdx = -1.
+	// With sort enabled the queries are reordered by direction octant and origin before packing,
+	// which helps incoherent batches; the results are still written in the input order.
+	// Return the number of hits.
+	int segs_first_hit(const GWCollisionResource& cls, const GWVectorF* pSegs, int nseg, HitInfo* pHits, bool sort = false);
+	int segs_any_hit(const GWCollisionResource& cls, const GWVectorF* pSegs, int nseg, bool* pRes, bool sort = false);
+	int rays_first_hit(const GWCollisionResource& cls, const GWRayF* pRays, int nray, float maxDist, HitInfo* pHits, bool sort = false);
+	int rays_any_hit(const GWCollisionResource& cls, const GWRayF* pRays, int nray, float maxDist, bool* pRes, bool sort = false);
+
+	struct Capsule {
+		GWVectorF mA; // axis ends
+		GWVectorF mB;
+		float mRadius;
+	};
+
+	// Continuous sweeps of a sphere or a capsule moving by `move`. Polygons collide on both sides.
+	// mT is the fraction of the move at the time of impact, mPos is the contact point on the geometry
+	// and mNrm points from it towards the shape. A shape that already touches the geometry reports mT = 0.
+	bool sphere_sweep(const GWCollisionResource& cls, const GWSphereF& sph, const GWVectorF& move, HitInfo* pHit = nullptr);
+	bool capsule_sweep(const GWCollisionResource& cls, const Capsule& cap, const GWVectorF& move, HitInfo* pHit = nullptr);
+	// Batched sweeps, spread over GWTask workers if parallel is set; return the number of hits.
+	int sphere_sweeps(const GWCollisionResource& cls, const GWSphereF* pSph, const GWVectorF* pMoves, int num, HitInfo* pHits, bool parallel = true);
+	int capsule_sweeps(const GWCollisionResource& cls, const Capsule* pCaps, const GWVectorF* pMoves, int num, HitInfo* pHits, bool parallel = true);
+
+	// Closest point of the geometry to pos within maxDist. mPos is the point, mT the distance and mNrm the front normal
+	// of its triangle; where several triangles share the closest point (edges, vertices) the one facing pos the most
+	// is picked, so the side of pos can be told by the sign of dot(pos - mPos, mNrm).
+	bool closest_pnt(const GWCollisionResource& cls, const GWVectorF& pos, float maxDist, HitInfo* pHit = nullptr);
+
+	struct GroundHit {
+		float mY;
+		GWVectorF mNrm;
+	};
+
+	// Ground heights cached on a regular XZ grid over the resource box. Each column of the grid keeps up to
+	// MAX_LAYERS walkable surfaces found by vertical casts from the top, highest first, so bridges and overhangs
+	// keep the ground below them. Only upward facing polygons are seen by the casts.
+	class GroundCache {
+	public:
+		static const int MAX_LAYERS = 4;
+
+		struct Column {
+			float mY[MAX_LAYERS];
+			int16_t mNrm[MAX_LAYERS][2]; // x and z of the normal, y is positive
+			int32_t mNumLayers;
+
+			GWVectorF get_nrm(int layer) const;
+		};
+
+		struct BakeParams {
+			float mCellSize;
+			float mMinNrmY; // steeper surfaces are not walkable
+			float mClearance; // surfaces closer than this below a hit surface are left out
+			bool mParallel;
+
+			BakeParams() : mCellSize(0.5f), mMinNrmY(0.5f), mClearance(1.8f), mParallel(true) {}
+		};
+
+		GWVectorF mOrg; // x and z of the first column
+		float mCellSize;
+		float mInvCellSize;
+		float mMaxRise; // the largest height difference across a cell on a walkable surface
+		int32_t mNumX;
+		int32_t mNumZ;
+		Column* mpColumns; // x fastest
+
+	private:
+		GroundCache() {}
+
+	public:
+		const Column& get_column(int ix, int iz) const { return mpColumns[iz * mNumX + ix]; }
+
+		// Bilinear ground under (x, z) for a point at height y: in each column the highest layer at most
+		// maxStep above y is used, columns with no such layer are left out of the blend. So are the columns
+		// whose layer is lower than the highest one found by more than maxStep and mMaxRise: at the edges
+		// of bridges and ledges these stand on another surface, blending them would put the ground in mid-air.
+		bool sample_ground(float x, float z, float y, float maxStep, GroundHit* pHit = nullptr) const;
+		// the top layers
+		bool sample_ground(float x, float z, GroundHit* pHit = nullptr) const;
+		// pPos holds the query points with y at the feet, misses leave the hit untouched; returns the number of hits
+		int sample_ground(const GWVectorF* pPos, float maxStep, GroundHit* pHits, bool* pFound, int num, bool parallel = true) const;
+
+		static GroundCache* create(const GWCollisionResource& cls, const BakeParams& params = BakeParams());
+		static void destroy(GroundCache* pCache);
+	};
+
+	enum class QBVHKind : uint8_t {
+		FLOAT = 0,
+		Q16 = 1,
+		Q8 = 2
+	};
+
+	// 4-wide BVH collapsed from the resource's binary BVH.
+	// Nodes are cache line aligned and stored depth-first, children bounds are kept in SoA form:
+	// mBounds[0..2][i] is the min x, y, z of child i, mBounds[3..5][i] is its max x, y, z.
+	// Quantized children are stored relative to the box of the node that holds them;
+	// for Q16 nodes that box is decoded from the parent during traversal, Q8 nodes keep it in mOrg/mScl.
+	class QBVH {
+	public:
+		static const int32_t EMPTY = -0x7FFFFFFF - 1;
+
+		struct Node {
+			float mBounds[6][4];
+			int32_t mChild[4];
+			int32_t mReserved[4];
+		};
+
+		struct NodeQ16 {
+			uint16_t mBounds[6][4];
+			int32_t mChild[4];
+		};
+
+		struct NodeQ8 {
+			float mOrg[3];
+			float mScl[3];
+			uint8_t mBounds[6][4];
+			int32_t mChild[4];
+		};
+
+		static const size_t NODE_ALIGN = 0x40;
+
+		const GWCollisionResource* mpCls;
+		void* mpNodes;
+		int32_t mNumNodes;
+		QBVHKind mKind;
+		// root box, padded for the quantized kinds
+		GWVectorF mBBoxMin;
+		GWVectorF mBBoxMax;
+
+	private:
+		QBVH() {}
+
+	public:
+		// children: >= 0 - node index, EMPTY - unused slot, otherwise a leaf with poly id = -1 - child
+		static bool is_leaf(int32_t child) { return child < 0 && child != EMPTY; }
+		static int get_poly_id(int32_t child) { return -1 - child; }
+
+		const Node* get_nodes() const { return mKind == QBVHKind::FLOAT ? reinterpret_cast<const Node*>(mpNodes) : nullptr; }
+		const NodeQ16* get_nodes_q16() const { return mKind == QBVHKind::Q16 ? reinterpret_cast<const NodeQ16*>(mpNodes) : nullptr; }
+		const NodeQ8* get_nodes_q8() const { return mKind == QBVHKind::Q8 ? reinterpret_cast<const NodeQ8*>(mpNodes) : nullptr; }
+
+		static size_t get_node_size(QBVHKind kind);
+
+		// returns nullptr if the resource has no BVH
+		static QBVH* create(const GWCollisionResource& cls, QBVHKind kind = QBVHKind::FLOAT);
+		static void destroy(QBVH* pQBVH);
+	};
+
+	bool seg_first_hit(const QBVH& qbvh, const GWVectorF& p, const GWVectorF& q, HitInfo* pHit = nullptr);
+	bool seg_any_hit(const QBVH& qbvh, const GWVectorF& p, const GWVectorF& q);
+
+	bool ray_first_hit(const QBVH& qbvh, const GWRayF& ray, float maxDist, HitInfo* pHit = nullptr);
+	bool ray_any_hit(const QBVH& qbvh, const GWRayF& ray, float maxDist);
+
+	// Queries against the deformed triangles of a model instance, as of its last refit.
+	// mPolIdx of the hit is the triangle index (numbered through the materials), mTriIdx is 0.
+	bool seg_first_hit(const GWBVH::ModelBVH& mbvh, const GWVectorF& p, const GWVectorF& q, HitInfo* pHit = nullptr);
+	bool seg_any_hit(const GWBVH::ModelBVH& mbvh, const GWVectorF& p, const GWVectorF& q);
+	bool ray_first_hit(const GWBVH::ModelBVH& mbvh, const GWRayF& ray, float maxDist, HitInfo* pHit = nullptr);
+	bool ray_any_hit(const GWBVH::ModelBVH& mbvh, const GWRayF& ray, float maxDist);
+
+	bool closest_pnt(const GWBVH::ModelBVH& mbvh, const GWVectorF& pos, float maxDist, HitInfo* pHit = nullptr);
+
+	// Coarse test against the posed skin spheres, for instances that are not refitted on this frame.
+	// Returns the skin node of the nearest sphere hit or -1, pT receives the entry distance along the ray.
+	int ray_skin_spheres(const GWBVH::ModelBVH& mbvh, const GWRayF& ray, float maxDist, float* pT = nullptr);
+}
@@ -5,6 +5,7 @@
 
 #include "GWSys.hpp"
 #include "GWBase.hpp"
+#include "GWTask.hpp"
 #include "GWVector.hpp"
 #include "GWMatrix.hpp"
 #include "GWQuaternion.hpp"
@@ -35,23 +35,24 @@ public:
 		return (r + g + b) / 3.0f;
 	}
 
-	void to_nonlinear(float gamma = 2.2f) {
+	// tier : see GWMathTier, the gamma curve tolerates FAST for 8-bit output
+	void to_nonlinear(float gamma = 2.2f, GWMathTier tier = GWMathTier::FULL) {
 		if (gamma <= 0.0f || gamma == 1.0f) { return; }
 		float igamma = 1.0f / gamma;
 		for (int i = 0; i < 3; ++i) {
 			if (elems[i] <= 0.0f) {
 				elems[i] = 0.0f;
 			} else {
-				elems[i] = ::powf(elems[i], igamma);
+				elems[i] = GWBase::approx_pow(elems[i], igamma, tier);
 			}
 		}
 	}
 
-	void to_linear(float gamma = 2.2f) {
+	void to_linear(float gamma = 2.2f, GWMathTier tier = GWMathTier::FULL) {
 		if (gamma <= 0.0f || gamma == 1.0f) { return; }
 		for (int i = 0; i < 3; ++i) {
 			if (elems[i] > 0.0f) {
-				elems[i] = ::powf(elems[i], gamma);
+				elems[i] = GWBase::approx_pow(elems[i], gamma, tier);
 			}
 		}
 	}
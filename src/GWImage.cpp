@@ -4,6 +4,7 @@
 //#include <cstring>
 #include "GWSys.hpp"
 #include "GWBase.hpp"
+#include "GWTask.hpp"
 #include "GWVector.hpp"
 #include "GWMatrix.hpp"
 #include "GWQuaternion.hpp"
@@ -41,12 +42,7 @@ void GWImage::release_binding_memory() {
 }
 
 static void calc_range(GWColorF& minVal, GWColorF& maxVal, const GWColorF* pPix, int n) {
-	minVal = pPix[0];
-	maxVal = pPix[0];
-	for (int i = 1; i < n; ++i) {
-		GWTuple::min(minVal, minVal, pPix[i]);
-		GWTuple::max(maxVal, maxVal, pPix[i]);
-	}
+	GWBase::calc_range(minVal.elems, maxVal.elems, pPix->elems, n, 4);
 }
 
 void GWImage::update() {
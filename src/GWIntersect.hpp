@@ -6,7 +6,7 @@ namespace GWIntersect {
 
 	// Ericson, Real-Time Collision Detection 2nd ed., p. 191
 	template<typename T> bool seg_tri_ccw(const GWVectorBase<T>& p, const GWVectorBase<T>& q,
-		const GWVectorBase<T>& a, const GWVectorBase<T>& b, const GWVectorBase<T>& c, GWVectorBase<T>* pHitPos = nullptr, GWVectorBase<T>* pHitNrm = nullptr) {
+		const GWVectorBase<T>& a, const GWVectorBase<T>& b, const GWVectorBase<T>& c, GWVectorBase<T>* pHitPos = nullptr, GWVectorBase<T>* pHitNrm = nullptr, T* pHitT = nullptr) {
 
 		GWVectorBase<T> ab = b - a;
 		GWVectorBase<T> ac = c - a;
@@ -25,6 +25,9 @@ namespace GWIntersect {
 		w = -ab.dot(e);
 		if ((w < T(0)) || ((v + w) > d)) { return false; }
 		t = t / d;
+		if (pHitT) {
+			*pHitT = t;
+		}
 		if (pHitPos) {
 			*pHitPos = p + t * (q - p);
 		}
@@ -36,8 +39,8 @@ namespace GWIntersect {
 	}
 
 	template<typename T> bool seg_tri_cw(const GWVectorBase<T>& p, const GWVectorBase<T>& q,
-		const GWVectorBase<T>& a, const GWVectorBase<T>& b, const GWVectorBase<T>& c, GWVectorBase<T>* pHitPos = nullptr, GWVectorBase<T>* pHitNrm = nullptr) {
-			return seg_tri_ccw(p, q, a, c, b, pHitPos, pHitNrm);
+		const GWVectorBase<T>& a, const GWVectorBase<T>& b, const GWVectorBase<T>& c, GWVectorBase<T>* pHitPos = nullptr, GWVectorBase<T>* pHitNrm = nullptr, T* pHitT = nullptr) {
+			return seg_tri_ccw(p, q, a, c, b, pHitPos, pHitNrm, pHitT);
 		}
 
 }
\ No newline at end of file
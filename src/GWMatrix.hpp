@@ -2,16 +2,127 @@
  * Author: Gleb Novodran <novodran@gmail.com>
  */
 #include <cmath>
+#include <limits>
 
 namespace GWMatrix {
 
 
 	/* matrices */
 
+	// Tiled products for the large matrices: 4 x MM_COLS blocks of the result are accumulated in registers
+	// over MM_DEPTH rows of the right operand, which stay in cache while the left rows stream by.
+	const int MM_ROWS = 4; // mm_block
+	const int MM_COLS = 16;
+	const int MM_DEPTH = 256;
+	const int MM_PAR_ROWS = 32;
+	const int64_t MM_BLOCKED_MIN = 32 * 32 * 32;
+
+	// ld* - row strides; the accumulators are kept per row, which the compilers vectorize best
+	template<bool SUB_T, int COLS_T, typename DST_T, typename SRC1_T, typename SRC2_T>
+	inline void mm_block(DST_T* pDst, const int ldd, const SRC1_T* pSrc1, const int ld1, const SRC2_T* pSrc2, const int ld2, const int n) {
+		DST_T acc0[COLS_T];
+		DST_T acc1[COLS_T];
+		DST_T acc2[COLS_T];
+		DST_T acc3[COLS_T];
+		for (int j = 0; j < COLS_T; ++j) {
+			acc0[j] = pDst[j];
+			acc1[j] = pDst[ldd + j];
+			acc2[j] = pDst[ldd * 2 + j];
+			acc3[j] = pDst[ldd * 3 + j];
+		}
+		for (int k = 0; k < n; ++k) {
+			const SRC2_T* pRow = pSrc2 + k * ld2;
+			// negation is exact, x + b * -a == x - b * a
+			DST_T s0 = SUB_T ? -DST_T(pSrc1[k]) : DST_T(pSrc1[k]);
+			DST_T s1 = SUB_T ? -DST_T(pSrc1[ld1 + k]) : DST_T(pSrc1[ld1 + k]);
+			DST_T s2 = SUB_T ? -DST_T(pSrc1[ld1 * 2 + k]) : DST_T(pSrc1[ld1 * 2 + k]);
+			DST_T s3 = SUB_T ? -DST_T(pSrc1[ld1 * 3 + k]) : DST_T(pSrc1[ld1 * 3 + k]);
+			for (int j = 0; j < COLS_T; ++j) {
+				DST_T b = DST_T(pRow[j]);
+				acc0[j] += b * s0;
+				acc1[j] += b * s1;
+				acc2[j] += b * s2;
+				acc3[j] += b * s3;
+			}
+		}
+		for (int j = 0; j < COLS_T; ++j) {
+			pDst[j] = acc0[j];
+			pDst[ldd + j] = acc1[j];
+			pDst[ldd * 2 + j] = acc2[j];
+			pDst[ldd * 3 + j] = acc3[j];
+		}
+	}
+
+	template<bool SUB_T, typename DST_T, typename SRC1_T, typename SRC2_T>
+	inline void mm_edge(DST_T* pDst, const int ldd, const SRC1_T* pSrc1, const int ld1, const SRC2_T* pSrc2, const int ld2, const int m, const int n, const int p) {
+		for (int i = 0; i < m; ++i) {
+			DST_T* pRes = pDst + i * ldd;
+			for (int k = 0; k < n; ++k) {
+				const SRC2_T* pRow = pSrc2 + k * ld2;
+				DST_T s = SUB_T ? -DST_T(pSrc1[i * ld1 + k]) : DST_T(pSrc1[i * ld1 + k]);
+				for (int j = 0; j < p; ++j) {
+					pRes[j] += DST_T(pRow[j]) * s;
+				}
+			}
+		}
+	}
+
+	// MxP (+|-)= MxN * NxP
+	template<bool SUB_T, typename DST_T, typename SRC1_T, typename SRC2_T>
+	inline void mm_tiles(DST_T* pDst, const int ldd, const SRC1_T* pSrc1, const int ld1, const SRC2_T* pSrc2, const int ld2, const int m, const int n, const int p) {
+		for (int k0 = 0; k0 < n; k0 += MM_DEPTH) {
+			int nk = std::min(MM_DEPTH, n - k0);
+			for (int j0 = 0; j0 < p; j0 += MM_COLS) {
+				int nc = std::min(MM_COLS, p - j0);
+				const SRC2_T* pB = pSrc2 + k0 * ld2 + j0;
+				for (int i0 = 0; i0 < m; i0 += MM_ROWS) {
+					int nr = std::min(MM_ROWS, m - i0);
+					DST_T* pC = pDst + i0 * ldd + j0;
+					const SRC1_T* pA = pSrc1 + i0 * ld1 + k0;
+					if (nr == MM_ROWS && nc == MM_COLS) {
+						mm_block<SUB_T, MM_COLS>(pC, ldd, pA, ld1, pB, ld2, nk);
+					} else {
+						mm_edge<SUB_T>(pC, ldd, pA, ld1, pB, ld2, nr, nk, nc);
+					}
+				}
+			}
+		}
+	}
+
+	// Done by chunks of MM_PAR_ROWS rows, which are split among the GWTask workers; the result doesn't depend
+	// on the parallel flag.
+	template<bool SUB_T, typename DST_T, typename SRC1_T, typename SRC2_T>
+	inline void mm_acc(DST_T* pDst, const int ldd, const SRC1_T* pSrc1, const int ld1, const SRC2_T* pSrc2, const int ld2, const int m, const int n, const int p, const bool parallel) {
+		int nchunks = (m + MM_PAR_ROWS - 1) / MM_PAR_ROWS;
+		auto mul_rows = [&](int c0, int c1) {
+			for (int c = c0; c < c1; ++c) {
+				int i0 = c * MM_PAR_ROWS;
+				int nr = std::min(MM_PAR_ROWS, m - i0);
+				mm_tiles<SUB_T>(pDst + i0 * ldd, ldd, pSrc1 + i0 * ld1, ld1, pSrc2, ld2, nr, n, p);
+			}
+		};
+		// serial as one chunk through the same code, fast math may compile an inlined copy differently
+		GWTask::parallel_for(nchunks, mul_rows, parallel ? 1 : nchunks);
+	}
+
+	// MxP = MxN * NxP
+	template<typename DST_T, typename SRC1_T, typename SRC2_T>
+	inline void mul_mm_blocked(DST_T* pDst, const SRC1_T* pSrc1, const SRC2_T* pSrc2, const int m, const int n, const int p, const bool parallel = true) {
+		const int nres = m * p;
+		for (int i = 0; i < nres; ++i) {
+			pDst[i] = 0;
+		}
+		mm_acc<false>(pDst, p, pSrc1, n, pSrc2, p, m, n, p, parallel);
+	}
+
 	// Based on https://blogs.msdn.microsoft.com/nativeconcurrency/2014/09/04/raking-through-the-parallelism-tool-shed-the-curious-case-of-matrix-matrix-multiplication/
 	// MxP = MxN * NxP
 	template<typename DST_T, typename SRC1_T, typename SRC2_T>
 	inline void mul_mm(DST_T* pDst, const SRC1_T* pSrc1, const SRC2_T* pSrc2, const int m, const int n, const int p) {
+		if (m >= MM_ROWS && p >= MM_COLS && int64_t(m) * n * p >= MM_BLOCKED_MIN) {
+			mul_mm_blocked(pDst, pSrc1, pSrc2, m, n, p);
+			return;
+		}
 		const int nres = m * p;
 		for (int i = 0; i < nres; ++i) {
 			pDst[i] = 0;
@@ -487,8 +598,85 @@ namespace GWMatrix {
 
 	/* solvers */
 
+	const int LU_BLOCK = 64;
+	const int LU_BLOCKED_MIN = LU_BLOCK * 2;
+	const int LU_PAR_COLS = 64;
+
+	// Right-looking blocked form of the elimination in lu_decomp. Each panel of LU_BLOCK columns is factored
+	// as in the unblocked loop, then the block row of U right of it is solved and the trailing matrix is updated
+	// by the tiled product, both split among the GWTask workers.
+	// pScl - reciprocal row norms
+	template<typename T>
+	inline bool lu_decomp_blocked(T* pLU, const int n, T* pScl, const T eps, int* pPerm, int& dsgn, const bool parallel) {
+		for (int j0 = 0; j0 < n; j0 += LU_BLOCK) {
+			int j1 = std::min(j0 + LU_BLOCK, n);
+			for (int j = j0; j < j1; ++j) {
+				T s = 0;
+				int idx = j;
+				for (int i = j; i < n; ++i) {
+					int offs = i*n + j;
+					T t = pLU[offs];
+					if (j > j0) {
+						t -= inner_row_col(pLU, n, i, pLU, n, j, j0, j - 1);
+						pLU[offs] = t;
+					}
+					t = std::fabs(t) * pScl[i];
+					if (t > s) {
+						s = t;
+						idx = i;
+					}
+				}
+				s = pLU[idx*n + j];
+				if (std::fabs(s) < eps) return false;
+				if (pPerm) {
+					pPerm[j] = idx;
+				}
+				pScl[idx] = pScl[j];
+				if (s < 0) dsgn = -dsgn;
+				if (idx != j) {
+					dsgn = -dsgn;
+					swap_rows(pLU, n, j, idx);
+				}
+				s = T(1) / s;
+				for (int i = j + 1; i < j1; ++i) {
+					T t = pLU[j*n + i];
+					if (j > j0) {
+						t -= inner_row_col(pLU, n, j, pLU, n, i, j0, j - 1);
+					}
+					pLU[j*n + i] = t * s;
+				}
+			}
+			if (j1 == n) break;
+
+			int nchunks = (n - j1 + LU_PAR_COLS - 1) / LU_PAR_COLS;
+			auto solve_cols = [&](int c0, int c1) {
+				int i0 = j1 + c0 * LU_PAR_COLS;
+				int i1 = std::min(j1 + c1 * LU_PAR_COLS, n);
+				for (int j = j0; j < j1; ++j) {
+					T* pRow = pLU + j*n;
+					for (int k = j0; k < j; ++k) {
+						const T* pRowK = pLU + k*n;
+						T l = pRow[k];
+						for (int i = i0; i < i1; ++i) {
+							pRow[i] -= l * pRowK[i];
+						}
+					}
+					T s = T(1) / pRow[j];
+					for (int i = i0; i < i1; ++i) {
+						pRow[i] *= s;
+					}
+				}
+			};
+			GWTask::parallel_for(nchunks, solve_cols, parallel ? 1 : nchunks);
+			mm_acc<true>(pLU + j1*n + j1, n, pLU + j1*n + j0, n, pLU + j0*n + j1, n, n - j1, j1 - j0, n - j1, parallel);
+		}
+		return true;
+	}
+
+	// Crout's method with scaled partial pivoting: L has the pivots on its diagonal, U has a unit one.
+	// Matrices of LU_BLOCKED_MIN and up are factored by lu_decomp_blocked.
 	template<typename T>
-	inline bool lu_decomp(T* pLU, const T* pMtx, const int n, T* pTmpVec /*[n]*/, int* pPerm /*[n]*/, int* pDetSgn = nullptr, const T tolerance = T(0)) {
+	inline bool lu_decomp(T* pLU, const T* pMtx, const int n, T* pTmpVec /*[n]*/, int* pPerm /*[n]*/, int* pDetSgn = nullptr, const T tolerance = T(0), const bool parallel = true) {
 		if (pLU != pMtx) {
 			GWMatrix::copy(pLU, pMtx, n);
 		}
@@ -503,6 +691,13 @@ namespace GWMatrix {
 		}
 		tup_rcp(pTmpVec, n);
 		int dsgn = 1;
+		if (n >= LU_BLOCKED_MIN) {
+			if (!lu_decomp_blocked(pLU, n, pTmpVec, eps, pPerm, dsgn, parallel)) return false;
+			if (pDetSgn) {
+				*pDetSgn = dsgn;
+			}
+			return true;
+		}
 		int offs;
 		for (int j = 0; j < n; ++j) {
 			T s = 0;
@@ -671,6 +866,498 @@ namespace GWMatrix {
 		}
 	}
 
+	// LDL^T of a symmetric matrix, only its lower triangle is read. D goes to the diagonal, the unit lower L below it
+	// and D L^T above it, so that both solves go along the rows. There is no pivoting: the matrix should be positive
+	// definite, or at least have all its leading minors away from zero.
+	// Matrices of LU_BLOCKED_MIN and up are factored by panels of LU_BLOCK columns, the lower part of the trailing
+	// matrix is then updated by the tiled product, split among the GWTask workers by MM_PAR_ROWS rows.
+	template<typename T>
+	inline bool ldl_decomp(T* pLDL, const T* pMtx, const int n, const T tolerance = T(0), const bool parallel = true) {
+		if (pLDL != pMtx) {
+			GWMatrix::copy(pLDL, pMtx, n);
+		}
+		T dmax = 0;
+		for (int i = 0; i < n; ++i) {
+			dmax = std::max(dmax, std::fabs(pLDL[i*n + i]));
+		}
+		const T eps = dmax * (tolerance > T(0) ? tolerance : std::numeric_limits<T>::epsilon());
+		const int nblk = n >= LU_BLOCKED_MIN ? LU_BLOCK : n;
+		for (int j0 = 0; j0 < n; j0 += nblk) {
+			int j1 = std::min(j0 + nblk, n);
+			for (int j = j0; j < j1; ++j) {
+				T* pRow = pLDL + j*n;
+				T d = pRow[j];
+				if (j > j0) {
+					d -= inner_row_col(pLDL, n, j, pLDL, n, j, j0, j - 1);
+				}
+				if (!(std::fabs(d) > eps)) return false;
+				pRow[j] = d;
+				T s = T(1) / d;
+				for (int i = j + 1; i < n; ++i) {
+					int offs = i*n + j;
+					T t = pLDL[offs];
+					if (j > j0) {
+						t -= inner_row_col(pLDL, n, i, pLDL, n, j, j0, j - 1);
+					}
+					pRow[i] = t;
+					pLDL[offs] = t * s;
+				}
+			}
+			if (j1 == n) break;
+
+			// rows past the diagonal are only written above it, where D L^T is stored later
+			int nchunks = (n - j1 + MM_PAR_ROWS - 1) / MM_PAR_ROWS;
+			auto update_rows = [&](int c0, int c1) {
+				for (int c = c0; c < c1; ++c) {
+					int i0 = j1 + c * MM_PAR_ROWS;
+					int i1 = std::min(i0 + MM_PAR_ROWS, n);
+					mm_tiles<true>(pLDL + i0*n + j1, n, pLDL + i0*n + j0, n, pLDL + j0*n + j1, n, i1 - i0, j1 - j0, i1 - j1);
+				}
+			};
+			GWTask::parallel_for(nchunks, update_rows, parallel ? 1 : nchunks);
+		}
+		return true;
+	}
+
+	template<typename T>
+	inline void ldl_get_lower(T* pL, const T* pLDL, const int n) {
+		for (int i = 0; i < n; ++i) {
+			for (int j = 0; j < n; ++j) {
+				int offs = i*n + j;
+				if (i == j) {
+					pL[offs] = 1;
+				} else if (j < i) {
+					pL[offs] = pLDL[offs];
+				} else {
+					pL[offs] = 0;
+				}
+			}
+		}
+	}
+
+	template<typename T>
+	inline void ldl_get_diag(T* pD, const T* pLDL, const int n) {
+		for (int i = 0; i < n; ++i) {
+			pD[i] = pLDL[i*n + i];
+		}
+	}
+
+	template<typename T>
+	inline void ldl_solve(T* pAns, const T* pLDL, const int n, const T* pRH) {
+		if (pAns == nullptr) return;
+		if (pRH != nullptr) {
+			if (pAns != pRH) {
+				for (int i = 0; i < n; ++i) {
+					pAns[i] = pRH[i];
+				}
+			}
+		}
+		for (int i = 1; i < n; ++i) {
+			pAns[i] -= inner_row_vec(pLDL, n, i, pAns, 0, i - 1);
+		}
+		for (int i = n; --i >= 0;) {
+			if (i < n - 1) {
+				pAns[i] -= inner_row_vec(pLDL, n, i, pAns, i + 1, n - 1);
+			}
+			pAns[i] /= pLDL[i*n + i];
+		}
+	}
+
+	template<typename T>
+	inline T ldl_det(const T* pLDL, const int n) {
+		T det = 1;
+		for (int i = 0; i < n; ++i) {
+			det *= pLDL[i*n + i];
+		}
+		return det;
+	}
+
+	template<typename T, typename XT = long double>
+	inline void ldl_improve(/* inout */ T* pAns, const T* pMtx, const T* pLDL, const int n, const T* pRH, T* pTmpVec) {
+		for (int i = 0; i < n; ++i) {
+			XT r = XT(-pRH[i]);
+			r += inner_row_vec<T, XT>(pMtx, n, i, pAns);
+			pTmpVec[i] = T(r);
+		}
+		ldl_solve(pTmpVec, pLDL, n, pTmpVec);
+		tup_sub(pAns, pTmpVec, n);
+	}
+
+	// Householder QR of an MxN matrix, M >= N. The reflection vectors go to the lower trapezoid and R above
+	// the diagonal, the diagonal of R goes to pDiag. Each reflection is applied along the rows, the columns
+	// right of it are split among the GWTask workers by LU_PAR_COLS. Fails if the matrix is rank deficient.
+	template<typename T>
+	inline bool qr_decomp(T* pQR, const T* pMtx, const int m, const int n, T* pDiag /*[n]*/, T* pTmpVec /*[n]*/, const T tolerance = T(0), const bool parallel = true) {
+		if (pQR != pMtx) {
+			GWMatrix::copy(pQR, pMtx, m, n);
+		}
+		tup_zero(pTmpVec, n);
+		for (int i = 0; i < m; ++i) {
+			const T* pRow = pQR + i*n;
+			for (int j = 0; j < n; ++j) {
+				pTmpVec[j] += pRow[j] * pRow[j];
+			}
+		}
+		const T eps = std::sqrt(tup_max(pTmpVec, n)) * (tolerance > T(0) ? tolerance : std::numeric_limits<T>::epsilon());
+		for (int k = 0; k < n; ++k) {
+			T nrm = std::sqrt(inner_col_col(pQR, n, k, pQR, n, k, k, m - 1));
+			if (!(nrm > eps)) return false;
+			if (pQR[k*n + k] < 0) {
+				nrm = -nrm;
+			}
+			col_scl(pQR, n, k, k, m - 1, T(1) / nrm);
+			pQR[k*n + k] += T(1);
+			pDiag[k] = -nrm;
+			if (k == n - 1) break;
+
+			int nchunks = (n - k - 1 + LU_PAR_COLS - 1) / LU_PAR_COLS;
+			auto reflect_cols = [&](int c0, int c1) {
+				int j0 = k + 1 + c0 * LU_PAR_COLS;
+				int j1 = std::min(k + 1 + c1 * LU_PAR_COLS, n);
+				T* pW = pTmpVec;
+				tup_zero(pW, j0, j1 - 1);
+				for (int i = k; i < m; ++i) {
+					const T* pRow = pQR + i*n;
+					T v = pRow[k];
+					for (int j = j0; j < j1; ++j) {
+						pW[j] += v * pRow[j];
+					}
+				}
+				tup_scl(pW, pW, j0, j1 - 1, T(-1) / pQR[k*n + k]);
+				for (int i = k; i < m; ++i) {
+					T* pRow = pQR + i*n;
+					T v = pRow[k];
+					for (int j = j0; j < j1; ++j) {
+						pRow[j] += v * pW[j];
+					}
+				}
+			};
+			GWTask::parallel_for(nchunks, reflect_cols, parallel ? 1 : nchunks);
+		}
+		return true;
+	}
+
+	template<typename T>
+	inline void qr_get_upper(T* pR, const T* pQR, const int n, const T* pDiag) {
+		for (int i = 0; i < n; ++i) {
+			for (int j = 0; j < n; ++j) {
+				if (i == j) {
+					pR[i*n + j] = pDiag[i];
+				} else if (j > i) {
+					pR[i*n + j] = pQR[i*n + j];
+				} else {
+					pR[i*n + j] = 0;
+				}
+			}
+		}
+	}
+
+	// Least squares solution of MxN * Nx1 = Mx1.
+	template<typename T>
+	inline void qr_solve(T* pAns /*[n]*/, const T* pQR, const int m, const int n, const T* pDiag, const T* pRH /*[m]*/, T* pTmpVec /*[m]*/) {
+		for (int i = 0; i < m; ++i) {
+			pTmpVec[i] = pRH[i];
+		}
+		for (int k = 0; k < n; ++k) {
+			T s = -inner_col_vec(pQR, n, k, pTmpVec, k, m - 1) / pQR[k*n + k];
+			for (int i = k; i < m; ++i) {
+				pTmpVec[i] += s * pQR[i*n + k];
+			}
+		}
+		for (int k = n; --k >= 0;) {
+			T t = pTmpVec[k];
+			if (k < n - 1) {
+				t -= inner_row_vec(pQR, n, k, pAns, k + 1, n - 1);
+			}
+			pAns[k] = t / pDiag[k];
+		}
+	}
+
+	template<typename T>
+	inline void sym_eigen_rotate(T* pMtx, const int n, const int i, const int j, const int k, const int l, const T s, const T tau) {
+		T g = pMtx[i*n + j];
+		T h = pMtx[k*n + l];
+		pMtx[i*n + j] = g - s * (h + g * tau);
+		pMtx[k*n + l] = h + s * (g - h * tau);
+	}
+
+	// Cyclic Jacobi for a symmetric matrix, only its upper triangle is read (Numerical Recipes 11.1).
+	// The eigenvalues are sorted in decreasing order, the eigenvectors are the columns of pVecs.
+	// pWrk - working copy of the matrix, can be pMtx itself
+	template<typename T>
+	inline bool sym_eigen(T* pVals /*[n]*/, T* pVecs /*[n*n]*/, T* pWrk /*[n*n]*/, const T* pMtx, const int n, T* pTmpVec /*[n*2]*/, const int maxSweeps = 50) {
+		if (pWrk != pMtx) {
+			GWMatrix::copy(pWrk, pMtx, n);
+		}
+		T* pB = pTmpVec;
+		T* pZ = pTmpVec + n;
+		set_identity(pVecs, n);
+		for (int i = 0; i < n; ++i) {
+			pB[i] = pVals[i] = pWrk[i*n + i];
+			pZ[i] = 0;
+		}
+		const T eps = std::numeric_limits<T>::epsilon() * T(0.5);
+		bool res = false;
+		for (int sweep = 1; sweep <= maxSweeps; ++sweep) {
+			T sm = 0;
+			for (int p = 0; p < n - 1; ++p) {
+				for (int q = p + 1; q < n; ++q) {
+					sm += std::fabs(pWrk[p*n + q]);
+				}
+			}
+			if (sm == T(0)) {
+				res = true;
+				break;
+			}
+			T tresh = sweep < 4 ? T(0.2) * sm / T(n * n) : T(0);
+			for (int p = 0; p < n - 1; ++p) {
+				for (int q = p + 1; q < n; ++q) {
+					T apq = pWrk[p*n + q];
+					T g = T(100) * std::fabs(apq);
+					// comparing against the ulps rather than adding, fast math would fold |d| + g == |d| into g == 0
+					if (sweep > 4 && g <= eps * std::fabs(pVals[p]) && g <= eps * std::fabs(pVals[q])) {
+						pWrk[p*n + q] = 0;
+					} else if (std::fabs(apq) > tresh) {
+						T h = pVals[q] - pVals[p];
+						T t;
+						if (g <= eps * std::fabs(h)) {
+							t = apq / h;
+						} else {
+							T theta = T(0.5) * h / apq;
+							t = T(1) / (std::fabs(theta) + std::sqrt(T(1) + theta * theta));
+							if (theta < 0) t = -t;
+						}
+						T c = T(1) / std::sqrt(T(1) + t * t);
+						T s = t * c;
+						T tau = s / (T(1) + c);
+						h = t * apq;
+						pZ[p] -= h;
+						pZ[q] += h;
+						pVals[p] -= h;
+						pVals[q] += h;
+						pWrk[p*n + q] = 0;
+						for (int j = 0; j < p; ++j) {
+							sym_eigen_rotate(pWrk, n, j, p, j, q, s, tau);
+						}
+						for (int j = p + 1; j < q; ++j) {
+							sym_eigen_rotate(pWrk, n, p, j, j, q, s, tau);
+						}
+						for (int j = q + 1; j < n; ++j) {
+							sym_eigen_rotate(pWrk, n, p, j, q, j, s, tau);
+						}
+						for (int j = 0; j < n; ++j) {
+							sym_eigen_rotate(pVecs, n, j, p, j, q, s, tau);
+						}
+					}
+				}
+			}
+			for (int p = 0; p < n; ++p) {
+				pB[p] += pZ[p];
+				pVals[p] = pB[p];
+				pZ[p] = 0;
+			}
+		}
+		for (int i = 0; i < n - 1; ++i) {
+			int idx = i;
+			for (int j = i + 1; j < n; ++j) {
+				if (pVals[j] > pVals[idx]) {
+					idx = j;
+				}
+			}
+			if (idx != i) {
+				std::swap(pVals[i], pVals[idx]);
+				swap_cols(pVecs, n, i, idx, 0, n - 1);
+			}
+		}
+		return res;
+	}
+
+	// Batches of small systems stored one after another, split among the GWTask workers by BATCH_GRAIN systems.
+	// pOk - optional per system result of the decomposition
+	const int BATCH_GRAIN = 64;
+
+	template<typename T>
+	inline void ldl_solve_batch(T* pAns /*[num*n]*/, T* pLDL /*[num*n*n]*/, const T* pMtx, const T* pRH /*[num*n]*/, const int n, const int num, bool* pOk = nullptr, const bool parallel = true) {
+		auto solve = [&](int i0, int i1) {
+			for (int i = i0; i < i1; ++i) {
+				size_t offs = size_t(i) * n * n;
+				bool ok = ldl_decomp(pLDL + offs, pMtx + offs, n, T(0), false);
+				if (ok) {
+					ldl_solve(pAns + size_t(i) * n, pLDL + offs, n, pRH + size_t(i) * n);
+				} else {
+					tup_zero(pAns + size_t(i) * n, n);
+				}
+				if (pOk) {
+					pOk[i] = ok;
+				}
+			}
+		};
+		GWTask::parallel_for(num, solve, parallel ? BATCH_GRAIN : num);
+	}
+
+	template<typename T>
+	inline void qr_solve_batch(T* pAns /*[num*n]*/, T* pQR /*[num*m*n]*/, const T* pMtx, const T* pRH /*[num*m]*/, const int m, const int n, const int num, T* pTmpVec /*[num*(m+n)]*/, bool* pOk = nullptr, const bool parallel = true) {
+		auto solve = [&](int i0, int i1) {
+			for (int i = i0; i < i1; ++i) {
+				size_t offs = size_t(i) * m * n;
+				T* pDiag = pTmpVec + size_t(i) * (m + n);
+				T* pTmp = pDiag + n;
+				bool ok = qr_decomp(pQR + offs, pMtx + offs, m, n, pDiag, pTmp, T(0), false);
+				if (ok) {
+					qr_solve(pAns + size_t(i) * n, pQR + offs, m, n, pDiag, pRH + size_t(i) * m, pTmp);
+				} else {
+					tup_zero(pAns + size_t(i) * n, n);
+				}
+				if (pOk) {
+					pOk[i] = ok;
+				}
+			}
+		};
+		GWTask::parallel_for(num, solve, parallel ? BATCH_GRAIN : num);
+	}
+
+	template<typename T>
+	inline void sym_eigen_batch(T* pVals /*[num*n]*/, T* pVecs /*[num*n*n]*/, T* pWrk /*[num*n*n]*/, const T* pMtx, const int n, const int num, T* pTmpVec /*[num*n*2]*/, bool* pOk = nullptr, const int maxSweeps = 50, const bool parallel = true) {
+		auto solve = [&](int i0, int i1) {
+			for (int i = i0; i < i1; ++i) {
+				size_t offs = size_t(i) * n * n;
+				bool ok = sym_eigen(pVals + size_t(i) * n, pVecs + offs, pWrk + offs, pMtx + offs, n, pTmpVec + size_t(i) * n * 2, maxSweeps);
+				if (pOk) {
+					pOk[i] = ok;
+				}
+			}
+		};
+		GWTask::parallel_for(num, solve, parallel ? BATCH_GRAIN : num);
+	}
+
+	/* fixed size solvers */
+
+	// NxN systems with N known at compile time, the loops unroll fully. V is float or GWLane::F, in which case
+	// every lane holds its own system: the partial pivoting moves the rows by selection, without branches.
+	// Returns the smallest pivot magnitude, zero for a singular system, whose answer is then not finite.
+	template<int N, typename V>
+	inline V solve_n(V* pAns /*[N]*/, const V* pMtx /*[N*N]*/, const V* pRH /*[N]*/) {
+		V a[N * N];
+		V b[N];
+		V rcp[N];
+		for (int i = 0; i < N * N; ++i) {
+			a[i] = pMtx[i];
+		}
+		for (int i = 0; i < N; ++i) {
+			b[i] = pRH[i];
+		}
+		V minPiv(std::numeric_limits<float>::max());
+		for (int k = 0; k < N; ++k) {
+			// any larger candidate takes the pivot row place, the order of the rows below doesn't matter
+			for (int i = k + 1; i < N; ++i) {
+				auto mask = GWLane::abs(a[i*N + k]) > GWLane::abs(a[k*N + k]);
+				for (int j = k; j < N; ++j) {
+					V t = a[k*N + j];
+					a[k*N + j] = GWLane::sel(mask, a[i*N + j], t);
+					a[i*N + j] = GWLane::sel(mask, t, a[i*N + j]);
+				}
+				V t = b[k];
+				b[k] = GWLane::sel(mask, b[i], t);
+				b[i] = GWLane::sel(mask, t, b[i]);
+			}
+			// taken after the swaps, a zero element that the pivoting replaces doesn't count
+			minPiv = GWLane::min(minPiv, GWLane::abs(a[k*N + k]));
+			rcp[k] = V(1.0f) / a[k*N + k];
+			for (int i = k + 1; i < N; ++i) {
+				V f = a[i*N + k] * rcp[k];
+				for (int j = k + 1; j < N; ++j) {
+					a[i*N + j] = a[i*N + j] - f * a[k*N + j];
+				}
+				b[i] = b[i] - f * b[k];
+			}
+		}
+		for (int i = N; --i >= 0;) {
+			V s = b[i];
+			for (int j = i + 1; j < N; ++j) {
+				s = s - a[i*N + j] * pAns[j];
+			}
+			pAns[i] = s * rcp[i];
+		}
+		return minPiv;
+	}
+
+	// Groups of SOA_BATCH systems interleaved element by element, element i of system k of group g is at
+	// [(g * size + i) * SOA_BATCH + k], where size is N*N for the matrices and N for the vectors.
+	// The layout doesn't depend on GWLane::WIDTH, a group takes SOA_BATCH / WIDTH passes.
+	const int SOA_BATCH = 8;
+
+	template<int N>
+	inline void solve_soa_group_n(float* pAns, const float* pMtx, const float* pRH, float* pMinPiv) {
+		typedef GWLane::F V;
+		for (int l = 0; l < SOA_BATCH; l += GWLane::WIDTH) {
+			V a[N * N];
+			V b[N];
+			V x[N];
+			for (int i = 0; i < N * N; ++i) {
+				a[i] = GWLane::load(pMtx + i * SOA_BATCH + l);
+			}
+			for (int i = 0; i < N; ++i) {
+				b[i] = GWLane::load(pRH + i * SOA_BATCH + l);
+			}
+			V minPiv = solve_n<N>(x, a, b);
+			for (int i = 0; i < N; ++i) {
+				GWLane::store(pAns + i * SOA_BATCH + l, x[i]);
+			}
+			if (pMinPiv) {
+				GWLane::store(pMinPiv + l, minPiv);
+			}
+		}
+	}
+
+	template<int N>
+	inline void solve_soa_n(float* pAns, const float* pMtx, const float* pRH, const int ngroups, float* pMinPiv /*[ngroups*SOA_BATCH]*/ = nullptr, const bool parallel = true) {
+		auto solve = [&](int g0, int g1) {
+			for (int g = g0; g < g1; ++g) {
+				float* pPiv = pMinPiv ? pMinPiv + size_t(g) * SOA_BATCH : nullptr;
+				solve_soa_group_n<N>(pAns + size_t(g) * N * SOA_BATCH, pMtx + size_t(g) * N * N * SOA_BATCH, pRH + size_t(g) * N * SOA_BATCH, pPiv);
+			}
+		};
+		GWTask::parallel_for(ngroups, solve, parallel ? BATCH_GRAIN : ngroups);
+	}
+
+	// The same for systems stored one after another, they are interleaved by groups on the stack;
+	// the last group is padded with the identity.
+	template<int N>
+	inline void solve_batch_n(float* pAns /*[num*N]*/, const float* pMtx /*[num*N*N]*/, const float* pRH /*[num*N]*/, const int num, float* pMinPiv /*[num]*/ = nullptr, const bool parallel = true) {
+		int ngroups = (num + SOA_BATCH - 1) / SOA_BATCH;
+		auto solve = [&](int g0, int g1) {
+			float m[N * N * SOA_BATCH];
+			float r[N * SOA_BATCH];
+			float x[N * SOA_BATCH];
+			float piv[SOA_BATCH];
+			for (int g = g0; g < g1; ++g) {
+				int k0 = g * SOA_BATCH;
+				int nk = std::min(SOA_BATCH, num - k0);
+				for (int k = 0; k < SOA_BATCH; ++k) {
+					const float* pM = pMtx + size_t(k0 + k) * N * N;
+					const float* pR = pRH + size_t(k0 + k) * N;
+					for (int i = 0; i < N * N; ++i) {
+						m[i * SOA_BATCH + k] = k < nk ? pM[i] : float(i % (N + 1) == 0);
+					}
+					for (int i = 0; i < N; ++i) {
+						r[i * SOA_BATCH + k] = k < nk ? pR[i] : 0.0f;
+					}
+				}
+				solve_soa_group_n<N>(x, m, r, piv);
+				for (int k = 0; k < nk; ++k) {
+					float* pX = pAns + size_t(k0 + k) * N;
+					for (int i = 0; i < N; ++i) {
+						pX[i] = x[i * SOA_BATCH + k];
+					}
+					if (pMinPiv) {
+						pMinPiv[k0 + k] = piv[k];
+					}
+				}
+			}
+		};
+		GWTask::parallel_for(ngroups, solve, parallel ? BATCH_GRAIN : ngroups);
+	}
+
 	// pGJ - resulting mtx: inverted, no columns permutations
 	// pIdxc, pIdxR, pPiv - pivot bookkeeping arrays
 	// pA - matrix to solve
@@ -65,4 +65,44 @@ void GWModel::destroy(GWModel* pMdl) {
 	if (pMdl) {
 		delete[] reinterpret_cast<uint8_t*>(pMdl);
 	}
-}
\ No newline at end of file
+}
+
+void GWModel::calc_posed_pnts(GWVectorF* pPnts, uint32_t org, uint32_t num) const {
+	if (pPnts == nullptr || mpRsc == nullptr) { return; }
+	GWModelResource* pMdr = mpRsc;
+	bool skinFlg = pMdr->has_skin() && mpSkinXforms != nullptr;
+	uint32_t end = std::min(org + num, pMdr->mNumPnt);
+	for (uint32_t i = org; i < end; ++i) {
+		GWVectorF pnt = pMdr->get_pnt(i);
+		uint32_t numJnt = skinFlg ? pMdr->get_pnt_skin_joints_count(i) : 0;
+		if (numJnt > 0) {
+			GWTuple4u jnt = pMdr->get_pnt_skin_joints(i);
+			GWTuple4f wgt = pMdr->get_pnt_skin_weights(i);
+			GWVectorF acc(0.0f);
+			float wsum = 0.0f;
+			for (uint32_t j = 0; j < numJnt; ++j) {
+				acc += mpSkinXforms[jnt[j]].calc_pnt(pnt) * wgt[j];
+				wsum += wgt[j];
+			}
+			// the weights are stored as bytes and don't always sum up to 1
+			pPnts[i] = acc * (1.0f / wsum);
+		} else {
+			pPnts[i] = mWorld.calc_pnt(pnt);
+		}
+	}
+}
+
+void GWModel::calc_posed_skin_spheres(const GWSphereF* pRestSph, GWSphereF* pSph) const {
+	if (pRestSph == nullptr || pSph == nullptr || mpRsc == nullptr) { return; }
+	if (!mpRsc->has_skin() || mpSkinXforms == nullptr) { return; }
+	for (uint32_t i = 0; i < mpRsc->mNumSkinNodes; ++i) {
+		const GWTransform3x4F& xform = mpSkinXforms[i];
+		float sclSq = 0.0f;
+		for (int j = 0; j < 3; ++j) {
+			GWVectorF axis(xform.m[0][j], xform.m[1][j], xform.m[2][j]);
+			sclSq = std::max(sclSq, axis.length_sq());
+		}
+		pSph[i].c = xform.calc_pnt(pRestSph[i].c);
+		pSph[i].r = pRestSph[i].r * GWBase::tsqrt(sclSq);
+	}
+}
@@ -17,4 +17,10 @@ public:
 public:
 	static GWModel* create(GWModelResource* pMdr, const size_t paramMemSz = 0, const size_t extMemSz = 0);
 	static void destroy(GWModel* pMdl);
+
+	// Points posed by the skin transforms (linear blend), or by mWorld for models without skin.
+	// pPnts holds mpRsc->mNumPnt entries, only the range [org, org + num) is written.
+	void calc_posed_pnts(GWVectorF* pPnts, uint32_t org, uint32_t num) const;
+	// Moves the bind pose skin spheres (see GWModelResource::calc_skin_spheres_of_influence) by the skin transforms.
+	void calc_posed_skin_spheres(const GWSphereF* pRestSph, GWSphereF* pSph) const;
 };
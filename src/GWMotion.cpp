@@ -352,6 +352,35 @@ GWVectorF GWMotion::eval(uint32_t nodeId, GWTrackKind trackKind, float frame) co
 	return val;
 }
 
+void GWMotion::eval_quats(GWQuaternionF* pDst, float frame, bool useSlerp) const {
+	uint32_t n = mNumNodes;
+	if (n == 0) { return; }
+	float fstart = ::floorf(frame);
+	float bias = frame - fstart;
+	if (useSlerp && bias != 0.0f) {
+		GWVectorF* pLog = reinterpret_cast<GWVectorF*>(GWSys::alloc_temp_mem(n * sizeof(GWVectorF)));
+		GWQuaternionF* pEnd = reinterpret_cast<GWQuaternionF*>(GWSys::alloc_temp_mem(n * sizeof(GWQuaternionF)));
+		for (uint32_t i = 0; i < n; ++i) {
+			pLog[i] = eval(i, GWTrackKind::ROT, fstart);
+		}
+		GWQuaternion::expmap_decode(pDst, pLog, n);
+		for (uint32_t i = 0; i < n; ++i) {
+			pLog[i] = eval(i, GWTrackKind::ROT, fstart + 1.0f);
+		}
+		GWQuaternion::expmap_decode(pEnd, pLog, n);
+		GWUnitQuaternion::slerp(pDst, pDst, pEnd, bias, n);
+		GWSys::free_temp_mem(pEnd);
+		GWSys::free_temp_mem(pLog);
+	} else {
+		GWVectorF* pLog = reinterpret_cast<GWVectorF*>(GWSys::alloc_temp_mem(n * sizeof(GWVectorF)));
+		for (uint32_t i = 0; i < n; ++i) {
+			pLog[i] = eval(i, GWTrackKind::ROT, useSlerp ? fstart : frame);
+		}
+		GWQuaternion::expmap_decode(pDst, pLog, n);
+		GWSys::free_temp_mem(pLog);
+	}
+}
+
 void dump_track_to_clip(std::ostream & os, const GWMotion::Track& track) {
 	using namespace std;
 
@@ -277,6 +277,9 @@ public:
 		return res;
 	}
 
+	// Rotations of all the nodes at once, pDst holds num_nodes() quaternions.
+	void eval_quats(GWQuaternionF* pDst, float frame, bool useSlerp = false) const;
+
 	GWTransformOrder eval_xord(uint32_t nodeId, float frame) const;
 
 	void eval_xform(GWTransformF& xform, uint32_t nodeId, float frame) const {
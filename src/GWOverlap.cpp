@@ -35,4 +35,147 @@ namespace GWOverlap {
 
 	template bool seg_aabb(const GWVectorBase<float>& p, const GWVectorBase<float>& q, const GWVectorBase<float>& min, const GWVectorBase<float>& max);
 	template bool seg_aabb(const GWVectorBase<double>& p, const GWVectorBase<double>& q, const GWVectorBase<double>& min, const GWVectorBase<double>& max);
+
+	// Voronoi regions of the vertices and edges are checked first, then the face (Ericson, RTCD 5.1.5)
+	template<typename T> GWVectorBase<T> closest_pnt_tri(const GWVectorBase<T>& p, const GWVectorBase<T>& a, const GWVectorBase<T>& b, const GWVectorBase<T>& c) {
+		GWVectorBase<T> ab = b - a;
+		GWVectorBase<T> ac = c - a;
+		GWVectorBase<T> ap = p - a;
+		T d1 = ab.dot(ap);
+		T d2 = ac.dot(ap);
+		if (d1 <= T(0) && d2 <= T(0)) { return a; }
+
+		GWVectorBase<T> bp = p - b;
+		T d3 = ab.dot(bp);
+		T d4 = ac.dot(bp);
+		if (d3 >= T(0) && d4 <= d3) { return b; }
+
+		T vc = d1*d4 - d3*d2;
+		if (vc <= T(0) && d1 >= T(0) && d3 <= T(0)) {
+			return a + ab * (d1 / (d1 - d3));
+		}
+
+		GWVectorBase<T> cp = p - c;
+		T d5 = ab.dot(cp);
+		T d6 = ac.dot(cp);
+		if (d6 >= T(0) && d5 <= d6) { return c; }
+
+		T vb = d5*d2 - d1*d6;
+		if (vb <= T(0) && d2 >= T(0) && d6 <= T(0)) {
+			return a + ac * (d2 / (d2 - d6));
+		}
+
+		T va = d3*d6 - d5*d4;
+		if (va <= T(0) && (d4 - d3) >= T(0) && (d5 - d6) >= T(0)) {
+			return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+		}
+
+		T denom = T(1) / (va + vb + vc);
+		return a + ab * (vb * denom) + ac * (vc * denom);
+	}
+
+	template<typename T> T seg_seg_closest(const GWVectorBase<T>& p0, const GWVectorBase<T>& q0, const GWVectorBase<T>& p1, const GWVectorBase<T>& q1,
+		T& s, T& t, GWVectorBase<T>& c0, GWVectorBase<T>& c1) {
+		const T eps = T(1.0e-12f);
+		GWVectorBase<T> d0 = q0 - p0;
+		GWVectorBase<T> d1 = q1 - p1;
+		GWVectorBase<T> r = p0 - p1;
+		T a = d0.dot(d0);
+		T e = d1.dot(d1);
+		T f = d1.dot(r);
+		if (a <= eps && e <= eps) {
+			s = t = T(0);
+		} else if (a <= eps) {
+			s = T(0);
+			t = GWBase::saturate(f / e);
+		} else {
+			T c = d0.dot(r);
+			if (e <= eps) {
+				t = T(0);
+				s = GWBase::saturate(-c / a);
+			} else {
+				T b = d0.dot(d1);
+				T denom = a*e - b*b;
+				s = denom > T(0) ? GWBase::saturate((b*f - c*e) / denom) : T(0);
+				t = (b*s + f) / e;
+				if (t < T(0)) {
+					t = T(0);
+					s = GWBase::saturate(-c / a);
+				} else if (t > T(1)) {
+					t = T(1);
+					s = GWBase::saturate((b - c) / a);
+				}
+			}
+		}
+		c0 = p0 + d0 * s;
+		c1 = p1 + d1 * t;
+		return (c0 - c1).length_sq();
+	}
+
+	template<typename T> T seg_tri_dist_sq(const GWVectorBase<T>& p, const GWVectorBase<T>& q, const GWVectorBase<T>& a, const GWVectorBase<T>& b, const GWVectorBase<T>& c,
+		GWVectorBase<T>* pSegPnt, GWVectorBase<T>* pTriPnt) {
+		GWVectorBase<T> segPnt;
+		GWVectorBase<T> triPnt;
+		T distSq;
+
+		// a segment crossing the triangle touches it
+		GWVectorBase<T> n;
+		n.cross(b - a, c - a);
+		T dp = (p - a).dot(n);
+		T dq = (q - a).dot(n);
+		if ((dp <= T(0) && dq >= T(0)) || (dp >= T(0) && dq <= T(0))) {
+			T den = dp - dq;
+			if (den != T(0)) {
+				GWVectorBase<T> x = p + (q - p) * (dp / den);
+				GWVectorBase<T> e0, e1, e2;
+				e0.cross(b - a, x - a);
+				e1.cross(c - b, x - b);
+				e2.cross(a - c, x - c);
+				T s0 = e0.dot(n);
+				T s1 = e1.dot(n);
+				T s2 = e2.dot(n);
+				if (s0 >= T(0) && s1 >= T(0) && s2 >= T(0)) {
+					if (pSegPnt) { *pSegPnt = x; }
+					if (pTriPnt) { *pTriPnt = x; }
+					return T(0);
+				}
+			}
+		}
+
+		triPnt = closest_pnt_tri(p, a, b, c);
+		segPnt = p;
+		distSq = (p - triPnt).length_sq();
+		GWVectorBase<T> tp = closest_pnt_tri(q, a, b, c);
+		T dsq = (q - tp).length_sq();
+		if (dsq < distSq) {
+			distSq = dsq;
+			segPnt = q;
+			triPnt = tp;
+		}
+		const GWVectorBase<T>* pVtx[3] = { &a, &b, &c };
+		for (int i = 0; i < 3; ++i) {
+			T s, t;
+			GWVectorBase<T> c0, c1;
+			dsq = seg_seg_closest(p, q, *pVtx[i], *pVtx[(i + 1) % 3], s, t, c0, c1);
+			if (dsq < distSq) {
+				distSq = dsq;
+				segPnt = c0;
+				triPnt = c1;
+			}
+		}
+		if (pSegPnt) { *pSegPnt = segPnt; }
+		if (pTriPnt) { *pTriPnt = triPnt; }
+		return distSq;
+	}
+
+	template GWVectorBase<float> closest_pnt_tri(const GWVectorBase<float>& p, const GWVectorBase<float>& a, const GWVectorBase<float>& b, const GWVectorBase<float>& c);
+	template GWVectorBase<double> closest_pnt_tri(const GWVectorBase<double>& p, const GWVectorBase<double>& a, const GWVectorBase<double>& b, const GWVectorBase<double>& c);
+	template float seg_seg_closest(const GWVectorBase<float>& p0, const GWVectorBase<float>& q0, const GWVectorBase<float>& p1, const GWVectorBase<float>& q1,
+		float& s, float& t, GWVectorBase<float>& c0, GWVectorBase<float>& c1);
+	template double seg_seg_closest(const GWVectorBase<double>& p0, const GWVectorBase<double>& q0, const GWVectorBase<double>& p1, const GWVectorBase<double>& q1,
+		double& s, double& t, GWVectorBase<double>& c0, GWVectorBase<double>& c1);
+	template float seg_tri_dist_sq(const GWVectorBase<float>& p, const GWVectorBase<float>& q, const GWVectorBase<float>& a, const GWVectorBase<float>& b, const GWVectorBase<float>& c,
+		GWVectorBase<float>* pSegPnt, GWVectorBase<float>* pTriPnt);
+	template double seg_tri_dist_sq(const GWVectorBase<double>& p, const GWVectorBase<double>& q, const GWVectorBase<double>& a, const GWVectorBase<double>& b, const GWVectorBase<double>& c,
+		GWVectorBase<double>* pSegPnt, GWVectorBase<double>* pTriPnt);
 } //GWOverlap
\ No newline at end of file
@@ -11,5 +11,51 @@ namespace GWOverlap {
 		return true;
 	}
 
+	template<typename T> inline T pnt_aabb_dist_sq(const GWVectorBase<T>& p, const GWVectorBase<T>& min, const GWVectorBase<T>& max) {
+		T distSq = T(0);
+		for (int i = 0; i < 3; ++i) {
+			T d = std::max(min[i] - p[i], p[i] - max[i]);
+			if (d > T(0)) { distSq += d * d; }
+		}
+		return distSq;
+	}
+
 	template<typename T> bool seg_aabb(const GWVectorBase<T>& p, const GWVectorBase<T>& q, const GWVectorBase<T>& min, const GWVectorBase<T>& max);
+
+	// Closest point of triangle abc to p, either winding.
+	template<typename T> GWVectorBase<T> closest_pnt_tri(const GWVectorBase<T>& p, const GWVectorBase<T>& a, const GWVectorBase<T>& b, const GWVectorBase<T>& c);
+	// Closest points of segments p0-q0 and p1-q1: c0 = p0 + s*(q0-p0), c1 = p1 + t*(q1-p1). Returns the squared distance.
+	template<typename T> T seg_seg_closest(const GWVectorBase<T>& p0, const GWVectorBase<T>& q0, const GWVectorBase<T>& p1, const GWVectorBase<T>& q1,
+		T& s, T& t, GWVectorBase<T>& c0, GWVectorBase<T>& c1);
+	// Squared distance between segment pq and triangle abc, optionally with the closest points.
+	template<typename T> T seg_tri_dist_sq(const GWVectorBase<T>& p, const GWVectorBase<T>& q, const GWVectorBase<T>& a, const GWVectorBase<T>& b, const GWVectorBase<T>& c,
+		GWVectorBase<T>* pSegPnt = nullptr, GWVectorBase<T>* pTriPnt = nullptr);
+
+	// Reciprocal direction for the slab test, zero components are replaced with a tiny signed value
+	// to keep the result finite (the library is built with -ffast-math).
+	template<typename T> inline GWVectorBase<T> calc_inv_dir(const GWVectorBase<T>& dir) {
+		const T tiny = T(1.0e-20f);
+		GWVectorBase<T> inv;
+		for (int i = 0; i < 3; ++i) {
+			T d = dir[i];
+			if (std::fabs(d) < tiny) { d = d < T(0) ? -tiny : tiny; }
+			inv[i] = T(1) / d;
+		}
+		return inv;
+	}
+
+	// Kay-Kajiya slab test of the [tmin, tmax] span of org + t*dir, invDir = calc_inv_dir(dir)
+	template<typename T> inline bool seg_aabb_slab(const GWVectorBase<T>& org, const GWVectorBase<T>& invDir, T tmin, T tmax,
+		const GWVectorBase<T>& min, const GWVectorBase<T>& max, T* pTEntry = nullptr) {
+		for (int i = 0; i < 3; ++i) {
+			T t0 = (min[i] - org[i]) * invDir[i];
+			T t1 = (max[i] - org[i]) * invDir[i];
+			if (t0 > t1) { std::swap(t0, t1); }
+			tmin = t0 > tmin ? t0 : tmin;
+			tmax = t1 < tmax ? t1 : tmax;
+			if (tmin > tmax) { return false; }
+		}
+		if (pTEntry) { *pTEntry = tmin; }
+		return true;
+	}
 }
\ No newline at end of file
@@ -4,9 +4,11 @@
 
 #include "GWSys.hpp"
 #include "GWBase.hpp"
+#include "GWTask.hpp"
 #include "GWVector.hpp"
 #include "GWMatrix.hpp"
 #include "GWQuaternion.hpp"
+#include "GWTransform.hpp"
 
 template<typename T> GWVectorBase<T> GWUnitQuaternion::get_radians(const GWQuaternionBase<T>& q, GWRotationOrder order) {
 	static struct { uint8_t idx0, idx1, idx2, positive; } rotTbl[] = {
@@ -76,7 +78,7 @@ template<typename T> GWVectorBase<T> GWUnitQuaternion::get_radians(const GWQuate
 template GWVectorBase<float> GWUnitQuaternion::get_radians(const GWQuaternionBase<float>& q, GWRotationOrder order);
 template GWVectorBase<double> GWUnitQuaternion::get_radians(const GWQuaternionBase<double>& q, GWRotationOrder order);
 
-template<typename T> GWQuaternionBase<T> GWUnitQuaternion::slerp(const GWQuaternionBase<T>& qa, const GWQuaternionBase<T>& qb, T t) {
+template<typename T> GWQuaternionBase<T> GWUnitQuaternion::slerp(const GWQuaternionBase<T>& qa, const GWQuaternionBase<T>& qb, T t, GWMathTier tier) {
 	GWQuaternionBase<T> qres;
 	GWTuple4<T> res;
 	T c = qa.dot(qb);
@@ -93,11 +95,11 @@ template<typename T> GWQuaternionBase<T> GWUnitQuaternion::slerp(const GWQuatern
 
 	if (std::fabs(c) <= (T(1) - T(1e-5f))) {
 		GWBase::clamp(c, T(-1), T(1));
-		theta = std::acos(c);
-		s = std::sin(theta);
+		theta = GWBase::approx_acos(c, tier);
+		s = GWBase::approx_sin(theta, tier);
 		invS = T(1) / s;
-		af = std::sin(((1) - t)*theta) * invS;
-		bf *= std::sin(t*theta) * invS;
+		af = GWBase::approx_sin(((1) - t)*theta, tier) * invS;
+		bf *= GWBase::approx_sin(t*theta, tier) * invS;
 	} else {
 		af = T(1) - t;
 		bf *= t;
@@ -110,8 +112,8 @@ template<typename T> GWQuaternionBase<T> GWUnitQuaternion::slerp(const GWQuatern
 	return qres;
 }
 
-template GWQuaternionBase<float> GWUnitQuaternion::slerp(const GWQuaternionBase<float>& qa, const GWQuaternionBase<float>& qb, float t);
-template GWQuaternionBase<double> GWUnitQuaternion::slerp(const GWQuaternionBase<double>& qa, const GWQuaternionBase<double>& qb, double t);
+template GWQuaternionBase<float> GWUnitQuaternion::slerp(const GWQuaternionBase<float>& qa, const GWQuaternionBase<float>& qb, float t, GWMathTier tier);
+template GWQuaternionBase<double> GWUnitQuaternion::slerp(const GWQuaternionBase<double>& qa, const GWQuaternionBase<double>& qb, double t, GWMathTier tier);
 
 template<typename T> GWQuaternionBase<T> GWUnitQuaternion::from_transform(const T* pXfrom, const int n, const bool rowAxis) {
 	GWQuaternionBase<T> q;
@@ -173,7 +175,7 @@ template<typename T> GWQuaternionBase<T> GWUnitQuaternion::from_transform(const
 template GWQuaternionBase<float> GWUnitQuaternion::from_transform(const float* pXfrom, const int n, const bool rowAxis);
 template GWQuaternionBase<double> GWUnitQuaternion::from_transform(const double* pXfrom, const int n, const bool rowAxis);
 
-template<typename T> void GWQuaternionBase<T>::set_radians(T rx, T ry, T rz, GWRotationOrder order) {
+template<typename T> void GWQuaternionBase<T>::set_radians(T rx, T ry, T rz, GWRotationOrder order, GWMathTier tier) {
 	static uint8_t tbl[] = {
 		0, 1, 2,
 		0, 2, 1,
@@ -191,14 +193,256 @@ template<typename T> void GWQuaternionBase<T>::set_radians(T rx, T ry, T rz, GWR
 		int iq1 = tbl[idx + 1];
 		int iq0 = tbl[idx + 2];
 		GWQuaternionBase rq[3];
-		rq[0].set_rx(rx);
-		rq[1].set_ry(ry);
-		rq[2].set_rz(rz);
+		rq[0].set_rx(rx, tier);
+		rq[1].set_ry(ry, tier);
+		rq[2].set_rz(rz, tier);
 		mul(rq[iq0], rq[iq1]);
 		mul(rq[iq2]);
 	}
 }
 
-template void GWQuaternionBase<float>::set_radians(float rx, float ry, float rz, GWRotationOrder order);
-template void GWQuaternionBase<double>::set_radians(double rx, double ry, double rz, GWRotationOrder order);
+template void GWQuaternionBase<float>::set_radians(float rx, float ry, float rz, GWRotationOrder order, GWMathTier tier);
+template void GWQuaternionBase<double>::set_radians(double rx, double ry, double rz, GWRotationOrder order, GWMathTier tier);
 
+typedef GWLane::F QLane;
+
+#if defined(GW_SIMD_SSE)
+static GW_FORCEINLINE void load4_quats(const float* p, __m128& x, __m128& y, __m128& z, __m128& w) {
+	x = _mm_loadu_ps(p);
+	y = _mm_loadu_ps(p + 4);
+	z = _mm_loadu_ps(p + 8);
+	w = _mm_loadu_ps(p + 12);
+	_MM_TRANSPOSE4_PS(x, y, z, w);
+}
+
+static GW_FORCEINLINE void store4_quats(float* p, __m128 x, __m128 y, __m128 z, __m128 w) {
+	_MM_TRANSPOSE4_PS(x, y, z, w);
+	_mm_storeu_ps(p, x);
+	_mm_storeu_ps(p + 4, y);
+	_mm_storeu_ps(p + 8, z);
+	_mm_storeu_ps(p + 12, w);
+}
+
+// x0 y0 z0 x1 | y1 z1 x2 y2 | z2 x3 y3 z3
+static GW_FORCEINLINE void load4_vecs(const float* p, __m128& x, __m128& y, __m128& z) {
+	__m128 m0 = _mm_loadu_ps(p);
+	__m128 m1 = _mm_loadu_ps(p + 4);
+	__m128 m2 = _mm_loadu_ps(p + 8);
+	__m128 x23 = _mm_shuffle_ps(m1, m2, _MM_SHUFFLE(1, 1, 2, 2));
+	__m128 y01 = _mm_shuffle_ps(m0, m1, _MM_SHUFFLE(0, 0, 1, 1));
+	__m128 y23 = _mm_shuffle_ps(m1, m2, _MM_SHUFFLE(2, 2, 3, 3));
+	__m128 z01 = _mm_shuffle_ps(m0, m1, _MM_SHUFFLE(1, 1, 2, 2));
+	x = _mm_shuffle_ps(m0, x23, _MM_SHUFFLE(2, 0, 3, 0));
+	y = _mm_shuffle_ps(y01, y23, _MM_SHUFFLE(2, 0, 2, 0));
+	z = _mm_shuffle_ps(z01, m2, _MM_SHUFFLE(3, 0, 2, 0));
+}
+#endif
+
+#if defined(GW_SIMD_AVX)
+static GW_FORCEINLINE __m256 combine(__m128 lo, __m128 hi) {
+	return _mm256_insertf128_ps(_mm256_castps128_ps256(lo), hi, 1);
+}
+#endif
+
+// Element i of a block of GWLane::WIDTH goes to lane i.
+static GW_FORCEINLINE void lload(const GWQuaternionF* pSrc, QLane& x, QLane& y, QLane& z, QLane& w) {
+	const float* p = pSrc[0].as_tptr();
+#if defined(GW_SIMD_AVX)
+	__m128 x0, y0, z0, w0, x1, y1, z1, w1;
+	load4_quats(p, x0, y0, z0, w0);
+	load4_quats(p + 16, x1, y1, z1, w1);
+	x = combine(x0, x1);
+	y = combine(y0, y1);
+	z = combine(z0, z1);
+	w = combine(w0, w1);
+#elif defined(GW_SIMD_SSE)
+	load4_quats(p, x.v, y.v, z.v, w.v);
+#else
+	x = p[0];
+	y = p[1];
+	z = p[2];
+	w = p[3];
+#endif
+}
+
+static GW_FORCEINLINE void lload(const GWVectorF* pSrc, QLane& x, QLane& y, QLane& z) {
+	const float* p = pSrc[0].elems;
+#if defined(GW_SIMD_AVX)
+	__m128 x0, y0, z0, x1, y1, z1;
+	load4_vecs(p, x0, y0, z0);
+	load4_vecs(p + 12, x1, y1, z1);
+	x = combine(x0, x1);
+	y = combine(y0, y1);
+	z = combine(z0, z1);
+#elif defined(GW_SIMD_SSE)
+	load4_vecs(p, x.v, y.v, z.v);
+#else
+	x = p[0];
+	y = p[1];
+	z = p[2];
+#endif
+}
+
+static GW_FORCEINLINE void lstore(GWQuaternionF* pDst, QLane x, QLane y, QLane z, QLane w) {
+	float* p = pDst[0].as_tptr();
+#if defined(GW_SIMD_AVX)
+	store4_quats(p, _mm256_castps256_ps128(x.v), _mm256_castps256_ps128(y.v), _mm256_castps256_ps128(z.v), _mm256_castps256_ps128(w.v));
+	store4_quats(p + 16, _mm256_extractf128_ps(x.v, 1), _mm256_extractf128_ps(y.v, 1), _mm256_extractf128_ps(z.v, 1), _mm256_extractf128_ps(w.v, 1));
+#elif defined(GW_SIMD_SSE)
+	store4_quats(p, x.v, y.v, z.v, w.v);
+#else
+	p[0] = x.v;
+	p[1] = y.v;
+	p[2] = z.v;
+	p[3] = w.v;
+#endif
+}
+
+static void set_pad(GWQuaternionF& q) { q.set_identity(); }
+static void set_pad(GWVectorF& v) { v.fill(0.0f); }
+
+// Runs func(pDst, pA, pB) on full blocks of GWLane::WIDTH elements, the tail goes through a block
+// padded with identities or zero vectors. pB may be null.
+template<typename DST_T, typename SRC_T, typename FUNC_T>
+static void exec_blocks(DST_T* pDst, const SRC_T* pA, const SRC_T* pB, int num, const FUNC_T& func) {
+	const int width = GWLane::WIDTH;
+	int i = 0;
+	for (; i + width <= num; i += width) {
+		func(&pDst[i], &pA[i], pB ? &pB[i] : nullptr);
+	}
+	int n = num - i;
+	if (n > 0) {
+		DST_T dst[width];
+		SRC_T a[width];
+		SRC_T b[width];
+		for (int j = 0; j < width; ++j) {
+			set_pad(a[j]);
+			set_pad(b[j]);
+		}
+		for (int j = 0; j < n; ++j) {
+			a[j] = pA[i + j];
+			if (pB) { b[j] = pB[i + j]; }
+		}
+		func(dst, a, pB ? b : nullptr);
+		for (int j = 0; j < n; ++j) {
+			pDst[i + j] = dst[j];
+		}
+	}
+}
+
+static GW_FORCEINLINE QLane ldot(QLane ax, QLane ay, QLane az, QLane aw, QLane bx, QLane by, QLane bz, QLane bw) {
+	return ax * bx + ay * by + az * bz + aw * bw;
+}
+
+// zero stays zero
+static GW_FORCEINLINE void lnormalize(QLane& x, QLane& y, QLane& z, QLane& w) {
+	QLane len = GWLane::sqrt(ldot(x, y, z, w, x, y, z, w));
+	QLane s = GWLane::sel(len > QLane(0.0f), QLane(1.0f) / len, QLane(0.0f));
+	x = x * s;
+	y = y * s;
+	z = z * s;
+	w = w * s;
+}
+
+void GWQuaternion::expmap_decode(GWQuaternionF* pDst, const GWVectorF* pSrc, int num) {
+	exec_blocks(pDst, pSrc, (const GWVectorF*)nullptr, num, [](GWQuaternionF* pOut, const GWVectorF* pLog, const GWVectorF*) {
+		QLane x, y, z;
+		lload(pLog, x, y, z);
+		QLane ang = GWLane::sqrt(x * x + y * y + z * z);
+		QLane s, c;
+		GWBase::sincos_approx<GWMathTier::FAST>(ang, s, c);
+		// sin(ang) / ang
+		s = GWLane::sel(ang > QLane(1.0e-8f), s / ang, QLane(1.0f));
+		lstore(pOut, x * s, y * s, z * s, c);
+	});
+}
+
+void GWQuaternion::normalize(GWQuaternionF* pDst, const GWQuaternionF* pSrc, int num) {
+	exec_blocks(pDst, pSrc, (const GWQuaternionF*)nullptr, num, [](GWQuaternionF* pOut, const GWQuaternionF* pQ, const GWQuaternionF*) {
+		QLane x, y, z, w;
+		lload(pQ, x, y, z, w);
+		lnormalize(x, y, z, w);
+		lstore(pOut, x, y, z, w);
+	});
+}
+
+void GWUnitQuaternion::nlerp(GWQuaternionF* pDst, const GWQuaternionF* pA, const GWQuaternionF* pB, float t, int num) {
+	exec_blocks(pDst, pA, pB, num, [t](GWQuaternionF* pOut, const GWQuaternionF* pQA, const GWQuaternionF* pQB) {
+		QLane ax, ay, az, aw, bx, by, bz, bw;
+		lload(pQA, ax, ay, az, aw);
+		lload(pQB, bx, by, bz, bw);
+		QLane af(1.0f - t);
+		QLane bf = GWLane::neg_if(ldot(ax, ay, az, aw, bx, by, bz, bw) < QLane(0.0f), QLane(t));
+		QLane x = ax * af + bx * bf;
+		QLane y = ay * af + by * bf;
+		QLane z = az * af + bz * bf;
+		QLane w = aw * af + bw * bf;
+		lnormalize(x, y, z, w);
+		lstore(pOut, x, y, z, w);
+	});
+}
+
+void GWUnitQuaternion::slerp(GWQuaternionF* pDst, const GWQuaternionF* pA, const GWQuaternionF* pB, float t, int num) {
+	exec_blocks(pDst, pA, pB, num, [t](GWQuaternionF* pOut, const GWQuaternionF* pQA, const GWQuaternionF* pQB) {
+		QLane ax, ay, az, aw, bx, by, bz, bw;
+		lload(pQA, ax, ay, az, aw);
+		lload(pQB, bx, by, bz, bw);
+		QLane c = ldot(ax, ay, az, aw, bx, by, bz, bw);
+		auto flip = c < QLane(0.0f);
+		c = GWLane::min(GWLane::neg_if(flip, c), QLane(1.0f));
+		QLane theta = GWBase::acos_approx<GWMathTier::FAST>(c);
+		QLane sa, sb, unused;
+		GWBase::sincos_approx<GWMathTier::FAST>(theta * QLane(1.0f - t), sa, unused);
+		GWBase::sincos_approx<GWMathTier::FAST>(theta * QLane(t), sb, unused);
+		QLane invS = QLane(1.0f) / GWLane::sqrt(GWLane::max(QLane(1.0f) - c * c, QLane(1.0e-12f)));
+		// nearly parallel, lerp as the scalar version does
+		auto near = c > QLane(1.0f - 1.0e-5f);
+		QLane af = GWLane::sel(near, QLane(1.0f - t), sa * invS);
+		QLane bf = GWLane::neg_if(flip, GWLane::sel(near, QLane(t), sb * invS));
+		QLane x = ax * af + bx * bf;
+		QLane y = ay * af + by * bf;
+		QLane z = az * af + bz * bf;
+		QLane w = aw * af + bw * bf;
+		lnormalize(x, y, z, w);
+		lstore(pOut, x, y, z, w);
+	});
+}
+
+void GWUnitQuaternion::make_rotations(GWTransform3x4<float>* pDst, const GWQuaternionF* pSrc, int num) {
+	exec_blocks(pDst, pSrc, (const GWQuaternionF*)nullptr, num, [](GWTransform3x4<float>* pOut, const GWQuaternionF* pQ, const GWQuaternionF*) {
+		float m[9][GWLane::WIDTH];
+		QLane x, y, z, w;
+		lload(pQ, x, y, z, w);
+		QLane one(1.0f);
+		QLane x2 = x + x;
+		QLane y2 = y + y;
+		QLane z2 = z + z;
+		QLane xx = x * x2;
+		QLane yy = y * y2;
+		QLane zz = z * z2;
+		QLane xy = x * y2;
+		QLane xz = x * z2;
+		QLane yz = y * z2;
+		QLane wx = w * x2;
+		QLane wy = w * y2;
+		QLane wz = w * z2;
+		GWLane::store(m[0], one - (yy + zz));
+		GWLane::store(m[1], xy - wz);
+		GWLane::store(m[2], xz + wy);
+		GWLane::store(m[3], xy + wz);
+		GWLane::store(m[4], one - (xx + zz));
+		GWLane::store(m[5], yz - wx);
+		GWLane::store(m[6], xz - wy);
+		GWLane::store(m[7], yz + wx);
+		GWLane::store(m[8], one - (xx + yy));
+		for (int i = 0; i < GWLane::WIDTH; ++i) {
+			float* pMtx = pOut[i].as_tptr();
+			for (int j = 0; j < 3; ++j) {
+				pMtx[j * 4] = m[j * 3][i];
+				pMtx[j * 4 + 1] = m[j * 3 + 1][i];
+				pMtx[j * 4 + 2] = m[j * 3 + 2][i];
+				pMtx[j * 4 + 3] = 0.0f;
+			}
+		}
+	});
+}
@@ -3,6 +3,7 @@
  */
 
 template<typename T> class GWQuaternionBase;
+template<typename T> class GWTransform3x4;
 
 namespace GWUnitQuaternion {
 	template<typename T> inline GWVectorBase<T> log(const GWQuaternionBase<T>& q);
@@ -65,22 +66,25 @@ public:
 		return q;
 	}
 
-	void set_rx(T rads) {
-		T h = rads * T(0.5f);
-		GWTuple::set(mQ, std::sin(h), T(0), T(0), std::cos(h));
+	void set_rx(T rads, GWMathTier tier = GWMathTier::FULL) {
+		T s, c;
+		GWBase::approx_sincos(rads * T(0.5f), s, c, tier);
+		GWTuple::set(mQ, s, T(0), T(0), c);
 	}
-	void set_ry(T rads) {
-		T h = rads * T(0.5f);
-		GWTuple::set(mQ, T(0), std::sin(h), T(0), std::cos(h));
+	void set_ry(T rads, GWMathTier tier = GWMathTier::FULL) {
+		T s, c;
+		GWBase::approx_sincos(rads * T(0.5f), s, c, tier);
+		GWTuple::set(mQ, T(0), s, T(0), c);
 	}
-	void set_rz(T rads) {
-		T h = rads * T(0.5f);
-		GWTuple::set(mQ, T(0), T(0), std::sin(h), std::cos(h));
+	void set_rz(T rads, GWMathTier tier = GWMathTier::FULL) {
+		T s, c;
+		GWBase::approx_sincos(rads * T(0.5f), s, c, tier);
+		GWTuple::set(mQ, T(0), T(0), s, c);
 	}
 
-	void set_radians(T rx, T ry, T rz, GWRotationOrder order = GWRotationOrder::XYZ);
-	void set_degrees(T dx, T dy, T dz, GWRotationOrder order = GWRotationOrder::XYZ) {
-		set_radians(GWBase::radians(dx), GWBase::radians(dy), GWBase::radians(dz), order);
+	void set_radians(T rx, T ry, T rz, GWRotationOrder order = GWRotationOrder::XYZ, GWMathTier tier = GWMathTier::FULL);
+	void set_degrees(T dx, T dy, T dz, GWRotationOrder order = GWRotationOrder::XYZ, GWMathTier tier = GWMathTier::FULL) {
+		set_radians(GWBase::radians(dx), GWBase::radians(dy), GWBase::radians(dz), order, tier);
 	}
 
 	GWVectorBase<T> calc_axis_x() const {
@@ -243,7 +247,22 @@ namespace GWUnitQuaternion {
 		return T((std::acos(GWBase::saturate(std::fabs(q.dot(p)))) / (GWBase::pi / 2)));
 	}
 
-	template<typename T> GWQuaternionBase<T> slerp(const GWQuaternionBase<T>& qa, const GWQuaternionBase<T>& qb, T t);
+	template<typename T> GWQuaternionBase<T> slerp(const GWQuaternionBase<T>& qa, const GWQuaternionBase<T>& qb, T t, GWMathTier tier = GWMathTier::FULL);
+
+	// Normalized lerp along the shortest path.
+	template<typename T> GWQuaternionBase<T> nlerp(const GWQuaternionBase<T>& qa, const GWQuaternionBase<T>& qb, T t) {
+		GWQuaternionBase<T> qres;
+		GWTuple4<T> a = qa.get_tuple();
+		GWTuple4<T> b = qb.get_tuple();
+		T bf = qa.dot(qb) < 0 ? -t : t;
+		T af = T(1) - t;
+		for (int i = 0; i < 4; ++i) {
+			a[i] = af * a[i] + bf * b[i];
+		}
+		qres.from_tuple(a);
+		qres.normalize();
+		return qres;
+	}
 
 	template<typename T> GWQuaternionBase<T> diff(const GWQuaternionBase<T>& q, const GWQuaternionBase<T>& p) {
 		return q * GWUnitQuaternion::invert(p);
@@ -388,3 +407,17 @@ template<typename T> inline GWQuaternionBase<T> operator - (const GWQuaternionBa
 typedef GWQuaternionBase<float> GWQuaternionF;
 typedef GWQuaternionBase<double> GWQuaternionD;
 
+// Array forms over float quaternions, processed 8 (AVX) or 4 (SSE) at a time in SoA registers. pDst may be a source.
+// The angles go through the GWMathTier::FAST approximations of GWBase.
+namespace GWQuaternion {
+	void expmap_decode(GWQuaternionF* pDst, const GWVectorF* pSrc, int num);
+	void normalize(GWQuaternionF* pDst, const GWQuaternionF* pSrc, int num);
+}
+
+namespace GWUnitQuaternion {
+	// Shortest path, the results are normalized.
+	void nlerp(GWQuaternionF* pDst, const GWQuaternionF* pA, const GWQuaternionF* pB, float t, int num);
+	void slerp(GWQuaternionF* pDst, const GWQuaternionF* pA, const GWQuaternionF* pB, float t, int num);
+	// As GWTransform3x4::make_rotation for unit quaternions.
+	void make_rotations(GWTransform3x4<float>* pDst, const GWQuaternionF* pSrc, int num);
+}
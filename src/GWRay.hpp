@@ -15,20 +15,19 @@ public:
 	GWVectorBase<T> direction() const { return mDir; }
 	GWVectorBase<T> at(T t) const { return mOrig + t * mDir; }
 
-	inline void from_asimuth_inclination(T azimuth, T inclination) {
-		T sinA = std::sin(azimuth);
-		T cosA = std::cos(azimuth);
-		T sinI = std::sin(inclination);
-		T cosI = std::cos(inclination);
+	inline void from_asimuth_inclination(T azimuth, T inclination, GWMathTier tier = GWMathTier::FULL) {
+		T sinA, cosA, sinI, cosI;
+		GWBase::approx_sincos(azimuth, sinA, cosA, tier);
+		GWBase::approx_sincos(inclination, sinI, cosI, tier);
 		mDir.x = cosA * sinI;
 		mDir.y = cosI;
 		mDir.z = sinA * sinI;
 	}
 
-	inline void from_polar_uv(T u, T v) {
+	inline void from_polar_uv(T u, T v, GWMathTier tier = GWMathTier::FULL) {
 		float azimuth = u * T(2) * GWBase::pi;
 		float inclination = (v - T(1)) * GWBase::pi;
-		from_asimuth_inclination(azimuth, inclination);
+		from_asimuth_inclination(azimuth, inclination, tier);
 	}
 
 };
@@ -278,7 +278,9 @@ GWSphereF GWModelResource::calc_skin_node_sphere_of_influence(uint32_t skinIdx,
 			}
 		}
 
-		sph.ritter(pPts, k);
+		if (k > 0) {
+			sph.ritter(pPts, k);
+		}
 		if (pMem == nullptr) { GWSys::free_temp_mem(pPts); }
 	}
 	return sph;
@@ -293,11 +295,8 @@ GWSphereF* GWModelResource::calc_skin_spheres_of_influence(GWSphereF* pMem) {
 		pSph = (pMem == nullptr) ? reinterpret_cast<GWSphereF*>(GWSys::alloc_rsrc_mem(sphMemSz)) : pMem;
 
 		for (uint32_t i = 0; i < mNumSkinNodes; ++i) {
-			if (is_skel_node_skin_deformer(i)) {
-				pSph[i] = calc_skin_node_sphere_of_influence(i, pPntMem);
-			} else {
-				pSph[i].set_zero();
-			}
+			// skin nodes that don't affect any point get a zero sphere
+			pSph[i] = calc_skin_node_sphere_of_influence(i, pPntMem);
 		}
 		GWSys::free_temp_mem(pPntMem);
 	}
@@ -314,6 +313,26 @@ GWModelResource* GWModelResource::load(const std::string& path) {
 	return pMdr;
 }
 
+bool GWModelResource::get_mtl_tri_pnt_indices(uint32_t mtlIdx, uint32_t triIdx, uint32_t idx[3]) {
+	Material* pMtl = get_mtl(mtlIdx);
+	if (pMtl == nullptr || triIdx >= pMtl->mIdx.mNumTri) { return false; }
+	if (pMtl->mIdx.is_idx16()) {
+		uint16_t* pIdx16 = reinterpret_cast<uint16_t*>(get_ptr(mOffsIdx16)) + pMtl->mIdx.mOrg;
+		for (int k = 0; k < 3; ++k) {
+			idx[k] = pIdx16[(triIdx * 3) + k];
+		}
+	} else {
+		uint32_t* pIdx32 = reinterpret_cast<uint32_t*>(get_ptr(mOffsIdx32)) + pMtl->mIdx.mOrg;
+		for (int k = 0; k < 3; ++k) {
+			idx[k] = pIdx32[(triIdx * 3) + k];
+		}
+	}
+	for (int k = 0; k < 3; ++k) {
+		idx[k] += pMtl->mIdx.mMin;
+	}
+	return true;
+}
+
 void GWModelResource::write_geo(std::ostream& os) {
 	using namespace std;
 
@@ -493,43 +512,45 @@ int GWCollisionResource::calc_num_tris() {
 	return ntris;
 }
 
-bool GWCollisionResource::get_poly_tri(GWVectorF vtx[3], int polIdx, int triIdx) {
+bool GWCollisionResource::get_poly_tri(GWVectorF vtx[3], int polIdx, int triIdx) const {
 	bool res = false;
-	GWVectorF* pPnts = get_pnts_top();
-	Poly* pPols = get_pols_top();
-	int32_t* pIdx = get_idx_top();
+	const GWVectorF* pPnts = get_pnts_top();
+	const Poly* pPols = get_pols_top();
+	const int32_t* pIdx = get_idx_top();
 	if (pPnts && pPols && pIdx && check_poly_idx(polIdx)) {
 		int pntIdx[3];
-		Poly* pPol = &pPols[polIdx];
+		const Poly* pPol = &pPols[polIdx];
 		int nvtx = pPol->mNumVtx;
 		int ntri = nvtx - 2;
 		if (triIdx >= 0 && triIdx < ntri) {
 			if (nvtx > 3) {
-				int32_t* pTris = get_tris_top();
-				if (pTris) {
-					for (int i = 0; i < 3; ++i) {
-						pntIdx[i] = pTris[pPol->mOffsTris + triIdx*3 + i];
-					}
-					for (int i = 0; i < 3; ++i) {
-						pntIdx[i] = pIdx[pPol->mOffsIdx + pntIdx[i]];
-					}
+				const int32_t* pTris = get_tris_top();
+				if (!pTris) { return false; }
+				for (int i = 0; i < 3; ++i) {
+					pntIdx[i] = pTris[pPol->mOffsTris + triIdx*3 + i];
+				}
+				for (int i = 0; i < 3; ++i) {
+					pntIdx[i] = pIdx[pPol->mOffsIdx + pntIdx[i]];
 				}
 			} else {
 				for (int i = 0; i < 3; ++i) {
 					pntIdx[i] = pIdx[pPol->mOffsIdx + i];
 				}
 			}
+			for (int i = 0; i < 3; ++i) {
+				vtx[i] = pPnts[pntIdx[i]];
+			}
 			res = true;
 		}
 	}
 	return res;
 }
 
-int GWCollisionResource::get_poly_num_tris(int polIdx) {
+int GWCollisionResource::get_poly_num_tris(int polIdx) const {
 	int nvtx = 0;
-	Poly* pPols = get_pols_top();
+	const Poly* pPols = get_pols_top();
 	if (pPols && check_poly_idx(polIdx)) {
-		nvtx = pPols->mNumVtx - 2;
+		nvtx = pPols[polIdx].mNumVtx - 2;
 	}
 	return nvtx;
 }
@@ -732,16 +753,93 @@ void GWCollisionResource::save_bvh_geo(const std::string& path) {
 	os.close();
 }
 
-GWCollisionResource* GWCollisionResource::load(const std::string& path) {
+GWCollisionResource* GWCollisionResource::load(const std::string& path, TriSoup** ppSoup) {
 	GWCollisionResource* pCls = nullptr;
 	GWResource* pRsrc = GWResource::load(path, GW_RSRC_ID("GWCls"));
 	if (pRsrc) {
 		pCls = reinterpret_cast<GWCollisionResource*>(pRsrc);
 		GWSys::dbg_msg("+ collision resource: %s\n", pCls->get_path());
 	}
+	if (ppSoup) {
+		*ppSoup = pCls ? TriSoup::create(*pCls) : nullptr;
+	}
 	return pCls;
 }
 
+GWCollisionResource::TriSoup* GWCollisionResource::TriSoup::create(const GWCollisionResource& cls, bool parallel) {
+	const Poly* pPols = cls.get_pols_top();
+	const GWVectorF* pPnts = cls.get_pnts_top();
+	const int32_t* pIdx = cls.get_idx_top();
+	const int32_t* pTris = cls.get_tris_top();
+	if (!pPols || !pPnts || !pIdx || cls.mNumPol <= 0) { return nullptr; }
+
+	int npol = cls.mNumPol;
+	int32_t* pTriOrg = reinterpret_cast<int32_t*>(GWSys::alloc_temp_mem((npol + 1) * sizeof(int32_t)));
+	pTriOrg[0] = 0;
+	for (int i = 0; i < npol; ++i) {
+		pTriOrg[i + 1] = pTriOrg[i] + std::max(pPols[i].mNumVtx - 2, 0);
+	}
+	int ntri = pTriOrg[npol];
+	int nslots = int(GWBase::align(std::max(ntri, 1), SOA_WIDTH));
+	size_t chSize = GWBase::align(nslots * sizeof(float), 0x20);
+	size_t memSz = sizeof(TriSoup) + 0x20 + chSize * NUM_CHANNELS + nslots * sizeof(int32_t) * 2;
+	uint8_t* pMem = reinterpret_cast<uint8_t*>(GWSys::alloc_rsrc_mem(memSz));
+	TriSoup* pSoup = reinterpret_cast<TriSoup*>(pMem);
+	pSoup->mpCls = &cls;
+	pSoup->mNumTri = ntri;
+	pSoup->mNumSlots = nslots;
+	uint8_t* pData = reinterpret_cast<uint8_t*>(GWBase::align(reinterpret_cast<uintptr_t>(pMem + sizeof(TriSoup)), 0x20));
+	for (int i = 0; i < NUM_CHANNELS; ++i) {
+		pSoup->mpChannels[i] = reinterpret_cast<float*>(pData);
+		std::fill_n(pSoup->mpChannels[i], nslots, 0.0f);
+		pData += chSize;
+	}
+	pSoup->mpPolIdx = reinterpret_cast<int32_t*>(pData);
+	pSoup->mpTriIdx = pSoup->mpPolIdx + nslots;
+	std::fill_n(pSoup->mpPolIdx, nslots, -1);
+	std::fill_n(pSoup->mpTriIdx, nslots, -1);
+
+	auto fill = [&](int i0, int i1) {
+		for (int i = i0; i < i1; ++i) {
+			const Poly& pol = pPols[i];
+			int polTris = pTriOrg[i + 1] - pTriOrg[i];
+			for (int j = 0; j < polTris; ++j) {
+				GWVectorF v[3];
+				for (int k = 0; k < 3; ++k) {
+					int vtx = pol.mNumVtx > 3 ? pTris[pol.mOffsTris + j * 3 + k] : k;
+					v[k] = pPnts[pIdx[pol.mOffsIdx + vtx]];
+				}
+				GWVectorF e1 = v[1] - v[0];
+				GWVectorF e2 = v[2] - v[0];
+				GWVectorF nrm = GWVector::cross(v[0] - v[1], v[2] - v[1]);
+				nrm.normalize();
+				int idx = pTriOrg[i] + j;
+				for (int k = 0; k < 3; ++k) {
+					pSoup->mpChannels[V0X + k][idx] = v[0][k];
+					pSoup->mpChannels[E1X + k][idx] = e1[k];
+					pSoup->mpChannels[E2X + k][idx] = e2[k];
+					pSoup->mpChannels[NX + k][idx] = nrm[k];
+				}
+				pSoup->mpPolIdx[idx] = i;
+				pSoup->mpTriIdx[idx] = j;
+			}
+		}
+	};
+	if (parallel) {
+		GWTask::parallel_for(npol, fill);
+	} else {
+		fill(0, npol);
+	}
+	GWSys::free_temp_mem(pTriOrg);
+	return pSoup;
+}
+
+void GWCollisionResource::TriSoup::destroy(TriSoup* pSoup) {
+	if (pSoup) {
+		GWSys::free_rsrc_mem(pSoup);
+	}
+}
+
 
 GWBundle* GWBundle::create(const std::string& name, const std::string& dataPath, GWRsrcRegistry* pRgy) {
 	GWBundle* pBdl = nullptr;
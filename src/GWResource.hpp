@@ -62,6 +62,13 @@ public:
 		return nullptr;
 	}
 
+	const void* get_ptr(uint32_t offs) const {
+		if (offs < mDataSize) {
+			return reinterpret_cast<const char*>(this) + offs;
+		}
+		return nullptr;
+	}
+
 	static GWResource* load(const std::string& path, const char* pSig);
 	static void unload(GWResource* pRsrc);
 
@@ -308,6 +315,8 @@ public:
 		return reinterpret_cast<char*>(get_ptr(offs));
 	}
 
+	bool get_mtl_tri_pnt_indices(uint32_t mtlIdx, uint32_t triIdx, uint32_t idx[3]);
+
 	GWTransformF get_skel_node_local_mtx(uint32_t idx) {
 		GWTransformF lm;
 		lm.set_identity();
@@ -423,33 +432,120 @@ public:
 		virtual void operator ()(GWCollisionResource& cls, GWVectorF vtx[3], GWVectorF nrm, int polIdx, int triIdx) {}
 	};
 
+	// All the triangles expanded into flat SoA channels with precomputed edges and normals,
+	// so that whole-mesh passes stream through memory instead of chasing the poly/index/tris indirections.
+	// Channels are 32-byte aligned and padded to a multiple of SOA_WIDTH with degenerate triangles (mPolIdx = -1).
+	class TriSoup {
+	private:
+		TriSoup() {}
+
+	public:
+		static const int SOA_WIDTH = 8;
+
+		enum Channel {
+			V0X, V0Y, V0Z,
+			E1X, E1Y, E1Z, // v1 - v0
+			E2X, E2Y, E2Z, // v2 - v0
+			NX, NY, NZ, // same as the normals passed by for_all_tris
+			NUM_CHANNELS
+		};
+
+		struct Tri {
+			GWVectorF mV0;
+			GWVectorF mE1;
+			GWVectorF mE2;
+			GWVectorF mNrm;
+			int32_t mPolIdx;
+			int32_t mTriIdx;
+
+			GWVectorF get_vtx(int i) const { return i == 0 ? mV0 : (i == 1 ? mV0 + mE1 : mV0 + mE2); }
+		};
+
+		const GWCollisionResource* mpCls;
+		float* mpChannels[NUM_CHANNELS];
+		int32_t* mpPolIdx;
+		int32_t* mpTriIdx;
+		int32_t mNumTri;
+		int32_t mNumSlots;
+
+		const float* get_channel(Channel ch) const { return mpChannels[ch]; }
+
+		void get_tri(int idx, Tri& tri) const {
+			for (int i = 0; i < 3; ++i) {
+				tri.mV0[i] = mpChannels[V0X + i][idx];
+				tri.mE1[i] = mpChannels[E1X + i][idx];
+				tri.mE2[i] = mpChannels[E2X + i][idx];
+				tri.mNrm[i] = mpChannels[NX + i][idx];
+			}
+			tri.mPolIdx = mpPolIdx[idx];
+			tri.mTriIdx = mpTriIdx[idx];
+		}
+
+		// FUNC_T(const Tri&), triangles in [begin, end), end < 0 stands for all
+		template<typename FUNC_T> void for_each_tri(const FUNC_T& func, int begin = 0, int end = -1) const {
+			if (end < 0 || end > mNumTri) { end = mNumTri; }
+			Tri tri;
+			for (int i = begin; i < end; ++i) {
+				get_tri(i, tri);
+				func(tri);
+			}
+		}
+
+		// the calls are spread over GWTask workers, FUNC_T has to be safe to run concurrently
+		template<typename FUNC_T> void parallel_for_each_tri(const FUNC_T& func, int grain = 0) const {
+			GWTask::parallel_for(mNumTri, [&](int begin, int end) { for_each_tri(func, begin, end); }, grain);
+		}
+
+		static TriSoup* create(const GWCollisionResource& cls, bool parallel = true);
+		static void destroy(TriSoup* pSoup);
+	};
+
 	const char* get_path() const { return get_str(mPathOffs); }
 
 	GWVectorF* get_pnts_top() {
 		return reinterpret_cast<GWVectorF*>(get_ptr(mOffsPnts));
 	}
+	const GWVectorF* get_pnts_top() const {
+		return reinterpret_cast<const GWVectorF*>(get_ptr(mOffsPnts));
+	}
 
 	Poly* get_pols_top() {
 		return reinterpret_cast<Poly*>(get_ptr(mOffsPols));
 	}
+	const Poly* get_pols_top() const {
+		return reinterpret_cast<const Poly*>(get_ptr(mOffsPols));
+	}
 
 	int32_t* get_idx_top() {
 		return reinterpret_cast<int32_t*>(get_ptr(mOffsIdx));
 	}
+	const int32_t* get_idx_top() const {
+		return reinterpret_cast<const int32_t*>(get_ptr(mOffsIdx));
+	}
 
 	int32_t* get_tris_top() {
 		return reinterpret_cast<int32_t*>(get_ptr(mOffsTris));
 	}
+	const int32_t* get_tris_top() const {
+		return reinterpret_cast<const int32_t*>(get_ptr(mOffsTris));
+	}
 
 	BVHNode* get_bvh_top() {
 		return reinterpret_cast<BVHNode*>(get_ptr(mOffsBVH));
 	}
+	const BVHNode* get_bvh_top() const {
+		return reinterpret_cast<const BVHNode*>(get_ptr(mOffsBVH));
+	}
+
+	// offset 0 would resolve to the resource header itself
+	bool has_bvh() const { return mOffsBVH > 0 && mNumPol > 0; }
+	int get_num_bvh_nodes() const { return has_bvh() ? mNumPol * 2 - 1 : 0; }
 
 	int calc_num_tris();
 
 	bool check_poly_idx(int polIdx) const { return polIdx >= 0 && polIdx < mNumPol; }
-	bool get_poly_tri(GWVectorF vtx[3], int polIdx, int triIdx);
-	int get_poly_num_tris(int polIdx);
+	bool get_poly_tri(GWVectorF vtx[3], int polIdx, int triIdx) const;
+	int get_poly_num_tris(int polIdx) const;
 	int for_all_tris(TriFunc& func, bool withNormals = true);
 
 	void write_geo(std::ostream& os);
@@ -461,7 +557,8 @@ public:
 	void write_bvh_geo(std::ostream& os);
 	void save_bvh_geo(const std::string& path);
 
-	static GWCollisionResource* load(const std::string& path);
+	// with ppSoup set the triangles are also expanded into a TriSoup, to be destroyed before unloading
+	static GWCollisionResource* load(const std::string& path, TriSoup** ppSoup = nullptr);
 };
 
 class GWCatalog : public GWResource {
@@ -0,0 +1,452 @@
+/*
+ * Author: Gleb Novodran <novodran@gmail.com>
+ */
+
+#include <cfloat>
+#include <vector>
+#include <algorithm>
+#include "groundwork.hpp"
+
+namespace GWSDF {
+
+	// unbounded closest point search, kept finite for the squared distances
+	static const float FAR_DIST = 1.0e18f;
+
+	template<typename FUNC_T> static void exec_range(int count, bool parallel, const FUNC_T& func) {
+		if (parallel) {
+			GWTask::parallel_for(count, func);
+		} else {
+			func(0, count);
+		}
+	}
+
+	static float calc_qscl(BrickKind kind) {
+		return kind == BrickKind::Q8 ? 127.0f : 32767.0f;
+	}
+
+	template<typename T> static void fill_brick(T* pBrick, const float* pDist, float band, float qscl) {
+		for (int i = 0; i < Field::BRICK_SAMPLES; ++i) {
+			float v = GWBase::clamp(pDist[i] / band, -1.0f, 1.0f);
+			pBrick[i] = T(std::round(v * qscl));
+		}
+	}
+
+	template<typename T> static void fetch_corners(const T* pBrick, const int* pCell, float scl, float v[8]) {
+		const T* pSmp = pBrick + (pCell[2] * Field::BRICK_SIZE + pCell[1]) * Field::BRICK_SIZE + pCell[0];
+		for (int k = 0; k < 8; ++k) {
+			int offs = ((k >> 2) * Field::BRICK_SIZE + ((k >> 1) & 1)) * Field::BRICK_SIZE + (k & 1);
+			v[k] = float(pSmp[offs]) * scl;
+		}
+	}
+
+	// Samples marked in pFar are farther than the band from the surface, they get the sign of their neighbours:
+	// the distance changes by at most a cell between neighbours, so it can't cross zero next to such a sample.
+	// Samples with no known neighbour at all lie in a part of the brick the surface doesn't reach, which
+	// has the side of the brick center.
+	static void fill_far_signs(float* pSmp, uint8_t* pFar, int nfar, float centerVal) {
+		const int n = Field::BRICK_SIZE;
+		const int step[3] = { 1, n, n * n };
+		while (nfar > 0) {
+			int nfilled = 0;
+			for (int z = 0; z < n; ++z) {
+				for (int y = 0; y < n; ++y) {
+					for (int x = 0; x < n; ++x) {
+						int s = (z * n + y) * n + x;
+						if (!pFar[s]) { continue; }
+						const int crd[3] = { x, y, z };
+						for (int i = 0; i < 6; ++i) {
+							int axis = i >> 1;
+							bool up = (i & 1) != 0;
+							if (up ? crd[axis] == n - 1 : crd[axis] == 0) { continue; }
+							int nb = up ? s + step[axis] : s - step[axis];
+							if (!pFar[nb] && pSmp[nb] != 0.0f) {
+								pSmp[s] = pSmp[nb] < 0.0f ? -FAR_DIST : FAR_DIST;
+								pFar[s] = 0;
+								++nfilled;
+								break;
+							}
+						}
+					}
+				}
+			}
+			if (nfilled == 0) { break; }
+			nfar -= nfilled;
+		}
+		for (int i = 0; nfar > 0 && i < Field::BRICK_SAMPLES; ++i) {
+			if (pFar[i]) {
+				pSmp[i] = centerVal < 0.0f ? -FAR_DIST : FAR_DIST;
+			}
+		}
+	}
+
+	template<typename DIST_FUNC> Field* Field::bake(const GWVectorF& bbMin, const GWVectorF& bbMax, const BakeParams& params, const DIST_FUNC& dist) {
+		float cellSize = params.mCellSize > 0.0f ? params.mCellSize : BakeParams().mCellSize;
+		float brickExt = cellSize * BRICK_CELLS;
+		// the band is kept wider than two cells for fill_far_signs()
+		float band = std::max(params.mBand > 0.0f ? params.mBand : brickExt * 2.0f, cellSize * 2.5f);
+		bool parallel = params.mParallel;
+		GWVectorF org = bbMin - GWVectorF(band);
+		GWVectorF ext = bbMax + GWVectorF(band) - org;
+		int32_t nb[3];
+		for (int i = 0; i < 3; ++i) {
+			nb[i] = std::max(int32_t(std::ceil(ext[i] / brickExt)), 1);
+		}
+		int nbricks = nb[0] * nb[1] * nb[2];
+		float halfDiag = 0.5f * brickExt * GWBase::tsqrt(3.0f);
+
+		// a brick whose center is farther than band + half diagonal from the surface doesn't reach the band
+		int32_t* pIdx = reinterpret_cast<int32_t*>(GWSys::alloc_temp_mem(nbricks * sizeof(int32_t)));
+		float* pVal = reinterpret_cast<float*>(GWSys::alloc_temp_mem(nbricks * sizeof(float)));
+		exec_range(nbricks, parallel, [&](int i0, int i1) {
+			for (int i = i0; i < i1; ++i) {
+				int bx = i % nb[0];
+				int by = (i / nb[0]) % nb[1];
+				int bz = i / (nb[0] * nb[1]);
+				GWVectorF ctr = org + GWVectorF(float(bx) + 0.5f, float(by) + 0.5f, float(bz) + 0.5f) * brickExt;
+				float d = FAR_DIST;
+				dist(ctr, FAR_DIST, &d);
+				float bound = std::fabs(d) - halfDiag;
+				if (bound >= band) {
+					pIdx[i] = EMPTY;
+					pVal[i] = d < 0.0f ? -bound : bound;
+				} else {
+					pIdx[i] = 0;
+					pVal[i] = d;
+				}
+			}
+		});
+		int32_t ndense = 0;
+		for (int i = 0; i < nbricks; ++i) {
+			if (pIdx[i] != EMPTY) {
+				pIdx[i] = ndense++;
+			}
+		}
+
+		size_t brickSize = BRICK_SAMPLES * (params.mKind == BrickKind::Q8 ? sizeof(int8_t) : sizeof(int16_t));
+		size_t memSize = sizeof(Field) + nbricks * (sizeof(int32_t) + sizeof(float)) + BRICK_ALIGN + ndense * brickSize;
+		char* pMem = reinterpret_cast<char*>(GWSys::alloc_rsrc_mem(memSize));
+		Field* pField = reinterpret_cast<Field*>(pMem);
+		pField->mOrg = org;
+		pField->mCellSize = cellSize;
+		pField->mInvCellSize = 1.0f / cellSize;
+		pField->mBand = band;
+		for (int i = 0; i < 3; ++i) {
+			pField->mNumBricks[i] = nb[i];
+		}
+		pField->mNumDense = ndense;
+		pField->mKind = params.mKind;
+		pField->mpBrickIdx = reinterpret_cast<int32_t*>(pMem + sizeof(Field));
+		pField->mpBrickVal = reinterpret_cast<float*>(pField->mpBrickIdx + nbricks);
+		pField->mpBricks = reinterpret_cast<void*>(GWBase::align(reinterpret_cast<uintptr_t>(pField->mpBrickVal + nbricks), int(BRICK_ALIGN)));
+		std::copy(pIdx, pIdx + nbricks, pField->mpBrickIdx);
+		std::copy(pVal, pVal + nbricks, pField->mpBrickVal);
+
+		float qscl = calc_qscl(params.mKind);
+		exec_range(nbricks, parallel, [&](int i0, int i1) {
+			float smp[BRICK_SAMPLES];
+			uint8_t isFar[BRICK_SAMPLES];
+			for (int i = i0; i < i1; ++i) {
+				int32_t idx = pIdx[i];
+				if (idx == EMPTY) { continue; }
+				int bx = i % nb[0];
+				int by = (i / nb[0]) % nb[1];
+				int bz = i / (nb[0] * nb[1]);
+				GWVectorF brickOrg = org + GWVectorF(float(bx), float(by), float(bz)) * brickExt;
+				int nfar = 0;
+				for (int z = 0; z < BRICK_SIZE; ++z) {
+					for (int y = 0; y < BRICK_SIZE; ++y) {
+						for (int x = 0; x < BRICK_SIZE; ++x) {
+							int s = (z * BRICK_SIZE + y) * BRICK_SIZE + x;
+							isFar[s] = dist(brickOrg + GWVectorF(float(x), float(y), float(z)) * cellSize, band, &smp[s]) ? 0 : 1;
+							nfar += isFar[s];
+						}
+					}
+				}
+				if (nfar > 0) {
+					fill_far_signs(smp, isFar, nfar, pVal[i]);
+				}
+				char* pBrick = reinterpret_cast<char*>(pField->mpBricks) + idx * brickSize;
+				if (params.mKind == BrickKind::Q8) {
+					fill_brick(reinterpret_cast<int8_t*>(pBrick), smp, band, qscl);
+				} else {
+					fill_brick(reinterpret_cast<int16_t*>(pBrick), smp, band, qscl);
+				}
+			}
+		});
+		GWSys::free_temp_mem(pVal);
+		GWSys::free_temp_mem(pIdx);
+		return pField;
+	}
+
+	float Field::sample(const GWVectorF& pos, GWVectorF* pGrad) const {
+		GWVectorF g = (pos - mOrg) * mInvCellSize;
+		int brick[3];
+		int cell[3];
+		float frac[3];
+		float outDistSq = 0.0f;
+		for (int i = 0; i < 3; ++i) {
+			int ncells = mNumBricks[i] * BRICK_CELLS;
+			float gi = GWBase::clamp(g[i], 0.0f, float(ncells));
+			float outside = (g[i] - gi) * mCellSize;
+			outDistSq += outside * outside;
+			int ci = std::min(int(gi), ncells - 1);
+			brick[i] = ci / BRICK_CELLS;
+			cell[i] = ci - brick[i] * BRICK_CELLS;
+			frac[i] = gi - float(ci);
+		}
+		int brickIdx = (brick[2] * mNumBricks[1] + brick[1]) * mNumBricks[0] + brick[0];
+		int32_t idx = mpBrickIdx[brickIdx];
+		float d;
+		if (idx == EMPTY) {
+			d = mpBrickVal[brickIdx];
+			if (pGrad) {
+				pGrad->fill(0.0f);
+			}
+		} else {
+			float v[8];
+			float scl = mBand / calc_qscl(mKind);
+			const char* pBrick = reinterpret_cast<const char*>(mpBricks) + idx * get_brick_size();
+			if (mKind == BrickKind::Q8) {
+				fetch_corners(reinterpret_cast<const int8_t*>(pBrick), cell, scl, v);
+			} else {
+				fetch_corners(reinterpret_cast<const int16_t*>(pBrick), cell, scl, v);
+			}
+			float fx = frac[0];
+			float fy = frac[1];
+			float fz = frac[2];
+			float x00 = GWBase::lerp(v[0], v[1], fx);
+			float x10 = GWBase::lerp(v[2], v[3], fx);
+			float x01 = GWBase::lerp(v[4], v[5], fx);
+			float x11 = GWBase::lerp(v[6], v[7], fx);
+			float y0 = GWBase::lerp(x00, x10, fy);
+			float y1 = GWBase::lerp(x01, x11, fy);
+			d = GWBase::lerp(y0, y1, fz);
+			if (pGrad) {
+				float dx = GWBase::lerp(GWBase::lerp(v[1] - v[0], v[3] - v[2], fy), GWBase::lerp(v[5] - v[4], v[7] - v[6], fy), fz);
+				float dy = GWBase::lerp(x10 - x00, x11 - x01, fz);
+				float dz = y1 - y0;
+				GWTuple::set(*pGrad, dx, dy, dz);
+				*pGrad *= mInvCellSize;
+			}
+		}
+		if (outDistSq > 0.0f && d >= 0.0f) {
+			d += GWBase::tsqrt(outDistSq);
+		}
+		return d;
+	}
+
+	void Field::sample(const GWVectorF* pPos, float* pDist, GWVectorF* pGrads, int num, bool parallel) const {
+		if (pPos == nullptr || pDist == nullptr || num <= 0) { return; }
+		exec_range(num, parallel, [&](int i0, int i1) {
+			for (int i = i0; i < i1; ++i) {
+				pDist[i] = sample(pPos[i], pGrads ? &pGrads[i] : nullptr);
+			}
+		});
+	}
+
+	float Field::push_out(GWVectorF& pos, float radius) const {
+		GWVectorF grad;
+		float d = sample(pos, &grad);
+		if (d >= radius) { return 0.0f; }
+		float len = grad.length();
+		if (len > 1.0e-6f) {
+			pos += grad * ((radius - d) / len);
+		}
+		return radius - d;
+	}
+
+	// Angle-weighted pseudonormals of the triangles, their edges and points. The side of a position is the sign of
+	// its offset from the closest point dotted with the pseudonormal of the feature that point lies on, which
+	// holds at sharp and concave edges and vertices too. Features are shared by the point indices.
+	struct SignNormals {
+		struct EdgeKey {
+			uint64_t mPnts;
+			int32_t mSlot;
+		};
+
+		const GWVectorF* mpPnts;
+		int32_t* mpFirstTri; // per polygon of a collision resource, nullptr for models
+		uint32_t* mpTriPnts; // 3 per triangle
+		GWVectorF* mpTriNrm;
+		GWVectorF* mpEdgeNrm; // 3 per triangle, edge k goes from point k to point k + 1
+		GWVectorF* mpPntNrm;
+		int32_t mNumTri;
+		int32_t mNumPnt;
+
+		void alloc(int npol, int ntri) {
+			mpFirstTri = npol > 0 ? reinterpret_cast<int32_t*>(GWSys::alloc_temp_mem(npol * sizeof(int32_t))) : nullptr;
+			mpTriPnts = reinterpret_cast<uint32_t*>(GWSys::alloc_temp_mem(ntri * 3 * sizeof(uint32_t)));
+			mpTriNrm = reinterpret_cast<GWVectorF*>(GWSys::alloc_temp_mem(ntri * sizeof(GWVectorF)));
+			mpEdgeNrm = reinterpret_cast<GWVectorF*>(GWSys::alloc_temp_mem(ntri * 3 * sizeof(GWVectorF)));
+			mpPntNrm = nullptr;
+			mNumTri = ntri;
+			mNumPnt = 0;
+		}
+
+		void init(const GWCollisionResource& cls) {
+			const GWCollisionResource::Poly* pPols = cls.get_pols_top();
+			int ntri = 0;
+			for (int i = 0; i < cls.mNumPol; ++i) {
+				ntri += pPols[i].mNumVtx - 2;
+			}
+			alloc(cls.mNumPol, ntri);
+			mpPnts = cls.get_pnts_top();
+			ntri = 0;
+			for (int i = 0; i < cls.mNumPol; ++i) {
+				const int32_t* pIdx = cls.get_idx_top() + pPols[i].mOffsIdx;
+				const int32_t* pTris = pPols[i].mNumVtx > 3 ? cls.get_tris_top() + pPols[i].mOffsTris : nullptr;
+				mpFirstTri[i] = ntri;
+				for (int j = 0; j < pPols[i].mNumVtx - 2; ++j) {
+					for (int k = 0; k < 3; ++k) {
+						mpTriPnts[ntri * 3 + k] = uint32_t(pIdx[pTris ? pTris[j * 3 + k] : k]);
+					}
+					++ntri;
+				}
+			}
+			calc_nrms();
+		}
+
+		void init(const GWBVH::ModelBVH& mbvh) {
+			alloc(0, mbvh.mNumTri);
+			mpPnts = mbvh.mpPnts;
+			std::copy(mbvh.mpTriPnts, mbvh.mpTriPnts + mbvh.mNumTri * 3, mpTriPnts);
+			calc_nrms();
+		}
+
+		void reset() {
+			GWSys::free_temp_mem(mpPntNrm);
+			GWSys::free_temp_mem(mpEdgeNrm);
+			GWSys::free_temp_mem(mpTriNrm);
+			GWSys::free_temp_mem(mpTriPnts);
+			if (mpFirstTri) {
+				GWSys::free_temp_mem(mpFirstTri);
+			}
+		}
+
+		void calc_nrms() {
+			uint32_t npnt = 0;
+			for (int i = 0; i < mNumTri * 3; ++i) {
+				npnt = std::max(npnt, mpTriPnts[i] + 1);
+			}
+			mNumPnt = int32_t(npnt);
+			mpPntNrm = reinterpret_cast<GWVectorF*>(GWSys::alloc_temp_mem(npnt * sizeof(GWVectorF)));
+			std::fill_n(mpPntNrm, npnt, GWVectorF(0.0f));
+			EdgeKey* pEdges = reinterpret_cast<EdgeKey*>(GWSys::alloc_temp_mem(mNumTri * 3 * sizeof(EdgeKey)));
+			for (int i = 0; i < mNumTri; ++i) {
+				const uint32_t* pIdx = &mpTriPnts[i * 3];
+				const GWVectorF* pV[3] = { &mpPnts[pIdx[0]], &mpPnts[pIdx[1]], &mpPnts[pIdx[2]] };
+				// clockwise winding, as in GWCollision::closest_pnt()
+				GWVectorF nrm = GWVector::cross(*pV[2] - *pV[0], *pV[1] - *pV[0]);
+				float nlen = nrm.length();
+				nrm = nlen > 0.0f ? nrm * (1.0f / nlen) : GWVectorF(0.0f);
+				mpTriNrm[i] = nrm;
+				for (int k = 0; k < 3; ++k) {
+					GWVectorF e0 = *pV[(k + 1) % 3] - *pV[k];
+					GWVectorF e1 = *pV[(k + 2) % 3] - *pV[k];
+					float len = e0.length() * e1.length();
+					if (len > 0.0f) {
+						float ang = std::acos(GWBase::clamp(e0.dot(e1) / len, -1.0f, 1.0f));
+						mpPntNrm[pIdx[k]] += nrm * ang;
+					}
+					uint64_t p0 = std::min(pIdx[k], pIdx[(k + 1) % 3]);
+					uint64_t p1 = std::max(pIdx[k], pIdx[(k + 1) % 3]);
+					pEdges[i * 3 + k].mPnts = (p0 << 32) | p1;
+					pEdges[i * 3 + k].mSlot = i * 3 + k;
+				}
+			}
+			// the triangles sharing an edge are next to each other once sorted
+			std::sort(pEdges, pEdges + mNumTri * 3, [](const EdgeKey& a, const EdgeKey& b) {
+				return a.mPnts != b.mPnts ? a.mPnts < b.mPnts : a.mSlot < b.mSlot;
+			});
+			for (int i = 0; i < mNumTri * 3;) {
+				int end = i + 1;
+				while (end < mNumTri * 3 && pEdges[end].mPnts == pEdges[i].mPnts) { ++end; }
+				GWVectorF nrm(0.0f);
+				for (int j = i; j < end; ++j) {
+					nrm += mpTriNrm[pEdges[j].mSlot / 3];
+				}
+				for (int j = i; j < end; ++j) {
+					mpEdgeNrm[pEdges[j].mSlot] = nrm;
+				}
+				i = end;
+			}
+			GWSys::free_temp_mem(pEdges);
+		}
+
+		int get_tri(const GWCollision::HitInfo& hit) const {
+			return mpFirstTri ? mpFirstTri[hit.mPolIdx] + hit.mTriIdx : hit.mPolIdx;
+		}
+
+		// the feature is told by the barycentric coordinates of pos, a point of the triangle
+		GWVectorF get_nrm(int tri, const GWVectorF& pos) const {
+			const uint32_t* pIdx = &mpTriPnts[tri * 3];
+			GWVectorF a = mpPnts[pIdx[0]];
+			GWVectorF e1 = mpPnts[pIdx[1]] - a;
+			GWVectorF e2 = mpPnts[pIdx[2]] - a;
+			GWVectorF ep = pos - a;
+			float d11 = e1.dot(e1);
+			float d12 = e1.dot(e2);
+			float d22 = e2.dot(e2);
+			float dp1 = ep.dot(e1);
+			float dp2 = ep.dot(e2);
+			float det = d11 * d22 - d12 * d12;
+			if (det <= 0.0f) { return mpTriNrm[tri]; }
+			float bc[3];
+			bc[1] = (d22 * dp1 - d12 * dp2) / det;
+			bc[2] = (d11 * dp2 - d12 * dp1) / det;
+			bc[0] = 1.0f - bc[1] - bc[2];
+			const float eps = 1.0e-4f;
+			int nzero = 0;
+			int zero = 0;
+			int nonzero = 0;
+			for (int k = 0; k < 3; ++k) {
+				if (bc[k] < eps) {
+					++nzero;
+					zero = k;
+				} else {
+					nonzero = k;
+				}
+			}
+			if (nzero >= 2) { return mpPntNrm[pIdx[nonzero]]; }
+			// the edge opposite to the zero coordinate
+			if (nzero == 1) { return mpEdgeNrm[tri * 3 + (zero + 1) % 3]; }
+			return mpTriNrm[tri];
+		}
+	};
+
+	template<typename GEOM_T> static bool calc_dist(const GEOM_T& geom, const SignNormals& sn, const GWVectorF& pos, float maxDist, float* pDist) {
+		GWCollision::HitInfo hit;
+		if (!GWCollision::closest_pnt(geom, pos, maxDist, &hit)) { return false; }
+		GWVectorF nrm = sn.get_nrm(sn.get_tri(hit), hit.mPos);
+		*pDist = (pos - hit.mPos).dot(nrm) < 0.0f ? -hit.mT : hit.mT;
+		return true;
+	}
+
+	Field* Field::bake(const GWCollisionResource& cls, const BakeParams& params) {
+		if (cls.mNumPol <= 0) { return nullptr; }
+		SignNormals sn;
+		sn.init(cls);
+		Field* pField = bake(cls.mBBoxMin, cls.mBBoxMax, params, [&cls, &sn](const GWVectorF& pos, float maxDist, float* pDist) {
+			return calc_dist(cls, sn, pos, maxDist, pDist);
+		});
+		sn.reset();
+		return pField;
+	}
+
+	Field* Field::bake(const GWBVH::ModelBVH& mbvh, const BakeParams& params) {
+		if (mbvh.mpNodes == nullptr || mbvh.mNumTri <= 0) { return nullptr; }
+		SignNormals sn;
+		sn.init(mbvh);
+		Field* pField = bake(mbvh.mpNodes[0].mBBoxMin, mbvh.mpNodes[0].mBBoxMax, params, [&mbvh, &sn](const GWVectorF& pos, float maxDist, float* pDist) {
+			return calc_dist(mbvh, sn, pos, maxDist, pDist);
+		});
+		sn.reset();
+		return pField;
+	}
+
+	void Field::destroy(Field* pField) {
+		if (pField) {
+			GWSys::free_rsrc_mem(pField);
+		}
+	}
+}
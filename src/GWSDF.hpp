@@ -0,0 +1,73 @@
+/*
+ * Author: Gleb Novodran <novodran@gmail.com>
+ */
+
+// Signed distance fields baked from collision or model geometry.
+namespace GWSDF {
+
+	enum class BrickKind : uint8_t {
+		Q8 = 0,
+		Q16 = 1
+	};
+
+	// Sparse field on a regular grid of samples split into bricks of BRICK_SIZE^3 samples, neighbouring bricks
+	// share their border samples. Only the bricks within the band around the surface keep their samples,
+	// quantized over [-band, band]; the others hold a single value, which is a lower bound of the distance
+	// anywhere in the brick. Distances are positive on the front side of the geometry.
+	class Field {
+	public:
+		static const int BRICK_SIZE = 8;
+		static const int BRICK_CELLS = BRICK_SIZE - 1;
+		static const int BRICK_SAMPLES = BRICK_SIZE * BRICK_SIZE * BRICK_SIZE;
+		static const int32_t EMPTY = -1;
+		static const size_t BRICK_ALIGN = 0x40;
+
+		struct BakeParams {
+			float mCellSize;
+			float mBand; // <= 0 : 2 bricks
+			BrickKind mKind;
+			bool mParallel;
+
+			BakeParams() : mCellSize(0.25f), mBand(0.0f), mKind(BrickKind::Q16), mParallel(true) {}
+		};
+
+		GWVectorF mOrg; // position of the first sample
+		float mCellSize;
+		float mInvCellSize;
+		float mBand;
+		int32_t mNumBricks[3];
+		int32_t mNumDense;
+		BrickKind mKind;
+		int32_t* mpBrickIdx; // dense brick index or EMPTY, x fastest
+		float* mpBrickVal; // value of the empty bricks
+		void* mpBricks; // samples of the dense bricks, x fastest
+
+	private:
+		Field() {}
+
+		template<typename DIST_FUNC> static Field* bake(const GWVectorF& bbMin, const GWVectorF& bbMax, const BakeParams& params, const DIST_FUNC& dist);
+
+	public:
+		int get_num_bricks() const { return mNumBricks[0] * mNumBricks[1] * mNumBricks[2]; }
+		size_t get_brick_size() const { return BRICK_SAMPLES * (mKind == BrickKind::Q8 ? sizeof(uint8_t) : sizeof(uint16_t)); }
+		GWVectorF get_min() const { return mOrg; }
+		GWVectorF get_max() const {
+			float ext = mCellSize * BRICK_CELLS;
+			return mOrg + GWVectorF(ext * mNumBricks[0], ext * mNumBricks[1], ext * mNumBricks[2]);
+		}
+
+		// Trilinear lookup, the gradient is that of the interpolated field and is zero in the empty bricks.
+		// Outside the grid the value at the nearest grid point is returned, increased by the distance to it if positive.
+		float sample(const GWVectorF& pos, GWVectorF* pGrad = nullptr) const;
+		void sample(const GWVectorF* pPos, float* pDist, GWVectorF* pGrads, int num, bool parallel = true) const;
+
+		// Moves a sphere at pos out of the geometry along the field gradient,
+		// returns the penetration depth before the move or 0 if there was no contact.
+		float push_out(GWVectorF& pos, float radius) const;
+
+		static Field* bake(const GWCollisionResource& cls, const BakeParams& params = BakeParams());
+		// Model triangles as of the last refit.
+		static Field* bake(const GWBVH::ModelBVH& mbvh, const BakeParams& params = BakeParams());
+		static void destroy(Field* pField);
+	};
+}
@@ -0,0 +1,80 @@
+/*
+ * Author: Gleb Novodran <novodran@gmail.com>
+ */
+
+#include <cstring>
+#include "groundwork.hpp"
+
+template<int N> void GWSoA<N>::fill_tail() {
+	if (mNum <= 0) { return; }
+	int last = mNum - 1;
+	int blk = last / BLOCK_SIZE;
+	for (int i = 0; i < N; ++i) {
+		float* pComp = get_component(blk, i);
+		std::fill(&pComp[last % BLOCK_SIZE + 1], &pComp[BLOCK_SIZE], pComp[last % BLOCK_SIZE]);
+	}
+}
+
+template<int N> void GWSoA<N>::calc_bbox(float* pMin, float* pMax) const {
+	if (mNum <= 0) { return; }
+	GWLane::Tuple<N> vmin;
+	GWLane::Tuple<N> vmax;
+	load(0, vmin);
+	vmax = vmin;
+	int ngrp = get_num_groups();
+	for (int i = 1; i < ngrp; ++i) {
+		GWLane::Tuple<N> v;
+		load(i, v);
+		GWLane::min(vmin, vmin, v);
+		GWLane::max(vmax, vmax, v);
+	}
+	for (int i = 0; i < N; ++i) {
+		float lmin[GWLane::WIDTH];
+		float lmax[GWLane::WIDTH];
+		GWLane::store(lmin, vmin.elems[i]);
+		GWLane::store(lmax, vmax.elems[i]);
+		pMin[i] = *std::min_element(lmin, lmin + GWLane::WIDTH);
+		pMax[i] = *std::max_element(lmax, lmax + GWLane::WIDTH);
+	}
+}
+
+template<int N> void GWSoA<N>::lerp(GWSoA& dst, const GWSoA& a, const GWSoA& b, float t) {
+	int ngrp = dst.get_num_groups();
+	GWLane::F vt(t);
+	for (int i = 0; i < ngrp; ++i) {
+		GWLane::Tuple<N> va;
+		GWLane::Tuple<N> vb;
+		a.load(i, va);
+		b.load(i, vb);
+		GWLane::lerp(va, va, vb, vt);
+		dst.store(i, va);
+	}
+}
+
+template<int N> GWSoA<N>* GWSoA<N>::create(int num) {
+	if (num < 0) { return nullptr; }
+	int nblk = (num + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	size_t dataSz = size_t(nblk) * N * BLOCK_SIZE * sizeof(float);
+	size_t memSz = sizeof(GWSoA) + 0x20 + dataSz;
+	uint8_t* pMem = reinterpret_cast<uint8_t*>(GWSys::alloc_rsrc_mem(memSz));
+	GWSoA* pSoA = reinterpret_cast<GWSoA*>(pMem);
+	pSoA->mNum = num;
+	pSoA->mNumBlocks = nblk;
+	pSoA->mpData = reinterpret_cast<float*>(GWBase::align(reinterpret_cast<uintptr_t>(pMem + sizeof(GWSoA)), 0x20));
+	std::memset(pSoA->mpData, 0, dataSz);
+	return pSoA;
+}
+
+template<int N> void GWSoA<N>::destroy(GWSoA* pSoA) {
+	if (pSoA) {
+		GWSys::free_rsrc_mem(pSoA);
+	}
+}
+
+// the constants are bound to references by std::min and the like
+template<int N> const int GWSoA<N>::NUM_COMPONENTS;
+template<int N> const int GWSoA<N>::BLOCK_SIZE;
+template<int N> const int GWSoA<N>::GROUPS_PER_BLOCK;
+
+template class GWSoA<3>;
+template class GWSoA<4>;
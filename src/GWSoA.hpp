@@ -0,0 +1,146 @@
+/*
+ * Author: Gleb Novodran <novodran@gmail.com>
+ */
+
+namespace GWLane {
+	// N-component items a GWLane at a time, the SIMD counterpart of the GWTuple functions.
+	template<int N> struct Tuple {
+		F elems[N];
+
+		F& operator [](int i) { return elems[i]; }
+		const F& operator [](int i) const { return elems[i]; }
+	};
+
+	typedef Tuple<3> V3;
+	typedef Tuple<4> V4;
+
+	template<int N> GW_FORCEINLINE void fill(Tuple<N>& dst, F s) {
+		for (int i = 0; i < N; ++i) { dst.elems[i] = s; }
+	}
+
+	template<int N> GW_FORCEINLINE void add(Tuple<N>& dst, const Tuple<N>& a, const Tuple<N>& b) {
+		for (int i = 0; i < N; ++i) { dst.elems[i] = a.elems[i] + b.elems[i]; }
+	}
+
+	template<int N> GW_FORCEINLINE void sub(Tuple<N>& dst, const Tuple<N>& a, const Tuple<N>& b) {
+		for (int i = 0; i < N; ++i) { dst.elems[i] = a.elems[i] - b.elems[i]; }
+	}
+
+	template<int N> GW_FORCEINLINE void scl(Tuple<N>& dst, const Tuple<N>& a, F s) {
+		for (int i = 0; i < N; ++i) { dst.elems[i] = a.elems[i] * s; }
+	}
+
+	template<int N> GW_FORCEINLINE void min(Tuple<N>& dst, const Tuple<N>& a, const Tuple<N>& b) {
+		for (int i = 0; i < N; ++i) { dst.elems[i] = min(a.elems[i], b.elems[i]); }
+	}
+
+	template<int N> GW_FORCEINLINE void max(Tuple<N>& dst, const Tuple<N>& a, const Tuple<N>& b) {
+		for (int i = 0; i < N; ++i) { dst.elems[i] = max(a.elems[i], b.elems[i]); }
+	}
+
+	template<int N> GW_FORCEINLINE void lerp(Tuple<N>& dst, const Tuple<N>& a, const Tuple<N>& b, F t) {
+		for (int i = 0; i < N; ++i) { dst.elems[i] = a.elems[i] + (b.elems[i] - a.elems[i]) * t; }
+	}
+
+	template<int N> GW_FORCEINLINE F dot(const Tuple<N>& a, const Tuple<N>& b) {
+		F res = a.elems[0] * b.elems[0];
+		for (int i = 1; i < N; ++i) { res = res + a.elems[i] * b.elems[i]; }
+		return res;
+	}
+
+	GW_FORCEINLINE void cross(V3& dst, const V3& a, const V3& b) {
+		F x = a.elems[1] * b.elems[2] - a.elems[2] * b.elems[1];
+		F y = a.elems[2] * b.elems[0] - a.elems[0] * b.elems[2];
+		F z = a.elems[0] * b.elems[1] - a.elems[1] * b.elems[0];
+		dst.elems[0] = x;
+		dst.elems[1] = y;
+		dst.elems[2] = z;
+	}
+}
+
+// Items of N floats (x, y, z of GWVectorF, r, g, b, a of GWColorF) stored as an array of structures of arrays:
+// blocks of BLOCK_SIZE items, each holding the components one after another. A GWLane of one component is a
+// single aligned load for any GWLane::WIDTH, and the layout is the same in every build.
+// The tail of the last block repeats the last item, so the bulk operations run on whole blocks.
+template<int N> class GWSoA {
+public:
+	static const int NUM_COMPONENTS = N;
+	static const int BLOCK_SIZE = 8;
+	static const int GROUPS_PER_BLOCK = BLOCK_SIZE / GWLane::WIDTH;
+
+	int32_t mNum;
+	int32_t mNumBlocks;
+	float* mpData; // [(block * N + component) * BLOCK_SIZE + item in the block], 32-byte aligned
+
+private:
+	GWSoA() {}
+
+public:
+	float* get_component(int blk, int comp) { return &mpData[(blk * N + comp) * BLOCK_SIZE]; }
+	const float* get_component(int blk, int comp) const { return &mpData[(blk * N + comp) * BLOCK_SIZE]; }
+
+	float get(int idx, int comp) const { return get_component(idx / BLOCK_SIZE, comp)[idx % BLOCK_SIZE]; }
+	void set(int idx, int comp, float val) { get_component(idx / BLOCK_SIZE, comp)[idx % BLOCK_SIZE] = val; }
+
+	// GWLane groups of items, GWLane::WIDTH items per group
+	int get_num_groups() const { return mNumBlocks * GROUPS_PER_BLOCK; }
+
+	void load(int grp, GWLane::Tuple<N>& v) const {
+		const float* pSrc = &mpData[(grp / GROUPS_PER_BLOCK) * N * BLOCK_SIZE + (grp % GROUPS_PER_BLOCK) * GWLane::WIDTH];
+		for (int i = 0; i < N; ++i) {
+			v.elems[i] = GWLane::load(&pSrc[i * BLOCK_SIZE]);
+		}
+	}
+
+	void store(int grp, const GWLane::Tuple<N>& v) {
+		float* pDst = &mpData[(grp / GROUPS_PER_BLOCK) * N * BLOCK_SIZE + (grp % GROUPS_PER_BLOCK) * GWLane::WIDTH];
+		for (int i = 0; i < N; ++i) {
+			GWLane::store(&pDst[i * BLOCK_SIZE], v.elems[i]);
+		}
+	}
+
+	// Copies the last item over the rest of its block, to be called after the items were changed with set().
+	void fill_tail();
+
+	// TUPLE_T is GWVectorF, GWColorF or another type with N float elems, num is mNum when 0
+	template<typename TUPLE_T> void from_aos(const TUPLE_T* pSrc, int num = 0) {
+		if (num <= 0) { num = mNum; }
+		for (int i = 0; i < num; i += BLOCK_SIZE) {
+			int cnt = std::min(BLOCK_SIZE, num - i);
+			for (int j = 0; j < N; ++j) {
+				float* pComp = get_component(i / BLOCK_SIZE, j);
+				for (int k = 0; k < cnt; ++k) { pComp[k] = pSrc[i + k].elems[j]; }
+			}
+		}
+		fill_tail();
+	}
+
+	template<typename TUPLE_T> void to_aos(TUPLE_T* pDst, int num = 0) const {
+		if (num <= 0) { num = mNum; }
+		for (int i = 0; i < num; i += BLOCK_SIZE) {
+			int cnt = std::min(BLOCK_SIZE, num - i);
+			for (int j = 0; j < N; ++j) {
+				const float* pComp = get_component(i / BLOCK_SIZE, j);
+				for (int k = 0; k < cnt; ++k) { pDst[i + k].elems[j] = pComp[k]; }
+			}
+		}
+	}
+
+	// The same as GWTuple::calc_bbox over the items, nothing is written when the container is empty.
+	void calc_bbox(float* pMin /*[N]*/, float* pMax /*[N]*/) const;
+	template<typename TUPLE_T> void calc_bbox(TUPLE_T& minVal, TUPLE_T& maxVal) const { calc_bbox(minVal.elems, maxVal.elems); }
+
+	// Dst = A + (B - A) * t, the containers have the same number of items; dst may be a or b.
+	static void lerp(GWSoA& dst, const GWSoA& a, const GWSoA& b, float t);
+
+	static GWSoA* create(int num);
+	template<typename TUPLE_T> static GWSoA* create(const TUPLE_T* pSrc, int num) {
+		GWSoA* pSoA = create(num);
+		pSoA->from_aos(pSrc, num);
+		return pSoA;
+	}
+	static void destroy(GWSoA* pSoA);
+};
+
+typedef GWSoA<3> GWSoA3;
+typedef GWSoA<4> GWSoA4;
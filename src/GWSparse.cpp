@@ -0,0 +1,423 @@
+/*
+ * Author: Gleb Novodran <novodran@gmail.com>
+ */
+
+#include <cstring>
+#include "groundwork.hpp"
+
+namespace GWSparse {
+
+	// rows handed out as one piece of work, the partial sums are kept per chunk
+	static const int ROW_CHUNK = 0x1000;
+	// relative diagonal shifts tried by IC0 before falling back to JACOBI
+	static const float IC0_SHIFT_MIN = 1.0e-3f;
+	static const int IC0_SHIFT_TRIES = 10;
+
+	static int calc_num_chunks(int n) { return (n + ROW_CHUNK - 1) / ROW_CHUNK; }
+
+	// serial as one chunk through the same code, fast math may compile an inlined copy differently
+	template<typename FUNC_T> static void exec_rows(int n, bool parallel, const FUNC_T& func) {
+		int nchunks = calc_num_chunks(n);
+		GWTask::parallel_for(nchunks, [&](int c0, int c1) {
+			for (int c = c0; c < c1; ++c) {
+				func(c * ROW_CHUNK, std::min((c + 1) * ROW_CHUNK, n));
+			}
+		}, parallel ? 1 : nchunks);
+	}
+
+	// pPartial - a sum per chunk
+	template<typename FUNC_T> static double reduce_rows(int n, bool parallel, double* pPartial, const FUNC_T& func) {
+		int nchunks = calc_num_chunks(n);
+		GWTask::parallel_for(nchunks, [&](int c0, int c1) {
+			for (int c = c0; c < c1; ++c) {
+				pPartial[c] = func(c * ROW_CHUNK, std::min((c + 1) * ROW_CHUNK, n));
+			}
+		}, parallel ? 1 : nchunks);
+		double s = 0.0;
+		for (int c = 0; c < nchunks; ++c) {
+			s += pPartial[c];
+		}
+		return s;
+	}
+
+	static double dot(const float* pA, const float* pB, int n, bool parallel, double* pPartial) {
+		return reduce_rows(n, parallel, pPartial, [&](int i0, int i1) {
+			double s = 0.0;
+			for (int i = i0; i < i1; ++i) {
+				s += double(pA[i]) * double(pB[i]);
+			}
+			return s;
+		});
+	}
+
+	static int32_t prefix_sum(int32_t* pOrg, const int32_t* pCnt, int n) {
+		int32_t sum = 0;
+		for (int i = 0; i < n; ++i) {
+			pOrg[i] = sum;
+			sum += pCnt[i];
+		}
+		pOrg[n] = sum;
+		return sum;
+	}
+
+	int CSRMatrix::find(int row, int col) const {
+		const int32_t* pBegin = mpCols + mpRowOrg[row];
+		const int32_t* pEnd = mpCols + mpRowOrg[row + 1];
+		const int32_t* p = std::lower_bound(pBegin, pEnd, col);
+		return (p != pEnd && *p == col) ? int(p - mpCols) : -1;
+	}
+
+	void CSRMatrix::get_diag(float* pDiag) const {
+		for (int i = 0; i < mNumRows; ++i) {
+			pDiag[i] = get(i, i);
+		}
+	}
+
+	void CSRMatrix::mul(float* pDst, const float* pVec, bool parallel) const {
+		exec_rows(mNumRows, parallel, [&](int i0, int i1) {
+			for (int i = i0; i < i1; ++i) {
+				float s = 0.0f;
+				for (int j = mpRowOrg[i]; j < mpRowOrg[i + 1]; ++j) {
+					s += mpVals[j] * pVec[mpCols[j]];
+				}
+				pDst[i] = s;
+			}
+		});
+	}
+
+	void CSRMatrix::set_laplacian(float scl, float diag, bool parallel) {
+		exec_rows(mNumRows, parallel, [&](int i0, int i1) {
+			for (int i = i0; i < i1; ++i) {
+				int deg = 0;
+				int idiag = -1;
+				for (int j = mpRowOrg[i]; j < mpRowOrg[i + 1]; ++j) {
+					if (mpCols[j] == i) {
+						idiag = j;
+					} else {
+						mpVals[j] = -scl;
+						++deg;
+					}
+				}
+				if (idiag >= 0) {
+					mpVals[idiag] = scl * float(deg) + diag;
+				}
+			}
+		});
+	}
+
+	CSRMatrix* CSRMatrix::create(int nrows, int ncols, int nnz) {
+		if (nrows <= 0 || ncols <= 0 || nnz < 0) { return nullptr; }
+		size_t memSz = GWBase::align(sizeof(CSRMatrix), 0x10);
+		size_t offsOrg = memSz;
+		memSz += GWBase::align((nrows + 1) * sizeof(int32_t), 0x10);
+		size_t offsCols = memSz;
+		memSz += GWBase::align(nnz * sizeof(int32_t), 0x10);
+		size_t offsVals = memSz;
+		memSz += nnz * sizeof(float);
+		uint8_t* pMem = reinterpret_cast<uint8_t*>(GWSys::alloc_rsrc_mem(memSz));
+		std::memset(pMem, 0, memSz);
+		CSRMatrix* pMtx = reinterpret_cast<CSRMatrix*>(pMem);
+		pMtx->mNumRows = nrows;
+		pMtx->mNumCols = ncols;
+		pMtx->mNumNonZero = nnz;
+		pMtx->mpRowOrg = reinterpret_cast<int32_t*>(pMem + offsOrg);
+		pMtx->mpCols = reinterpret_cast<int32_t*>(pMem + offsCols);
+		pMtx->mpVals = reinterpret_cast<float*>(pMem + offsVals);
+		return pMtx;
+	}
+
+	CSRMatrix* CSRMatrix::from_triangles(const uint32_t* pTriPnts, int ntri, int npnt, bool parallel) {
+		if (npnt <= 0) { return nullptr; }
+		int32_t* pCnt = reinterpret_cast<int32_t*>(GWSys::alloc_temp_mem((npnt * 2 + 1) * sizeof(int32_t)));
+		int32_t* pOrg = pCnt + npnt;
+		// the point itself and two neighbours per triangle corner, the duplicates are removed below
+		for (int i = 0; i < npnt; ++i) {
+			pCnt[i] = 1;
+		}
+		for (int t = 0; t < ntri; ++t) {
+			const uint32_t* pTri = pTriPnts + t * 3;
+			if (pTri[0] >= uint32_t(npnt) || pTri[1] >= uint32_t(npnt) || pTri[2] >= uint32_t(npnt)) continue;
+			for (int k = 0; k < 3; ++k) {
+				pCnt[pTri[k]] += 2;
+			}
+		}
+		int32_t total = prefix_sum(pOrg, pCnt, npnt);
+		int32_t* pNbr = reinterpret_cast<int32_t*>(GWSys::alloc_temp_mem(total * sizeof(int32_t)));
+		for (int i = 0; i < npnt; ++i) {
+			pNbr[pOrg[i]] = i;
+			pCnt[i] = 1;
+		}
+		for (int t = 0; t < ntri; ++t) {
+			const uint32_t* pTri = pTriPnts + t * 3;
+			if (pTri[0] >= uint32_t(npnt) || pTri[1] >= uint32_t(npnt) || pTri[2] >= uint32_t(npnt)) continue;
+			for (int k = 0; k < 3; ++k) {
+				int32_t a = int32_t(pTri[k]);
+				int32_t* pRow = pNbr + pOrg[a];
+				pRow[pCnt[a]++] = int32_t(pTri[(k + 1) % 3]);
+				pRow[pCnt[a]++] = int32_t(pTri[(k + 2) % 3]);
+			}
+		}
+		exec_rows(npnt, parallel, [&](int i0, int i1) {
+			for (int i = i0; i < i1; ++i) {
+				int32_t* pRow = pNbr + pOrg[i];
+				std::sort(pRow, pRow + pCnt[i]);
+				pCnt[i] = int32_t(std::unique(pRow, pRow + pCnt[i]) - pRow);
+			}
+		});
+		int32_t nnz = 0;
+		for (int i = 0; i < npnt; ++i) {
+			nnz += pCnt[i];
+		}
+		CSRMatrix* pMtx = create(npnt, npnt, nnz);
+		prefix_sum(pMtx->mpRowOrg, pCnt, npnt);
+		exec_rows(npnt, parallel, [&](int i0, int i1) {
+			for (int i = i0; i < i1; ++i) {
+				std::copy_n(pNbr + pOrg[i], pCnt[i], pMtx->mpCols + pMtx->mpRowOrg[i]);
+			}
+		});
+		GWSys::free_temp_mem(pNbr);
+		GWSys::free_temp_mem(pCnt);
+		return pMtx;
+	}
+
+	CSRMatrix* CSRMatrix::from_model(GWModelResource& mdr, bool parallel) {
+		if (mdr.mNumPnt == 0) { return nullptr; }
+		int ntri = int(mdr.mNumTri);
+		uint32_t* pTriPnts = reinterpret_cast<uint32_t*>(GWSys::alloc_temp_mem((ntri + 1) * 3 * sizeof(uint32_t)));
+		int triOrg = 0;
+		for (uint32_t i = 0; i < mdr.mNumMtl; ++i) {
+			GWModelResource::Material* pMtl = mdr.get_mtl(i);
+			int mtlTris = std::min(int(pMtl->mIdx.mNumTri), ntri - triOrg);
+			for (int j = 0; j < mtlTris; ++j) {
+				mdr.get_mtl_tri_pnt_indices(i, j, &pTriPnts[(triOrg + j) * 3]);
+			}
+			triOrg += mtlTris;
+		}
+		CSRMatrix* pMtx = from_triangles(pTriPnts, triOrg, int(mdr.mNumPnt), parallel);
+		GWSys::free_temp_mem(pTriPnts);
+		return pMtx;
+	}
+
+	void CSRMatrix::destroy(CSRMatrix* pMtx) {
+		if (pMtx) {
+			GWSys::free_rsrc_mem(pMtx);
+		}
+	}
+
+	// Row by row: L(i, k) = (A(i, k) - sum L(i, j) * L(k, j)) / L(k, k) over the j < k stored in both rows,
+	// the sums are merges of the sorted columns.
+	bool Preconditioner::factor(const CSRMatrix& mtx, float shift) {
+		CSRMatrix* pL = mpFactor;
+		int n = mNumRows;
+		for (int i = 0; i < n; ++i) {
+			int org = mtx.mpRowOrg[i];
+			int lorg = pL->mpRowOrg[i];
+			int lend = pL->mpRowOrg[i + 1] - 1;
+			for (int j = lorg; j <= lend; ++j) {
+				pL->mpVals[j] = mtx.mpVals[org + (j - lorg)];
+			}
+			for (int e = lorg; e < lend; ++e) {
+				int k = pL->mpCols[e];
+				int a = lorg;
+				int b = pL->mpRowOrg[k];
+				int bend = pL->mpRowOrg[k + 1] - 1;
+				float s = pL->mpVals[e];
+				while (a < e && b < bend) {
+					int ca = pL->mpCols[a];
+					int cb = pL->mpCols[b];
+					if (ca == cb) {
+						s -= pL->mpVals[a] * pL->mpVals[b];
+						++a;
+						++b;
+					} else if (ca < cb) {
+						++a;
+					} else {
+						++b;
+					}
+				}
+				pL->mpVals[e] = s / pL->mpVals[bend];
+			}
+			float d = pL->mpVals[lend] * (1.0f + shift);
+			for (int j = lorg; j < lend; ++j) {
+				d -= pL->mpVals[j] * pL->mpVals[j];
+			}
+			if (!(d > 0.0f)) { return false; }
+			pL->mpVals[lend] = std::sqrt(d);
+		}
+		mShift = shift;
+		return true;
+	}
+
+	void Preconditioner::apply(float* pDst, const float* pSrc, bool parallel) const {
+		int n = mNumRows;
+		if (mKind == PrecondKind::JACOBI) {
+			exec_rows(n, parallel, [&](int i0, int i1) {
+				for (int i = i0; i < i1; ++i) {
+					pDst[i] = pSrc[i] * mpInvDiag[i];
+				}
+			});
+		} else if (mKind == PrecondKind::IC0) {
+			const CSRMatrix* pL = mpFactor;
+			// L y = src
+			for (int i = 0; i < n; ++i) {
+				int lend = pL->mpRowOrg[i + 1] - 1;
+				float s = pSrc[i];
+				for (int j = pL->mpRowOrg[i]; j < lend; ++j) {
+					s -= pL->mpVals[j] * pDst[pL->mpCols[j]];
+				}
+				pDst[i] = s / pL->mpVals[lend];
+			}
+			// L^T dst = y, by the rows of L
+			for (int i = n; --i >= 0;) {
+				int lend = pL->mpRowOrg[i + 1] - 1;
+				float x = pDst[i] / pL->mpVals[lend];
+				pDst[i] = x;
+				for (int j = pL->mpRowOrg[i]; j < lend; ++j) {
+					pDst[pL->mpCols[j]] -= pL->mpVals[j] * x;
+				}
+			}
+		} else if (pDst != pSrc) {
+			std::copy_n(pSrc, n, pDst);
+		}
+	}
+
+	Preconditioner* Preconditioner::create(const CSRMatrix& mtx, PrecondKind kind, bool parallel) {
+		int n = mtx.mNumRows;
+		Preconditioner* pPrecond = reinterpret_cast<Preconditioner*>(GWSys::alloc_rsrc_mem(sizeof(Preconditioner)));
+		std::memset(reinterpret_cast<void*>(pPrecond), 0, sizeof(Preconditioner));
+		pPrecond->mKind = kind;
+		pPrecond->mNumRows = n;
+		if (kind == PrecondKind::IC0) {
+			int32_t* pCnt = reinterpret_cast<int32_t*>(GWSys::alloc_temp_mem(n * sizeof(int32_t)));
+			bool valid = true;
+			for (int i = 0; i < n; ++i) {
+				int org = mtx.mpRowOrg[i];
+				int end = mtx.mpRowOrg[i + 1];
+				int cnt = int(std::upper_bound(mtx.mpCols + org, mtx.mpCols + end, i) - (mtx.mpCols + org));
+				valid = valid && cnt > 0 && mtx.mpCols[org + cnt - 1] == i;
+				pCnt[i] = cnt;
+			}
+			if (valid) {
+				int32_t nnz = 0;
+				for (int i = 0; i < n; ++i) {
+					nnz += pCnt[i];
+				}
+				CSRMatrix* pL = CSRMatrix::create(n, n, nnz);
+				prefix_sum(pL->mpRowOrg, pCnt, n);
+				for (int i = 0; i < n; ++i) {
+					std::copy_n(mtx.mpCols + mtx.mpRowOrg[i], pCnt[i], pL->mpCols + pL->mpRowOrg[i]);
+				}
+				pPrecond->mpFactor = pL;
+				valid = pPrecond->factor(mtx, 0.0f);
+				float shift = IC0_SHIFT_MIN;
+				for (int i = 0; !valid && i < IC0_SHIFT_TRIES; ++i) {
+					valid = pPrecond->factor(mtx, shift);
+					shift *= 2.0f;
+				}
+				if (!valid) {
+					CSRMatrix::destroy(pL);
+					pPrecond->mpFactor = nullptr;
+				}
+			}
+			GWSys::free_temp_mem(pCnt);
+			if (!valid) {
+				pPrecond->mKind = PrecondKind::JACOBI;
+			}
+		}
+		if (pPrecond->mKind == PrecondKind::JACOBI) {
+			pPrecond->mpInvDiag = reinterpret_cast<float*>(GWSys::alloc_rsrc_mem(n * sizeof(float)));
+			exec_rows(n, parallel, [&](int i0, int i1) {
+				for (int i = i0; i < i1; ++i) {
+					float d = mtx.get(i, i);
+					pPrecond->mpInvDiag[i] = d != 0.0f ? 1.0f / d : 1.0f;
+				}
+			});
+		}
+		return pPrecond;
+	}
+
+	void Preconditioner::destroy(Preconditioner* pPrecond) {
+		if (pPrecond == nullptr) { return; }
+		if (pPrecond->mpInvDiag) {
+			GWSys::free_rsrc_mem(pPrecond->mpInvDiag);
+		}
+		CSRMatrix::destroy(pPrecond->mpFactor);
+		GWSys::free_rsrc_mem(pPrecond);
+	}
+
+	int cg_solve(const CSRMatrix& mtx, float* pAns, const float* pRH, const Preconditioner* pPrecond, const CGParams& params, float* pResidual) {
+		const int n = mtx.mNumRows;
+		const bool parallel = params.mParallel;
+		const bool precond = pPrecond != nullptr && pPrecond->mKind != PrecondKind::NONE;
+		size_t memSz = GWBase::align(calc_num_chunks(n) * sizeof(double), 0x10) + n * sizeof(float) * 4;
+		uint8_t* pMem = reinterpret_cast<uint8_t*>(GWSys::alloc_temp_mem(memSz));
+		double* pPartial = reinterpret_cast<double*>(pMem);
+		float* pR = reinterpret_cast<float*>(pMem + GWBase::align(calc_num_chunks(n) * sizeof(double), 0x10));
+		float* pP = pR + n;
+		float* pQ = pP + n;
+		float* pZ = precond ? pQ + n : pR;
+
+		double rhNrm = std::sqrt(dot(pRH, pRH, n, parallel, pPartial));
+		if (rhNrm == 0.0) {
+			std::fill_n(pAns, n, 0.0f);
+			GWSys::free_temp_mem(pMem);
+			if (pResidual) {
+				*pResidual = 0.0f;
+			}
+			return 0;
+		}
+		mtx.mul(pQ, pAns, parallel);
+		double rr = reduce_rows(n, parallel, pPartial, [&](int i0, int i1) {
+			double s = 0.0;
+			for (int i = i0; i < i1; ++i) {
+				pR[i] = pRH[i] - pQ[i];
+				s += double(pR[i]) * double(pR[i]);
+			}
+			return s;
+		});
+		const double tol = double(params.mTolerance) * rhNrm;
+		int iter = 0;
+		if (std::sqrt(rr) > tol) {
+			if (precond) {
+				pPrecond->apply(pZ, pR, parallel);
+			}
+			std::copy_n(pZ, n, pP);
+			double rz = precond ? dot(pR, pZ, n, parallel, pPartial) : rr;
+			while (iter < params.mMaxIter) {
+				mtx.mul(pQ, pP, parallel);
+				double pq = dot(pP, pQ, n, parallel, pPartial);
+				if (!(pq > 0.0)) break; // not positive definite
+				float alpha = float(rz / pq);
+				rr = reduce_rows(n, parallel, pPartial, [&](int i0, int i1) {
+					double s = 0.0;
+					for (int i = i0; i < i1; ++i) {
+						pAns[i] += alpha * pP[i];
+						pR[i] -= alpha * pQ[i];
+						s += double(pR[i]) * double(pR[i]);
+					}
+					return s;
+				});
+				++iter;
+				if (std::sqrt(rr) <= tol) break;
+				double rzPrev = rz;
+				if (precond) {
+					pPrecond->apply(pZ, pR, parallel);
+					rz = dot(pR, pZ, n, parallel, pPartial);
+				} else {
+					rz = rr;
+				}
+				float beta = float(rz / rzPrev);
+				exec_rows(n, parallel, [&](int i0, int i1) {
+					for (int i = i0; i < i1; ++i) {
+						pP[i] = pZ[i] + beta * pP[i];
+					}
+				});
+			}
+		}
+		if (pResidual) {
+			*pResidual = float(std::sqrt(rr) / rhNrm);
+		}
+		GWSys::free_temp_mem(pMem);
+		return iter;
+	}
+}
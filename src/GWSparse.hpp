@@ -0,0 +1,89 @@
+/*
+ * Author: Gleb Novodran <novodran@gmail.com>
+ */
+
+// Sparse matrices for the systems over mesh points and the conjugate gradient solver for them.
+namespace GWSparse {
+
+	// Compressed sparse rows, the columns are sorted within each row.
+	class CSRMatrix {
+	public:
+		int32_t mNumRows;
+		int32_t mNumCols;
+		int32_t mNumNonZero;
+		int32_t* mpRowOrg; // mNumRows + 1 entries
+		int32_t* mpCols;
+		float* mpVals;
+
+	private:
+		CSRMatrix() {}
+
+	public:
+		int get_row_size(int row) const { return mpRowOrg[row + 1] - mpRowOrg[row]; }
+		// index of the entry in mpCols and mpVals, -1 if it's not stored
+		int find(int row, int col) const;
+		float get(int row, int col) const {
+			int idx = find(row, col);
+			return idx < 0 ? 0.0f : mpVals[idx];
+		}
+		void get_diag(float* pDiag) const;
+
+		// Dst = M * Vec, done by chunks of rows split among the GWTask workers.
+		void mul(float* pDst, const float* pVec, bool parallel = true) const;
+
+		// Uniform weight graph Laplacian scaled by scl, plus diag on the diagonal; with diag > 0 the matrix is
+		// positive definite. Off the diagonal every stored entry is an edge.
+		void set_laplacian(float scl = 1.0f, float diag = 0.0f, bool parallel = true);
+
+		// Zeroed values, the pattern has to be filled by the caller.
+		static CSRMatrix* create(int nrows, int ncols, int nnz);
+		// Pattern of the mesh graph: a row per point holding the point itself and its neighbours across
+		// the triangle edges, values are zero.
+		static CSRMatrix* from_triangles(const uint32_t* pTriPnts, int ntri, int npnt, bool parallel = true);
+		// Points as they are stored in the model, split ones don't share their rows.
+		static CSRMatrix* from_model(GWModelResource& mdr, bool parallel = true);
+		static void destroy(CSRMatrix* pMtx);
+	};
+
+	enum class PrecondKind : uint8_t {
+		NONE = 0,
+		JACOBI = 1,
+		IC0 = 2 // incomplete Cholesky with the pattern of the lower triangle
+	};
+
+	// Made once per matrix and reused by the solves. The triangular solves of IC0 are serial,
+	// it takes fewer iterations than JACOBI but each of them is longer.
+	class Preconditioner {
+	public:
+		PrecondKind mKind;
+		int32_t mNumRows;
+		float* mpInvDiag; // JACOBI
+		CSRMatrix* mpFactor; // IC0, lower triangle with the diagonal last in every row
+		float mShift; // IC0, relative diagonal shift which was needed to complete the factorization
+
+	private:
+		Preconditioner() {}
+
+		bool factor(const CSRMatrix& mtx, float shift);
+
+	public:
+		void apply(float* pDst, const float* pSrc, bool parallel = true) const;
+
+		// IC0 falls back to JACOBI when it can't be completed even with the diagonal shifted.
+		static Preconditioner* create(const CSRMatrix& mtx, PrecondKind kind, bool parallel = true);
+		static void destroy(Preconditioner* pPrecond);
+	};
+
+	struct CGParams {
+		int32_t mMaxIter;
+		float mTolerance; // relative to the norm of the right-hand side
+		bool mParallel;
+
+		CGParams() : mMaxIter(1000), mTolerance(1.0e-6f), mParallel(true) {}
+	};
+
+	// Preconditioned conjugate gradient for a symmetric positive definite matrix, pAns holds the starting
+	// guess on input. Returns the number of iterations, pResidual gets the final relative residual.
+	// The sums are done by fixed chunks of rows, the result doesn't depend on the parallel flag.
+	int cg_solve(const CSRMatrix& mtx, float* pAns, const float* pRH, const Preconditioner* pPrecond = nullptr, const CGParams& params = CGParams(), float* pResidual = nullptr);
+}
@@ -5,58 +5,316 @@
 #include "GWSys.hpp"
 #include "GWBase.hpp"
 #include "GWVector.hpp"
+#include "GWSoA.hpp"
 #include "GWSphere.hpp"
 
-template<typename T> void GWSphereBase<T>::ritter(const GWVectorBase<T>* pPts, int numPts) {
-	GWSphereBase<T> sph;
-	GWTuple3i imin, imax;
-	GWTuple::fill(imin, 0);
-	GWTuple::fill(imax, 0);
+// Index of the first point with the smallest and the largest x, y, z.
+template<typename T> static void find_extremes(int* pMinIdx, int* pMaxIdx, const GWVectorBase<T>* pPts, int numPts, bool) {
+	std::fill_n(pMinIdx, 3, 0);
+	std::fill_n(pMaxIdx, 3, 0);
+	for (int i = 1; i < numPts; ++i) {
+		for (int j = 0; j < 3; ++j) {
+			if (pPts[i][j] < pPts[pMinIdx[j]][j]) pMinIdx[j] = i;
+			if (pPts[i][j] > pPts[pMaxIdx[j]][j]) pMaxIdx[j] = i;
+		}
+	}
+}
 
-	for (int i = 0; i < numPts; ++i) {
-		GWVectorBase<T> pnt = pPts[i];
+static void find_extremes(int* pMinIdx, int* pMaxIdx, const GWVectorF* pPts, int numPts, bool parallel) {
+	GWBase::calc_extremes(pMinIdx, pMaxIdx, pPts->elems, numPts, 3, parallel);
+}
 
-		if (pnt.x < pPts[imin.x].x) imin.x = i;
-		if (pnt.x > pPts[imax.x].x) imax.x = i;
-		if (pnt.y < pPts[imin.y].y) imin.y = i;
-		if (pnt.y > pPts[imax.y].y) imax.y = i;
-		if (pnt.z < pPts[imin.z].z) imin.z = i;
-		if (pnt.z > pPts[imax.z].z) imax.z = i;
+template<typename T> static T calc_max_dist_sq(const GWVectorBase<T>* pPts, int numPts, const GWVectorBase<T>& c, bool) {
+	T res = T(0);
+	for (int i = 0; i < numPts; ++i) {
+		res = std::max(res, (pPts[i] - c).length_sq());
 	}
+	return res;
+}
 
-	GWVectorBase<T> vx = pPts[imax.x] - pPts[imin.x];
-	GWVectorBase<T> vy = pPts[imax.y] - pPts[imin.y];
-	GWVectorBase<T> vz = pPts[imax.z] - pPts[imin.z];
-	T dx = vx.length_sq();
-	T dy = vy.length_sq();
-	T dz = vz.length_sq();
+static float calc_max_dist_sq(const GWVectorF* pPts, int numPts, const GWVectorF& c, bool parallel) {
+	return GWBase::calc_max_dist_sq(pPts->elems, numPts, c.elems, parallel);
+}
 
-	int minPntIdx = imin.x;
-	int maxPntIdx = imax.x;
-	if (dy > dx && dy > dz) {
-		minPntIdx = imin.y;
-		maxPntIdx = imax.y;
+// The initial sphere over the most distant pair of the extreme points.
+template<typename T, typename GET_PNT_T> static void init_ritter(GWSphereBase<T>& sph, const int* pMinIdx, const int* pMaxIdx, const GET_PNT_T& get_pnt) {
+	T dist[3];
+	for (int j = 0; j < 3; ++j) {
+		dist[j] = (get_pnt(pMaxIdx[j]) - get_pnt(pMinIdx[j])).length_sq();
+	}
+	int minPntIdx = pMinIdx[0];
+	int maxPntIdx = pMaxIdx[0];
+	if (dist[1] > dist[0] && dist[1] > dist[2]) {
+		minPntIdx = pMinIdx[1];
+		maxPntIdx = pMaxIdx[1];
 	}
-	if (dz > dx && dz > dy) {
-		minPntIdx = imin.z;
-		maxPntIdx = imax.z;
+	if (dist[2] > dist[0] && dist[2] > dist[1]) {
+		minPntIdx = pMinIdx[2];
+		maxPntIdx = pMaxIdx[2];
 	}
+	sph.c = (get_pnt(minPntIdx) + get_pnt(maxPntIdx)) * T(0.5f);
+	sph.r = (get_pnt(maxPntIdx) - sph.c).length();
+}
 
-	sph.c = (pPts[minPntIdx] + pPts[maxPntIdx]) * T(0.5f);
-	sph.r = (pPts[maxPntIdx] - sph.c).length();
+// The growing pass is serial, the result depends on the order of the points. With floats the points are
+// tested GWLane::WIDTH at a time against a slightly smaller sphere first, and enclose() only runs for the groups
+// where it can change the sphere.
+static const float RITTER_SKIP_MARGIN = 0.9999f;
 
+template<typename T> static void enclose_all(GWSphereBase<T>& sph, const GWVectorBase<T>* pPts, int numPts) {
 	for (int i = 0; i < numPts; ++i) {
 		sph.enclose(pPts[i]);
 	}
+}
 
-	for (int i = 0; i < numPts; ++i) {
-		T sqd = (pPts[i] - sph.c).length_sq();
-		if (sqd > sph.r * sph.r) {
-			sph.r = GWBase::tsqrt(sqd) + (sph.r * T(1.0e-5));
+static void enclose_all(GWSphereF& sph, const GWVectorF* pPts, int numPts) {
+	for (int i = 0; i < numPts; i += GWLane::WIDTH) {
+		int end = std::min(i + GWLane::WIDTH, numPts);
+		float xyz[3][GWLane::WIDTH];
+		for (int k = 0; k < GWLane::WIDTH; ++k) {
+			const GWVectorF& pnt = pPts[std::min(i + k, end - 1)];
+			xyz[0][k] = pnt.x;
+			xyz[1][k] = pnt.y;
+			xyz[2][k] = pnt.z;
+		}
+		GWLane::F dx = GWLane::load(xyz[0]) - GWLane::F(sph.c.x);
+		GWLane::F dy = GWLane::load(xyz[1]) - GWLane::F(sph.c.y);
+		GWLane::F dz = GWLane::load(xyz[2]) - GWLane::F(sph.c.z);
+		if (GWLane::any(dx * dx + dy * dy + dz * dz > GWLane::F(sph.r * sph.r * RITTER_SKIP_MARGIN))) {
+			for (int k = i; k < end; ++k) {
+				sph.enclose(pPts[k]);
+			}
 		}
 	}
+}
+
+// The last pass extends the radius once to the farthest point, with a relative margin for the rounding.
+template<typename T> static void ritter_finish(GWSphereBase<T>& sph, T maxDistSq) {
+	if (maxDistSq > sph.r * sph.r) {
+		sph.r = GWBase::tsqrt(maxDistSq) + (sph.r * T(1.0e-5));
+	}
+}
+
+template<typename T> void GWSphereBase<T>::ritter(const GWVectorBase<T>* pPts, int numPts, bool parallel) {
+	if (numPts <= 0) {
+		set_zero();
+		return;
+	}
+	int imin[3];
+	int imax[3];
+	find_extremes(imin, imax, pPts, numPts, parallel);
+	GWSphereBase<T> sph;
+	init_ritter(sph, imin, imax, [pPts](int idx) { return pPts[idx]; });
+	enclose_all(sph, pPts, numPts);
+	ritter_finish(sph, calc_max_dist_sq(pPts, numPts, sph.c, parallel));
 	*this = sph;
 }
 
-template void GWSphereBase<float>::ritter(const GWVectorBase<float>* pPnts, int numPts);
-template void GWSphereBase<double>::ritter(const GWVectorBase<double>* pPnts, int numPts);
+template void GWSphereBase<float>::ritter(const GWVectorBase<float>* pPnts, int numPts, bool parallel);
+template void GWSphereBase<double>::ritter(const GWVectorBase<double>* pPnts, int numPts, bool parallel);
+
+// Extreme points a GWLane at a time, keeping per lane the first smallest and largest value and its group; merging
+// the lanes by the lower index picks the same points as the loop over the array.
+template<> void GWSphereBase<float>::ritter(const GWSoA3& pts) {
+	if (pts.mNum <= 0) {
+		set_zero();
+		return;
+	}
+	int ngrp = pts.get_num_groups();
+	GWLane::V3 vmin, vmax, gmin, gmax;
+	pts.load(0, vmin);
+	vmax = vmin;
+	GWLane::fill(gmin, GWLane::F(0.0f));
+	GWLane::fill(gmax, GWLane::F(0.0f));
+	for (int i = 1; i < ngrp; ++i) {
+		GWLane::V3 v;
+		pts.load(i, v);
+		GWLane::F grp = GWLane::F(float(i));
+		for (int j = 0; j < 3; ++j) {
+			auto lt = v[j] < vmin[j];
+			auto gt = v[j] > vmax[j];
+			vmin[j] = GWLane::sel(lt, v[j], vmin[j]);
+			gmin[j] = GWLane::sel(lt, grp, gmin[j]);
+			vmax[j] = GWLane::sel(gt, v[j], vmax[j]);
+			gmax[j] = GWLane::sel(gt, grp, gmax[j]);
+		}
+	}
+
+	auto get_pnt = [&pts](int idx) { return GWVectorF(pts.get(idx, 0), pts.get(idx, 1), pts.get(idx, 2)); };
+	int imin[3];
+	int imax[3];
+	for (int j = 0; j < 3; ++j) {
+		float lval[2][GWLane::WIDTH];
+		float lgrp[2][GWLane::WIDTH];
+		GWLane::store(lval[0], vmin[j]);
+		GWLane::store(lval[1], vmax[j]);
+		GWLane::store(lgrp[0], gmin[j]);
+		GWLane::store(lgrp[1], gmax[j]);
+		imin[j] = int(lgrp[0][0]) * GWLane::WIDTH;
+		imax[j] = int(lgrp[1][0]) * GWLane::WIDTH;
+		float bmin = lval[0][0];
+		float bmax = lval[1][0];
+		for (int k = 1; k < GWLane::WIDTH; ++k) {
+			int idx = int(lgrp[0][k]) * GWLane::WIDTH + k;
+			if (lval[0][k] < bmin || (lval[0][k] == bmin && idx < imin[j])) {
+				bmin = lval[0][k];
+				imin[j] = idx;
+			}
+			idx = int(lgrp[1][k]) * GWLane::WIDTH + k;
+			if (lval[1][k] > bmax || (lval[1][k] == bmax && idx < imax[j])) {
+				bmax = lval[1][k];
+				imax[j] = idx;
+			}
+		}
+	}
+
+	GWSphereF sph;
+	init_ritter(sph, imin, imax, get_pnt);
+
+	auto dist_sq = [&pts, &sph](int grp) {
+		GWLane::V3 v, c;
+		pts.load(grp, v);
+		for (int j = 0; j < 3; ++j) { c[j] = GWLane::F(sph.c[j]); }
+		GWLane::sub(v, v, c);
+		return GWLane::dot(v, v);
+	};
+	for (int i = 0; i < ngrp; ++i) {
+		if (GWLane::any(dist_sq(i) > GWLane::F(sph.r * sph.r * RITTER_SKIP_MARGIN))) {
+			int end = std::min((i + 1) * GWLane::WIDTH, int(pts.mNum));
+			for (int k = i * GWLane::WIDTH; k < end; ++k) {
+				sph.enclose(get_pnt(k));
+			}
+		}
+	}
+
+	GWLane::F vdist(0.0f);
+	for (int i = 0; i < ngrp; ++i) {
+		vdist = GWLane::max(vdist, dist_sq(i));
+	}
+	float ldist[GWLane::WIDTH];
+	GWLane::store(ldist, vdist);
+	ritter_finish(sph, *std::max_element(ldist, ldist + GWLane::WIDTH));
+	*this = sph;
+}
+
+struct WelzlSphere {
+	GWVectorD c;
+	double r2;
+
+	bool outside(const GWVectorD& p) const { return (p - c).length_sq() > r2 * (1.0 + 1.0e-10); }
+};
+
+static WelzlSphere welzl_sphere(const GWVectorD& a, const GWVectorD& b) {
+	WelzlSphere s;
+	s.c = (a + b) * 0.5;
+	s.r2 = (a - s.c).length_sq();
+	return s;
+}
+
+// Circumcircle of the triangle, the widest pair when the points are collinear.
+static WelzlSphere welzl_sphere(const GWVectorD& a, const GWVectorD& b, const GWVectorD& c) {
+	GWVectorD u = b - a;
+	GWVectorD v = c - a;
+	GWVectorD w = GWVector::cross(u, v);
+	double w2 = w.length_sq();
+	double u2 = u.length_sq();
+	double v2 = v.length_sq();
+	if (w2 <= 1.0e-12 * u2 * v2) {
+		WelzlSphere s = welzl_sphere(a, b);
+		WelzlSphere sac = welzl_sphere(a, c);
+		WelzlSphere sbc = welzl_sphere(b, c);
+		if (sac.r2 > s.r2) { s = sac; }
+		if (sbc.r2 > s.r2) { s = sbc; }
+		return s;
+	}
+	WelzlSphere s;
+	GWVectorD offs = (GWVector::cross(v, w) * u2 + GWVector::cross(w, u) * v2) * (0.5 / w2);
+	s.c = a + offs;
+	s.r2 = offs.length_sq();
+	return s;
+}
+
+// Circumsphere, the smallest of the triangle spheres holding all four points when they are coplanar.
+static WelzlSphere welzl_sphere(const GWVectorD& a, const GWVectorD& b, const GWVectorD& c, const GWVectorD& d) {
+	GWVectorD u = b - a;
+	GWVectorD v = c - a;
+	GWVectorD t = d - a;
+	GWVectorD vt = GWVector::cross(v, t);
+	double det = u.dot(vt);
+	if (det * det <= 1.0e-12 * u.length_sq() * v.length_sq() * t.length_sq()) {
+		const GWVectorD* pPts[] = { &a, &b, &c, &d };
+		WelzlSphere best;
+		best.r2 = -1.0;
+		for (int i = 0; i < 4; ++i) {
+			WelzlSphere s = welzl_sphere(*pPts[(i + 1) % 4], *pPts[(i + 2) % 4], *pPts[(i + 3) % 4]);
+			bool enclosing = !s.outside(*pPts[i]);
+			if ((enclosing && (best.r2 < 0.0 || s.r2 < best.r2)) || (best.r2 < 0.0 && i == 3)) {
+				best = s;
+			}
+		}
+		return best;
+	}
+	WelzlSphere s;
+	GWVectorD offs = (vt * u.length_sq() + GWVector::cross(t, u) * v.length_sq() + GWVector::cross(u, v) * t.length_sq()) * (0.5 / det);
+	s.c = a + offs;
+	s.r2 = offs.length_sq();
+	return s;
+}
+
+// Welzl's randomized incremental form without recursion: a point outside the current sphere must be on the
+// boundary of the sphere of the points so far, every nested level fixes one more boundary point. The points
+// are shuffled by the seed first, which makes the expected time linear. Done in doubles, the
+// radius is then rounded up so that every point is inside the sphere with the rounded center.
+template<typename T> void GWSphereBase<T>::welzl(const GWVectorBase<T>* pPts, int numPts, uint64_t seed) {
+	if (numPts <= 0) {
+		set_zero();
+		return;
+	}
+	GWVectorD* pPnts = reinterpret_cast<GWVectorD*>(GWSys::alloc_temp_mem(numPts * sizeof(GWVectorD)));
+	for (int i = 0; i < numPts; ++i) {
+		pPnts[i] = GWVectorD(double(pPts[i].x), double(pPts[i].y), double(pPts[i].z));
+	}
+	GWBase::Random rnd(seed);
+	for (int i = numPts - 1; i > 0; --i) {
+		int j = int(rnd.u64() % uint64_t(i + 1));
+		std::swap(pPnts[i], pPnts[j]);
+	}
+
+	WelzlSphere s;
+	s.c = pPnts[0];
+	s.r2 = 0.0;
+	for (int i = 1; i < numPts; ++i) {
+		if (!s.outside(pPnts[i])) { continue; }
+		s.c = pPnts[i];
+		s.r2 = 0.0;
+		for (int j = 0; j < i; ++j) {
+			if (!s.outside(pPnts[j])) { continue; }
+			s = welzl_sphere(pPnts[i], pPnts[j]);
+			for (int k = 0; k < j; ++k) {
+				if (!s.outside(pPnts[k])) { continue; }
+				s = welzl_sphere(pPnts[i], pPnts[j], pPnts[k]);
+				for (int l = 0; l < k; ++l) {
+					if (s.outside(pPnts[l])) {
+						s = welzl_sphere(pPnts[i], pPnts[j], pPnts[k], pPnts[l]);
+					}
+				}
+			}
+		}
+	}
+
+	c = GWVectorBase<T>(T(s.c.x), T(s.c.y), T(s.c.z));
+	GWVectorD cd(double(c.x), double(c.y), double(c.z));
+	double maxDistSq = 0.0;
+	for (int i = 0; i < numPts; ++i) {
+		maxDistSq = std::max(maxDistSq, (pPnts[i] - cd).length_sq());
+	}
+	double dist = std::sqrt(maxDistSq);
+	r = T(dist);
+	while (double(r) < dist) {
+		r = std::nextafter(r, r * T(2) + T(1));
+	}
+	GWSys::free_temp_mem(pPnts);
+}
+
+template void GWSphereBase<float>::welzl(const GWVectorBase<float>* pPnts, int numPts, uint64_t seed);
+template void GWSphereBase<double>::welzl(const GWVectorBase<double>* pPnts, int numPts, uint64_t seed);
@@ -32,8 +32,15 @@ template<typename T> struct GWSphereBase {
 		r = T(0);
 	}
 
-	void ritter(const GWVectorBase<T>* pPts, int numPts);
+	// Extreme points and the final radius come from the parallel reductions for floats, the growing pass is serial.
+	void ritter(const GWVectorBase<T>* pPts, int numPts, bool parallel = true);
+	// Same sphere as from the points in an array, float only.
+	void ritter(const GWSoA3& pts);
+	// The minimal enclosing sphere, expected linear time but several passes over the points; for offline use.
+	void welzl(const GWVectorBase<T>* pPts, int numPts, uint64_t seed = 1);
 };
 
+template<> void GWSphereBase<float>::ritter(const GWSoA3& pts);
+
 typedef GWSphereBase<float> GWSphereF;
 typedef GWSphereBase<double> GWSphereD;
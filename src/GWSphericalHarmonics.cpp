@@ -3,8 +3,10 @@
  * Author: Gleb Novodran <novodran@gmail.com>
  */
 
+#include <cstring>
 #include "GWSys.hpp"
 #include "GWBase.hpp"
+#include "GWTask.hpp"
 #include "GWVector.hpp"
 #include "GWMatrix.hpp"
 #include "GWQuaternion.hpp"
@@ -13,53 +15,133 @@
 #include "GWImage.hpp"
 #include "GWSphericalHarmonics.hpp"
 
-template<typename T> void GWSHCoeffsBase<T>::calc_pano(const GWImage* pImg) {
-	int w = pImg->get_width();
-	int h = pImg->get_height();
-	T da = T((2.0*T(GWBase::pi) / w) * (T(GWBase::pi) / h));
-	T dx[1];
-	T dy[1];
-	T dz[1];
+template<typename T> static T pairwise_sum(const T* pVal, int n) {
+	if (n <= 32) {
+		T sum = T(0);
+		for (int i = 0; i < n; ++i) {
+			sum += pVal[i];
+		}
+		return sum;
+	}
+	int half = n / 2;
+	return pairwise_sum(pVal, half) + pairwise_sum(pVal + half, n - half);
+}
 
-	T sum = T(0);
+template<typename T, int ORDER_T> template<typename FETCH_FUNC>
+void GWSHCoeffsBase<T, ORDER_T>::calc_pano(int w, int h, bool parallel, const FETCH_FUNC& fetch) {
+	const int NSUM = N * 3;
+	T* pRawCoefs = as_raw();
+	std::fill_n(pRawCoefs, NSUM, T(0));
+	if (w <= 0 || h <= 0) { return; }
+
+	T da = T((2.0*T(GWBase::pi) / w) * (T(GWBase::pi) / h));
 	T iw = T(1) / w;
 	T ih = T(1) / h;
 
-	T* pRawCoefs = as_raw();
-	std::fill_n(pRawCoefs, N*3, T(0));
-	T dirCoefs[N];
+	// the azimuth only depends on the column
+	T* pCosA = reinterpret_cast<T*>(GWSys::alloc_temp_mem(w * 2 * sizeof(T)));
+	T* pSinA = pCosA + w;
+	for (int x = 0; x < w; ++x) {
+		T u = (x + T(0.5f)) * iw;
+		T azimuth = u * T(2) * T(GWBase::pi);
+		pCosA[x] = std::cos(azimuth);
+		pSinA[x] = std::sin(azimuth);
+	}
 
-	for (int y = 0; y < h; ++y) {
-		T v = T(1) - (y + T(0.5f)) * ih;
-		T dw = da * std::sin(T(GWBase::pi) * v);
-		T inclination = (v - T(1)) * T(GWBase::pi);
-		T sinI = std::sin(inclination);
-		T cosI = std::cos(inclination);
-		for (int x = 0; x < w; ++x) {
-			T u = (x + T(0.5f)) * iw;
-			T azimuth = u * T(2) * T(GWBase::pi);
-			T sinA = std::sin(azimuth);
-			T cosA = std::cos(azimuth);
-			dx[0] = cosA * sinI;
-			dy[0] = cosI;
-			dz[0] = sinA * sinI;
-			GWSH::vec_project_i<T>(dirCoefs, dx, dy, dz, 1);
-
-			GWColorF pix = pImg->get_pixel(x, y);
+	T* pRowSums = reinterpret_cast<T*>(GWSys::alloc_temp_mem(h * NSUM * sizeof(T)));
+	auto proj_rows = [&](int y0, int y1) {
+		T* pDir = reinterpret_cast<T*>(GWSys::alloc_temp_mem(w * (N + 4) * sizeof(T)));
+		T* pDX = pDir + N * w;
+		T* pDY = pDX + w;
+		T* pDZ = pDY + w;
+		T* pProd = pDZ + w;
+		float* pRGBA = reinterpret_cast<float*>(GWSys::alloc_temp_mem(w * 4 * sizeof(float)));
+		T* pClr = reinterpret_cast<T*>(GWSys::alloc_temp_mem(w * 3 * sizeof(T)));
+		for (int y = y0; y < y1; ++y) {
+			T v = T(1) - (y + T(0.5f)) * ih;
+			T dw = da * std::sin(T(GWBase::pi) * v);
+			T inclination = (v - T(1)) * T(GWBase::pi);
+			T sinI = std::sin(inclination);
+			T cosI = std::cos(inclination);
+			for (int x = 0; x < w; ++x) {
+				pDX[x] = pCosA[x] * sinI;
+				pDY[x] = cosI;
+				pDZ[x] = pSinA[x] * sinI;
+			}
+			GWSH::vec_project<T, ORDER>(pDir, pDX, pDY, pDZ, w);
+
+			fetch(y, pRGBA);
+			for (int j = 0; j < 3; ++j) {
+				T* pDst = &pClr[j * w];
+				for (int x = 0; x < w; ++x) {
+					pDst[x] = T(pRGBA[x * 4 + j]);
+				}
+			}
+
+			T* pSum = &pRowSums[y * NSUM];
 			for (int i = 0; i < N; ++i) {
-				T sw = dirCoefs[i] * dw;
+				const T* pCoef = &pDir[i * w];
 				for (int j = 0; j < 3; ++j) {
-					mCoef[i][j] += pix[j] * sw;
+					const T* pSrc = &pClr[j * w];
+					for (int x = 0; x < w; ++x) {
+						pProd[x] = pCoef[x] * pSrc[x];
+					}
+					pSum[i * 3 + j] = pairwise_sum(pProd, w) * dw;
 				}
 			}
 		}
+		GWSys::free_temp_mem(pClr);
+		GWSys::free_temp_mem(pRGBA);
+		GWSys::free_temp_mem(pDir);
+	};
+	if (parallel) {
+		GWTask::parallel_for(h, proj_rows);
+	} else {
+		proj_rows(0, h);
+	}
+
+	// the row sums are folded in halves
+	for (int n = h; n > 1;) {
+		int half = (n + 1) / 2;
+		for (int y = 0; y < n - half; ++y) {
+			T* pDst = &pRowSums[y * NSUM];
+			const T* pSrc = &pRowSums[(y + half) * NSUM];
+			for (int i = 0; i < NSUM; ++i) {
+				pDst[i] += pSrc[i];
+			}
+		}
+		n = half;
 	}
+	std::copy_n(pRowSums, NSUM, pRawCoefs);
+
+	GWSys::free_temp_mem(pRowSums);
+	GWSys::free_temp_mem(pCosA);
 }
 
-template void GWSHCoeffsBase<float>::calc_pano(const GWImage* pImg);
-template void GWSHCoeffsBase<double>::calc_pano(const GWImage* pImg);
+template<typename T, int ORDER_T> void GWSHCoeffsBase<T, ORDER_T>::calc_pano(const GWImage* pImg, bool parallel) {
+	int w = pImg->get_width();
+	const GWColorF* pPix = pImg->get_pixels();
+	calc_pano(w, pImg->get_height(), parallel, [w, pPix](int y, float* pRGBA) {
+		std::memcpy(pRGBA, &pPix[y * w], w * sizeof(GWColorF));
+	});
+}
+
+template<typename T, int ORDER_T> void GWSHCoeffsBase<T, ORDER_T>::calc_pano(const GWHalf4* pPix, int w, int h, bool parallel) {
+	calc_pano(w, h, parallel, [w, pPix](int y, float* pRGBA) {
+		GWBase::half_to_float(pRGBA, reinterpret_cast<const uint16_t*>(&pPix[y * w]), w * 4);
+	});
+}
 
-template<typename T> void GWSHCoeffsBase<T>::synth_pano(GWImage * pImg) const {
+template<typename T, int ORDER_T> void GWSHCoeffsBase<T, ORDER_T>::calc_pano(const uint32_t* pPix, int w, int h, bool parallel) {
+	calc_pano(w, h, parallel, [w, pPix](int y, float* pRGBA) {
+		const uint8_t* pSrc = reinterpret_cast<const uint8_t*>(&pPix[y * w]);
+		for (int i = 0; i < w * 4; ++i) {
+			pRGBA[i] = float(pSrc[i]) * (1.0f / 255.0f);
+		}
+	});
+}
+
+template<typename T, int ORDER_T> void GWSHCoeffsBase<T, ORDER_T>::synth_pano(GWImage * pImg, GWMathTier tier) const {
 	int w = pImg->get_width();
 	int h = pImg->get_height();
 	T da = T((2.0*T(GWBase::pi) / w) * (T(GWBase::pi) / h));
@@ -75,13 +157,13 @@ template<typename T> void GWSHCoeffsBase<T>::synth_pano(GWImage * pImg) const {
 		T v = T(1) - (y + T(0.5f)) * ih;
 		T dw = da * std::sin(T(GWBase::pi) * v);
 		T inclination = (v - T(1)) * T(GWBase::pi);
-		T sinI = std::sin(inclination);
-		T cosI = std::cos(inclination);
+		T sinI, cosI;
+		GWBase::approx_sincos(inclination, sinI, cosI, tier);
 		for (int x = 0; x < w; ++x) {
 			T u = (x + T(0.5f)) * iw;
 			T azimuth = u * T(2) * T(GWBase::pi);
-			T sinA = std::sin(azimuth);
-			T cosA = std::cos(azimuth);
+			T sinA, cosA;
+			GWBase::approx_sincos(azimuth, sinA, cosA, tier);
 			dx = cosA * sinI;
 			dy = cosI;
 			dz = sinA * sinI;
@@ -95,5 +177,290 @@ template<typename T> void GWSHCoeffsBase<T>::synth_pano(GWImage * pImg) const {
 	}
 }
 
-template void GWSHCoeffsBase<float>::synth_pano(GWImage * pImg) const;
-template void GWSHCoeffsBase<double>::synth_pano(GWImage * pImg) const;
+// Band l of the rotation matrices starts at band_offs(l), the rows and columns run over m = -l..l.
+static int band_offs(int l) { return l * (2 * l - 1) * (2 * l + 1) / 3; }
+
+template<typename T, int ORDER_T> void GWSHCoeffsBase<T, ORDER_T>::calc_rotation(T* pMtx, const GWVectorBase<T>* pAxes) {
+	auto rm = [pMtx](int l, int m, int n) -> T& { return pMtx[band_offs(l) + (m + l) * (2 * l + 1) + n + l]; };
+	// the recurrence works on the basis without the Condon-Shortley phase, band 1 is (y, z, x)
+	static const int axisMap[3] = { 1, 2, 0 };
+	rm(0, 0, 0) = T(1);
+	if (ORDER < 2) { return; }
+	for (int m = -1; m <= 1; ++m) {
+		for (int n = -1; n <= 1; ++n) {
+			rm(1, m, n) = pAxes[axisMap[n + 1]][axisMap[m + 1]];
+		}
+	}
+	auto P = [&rm](int i, int l, int a, int b) -> T {
+		if (b == l) {
+			return rm(1, i, 1) * rm(l - 1, a, l - 1) - rm(1, i, -1) * rm(l - 1, a, 1 - l);
+		} else if (b == -l) {
+			return rm(1, i, 1) * rm(l - 1, a, 1 - l) + rm(1, i, -1) * rm(l - 1, a, l - 1);
+		}
+		return rm(1, i, 0) * rm(l - 1, a, b);
+	};
+	for (int l = 2; l < ORDER; ++l) {
+		for (int m = -l; m <= l; ++m) {
+			int am = m < 0 ? -m : m;
+			T d = T(m == 0 ? 1 : 0);
+			for (int n = -l; n <= l; ++n) {
+				T denom = (n == l || n == -l) ? T(2 * l * (2 * l - 1)) : T((l + n) * (l - n));
+				T u = std::sqrt(T((l + m) * (l - m)) / denom);
+				T v = T(0.5) * std::sqrt((T(1) + d) * T((l + am - 1) * (l + am)) / denom) * (T(1) - T(2) * d);
+				T w = T(-0.5) * std::sqrt(T((l - am - 1) * (l - am)) / denom) * (T(1) - d);
+				T val = T(0);
+				if (u != T(0)) {
+					val += u * P(0, l, m, n);
+				}
+				if (v != T(0)) {
+					if (m == 0) {
+						val += v * (P(1, l, 1, n) + P(-1, l, -1, n));
+					} else if (m > 0) {
+						T dm = T(m == 1 ? 1 : 0);
+						val += v * (P(1, l, m - 1, n) * std::sqrt(T(1) + dm) - P(-1, l, 1 - m, n) * (T(1) - dm));
+					} else {
+						T dm = T(m == -1 ? 1 : 0);
+						val += v * (P(1, l, m + 1, n) * (T(1) - dm) + P(-1, l, -m - 1, n) * std::sqrt(T(1) + dm));
+					}
+				}
+				if (w != T(0)) {
+					if (m > 0) {
+						val += w * (P(1, l, m + 1, n) + P(-1, l, -m - 1, n));
+					} else {
+						val += w * (P(1, l, m - 1, n) - P(-1, l, 1 - m, n));
+					}
+				}
+				rm(l, m, n) = val;
+			}
+		}
+	}
+	// back to the basis of vec_project, where the odd m functions change sign
+	for (int l = 1; l < ORDER; ++l) {
+		for (int m = -l; m <= l; ++m) {
+			for (int n = -l; n <= l; ++n) {
+				if ((m + n) & 1) {
+					rm(l, m, n) = -rm(l, m, n);
+				}
+			}
+		}
+	}
+}
+
+template<typename T, int ORDER_T> void GWSHCoeffsBase<T, ORDER_T>::rotate(GWSHCoeffsBase* pCoefs, int num, const T* pMtx, bool parallel) {
+	auto rotate_sets = [pCoefs, pMtx](int i0, int i1) {
+		GWColorTuple3<T> src[2 * ORDER - 1];
+		for (int i = i0; i < i1; ++i) {
+			GWColorTuple3<T>* pCoef = pCoefs[i].mCoef;
+			for (int l = 1; l < ORDER; ++l) {
+				int dim = 2 * l + 1;
+				const T* pBand = &pMtx[band_offs(l)];
+				GWColorTuple3<T>* pDst = &pCoef[get_coef_num(l)];
+				for (int m = 0; m < dim; ++m) {
+					src[m] = pDst[m];
+				}
+				for (int m = 0; m < dim; ++m) {
+					GWTuple::fill(pDst[m], T(0));
+					for (int n = 0; n < dim; ++n) {
+						GWTuple::add_scaled(pDst[m], src[n], pBand[m * dim + n]);
+					}
+				}
+			}
+		}
+	};
+	if (parallel) {
+		GWTask::parallel_for(num, rotate_sets);
+	} else {
+		rotate_sets(0, num);
+	}
+}
+
+template<typename T, int ORDER_T> void GWSHCoeffsBase<T, ORDER_T>::rotate(GWSHCoeffsBase* pCoefs, int num, const GWQuaternionBase<T>& q, bool parallel) {
+	if (!pCoefs || num <= 0) { return; }
+	GWVectorBase<T> axes[3] = { q.calc_axis_x(), q.calc_axis_y(), q.calc_axis_z() };
+	T mtx[ROT_SIZE];
+	calc_rotation(mtx, axes);
+	rotate(pCoefs, num, mtx, parallel);
+}
+
+template<typename T, int ORDER_T> void GWSHCoeffsBase<T, ORDER_T>::rotate(GWSHCoeffsBase* pCoefs, int num, const GWTransform<T>& xform, bool parallel) {
+	if (!pCoefs || num <= 0) { return; }
+	GWVectorBase<T> axes[3] = {
+		xform.calc_vec(GWVectorBase<T>(1, 0, 0)),
+		xform.calc_vec(GWVectorBase<T>(0, 1, 0)),
+		xform.calc_vec(GWVectorBase<T>(0, 0, 1))
+	};
+	T mtx[ROT_SIZE];
+	calc_rotation(mtx, axes);
+	rotate(pCoefs, num, mtx, parallel);
+}
+
+template class GWSHCoeffsBase<float, 3>;
+template class GWSHCoeffsBase<double, 3>;
+template class GWSHCoeffsBase<float, 4>;
+template class GWSHCoeffsBase<double, 4>;
+template class GWSHCoeffsBase<float, 5>;
+template class GWSHCoeffsBase<double, 5>;
+template class GWSHCoeffsBase<float, 6>;
+template class GWSHCoeffsBase<double, 6>;
+template class GWSHCoeffsBase<float, 7>;
+template class GWSHCoeffsBase<double, 7>;
+template class GWSHCoeffsBase<float, 8>;
+template class GWSHCoeffsBase<double, 8>;
+
+namespace GWSH {
+
+	const int ProbeGrid::EVAL_BLOCK;
+
+	ProbeGrid* ProbeGrid::create(const GWVectorF& bbMin, const GWVectorF& bbMax, const int res[3], ProbeStorage storage) {
+		for (int i = 0; i < 3; ++i) {
+			if (res[i] < 1) { return nullptr; }
+		}
+		int nprobe = res[0] * res[1] * res[2];
+		int stride = int(GWBase::align(uintptr_t(nprobe), 0x10));
+		size_t elemSize = storage == ProbeStorage::HALF ? sizeof(uint16_t) : sizeof(float);
+		size_t memSize = sizeof(ProbeGrid) + 0x40 + stride * NUM_CHANNELS * elemSize;
+		char* pMem = reinterpret_cast<char*>(GWSys::alloc_rsrc_mem(memSize));
+		if (!pMem) { return nullptr; }
+		ProbeGrid* pGrid = reinterpret_cast<ProbeGrid*>(pMem);
+		pGrid->mOrg = bbMin;
+		for (int i = 0; i < 3; ++i) {
+			pGrid->mRes[i] = res[i];
+			float size = res[i] > 1 ? (bbMax[i] - bbMin[i]) / float(res[i] - 1) : 0.0f;
+			pGrid->mCellSize[i] = size;
+			pGrid->mInvCellSize[i] = size > 0.0f ? 1.0f / size : 0.0f;
+		}
+		pGrid->mStride = stride;
+		pGrid->mStorage = storage;
+		pGrid->mpData = reinterpret_cast<void*>(GWBase::align(reinterpret_cast<uintptr_t>(pMem + sizeof(ProbeGrid)), 0x40));
+		std::memset(pGrid->mpData, 0, stride * NUM_CHANNELS * elemSize);
+		return pGrid;
+	}
+
+	void ProbeGrid::destroy(ProbeGrid* pGrid) {
+		if (pGrid) {
+			GWSys::free_rsrc_mem(pGrid);
+		}
+	}
+
+	void ProbeGrid::set_probe(int ix, int iy, int iz, const GWSHCoeffsF& coefs, float scl) {
+		GWSHCoeffsF irr = coefs;
+		float wgt[3];
+		calc_irradiance_weights(wgt, scl);
+		irr.apply_weights(wgt);
+		const float* pSrc = irr.as_raw();
+		int idx = get_probe_idx(ix, iy, iz);
+		for (int c = 0; c < NUM_CHANNELS; ++c) {
+			if (mStorage == ProbeStorage::HALF) {
+				GWBase::float_to_half(&reinterpret_cast<uint16_t*>(mpData)[c * mStride + idx], &pSrc[c], 1);
+			} else {
+				reinterpret_cast<float*>(mpData)[c * mStride + idx] = pSrc[c];
+			}
+		}
+	}
+
+	GWSHCoeffsF ProbeGrid::get_probe(int ix, int iy, int iz) const {
+		GWSHCoeffsF coefs;
+		float* pDst = coefs.as_raw();
+		int idx = get_probe_idx(ix, iy, iz);
+		for (int c = 0; c < NUM_CHANNELS; ++c) {
+			if (mStorage == ProbeStorage::HALF) {
+				GWBase::half_to_float(&pDst[c], &reinterpret_cast<const uint16_t*>(mpData)[c * mStride + idx], 1);
+			} else {
+				pDst[c] = reinterpret_cast<const float*>(mpData)[c * mStride + idx];
+			}
+		}
+		return coefs;
+	}
+
+	GWColorTuple3f ProbeGrid::eval(const GWVectorF& pos, const GWVectorF& nrm) const {
+		GWColorTuple3f irr;
+		eval(&pos, &nrm, &irr, 1, false);
+		return irr;
+	}
+
+	void ProbeGrid::eval(const GWVectorF* pPos, const GWVectorF* pNrm, GWColorTuple3f* pIrr, int num, bool parallel) const {
+		if (!pPos || !pNrm || !pIrr || num <= 0) { return; }
+		// each block gathers the 8 corners of every query channel by channel,
+		// the basis is evaluated for the whole block in the array form
+		auto eval_blocks = [&](int b0, int b1) {
+			int32_t idx[8][EVAL_BLOCK];
+			float wgt[8][EVAL_BLOCK];
+			float corner[8][EVAL_BLOCK];
+			uint16_t cornerHalf[8][EVAL_BLOCK];
+			float nx[EVAL_BLOCK];
+			float ny[EVAL_BLOCK];
+			float nz[EVAL_BLOCK];
+			float basis[NUM_COEFS * EVAL_BLOCK];
+			float acc[3][EVAL_BLOCK];
+			for (int blk = b0; blk < b1; ++blk) {
+				int q0 = blk * EVAL_BLOCK;
+				int nq = std::min(EVAL_BLOCK, num - q0);
+				for (int q = 0; q < nq; ++q) {
+					const GWVectorF& pos = pPos[q0 + q];
+					int i0[3];
+					int i1[3];
+					float f[3];
+					for (int k = 0; k < 3; ++k) {
+						float g = GWBase::clamp((pos[k] - mOrg[k]) * mInvCellSize[k], 0.0f, float(mRes[k] - 1));
+						i0[k] = std::min(int(g), mRes[k] - 1);
+						i1[k] = std::min(i0[k] + 1, mRes[k] - 1);
+						f[k] = g - float(i0[k]);
+					}
+					for (int c = 0; c < 8; ++c) {
+						int cx = c & 1 ? i1[0] : i0[0];
+						int cy = c & 2 ? i1[1] : i0[1];
+						int cz = c & 4 ? i1[2] : i0[2];
+						idx[c][q] = get_probe_idx(cx, cy, cz);
+						wgt[c][q] = (c & 1 ? f[0] : 1.0f - f[0]) * (c & 2 ? f[1] : 1.0f - f[1]) * (c & 4 ? f[2] : 1.0f - f[2]);
+					}
+					nx[q] = pNrm[q0 + q].x;
+					ny[q] = pNrm[q0 + q].y;
+					nz[q] = pNrm[q0 + q].z;
+				}
+				vec_project_i(basis, nx, ny, nz, nq);
+				for (int j = 0; j < 3; ++j) {
+					std::fill_n(acc[j], nq, 0.0f);
+				}
+				for (int ch = 0; ch < NUM_CHANNELS; ++ch) {
+					if (mStorage == ProbeStorage::HALF) {
+						const uint16_t* pSrc = &reinterpret_cast<const uint16_t*>(mpData)[ch * mStride];
+						for (int c = 0; c < 8; ++c) {
+							for (int q = 0; q < nq; ++q) {
+								cornerHalf[c][q] = pSrc[idx[c][q]];
+							}
+							GWBase::half_to_float(corner[c], cornerHalf[c], nq);
+						}
+					} else {
+						const float* pSrc = &reinterpret_cast<const float*>(mpData)[ch * mStride];
+						for (int c = 0; c < 8; ++c) {
+							for (int q = 0; q < nq; ++q) {
+								corner[c][q] = pSrc[idx[c][q]];
+							}
+						}
+					}
+					const float* pBasis = &basis[(ch / 3) * nq];
+					float* pAcc = acc[ch % 3];
+					for (int q = 0; q < nq; ++q) {
+						float val = 0.0f;
+						for (int c = 0; c < 8; ++c) {
+							val += corner[c][q] * wgt[c][q];
+						}
+						pAcc[q] += val * pBasis[q];
+					}
+				}
+				for (int q = 0; q < nq; ++q) {
+					GWColorTuple3f& irr = pIrr[q0 + q];
+					for (int j = 0; j < 3; ++j) {
+						irr[j] = acc[j][q];
+					}
+				}
+			}
+		};
+		int nblk = (num + EVAL_BLOCK - 1) / EVAL_BLOCK;
+		if (parallel) {
+			GWTask::parallel_for(nblk, eval_blocks);
+		} else {
+			eval_blocks(0, nblk);
+		}
+	}
+}
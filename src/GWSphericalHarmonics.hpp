@@ -67,37 +67,176 @@ namespace GWSH {
 		}
 	}
 
-	template <typename T> inline
+	constexpr int get_idx(int l, int m) { return l*(l + 1) + m; }
+	constexpr int get_coef_num(int order) { return order*order; }
+
+	// Compile-time constants of the basis for any order, C++11 constexpr has to do with recursion.
+	constexpr double const_fact_ratio(int a, int b) { return a <= b ? 1.0 : double(a) * const_fact_ratio(a - 1, b); }
+	constexpr double const_double_fact(int n) { return n <= 1 ? 1.0 : double(n) * const_double_fact(n - 2); }
+	constexpr double const_sqrt_iter(double x, double g, int n) { return n <= 0 ? g : const_sqrt_iter(x, 0.5 * (g + x / g), n - 1); }
+	constexpr double const_sqrt(double x) { return x <= 0.0 ? 0.0 : const_sqrt_iter(x, x > 1.0 ? x : 1.0, 64); }
+	// P(m, m) of the associated Legendre functions with the (1 - z^2)^(m/2) factor taken out
+	constexpr double legendre_mm(int m) { return (m & 1 ? -1.0 : 1.0) * const_double_fact(2 * m - 1); }
+	// normalization of the real basis functions, sqrt(2) is folded in for m > 0
+	constexpr double basis_norm(int l, int m) {
+		return const_sqrt((m ? 2.0 : 1.0) * double(2 * l + 1) / (4.0 * 3.14159265358979323846) / const_fact_ratio(l + m, l - m));
+	}
+
+	// Band m of the basis up to ORDER in the array form. The cos(m*phi) and sin(m*phi) terms times sin(theta)^m
+	// are the polynomials C(m) = x*C(m-1) - y*S(m-1) and S(m) = x*S(m-1) + y*C(m-1), they are kept in the
+	// (m, m) and (m, -m) rows until the band is scaled, the next band takes them back from the scaled rows.
+	template <typename T, int ORDER, int L, int M> struct BasisLegendre {
+		static GW_FORCEINLINE void calc(T* pCoefs, const T z[], const int N) {
+			T* pDst = &pCoefs[get_idx(L, M) * N];
+			if (L == M + 1) {
+				const T a = T(double(2 * M + 1) * legendre_mm(M));
+				for (int i = 0; i < N; ++i) {
+					pDst[i] = z[i] * a;
+				}
+			} else {
+				const T a = T(double(2 * L - 1) / double(L - M));
+				const T b = T(double(L + M - 1) / double(L - M));
+				const T* pP1 = &pCoefs[get_idx(L - 1, M) * N];
+				if (L == M + 2) {
+					const T c = b * T(legendre_mm(M));
+					for (int i = 0; i < N; ++i) {
+						pDst[i] = a * z[i] * pP1[i] - c;
+					}
+				} else {
+					const T* pP0 = &pCoefs[get_idx(L - 2, M) * N];
+					for (int i = 0; i < N; ++i) {
+						pDst[i] = a * z[i] * pP1[i] - b * pP0[i];
+					}
+				}
+			}
+			BasisLegendre<T, ORDER, L + 1, M>::calc(pCoefs, z, N);
+		}
+	};
+	template <typename T, int ORDER, int M> struct BasisLegendre<T, ORDER, ORDER, M> {
+		static GW_FORCEINLINE void calc(T*, const T[], const int) {}
+	};
+
+	template <typename T, int ORDER, int L, int M> struct BasisScale {
+		static GW_FORCEINLINE void calc(T* pCoefs, const int N) {
+			const T k = T(basis_norm(L, M));
+			T* pDst = &pCoefs[get_idx(L, M) * N];
+			if (M == 0) {
+				for (int i = 0; i < N; ++i) {
+					pDst[i] *= k;
+				}
+			} else {
+				const T* pC = &pCoefs[get_idx(M, M) * N];
+				const T* pS = &pCoefs[get_idx(M, -M) * N];
+				T* pNeg = &pCoefs[get_idx(L, -M) * N];
+				for (int i = 0; i < N; ++i) {
+					pNeg[i] = pDst[i] * pS[i] * k;
+				}
+				for (int i = 0; i < N; ++i) {
+					pDst[i] *= pC[i] * k;
+				}
+			}
+			BasisScale<T, ORDER, L + 1, M>::calc(pCoefs, N);
+		}
+	};
+	template <typename T, int ORDER, int M> struct BasisScale<T, ORDER, ORDER, M> {
+		static GW_FORCEINLINE void calc(T*, const int) {}
+	};
+
+	template <typename T, int ORDER, int M> struct BasisBand {
+		static GW_FORCEINLINE void calc(T* pCoefs, const T x[], const T y[], const T z[], const int N) {
+			T* pC = &pCoefs[get_idx(M, M) * N];
+			T* pS = &pCoefs[get_idx(M, -M) * N];
+			if (M == 1) {
+				for (int i = 0; i < N; ++i) {
+					pC[i] = x[i];
+				}
+				for (int i = 0; i < N; ++i) {
+					pS[i] = y[i];
+				}
+			} else if (M > 1) {
+				const T s = T(1.0 / (basis_norm(M - 1, M - 1) * legendre_mm(M - 1)));
+				const T* pPrevC = &pCoefs[get_idx(M - 1, M - 1) * N];
+				const T* pPrevS = &pCoefs[get_idx(M - 1, 1 - M) * N];
+				for (int i = 0; i < N; ++i) {
+					T c = pPrevC[i] * s;
+					T sn = pPrevS[i] * s;
+					pC[i] = x[i] * c - y[i] * sn;
+					pS[i] = x[i] * sn + y[i] * c;
+				}
+			}
+			BasisLegendre<T, ORDER, M + 1, M>::calc(pCoefs, z, N);
+			BasisScale<T, ORDER, M + 1, M>::calc(pCoefs, N);
+			const T k = T(basis_norm(M, M) * legendre_mm(M));
+			if (M == 0) {
+				for (int i = 0; i < N; ++i) {
+					pC[i] = k;
+				}
+			} else {
+				for (int i = 0; i < N; ++i) {
+					pC[i] *= k;
+				}
+				for (int i = 0; i < N; ++i) {
+					pS[i] *= k;
+				}
+			}
+			BasisBand<T, ORDER, M + 1>::calc(pCoefs, x, y, z, N);
+		}
+	};
+	template <typename T, int ORDER> struct BasisBand<T, ORDER, ORDER> {
+		static GW_FORCEINLINE void calc(T*, const T[], const T[], const T[], const int) {}
+	};
+
+	template <typename T, int ORDER> struct Basis {
+		static GW_FORCEINLINE void project(T* pCoefs, const T x[], const T y[], const T z[], const int N) {
+			BasisBand<T, ORDER, 0>::calc(pCoefs, x, y, z, N);
+		}
+	};
+	// the hand-expanded form stays for the common order
+	template <typename T> struct Basis<T, 3> {
+		static GW_FORCEINLINE void project(T* pCoefs, const T x[], const T y[], const T z[], const int N) {
+			vec_project_i(pCoefs, x, y, z, N);
+		}
+	};
+
+	// pCoefs holds get_coef_num(ORDER) rows of N values
+	template <typename T, int ORDER = 3> inline
 	void vec_project(T* pCoefs, const T x[], const T y[], const T z[], const int N = 1) {
-		vec_project_i(pCoefs, x, y, z, N);
+		Basis<T, ORDER>::project(pCoefs, x, y, z, N);
 	}
 
 	template <typename T> inline
-	void calc_phong_weights(T* pWgt, T s, T scl) {
+	void calc_phong_weights(T* pWgt, T s, T scl, int order = 3) {
 		if (pWgt) {
-			for (int i = 0; i < 3; ++i) {
+			for (int i = 0; i < order; ++i) {
 				pWgt[i] = std::exp(float(-i * i) / (T(2) * s)) * scl;
 			}
 		}
 	}
 
+	// Bands of the clamped cosine lobe relative to the first one, zero for the odd bands past the second.
 	template <typename T> inline
-	void calc_irradiance_weights(T* pWgt, T scl) {
+	void calc_irradiance_weights(T* pWgt, T scl, int order = 3) {
 		if (pWgt) {
-			std::fill_n(pWgt, 3, T(0));
+			std::fill_n(pWgt, order, T(0));
 			pWgt[0] = scl;
-			pWgt[1] = scl / T(1.5f);
-			pWgt[2] = scl / T(4);
+			if (order > 1) {
+				pWgt[1] = scl / T(1.5f);
+			}
+			for (int l = 2; l < order; l += 2) {
+				double w = 2.0 / (double(l + 2) * double(l - 1)) * const_fact_ratio(l, l / 2) / (std::pow(2.0, l) * const_fact_ratio(l / 2, 0));
+				pWgt[l] = T((l & 2 ? w : -w) * scl);
+			}
 		}
 	}
 
 }
-template<typename T> class GWSHCoeffsBase {
-protected:
-	static const int ORDER = 3;
+template<typename T, int ORDER_T = 3> class GWSHCoeffsBase {
+public:
+	static const int ORDER = ORDER_T;
 
-	static constexpr int get_idx(int l, int m) { return l*(l + 1) + m; }
-	static constexpr int get_coef_num(int order) { return order*order; }
+protected:
+	static constexpr int get_idx(int l, int m) { return GWSH::get_idx(l, m); }
+	static constexpr int get_coef_num(int order) { return GWSH::get_coef_num(order); }
 	static constexpr int N = get_coef_num(ORDER);
 
 	GWColorTuple3<T> mCoef[N];
@@ -135,11 +274,16 @@ public:
 		}
 	}
 
-	void lerp(GWSHCoeffsBase<T>& coefA, GWSHCoeffsBase<T>& coefB, T t);
+	void lerp(GWSHCoeffsBase& coefA, GWSHCoeffsBase& coefB, T t);
 
 	void calc_const(const GWColorF& clr);
 	void calc_dir(const GWColorF& clr, const GWVectorBase<T>& dir);
-	void calc_pano(const GWImage* pImg);
+	// Projection of an equirectangular panorama. Every row is projected as a whole and the rows are summed
+	// pairwise, so the result doesn't depend on the parallel flag.
+	void calc_pano(const GWImage* pImg, bool parallel = true);
+	void calc_pano(const GWHalf4* pPix, int w, int h, bool parallel = true);
+	// 8-bit channels scaled to [0, 1] as by GWColorF::decode_rgba8
+	void calc_pano(const uint32_t* pPix, int w, int h, bool parallel = true);
 
 	GWColorTuple3<T> synthesize(T x, T y, T z) const {
 		T nx[1] = { x };
@@ -147,7 +291,7 @@ public:
 		T nz[1] = { z };
 		T dirCoefs[N];
 
-		GWSH::vec_project<T>(dirCoefs, nx, ny, nz, 1);
+		GWSH::vec_project<T, ORDER>(dirCoefs, nx, ny, nz, 1);
 
 		GWColorTuple3<T> clr;
 		GWTuple::fill(clr, T(0));
@@ -158,8 +302,77 @@ public:
 		return clr;
 	}
 
-	void synth_pano(GWImage* pImg) const;
+	// tier : accuracy of the per-pixel direction, see GWMathTier
+	void synth_pano(GWImage* pImg, GWMathTier tier = GWMathTier::FULL) const;
+
+	// Rotates the lighting: the result in direction d is the source in the inverse rotation of d.
+	// The band matrices are built by the Ivanic-Ruedenberg recurrence and applied in O(ORDER^3).
+	void rotate(const GWQuaternionBase<T>& q) { rotate(this, 1, q, false); }
+	// the rotation part of xform is expected to be orthonormal
+	void rotate(const GWTransform<T>& xform) { rotate(this, 1, xform, false); }
+	// many sets with the same rotation, the matrices are built once
+	static void rotate(GWSHCoeffsBase* pCoefs, int num, const GWQuaternionBase<T>& q, bool parallel = true);
+	static void rotate(GWSHCoeffsBase* pCoefs, int num, const GWTransform<T>& xform, bool parallel = true);
+
+private:
+	static const int ROT_SIZE = ORDER * (2 * ORDER - 1) * (2 * ORDER + 1) / 3;
+
+	// pAxes are the rotated x, y and z axes
+	static void calc_rotation(T* pMtx, const GWVectorBase<T>* pAxes);
+	static void rotate(GWSHCoeffsBase* pCoefs, int num, const T* pMtx, bool parallel);
+
+	// fetch(y, pRGBA) fills the row with w RGBA pixels
+	template<typename FETCH_FUNC> void calc_pano(int w, int h, bool parallel, const FETCH_FUNC& fetch);
 };
 
 typedef GWSHCoeffsBase<float> GWSHCoeffsF;
 typedef GWSHCoeffsBase<double> GWSHCoeffsD;
+
+namespace GWSH {
+	enum class ProbeStorage : uint8_t {
+		FLOAT = 0,
+		HALF = 1
+	};
+
+	// Order 3 probes on a regular grid, probe (ix, iy, iz) sits at mOrg + (ix, iy, iz) * mCellSize.
+	// The coefficients are kept with the irradiance weights applied, as channel arrays over all the probes:
+	// channel c = coef * 3 + rgb, which is the layout of GWSHCoeffsF::as_raw.
+	class ProbeGrid {
+	public:
+		static const int NUM_COEFS = 9;
+		static const int NUM_CHANNELS = NUM_COEFS * 3;
+		static const int EVAL_BLOCK = 64;
+
+		GWVectorF mOrg;
+		GWVectorF mCellSize;
+		GWVectorF mInvCellSize; // 0 along the axes with a single probe
+		int32_t mRes[3];
+		int32_t mStride; // probes per channel, padded
+		ProbeStorage mStorage;
+		void* mpData;
+
+	private:
+		ProbeGrid() {}
+
+	public:
+		int get_num_probes() const { return mRes[0] * mRes[1] * mRes[2]; }
+		int get_probe_idx(int ix, int iy, int iz) const { return (iz * mRes[1] + iy) * mRes[0] + ix; }
+		GWVectorF get_probe_pos(int ix, int iy, int iz) const {
+			return mOrg + GWVectorF(float(ix), float(iy), float(iz)) * mCellSize;
+		}
+
+		// Radiance coefficients in, irradiance weights applied by calc_irradiance_weights with scl.
+		void set_probe(int ix, int iy, int iz, const GWSHCoeffsF& coefs, float scl = 1.0f);
+		// the stored, weighted coefficients
+		GWSHCoeffsF get_probe(int ix, int iy, int iz) const;
+
+		// Irradiance for unit normals at the positions, trilinear between the probes and clamped to the grid.
+		// The result isn't clipped to positive values.
+		GWColorTuple3f eval(const GWVectorF& pos, const GWVectorF& nrm) const;
+		void eval(const GWVectorF* pPos, const GWVectorF* pNrm, GWColorTuple3f* pIrr, int num, bool parallel = true) const;
+
+		// res >= 1 along every axis
+		static ProbeGrid* create(const GWVectorF& bbMin, const GWVectorF& bbMax, const int res[3], ProbeStorage storage = ProbeStorage::FLOAT);
+		static void destroy(ProbeGrid* pGrid);
+	};
+}
@@ -0,0 +1,162 @@
+/*
+ * Author: Gleb Novodran <novodran@gmail.com>
+ */
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <vector>
+#include <algorithm>
+
+#include "GWSys.hpp"
+#include "GWTask.hpp"
+
+namespace GWTask {
+
+	struct Job {
+		RangeFunc mpFunc;
+		void* mpCtx;
+		int mCount;
+		int mGrain;
+		std::atomic<int> mNext;
+		std::atomic<int> mDone;
+	};
+
+	static thread_local bool s_inTask = false;
+
+	static void exec_job(Job* pJob) {
+		bool inTask = s_inTask;
+		s_inTask = true;
+		while (true) {
+			int begin = pJob->mNext.fetch_add(pJob->mGrain);
+			if (begin >= pJob->mCount) { break; }
+			int end = std::min(begin + pJob->mGrain, pJob->mCount);
+			pJob->mpFunc(pJob->mpCtx, begin, end);
+			pJob->mDone.fetch_add(end - begin);
+		}
+		s_inTask = inTask;
+	}
+
+	class Pool {
+	protected:
+		std::vector<std::thread> mWorkers;
+		std::mutex mMtx;
+		std::condition_variable mWakeCV;
+		std::condition_variable mDoneCV;
+		std::mutex mJobMtx;
+		Job* mpJob;
+		uint64_t mGen;
+		int mNumBusy;
+		bool mQuit;
+
+		void worker_loop() {
+			uint64_t gen = 0;
+			std::unique_lock<std::mutex> lock(mMtx);
+			while (true) {
+				mWakeCV.wait(lock, [&] { return mQuit || (mpJob != nullptr && mGen != gen); });
+				if (mQuit) { break; }
+				gen = mGen;
+				Job* pJob = mpJob;
+				++mNumBusy;
+				lock.unlock();
+				exec_job(pJob);
+				lock.lock();
+				--mNumBusy;
+				mDoneCV.notify_all();
+			}
+		}
+
+	public:
+		Pool(int numWorkers) : mpJob(nullptr), mGen(0), mNumBusy(0), mQuit(false) {
+			for (int i = 0; i < numWorkers; ++i) {
+				mWorkers.push_back(std::thread(&Pool::worker_loop, this));
+			}
+		}
+
+		~Pool() {
+			{
+				std::lock_guard<std::mutex> lock(mMtx);
+				mQuit = true;
+			}
+			mWakeCV.notify_all();
+			for (size_t i = 0; i < mWorkers.size(); ++i) {
+				mWorkers[i].join();
+			}
+		}
+
+		int get_num_workers() const { return int(mWorkers.size()); }
+
+		// returns false if another thread is running a job, the caller is then expected to do the work itself
+		bool exec(Job* pJob) {
+			std::unique_lock<std::mutex> jobLock(mJobMtx, std::try_to_lock);
+			if (!jobLock.owns_lock()) { return false; }
+			{
+				std::lock_guard<std::mutex> lock(mMtx);
+				mpJob = pJob;
+				++mGen;
+			}
+			mWakeCV.notify_all();
+			exec_job(pJob);
+			std::unique_lock<std::mutex> lock(mMtx);
+			mDoneCV.wait(lock, [&] { return pJob->mDone.load() >= pJob->mCount && mNumBusy == 0; });
+			mpJob = nullptr;
+			return true;
+		}
+	};
+
+	// read without the lock on every parallel_for, written under it
+	static std::atomic<Pool*> s_pPool(nullptr);
+	static std::mutex s_poolMtx;
+
+	void init(int numWorkers) {
+		std::lock_guard<std::mutex> lock(s_poolMtx);
+		if (s_pPool.load(std::memory_order_relaxed)) { return; }
+		if (numWorkers < 0) {
+			int nhw = int(std::thread::hardware_concurrency());
+			numWorkers = std::max(nhw - 1, 0);
+		}
+		s_pPool.store(new Pool(numWorkers), std::memory_order_release);
+	}
+
+	void reset() {
+		std::lock_guard<std::mutex> lock(s_poolMtx);
+		delete s_pPool.exchange(nullptr, std::memory_order_acq_rel);
+	}
+
+	static Pool* get_pool() {
+		Pool* pPool = s_pPool.load(std::memory_order_acquire);
+		if (!pPool) {
+			init();
+			pPool = s_pPool.load(std::memory_order_acquire);
+		}
+		return pPool;
+	}
+
+	int get_num_workers() {
+		return get_pool()->get_num_workers();
+	}
+
+	void parallel_for(int count, RangeFunc pFunc, void* pCtx, int grain) {
+		if (count <= 0 || pFunc == nullptr) { return; }
+		Pool* pPool = s_inTask ? nullptr : get_pool();
+		int nthreads = pPool ? pPool->get_num_workers() + 1 : 1;
+		if (grain <= 0) {
+			grain = std::max(count / (nthreads * 4), 1);
+		}
+		if (nthreads > 1 && count > grain) {
+			Job job;
+			job.mpFunc = pFunc;
+			job.mpCtx = pCtx;
+			job.mCount = count;
+			job.mGrain = grain;
+			job.mNext = 0;
+			job.mDone = 0;
+			if (pPool->exec(&job)) { return; }
+		}
+		bool inTask = s_inTask;
+		s_inTask = true;
+		pFunc(pCtx, 0, count);
+		s_inTask = inTask;
+	}
+}
@@ -0,0 +1,27 @@
+/*
+ * Author: Gleb Novodran <novodran@gmail.com>
+ */
+
+// A pool of worker threads for data-parallel loops.
+// The calling thread works on the loop too, parallel_for issued from inside a running loop is executed serially.
+namespace GWTask {
+	typedef void (*RangeFunc)(void* pCtx, int begin, int end);
+
+	// numWorkers < 0 : one worker per hardware thread besides the caller
+	void init(int numWorkers = -1);
+	void reset();
+	int get_num_workers();
+	inline int get_num_threads() { return get_num_workers() + 1; }
+
+	// Splits [0, count) into chunks of grain items (grain <= 0 : picked automatically) and calls pFunc for each chunk.
+	void parallel_for(int count, RangeFunc pFunc, void* pCtx, int grain = 0);
+
+	template<typename FUNC_T> void parallel_for(int count, const FUNC_T& func, int grain = 0) {
+		struct Tramp {
+			static void call(void* pCtx, int begin, int end) {
+				(*reinterpret_cast<const FUNC_T*>(pCtx))(begin, end);
+			}
+		};
+		parallel_for(count, &Tramp::call, const_cast<void*>(reinterpret_cast<const void*>(&func)), grain);
+	}
+}
@@ -4,6 +4,7 @@
 
 #include "GWSys.hpp"
 #include "GWBase.hpp"
+#include "GWTask.hpp"
 #include "GWVector.hpp"
 #include "GWMatrix.hpp"
 #include "GWQuaternion.hpp"
@@ -153,3 +154,235 @@ template<typename T> GWTransform<T> GWTransform<T>::get_inverted_fast() const {
 
 template GWTransform<float> GWTransform<float>::get_inverted_fast() const;
 template GWTransform<double> GWTransform<double>::get_inverted_fast() const;
+
+// res = parent * child as 3x4 affine transforms, the result is written after all the reads.
+template<typename T> static GW_FORCEINLINE void mul_affine(T* pRes, const T* pChild, const T* pParent) {
+	T res[12];
+	for (int i = 0; i < 3; ++i) {
+		const T* pRow = &pParent[i * 4];
+		for (int j = 0; j < 4; ++j) {
+			res[i * 4 + j] = pRow[0] * pChild[j] + pRow[1] * pChild[4 + j] + pRow[2] * pChild[8 + j];
+		}
+		res[i * 4 + 3] += pRow[3];
+	}
+	for (int i = 0; i < 12; ++i) {
+		pRes[i] = res[i];
+	}
+}
+
+template<typename T> static bool invert_affine(T* pRes, const T* pSrc) {
+	const T* a = &pSrc[0];
+	const T* b = &pSrc[4];
+	const T* c = &pSrc[8];
+	// the columns of the inverse are the cross products of the rows
+	T bc[3] = { b[1] * c[2] - b[2] * c[1], b[2] * c[0] - b[0] * c[2], b[0] * c[1] - b[1] * c[0] };
+	T ca[3] = { c[1] * a[2] - c[2] * a[1], c[2] * a[0] - c[0] * a[2], c[0] * a[1] - c[1] * a[0] };
+	T ab[3] = { a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0] };
+	T det = a[0] * bc[0] + a[1] * bc[1] + a[2] * bc[2];
+	if (det == T(0)) { return false; }
+	T invDet = T(1) / det;
+	T tx = a[3];
+	T ty = b[3];
+	T tz = c[3];
+	for (int i = 0; i < 3; ++i) {
+		pRes[i * 4 + 0] = bc[i] * invDet;
+		pRes[i * 4 + 1] = ca[i] * invDet;
+		pRes[i * 4 + 2] = ab[i] * invDet;
+		pRes[i * 4 + 3] = -(bc[i] * tx + ca[i] * ty + ab[i] * tz) * invDet;
+	}
+	return true;
+}
+
+template<bool PNT, typename T> static void xform_affine(const T* pMtx, T* pDst, const T* pSrc, int num) {
+	for (int i = 0; i < num; ++i) {
+		T x = pSrc[i * 3];
+		T y = pSrc[i * 3 + 1];
+		T z = pSrc[i * 3 + 2];
+		for (int j = 0; j < 3; ++j) {
+			const T* pRow = &pMtx[j * 4];
+			pDst[i * 3 + j] = pRow[0] * x + pRow[1] * y + pRow[2] * z + (PNT ? pRow[3] : T(0));
+		}
+	}
+}
+
+#if defined(GW_SIMD_SSE)
+static GW_FORCEINLINE void mul_affine(float* pRes, const float* pChild, const float* pParent) {
+	__m128 c0 = _mm_loadu_ps(pChild);
+	__m128 c1 = _mm_loadu_ps(pChild + 4);
+	__m128 c2 = _mm_loadu_ps(pChild + 8);
+	__m128 p0 = _mm_loadu_ps(pParent);
+	__m128 p1 = _mm_loadu_ps(pParent + 4);
+	__m128 p2 = _mm_loadu_ps(pParent + 8);
+	__m128 wmask = _mm_castsi128_ps(_mm_set_epi32(-1, 0, 0, 0));
+	__m128 r[3];
+	__m128 p[3] = { p0, p1, p2 };
+	for (int i = 0; i < 3; ++i) {
+		__m128 row = _mm_mul_ps(_mm_shuffle_ps(p[i], p[i], 0x00), c0);
+		row = _mm_add_ps(row, _mm_mul_ps(_mm_shuffle_ps(p[i], p[i], 0x55), c1));
+		row = _mm_add_ps(row, _mm_mul_ps(_mm_shuffle_ps(p[i], p[i], 0xAA), c2));
+		r[i] = _mm_add_ps(row, _mm_and_ps(p[i], wmask));
+	}
+	_mm_storeu_ps(pRes, r[0]);
+	_mm_storeu_ps(pRes + 4, r[1]);
+	_mm_storeu_ps(pRes + 8, r[2]);
+}
+
+static GW_FORCEINLINE __m128 cross_sse(__m128 u, __m128 v) {
+	__m128 uyzx = _mm_shuffle_ps(u, u, _MM_SHUFFLE(3, 0, 2, 1));
+	__m128 vyzx = _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 0, 2, 1));
+	__m128 d = _mm_sub_ps(_mm_mul_ps(u, vyzx), _mm_mul_ps(uyzx, v));
+	return _mm_shuffle_ps(d, d, _MM_SHUFFLE(3, 0, 2, 1));
+}
+
+static bool invert_affine(float* pRes, const float* pSrc) {
+	__m128 xyzMask = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+	__m128 a = _mm_loadu_ps(pSrc);
+	__m128 b = _mm_loadu_ps(pSrc + 4);
+	__m128 c = _mm_loadu_ps(pSrc + 8);
+	__m128 trn = _mm_setr_ps(pSrc[3], pSrc[7], pSrc[11], 0.0f);
+	a = _mm_and_ps(a, xyzMask);
+	b = _mm_and_ps(b, xyzMask);
+	c = _mm_and_ps(c, xyzMask);
+	__m128 bc = cross_sse(b, c);
+	__m128 ca = cross_sse(c, a);
+	__m128 ab = cross_sse(a, b);
+	__m128 dp = _mm_mul_ps(a, bc);
+	float det = _mm_cvtss_f32(_mm_add_ss(_mm_add_ss(dp, _mm_shuffle_ps(dp, dp, 0x55)), _mm_movehl_ps(dp, dp)));
+	if (det == 0.0f) { return false; }
+	__m128 invDet = _mm_set1_ps(1.0f / det);
+	bc = _mm_mul_ps(bc, invDet);
+	ca = _mm_mul_ps(ca, invDet);
+	ab = _mm_mul_ps(ab, invDet);
+	// -inv * t, the columns are bc, ca and ab
+	__m128 t = _mm_mul_ps(bc, _mm_shuffle_ps(trn, trn, 0x00));
+	t = _mm_add_ps(t, _mm_mul_ps(ca, _mm_shuffle_ps(trn, trn, 0x55)));
+	t = _mm_add_ps(t, _mm_mul_ps(ab, _mm_shuffle_ps(trn, trn, 0xAA)));
+	t = _mm_sub_ps(_mm_setzero_ps(), t);
+	__m128 r0 = bc;
+	__m128 r1 = ca;
+	__m128 r2 = ab;
+	__m128 r3 = t;
+	_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+	// the fourth input row was the translation, it lands in the w lanes
+	_mm_storeu_ps(pRes, r0);
+	_mm_storeu_ps(pRes + 4, r1);
+	_mm_storeu_ps(pRes + 8, r2);
+	return true;
+}
+
+template<bool PNT> static void xform_affine_sse(const float* pMtx, float* pDst, const float* pSrc, int num) {
+	__m128 c0 = _mm_setr_ps(pMtx[0], pMtx[4], pMtx[8], 0.0f);
+	__m128 c1 = _mm_setr_ps(pMtx[1], pMtx[5], pMtx[9], 0.0f);
+	__m128 c2 = _mm_setr_ps(pMtx[2], pMtx[6], pMtx[10], 0.0f);
+	__m128 c3 = PNT ? _mm_setr_ps(pMtx[3], pMtx[7], pMtx[11], 0.0f) : _mm_setzero_ps();
+	for (int i = 0; i < num; ++i) {
+		const float* pVec = &pSrc[i * 3];
+		__m128 r = _mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(pVec[0])), c3);
+		r = _mm_add_ps(r, _mm_mul_ps(c1, _mm_set1_ps(pVec[1])));
+		r = _mm_add_ps(r, _mm_mul_ps(c2, _mm_set1_ps(pVec[2])));
+		float* pOut = &pDst[i * 3];
+		_mm_storel_pi(reinterpret_cast<__m64*>(pOut), r);
+		_mm_store_ss(pOut + 2, _mm_movehl_ps(r, r));
+	}
+}
+
+template<bool PNT> static void xform_affine(const float* pMtx, float* pDst, const float* pSrc, int num) {
+	int i = 0;
+#if defined(GW_SIMD_AVX)
+	// 8 vectors at a time, deinterleaved to x, y, z and back
+	__m256 m[12];
+	for (int j = 0; j < 12; ++j) {
+		m[j] = _mm256_set1_ps(pMtx[j]);
+	}
+	for (; i + 8 <= num; i += 8) {
+		const float* p = &pSrc[i * 3];
+		__m256 m03 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p)), _mm_loadu_ps(p + 12), 1);
+		__m256 m14 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p + 4)), _mm_loadu_ps(p + 16), 1);
+		__m256 m25 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p + 8)), _mm_loadu_ps(p + 20), 1);
+		__m256 xy = _mm256_shuffle_ps(m14, m25, _MM_SHUFFLE(2, 1, 3, 2));
+		__m256 yz = _mm256_shuffle_ps(m03, m14, _MM_SHUFFLE(1, 0, 2, 1));
+		__m256 x = _mm256_shuffle_ps(m03, xy, _MM_SHUFFLE(2, 0, 3, 0));
+		__m256 y = _mm256_shuffle_ps(yz, xy, _MM_SHUFFLE(3, 1, 2, 0));
+		__m256 z = _mm256_shuffle_ps(yz, m25, _MM_SHUFFLE(3, 0, 3, 1));
+		__m256 r[3];
+		for (int j = 0; j < 3; ++j) {
+			__m256 acc = _mm256_add_ps(_mm256_mul_ps(m[j * 4], x), _mm256_mul_ps(m[j * 4 + 1], y));
+			acc = _mm256_add_ps(acc, _mm256_mul_ps(m[j * 4 + 2], z));
+			r[j] = PNT ? _mm256_add_ps(acc, m[j * 4 + 3]) : acc;
+		}
+		__m256 rxy = _mm256_shuffle_ps(r[0], r[1], _MM_SHUFFLE(2, 0, 2, 0));
+		__m256 ryz = _mm256_shuffle_ps(r[1], r[2], _MM_SHUFFLE(3, 1, 3, 1));
+		__m256 rzx = _mm256_shuffle_ps(r[2], r[0], _MM_SHUFFLE(3, 1, 2, 0));
+		__m256 r03 = _mm256_shuffle_ps(rxy, rzx, _MM_SHUFFLE(2, 0, 2, 0));
+		__m256 r14 = _mm256_shuffle_ps(ryz, rxy, _MM_SHUFFLE(3, 1, 2, 0));
+		__m256 r25 = _mm256_shuffle_ps(rzx, ryz, _MM_SHUFFLE(3, 1, 3, 1));
+		float* pOut = &pDst[i * 3];
+		_mm_storeu_ps(pOut, _mm256_castps256_ps128(r03));
+		_mm_storeu_ps(pOut + 4, _mm256_castps256_ps128(r14));
+		_mm_storeu_ps(pOut + 8, _mm256_castps256_ps128(r25));
+		_mm_storeu_ps(pOut + 12, _mm256_extractf128_ps(r03, 1));
+		_mm_storeu_ps(pOut + 16, _mm256_extractf128_ps(r14, 1));
+		_mm_storeu_ps(pOut + 20, _mm256_extractf128_ps(r25, 1));
+	}
+#endif
+	xform_affine_sse<PNT>(pMtx, &pDst[i * 3], &pSrc[i * 3], num - i);
+}
+#endif
+
+namespace GWXform {
+
+template <typename T>
+void concatenate(GWTransform3x4<T>& res, const GWTransform3x4<T>& child, const GWTransform3x4<T>& parent) {
+	mul_affine(res.as_tptr(), child.as_tptr(), parent.as_tptr());
+}
+
+template <typename T>
+bool invert(GWTransform3x4<T>& res, const GWTransform3x4<T>& xform) {
+	return invert_affine(res.as_tptr(), xform.as_tptr());
+}
+
+template <typename T>
+void calc_pnts(const GWTransform3x4<T>& xform, GWVectorBase<T>* pDst, const GWVectorBase<T>* pSrc, int num) {
+	if (num <= 0) { return; }
+	xform_affine<true>(xform.as_tptr(), pDst[0].elems, pSrc[0].elems, num);
+}
+
+template <typename T>
+void calc_vecs(const GWTransform3x4<T>& xform, GWVectorBase<T>* pDst, const GWVectorBase<T>* pSrc, int num) {
+	if (num <= 0) { return; }
+	xform_affine<false>(xform.as_tptr(), pDst[0].elems, pSrc[0].elems, num);
+}
+
+template <typename T>
+void concatenate(GWTransform3x4<T>* pRes, const GWTransform3x4<T>* pChild, const GWTransform3x4<T>* pParent, int num) {
+	for (int i = 0; i < num; ++i) {
+		mul_affine(pRes[i].as_tptr(), pChild[i].as_tptr(), pParent[i].as_tptr());
+	}
+}
+
+template <typename T>
+void calc_world(GWTransform3x4<T>* pWorld, const GWTransform3x4<T>* pLocal, const int32_t* pParentIdx, int num) {
+	for (int i = 0; i < num; ++i) {
+		int32_t parentIdx = pParentIdx[i];
+		if (parentIdx < 0) {
+			pWorld[i] = pLocal[i];
+		} else {
+			mul_affine(pWorld[i].as_tptr(), pLocal[i].as_tptr(), pWorld[parentIdx].as_tptr());
+		}
+	}
+}
+
+template void concatenate(GWTransform3x4<float>& res, const GWTransform3x4<float>& child, const GWTransform3x4<float>& parent);
+template void concatenate(GWTransform3x4<double>& res, const GWTransform3x4<double>& child, const GWTransform3x4<double>& parent);
+template bool invert(GWTransform3x4<float>& res, const GWTransform3x4<float>& xform);
+template bool invert(GWTransform3x4<double>& res, const GWTransform3x4<double>& xform);
+template void calc_pnts(const GWTransform3x4<float>& xform, GWVectorBase<float>* pDst, const GWVectorBase<float>* pSrc, int num);
+template void calc_pnts(const GWTransform3x4<double>& xform, GWVectorBase<double>* pDst, const GWVectorBase<double>* pSrc, int num);
+template void calc_vecs(const GWTransform3x4<float>& xform, GWVectorBase<float>* pDst, const GWVectorBase<float>* pSrc, int num);
+template void calc_vecs(const GWTransform3x4<double>& xform, GWVectorBase<double>* pDst, const GWVectorBase<double>* pSrc, int num);
+template void concatenate(GWTransform3x4<float>* pRes, const GWTransform3x4<float>* pChild, const GWTransform3x4<float>* pParent, int num);
+template void concatenate(GWTransform3x4<double>* pRes, const GWTransform3x4<double>* pChild, const GWTransform3x4<double>* pParent, int num);
+template void calc_world(GWTransform3x4<float>* pWorld, const GWTransform3x4<float>* pLocal, const int32_t* pParentIdx, int num);
+template void calc_world(GWTransform3x4<double>* pWorld, const GWTransform3x4<double>* pLocal, const int32_t* pParentIdx, int num);
+
+} // namespace GWXform
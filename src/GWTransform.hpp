@@ -103,27 +103,27 @@ public:
 		set_scaling(s);
 	}
 
-	void make_rx(T rx) {
-		T s = std::sin(rx);
-		T c = std::cos(rx);
+	void make_rx(T rx, GWMathTier tier = GWMathTier::FULL) {
+		T s, c;
+		GWBase::approx_sincos(rx, s, c, tier);
 		set_identity();
 		m[1][1] = c;
 		m[1][2] = s;
 		m[2][1] = -s;
 		m[2][2] = c;
 	}
-	void make_ry(T ry) {
-		T s = std::sin(ry);
-		T c = std::cos(ry);
+	void make_ry(T ry, GWMathTier tier = GWMathTier::FULL) {
+		T s, c;
+		GWBase::approx_sincos(ry, s, c, tier);
 		set_identity();
 		m[0][0] = c;
 		m[0][2] = -s;
 		m[2][0] = s;
 		m[2][2] = c;
 	}
-	void make_rz(T rz) {
-		T s = std::sin(rz);
-		T c = std::cos(rz);
+	void make_rz(T rz, GWMathTier tier = GWMathTier::FULL) {
+		T s, c;
+		GWBase::approx_sincos(rz, s, c, tier);
 		set_identity();
 		m[0][0] = c;
 		m[0][1] = s;
@@ -359,27 +359,27 @@ public:
 	}
 
 	//transposed comparing to 4x4
-	void make_rx(T rx) {
-		T s = std::sin(rx);
-		T c = std::cos(rx);
+	void make_rx(T rx, GWMathTier tier = GWMathTier::FULL) {
+		T s, c;
+		GWBase::approx_sincos(rx, s, c, tier);
 		set_identity();
 		m[1][1] = c;
 		m[2][1] = s;
 		m[1][2] = -s;
 		m[2][2] = c;
 	}
-	void make_ry(T ry) {
-		T s = std::sin(ry);
-		T c = std::cos(ry);
+	void make_ry(T ry, GWMathTier tier = GWMathTier::FULL) {
+		T s, c;
+		GWBase::approx_sincos(ry, s, c, tier);
 		set_identity();
 		m[0][0] = c;
 		m[2][0] = -s;
 		m[0][2] = s;
 		m[2][2] = c;
 	}
-	void make_rz(T rz) {
-		T s = std::sin(rz);
-		T c = std::cos(rz);
+	void make_rz(T rz, GWMathTier tier = GWMathTier::FULL) {
+		T s, c;
+		GWBase::approx_sincos(rz, s, c, tier);
 		set_identity();
 		m[0][0] = c;
 		m[1][0] = s;
@@ -430,20 +430,17 @@ public:
 
 
 	GWVectorBase<T> calc_vec(const GWVectorBase<T>&v) const {
-		GWTuple4<T> res;
-		GWTuple4<T> vec;
-		GWTuple::copy(vec, v, 0);
-		GWMatrix::mul_mv(res.elems, vec.elems, as_tptr(), 3, 4);
-		return GWVectorBase<T>(res);
+		return GWVectorBase<T>(
+			m[0][0] * v.x + m[0][1] * v.y + m[0][2] * v.z,
+			m[1][0] * v.x + m[1][1] * v.y + m[1][2] * v.z,
+			m[2][0] * v.x + m[2][1] * v.y + m[2][2] * v.z);
 	}
 
 	GWVectorBase<T> calc_pnt(const GWVectorBase<T>&v) const {
-		GWTuple4<T> res;
-		GWTuple4<T> vec;
-		GWTuple::copy(vec, v);
-		vec[3] = 1;
-		GWMatrix::mul_mv(res.elems, vec.elems, as_tptr(), 3, 4);
-		return GWVectorBase<T>(res);
+		return GWVectorBase<T>(
+			m[0][0] * v.x + m[0][1] * v.y + m[0][2] * v.z + m[0][3],
+			m[1][0] * v.x + m[1][1] * v.y + m[1][2] * v.z + m[1][3],
+			m[2][0] * v.x + m[2][1] * v.y + m[2][2] * v.z + m[2][3]);
 	}
 };
 
@@ -481,9 +478,32 @@ inline GWTransform<T> concatenate(const GWTransform<T>& child, const GWTransform
 	return res;
 }
 
+// Native affine kernels of the 3x4 form, the float versions are SSE/AVX when available.
+// res = parent * child, res may be either of them.
+template <typename T>
+void concatenate(GWTransform3x4<T>& res, const GWTransform3x4<T>& child, const GWTransform3x4<T>& parent);
+
 template <typename T>
 inline GWTransform3x4<T> concatenate(const GWTransform3x4<T>& child, const GWTransform3x4<T>& parent) {
-	return GWXformCvt::get_3x4(concatenate(GWXformCvt::get_4x4(child), GWXformCvt::get_4x4(parent)));
+	GWTransform3x4<T> res;
+	concatenate(res, child, parent);
+	return res;
 }
 
+// General affine inverse, false with res left untouched if the 3x3 part is singular.
+template <typename T>
+bool invert(GWTransform3x4<T>& res, const GWTransform3x4<T>& xform);
+
+// Array forms, pDst may be pSrc.
+template <typename T>
+void calc_pnts(const GWTransform3x4<T>& xform, GWVectorBase<T>* pDst, const GWVectorBase<T>* pSrc, int num);
+template <typename T>
+void calc_vecs(const GWTransform3x4<T>& xform, GWVectorBase<T>* pDst, const GWVectorBase<T>* pSrc, int num);
+template <typename T>
+void concatenate(GWTransform3x4<T>* pRes, const GWTransform3x4<T>* pChild, const GWTransform3x4<T>* pParent, int num);
+
+// pWorld[i] = pWorld[pParentIdx[i]] * pLocal[i], parents come before their children, roots have negative indices.
+template <typename T>
+void calc_world(GWTransform3x4<T>* pWorld, const GWTransform3x4<T>* pLocal, const int32_t* pParentIdx, int num);
+
 } // namespace GWXform
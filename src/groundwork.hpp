@@ -4,8 +4,10 @@
 #include "GWSys.hpp"
 #include "GWApp.hpp"
 #include "GWBase.hpp"
+#include "GWTask.hpp"
 #include "GWList.hpp"
 #include "GWVector.hpp"
+#include "GWSoA.hpp"
 #include "GWOverlap.hpp"
 #include "GWIntersect.hpp"
 #include "GWSphere.hpp"
@@ -20,5 +22,10 @@
 #include "GWSphericalHarmonics.hpp"
 #include "GWResource.hpp"
 #include "GWModel.hpp"
+#include "GWBVH.hpp"
+#include "GWCollision.hpp"
+#include "GWBroadphase.hpp"
+#include "GWSDF.hpp"
+#include "GWSparse.hpp"
 #include "GWDraw.hpp"
 #include "GWScene.hpp"
\ No newline at end of file
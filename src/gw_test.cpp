@@ -157,10 +157,115 @@ bool test_distmtx() {
 		}
 	}
 	int dsgn = 0;
-	bool res = GWMatrix::lu_decomp(pLU, pMtx, N, pTmpVec, pPerm, &dsgn);
+	double t0 = GWSys::time_micros();
+	bool res = GWMatrix::lu_decomp(pLU, pMtx, N, pTmpVec, pPerm, &dsgn, 0.0f, false);
+	double tSerial = GWSys::time_micros() - t0;
+	t0 = GWSys::time_micros();
+	res = res && GWMatrix::lu_decomp(pLU, pMtx, N, pTmpVec, pPerm, &dsgn);
+	double tParallel = GWSys::time_micros() - t0;
+	std::cout << " LU " << N << "x" << N << ": serial " << tSerial * 1.0e-3 << " ms, parallel " << tParallel * 1.0e-3 << " ms";
+
+	float* pProd = new float[N * N];
+	t0 = GWSys::time_micros();
+	GWMatrix::mul_mm(pProd, pMtx, pLU, N, N, N);
+	std::cout << ", mul_mm " << (GWSys::time_micros() - t0) * 1.0e-3 << " ms";
+	delete[] pProd;
+	delete[] pMtx;
+	delete[] pLU;
+	delete[] pPerm;
+	delete[] pTmpVec;
 	return res;
 }
 
+bool test_spdmtx() {
+	const int N = 1000;
+	float* pMtx = new float[N * N];
+	float* pLDL = new float[N * N];
+	for (int i = 0; i < N; ++i) {
+		for (int j = 0; j < N; ++j) {
+			pMtx[i*N + j] = 1.0f / float(1 + std::abs(i - j)) + (i == j ? 4.0f : 0.0f);
+		}
+	}
+	double t0 = GWSys::time_micros();
+	bool res = GWMatrix::ldl_decomp(pLDL, pMtx, N, 0.0f, false);
+	double tSerial = GWSys::time_micros() - t0;
+	t0 = GWSys::time_micros();
+	res = res && GWMatrix::ldl_decomp(pLDL, pMtx, N);
+	double tParallel = GWSys::time_micros() - t0;
+	std::cout << " LDL " << N << "x" << N << ": serial " << tSerial * 1.0e-3 << " ms, parallel " << tParallel * 1.0e-3 << " ms";
+
+	const int NS = 4;
+	const int NUM = 100000;
+	float* pSys = new float[NUM * NS * NS];
+	float* pFac = new float[NUM * NS * NS];
+	float* pRH = new float[NUM * NS];
+	float* pAns = new float[NUM * NS];
+	for (int i = 0; i < NUM; ++i) {
+		for (int j = 0; j < NS * NS; ++j) {
+			pSys[i * NS * NS + j] = pMtx[(j / NS) * N + (j % NS) + i % 16];
+		}
+		for (int j = 0; j < NS; ++j) {
+			pRH[i * NS + j] = float(j + i % 3);
+		}
+	}
+	t0 = GWSys::time_micros();
+	GWMatrix::ldl_solve_batch(pAns, pFac, pSys, pRH, NS, NUM);
+	std::cout << ", " << NUM << " " << NS << "x" << NS << " ldl_solve_batch " << (GWSys::time_micros() - t0) * 1.0e-3 << " ms";
+	delete[] pSys;
+	delete[] pFac;
+	delete[] pRH;
+	delete[] pAns;
+	delete[] pMtx;
+	delete[] pLDL;
+	return res;
+}
+
+template<int N>
+void bench_small_systems(const int num) {
+	float* pMtx = new float[num * N * N];
+	float* pRH = new float[num * N];
+	float* pAns = new float[num * N];
+	float* pSoaMtx = new float[num * N * N];
+	float* pSoaRH = new float[num * N];
+	float tmp[N];
+	int perm[N];
+	float lu[N * N];
+	GWBase::Random rnd(7);
+	for (int i = 0; i < num * N * N; ++i) {
+		pMtx[i] = rnd.f01() + ((i % (N * N)) % (N + 1) == 0 ? 1.0f : 0.0f);
+	}
+	for (int i = 0; i < num * N; ++i) {
+		pRH[i] = rnd.f01();
+	}
+	const int B = GWMatrix::SOA_BATCH;
+	for (int k = 0; k < num; ++k) {
+		for (int i = 0; i < N * N; ++i) { pSoaMtx[((k / B) * N * N + i) * B + k % B] = pMtx[k * N * N + i]; }
+		for (int i = 0; i < N; ++i) { pSoaRH[((k / B) * N + i) * B + k % B] = pRH[k * N + i]; }
+	}
+	double t0 = GWSys::time_micros();
+	for (int k = 0; k < num; ++k) {
+		GWMatrix::lu_decomp(lu, pMtx + k * N * N, N, tmp, perm);
+		GWMatrix::lu_solve(pAns + k * N, lu, N, perm, pRH + k * N);
+	}
+	std::cout << " " << num << " " << N << "x" << N << ": lu " << (GWSys::time_micros() - t0) * 1.0e-3 << " ms";
+	t0 = GWSys::time_micros();
+	for (int k = 0; k < num; ++k) {
+		GWMatrix::solve_n<N>(pAns + k * N, pMtx + k * N * N, pRH + k * N);
+	}
+	std::cout << ", solve_n " << (GWSys::time_micros() - t0) * 1.0e-3 << " ms";
+	t0 = GWSys::time_micros();
+	GWMatrix::solve_batch_n<N>(pAns, pMtx, pRH, num, nullptr, false);
+	std::cout << ", batch " << (GWSys::time_micros() - t0) * 1.0e-3 << " ms";
+	t0 = GWSys::time_micros();
+	GWMatrix::solve_soa_n<N>(pAns, pSoaMtx, pSoaRH, num / B, nullptr, false);
+	std::cout << ", soa " << (GWSys::time_micros() - t0) * 1.0e-3 << " ms";
+	delete[] pMtx;
+	delete[] pRH;
+	delete[] pAns;
+	delete[] pSoaMtx;
+	delete[] pSoaRH;
+}
+
 void test_mtx() {
 	using namespace std;
 
@@ -171,6 +276,16 @@ void test_mtx() {
 	cout << "test_distmtx...";
 	res = test_distmtx();
 	cout << (res ? " OK " : "Failed") << endl;
+
+	cout << "test_spdmtx...";
+	res = test_spdmtx();
+	cout << (res ? " OK " : "Failed") << endl;
+
+	cout << "small systems...";
+	bench_small_systems<3>(1 << 20);
+	cout << endl << "small systems...";
+	bench_small_systems<4>(1 << 20);
+	cout << endl;
 }
 
 void test_tuple() {
@@ -537,6 +652,318 @@ void test_image(const std::string& imgPath) {
 	}
 }
 
+void test_quat_bench() {
+	using namespace std;
+	const int n = 1 << 16;
+	GWVectorF* pLogA = new GWVectorF[n];
+	GWVectorF* pLogB = new GWVectorF[n];
+	GWQuaternionF* pA = new GWQuaternionF[n];
+	GWQuaternionF* pB = new GWQuaternionF[n];
+	GWQuaternionF* pRes = new GWQuaternionF[n];
+	GWBase::Random rnd(11);
+	for (int i = 0; i < n; ++i) {
+		pLogA[i] = GWVectorF(rnd.f01() - 0.5f, rnd.f01() - 0.5f, rnd.f01() - 0.5f) * 3.0f;
+		pLogB[i] = GWVectorF(rnd.f01() - 0.5f, rnd.f01() - 0.5f, rnd.f01() - 0.5f) * 3.0f;
+	}
+
+	// decode two poses and slerp between them
+	double t0 = GWSys::time_micros();
+	for (int i = 0; i < n; ++i) {
+		GWQuaternionF a = GWQuaternion::expmap_decode(pLogA[i]);
+		GWQuaternionF b = GWQuaternion::expmap_decode(pLogB[i]);
+		pRes[i] = GWUnitQuaternion::slerp(a, b, 0.3f);
+		pRes[i].normalize();
+	}
+	double tSingle = GWSys::time_micros() - t0;
+	t0 = GWSys::time_micros();
+	GWQuaternion::expmap_decode(pA, pLogA, n);
+	GWQuaternion::expmap_decode(pB, pLogB, n);
+	GWUnitQuaternion::slerp(pRes, pA, pB, 0.3f, n);
+	double tBatch = GWSys::time_micros() - t0;
+	cout << "decode + slerp of " << n << ": one by one " << tSingle * 1.0e-3 << " ms, batch " << tBatch * 1.0e-3 << " ms" << endl;
+
+	delete[] pLogA;
+	delete[] pLogB;
+	delete[] pA;
+	delete[] pB;
+	delete[] pRes;
+}
+
+void test_math_bench() {
+	using namespace std;
+	const int n = 1 << 18;
+	float* pSrc = new float[n];
+	float* pDst = new float[n];
+	float* pDst2 = new float[n];
+	GWBase::Random rnd(13);
+	for (int i = 0; i < n; ++i) {
+		pSrc[i] = rnd.f01();
+	}
+
+	static const char* tierNames[] = { "full", "fast", "coarse" };
+	for (int t = 0; t < 3; ++t) {
+		GWMathTier tier = GWMathTier(t);
+		double t0 = GWSys::time_micros();
+		GWBase::approx_sincos(pDst, pDst2, pSrc, n, tier);
+		double tSinCos = GWSys::time_micros() - t0;
+		t0 = GWSys::time_micros();
+		GWBase::approx_pow(pDst, pSrc, 2.2f, n, tier);
+		double tPow = GWSys::time_micros() - t0;
+		cout << tierNames[t] << " math on " << n << ": sincos " << tSinCos * 1.0e-3 << " ms, pow " << tPow * 1.0e-3 << " ms" << endl;
+	}
+
+	delete[] pSrc;
+	delete[] pDst;
+	delete[] pDst2;
+}
+
+void test_rng_bench() {
+	using namespace std;
+	const int n = 1 << 20;
+	float* pDst = new float[n * 3];
+	GWBase::Random rnd(17);
+	double t0 = GWSys::time_micros();
+	for (int i = 0; i < n; ++i) {
+		pDst[i] = rnd.f01();
+	}
+	double tRandom = GWSys::time_micros() - t0;
+	GWBase::Philox philox(17);
+	t0 = GWSys::time_micros();
+	for (int i = 0; i < n; ++i) {
+		pDst[i] = philox.f01();
+	}
+	double tPhilox = GWSys::time_micros() - t0;
+	t0 = GWSys::time_micros();
+	philox.fill_f01(pDst, n);
+	double tFill = GWSys::time_micros() - t0;
+	cout << "f01 x " << n << ": random " << tRandom * 1.0e-3 << " ms, philox " << tPhilox * 1.0e-3 << " ms, philox fill " << tFill * 1.0e-3 << " ms" << endl;
+
+	// one stream per chunk, the same numbers for any number of workers
+	const int chunk = 0x4000;
+	t0 = GWSys::time_micros();
+	GWTask::parallel_for(n / chunk, [pDst, chunk](int begin, int end) {
+		for (int i = begin; i < end; ++i) {
+			GWBase::Philox chunkRnd(17, uint64_t(i));
+			chunkRnd.fill_cosine(pDst + i * chunk * 3, chunk);
+		}
+	}, 1);
+	double tCosine = GWSys::time_micros() - t0;
+	t0 = GWSys::time_micros();
+	for (int i = 0; i < n; ++i) {
+		float* pDir = pDst + i * 3;
+		philox.dir_cosine(pDir[0], pDir[1], pDir[2]);
+	}
+	double tCosineScl = GWSys::time_micros() - t0;
+	cout << "cosine directions x " << n << ": " << tCosineScl * 1.0e-3 << " ms one by one, " << tCosine * 1.0e-3 << " ms filled in parallel" << endl;
+	delete[] pDst;
+}
+
+void test_soa_bench() {
+	using namespace std;
+	const int n = 1 << 20;
+	GWVectorF* pPnts = new GWVectorF[n];
+	GWBase::Random rnd(19);
+	for (int i = 0; i < n; ++i) {
+		float x = rnd.f01() * 2.0f - 1.0f;
+		float y = rnd.f01() * 2.0f - 1.0f;
+		pPnts[i] = GWVectorF(x, y, rnd.f01() * 2.0f - 1.0f);
+	}
+	double t0 = GWSys::time_micros();
+	GWSoA3* pSoA = GWSoA3::create(pPnts, n);
+	double tConv = GWSys::time_micros() - t0;
+
+	GWVectorF minVal, maxVal;
+	t0 = GWSys::time_micros();
+	GWTuple::calc_bbox(pPnts, uint32_t(n), minVal, maxVal);
+	double tBBox = GWSys::time_micros() - t0;
+	t0 = GWSys::time_micros();
+	pSoA->calc_bbox(minVal, maxVal);
+	double tBBoxSoA = GWSys::time_micros() - t0;
+
+	GWSphereF sph;
+	t0 = GWSys::time_micros();
+	sph.ritter(pPnts, n);
+	double tRitter = GWSys::time_micros() - t0;
+	t0 = GWSys::time_micros();
+	sph.ritter(*pSoA);
+	double tRitterSoA = GWSys::time_micros() - t0;
+	cout << "soa " << n << " points, conversion " << tConv * 1.0e-3 << " ms; bbox " << tBBox * 1.0e-3 << " -> " << tBBoxSoA * 1.0e-3 << " ms, ritter " << tRitter * 1.0e-3 << " -> " << tRitterSoA * 1.0e-3 << " ms" << endl;
+	GWSoA3::destroy(pSoA);
+	delete[] pPnts;
+}
+
+void test_bv_bench() {
+	using namespace std;
+	const int n = 1 << 20;
+	GWVectorF* pPnts = new GWVectorF[n];
+	GWBase::Philox rnd(23);
+	rnd.fill_sphere(pPnts[0].elems, n);
+	for (int i = 0; i < n; ++i) {
+		pPnts[i].scl(rnd.f01());
+	}
+	GWVectorF minVal, maxVal;
+	double t[2][2];
+	GWSphereF sph;
+	for (int p = 0; p < 2; ++p) {
+		bool parallel = p == 1;
+		double t0 = GWSys::time_micros();
+		GWTuple::calc_bbox(pPnts, uint32_t(n), minVal, maxVal, parallel);
+		t[p][0] = GWSys::time_micros() - t0;
+		t0 = GWSys::time_micros();
+		sph.ritter(pPnts, n, parallel);
+		t[p][1] = GWSys::time_micros() - t0;
+	}
+	float ritterR = sph.r;
+	double t0 = GWSys::time_micros();
+	sph.welzl(pPnts, n);
+	double tWelzl = GWSys::time_micros() - t0;
+	cout << "bounds of " << n << " points, serial/parallel: bbox " << t[0][0] * 1.0e-3 << "/" << t[1][0] * 1.0e-3 << " ms, ritter " << t[0][1] * 1.0e-3 << "/" << t[1][1] * 1.0e-3 << " ms (r = " << ritterR << "), welzl " << tWelzl * 1.0e-3 << " ms (r = " << sph.r << ")" << endl;
+	delete[] pPnts;
+}
+
+void test_xform_bench() {
+	using namespace std;
+	const int nxf = 4096;
+	const int npnt = 1 << 20;
+	GWTransform3x4F* pLocal = new GWTransform3x4F[nxf];
+	GWTransform3x4F* pWorld = new GWTransform3x4F[nxf];
+	int32_t* pParentIdx = new int32_t[nxf];
+	GWVectorF* pPnts = new GWVectorF[npnt];
+	GWBase::Random rnd(7);
+	for (int i = 0; i < nxf; ++i) {
+		pLocal[i].make_deg_rotation(rnd.f01() * 90.0f, rnd.f01() * 90.0f, rnd.f01() * 90.0f);
+		pLocal[i].set_translation(rnd.f01(), rnd.f01(), rnd.f01());
+		pParentIdx[i] = i ? int32_t(rnd.u64() % i) : -1;
+	}
+	for (int i = 0; i < npnt; ++i) {
+		pPnts[i] = GWVectorF(rnd.f01(), rnd.f01(), rnd.f01());
+	}
+
+	// hierarchy through the 4x4 product against the native one
+	double t0 = GWSys::time_micros();
+	for (int i = 0; i < nxf; ++i) {
+		int32_t parentIdx = pParentIdx[i];
+		pWorld[i] = parentIdx < 0 ? pLocal[i] : GWXformCvt::get_3x4(GWXform::concatenate(GWXformCvt::get_4x4(pLocal[i]), GWXformCvt::get_4x4(pWorld[parentIdx])));
+	}
+	double t4x4 = GWSys::time_micros() - t0;
+	t0 = GWSys::time_micros();
+	GWXform::calc_world(pWorld, pLocal, pParentIdx, nxf);
+	double tNative = GWSys::time_micros() - t0;
+	cout << "3x4 hierarchy of " << nxf << ": via 4x4 " << t4x4 * 1.0e-3 << " ms, native " << tNative * 1.0e-3 << " ms" << endl;
+
+	t0 = GWSys::time_micros();
+	for (int i = 0; i < npnt; ++i) {
+		pPnts[i] = pWorld[1].calc_pnt(pPnts[i]);
+	}
+	double tSingle = GWSys::time_micros() - t0;
+	t0 = GWSys::time_micros();
+	GWXform::calc_pnts(pWorld[1], pPnts, pPnts, npnt);
+	double tBatch = GWSys::time_micros() - t0;
+	cout << "3x4 points: " << npnt << " one by one " << tSingle * 1.0e-3 << " ms, batch " << tBatch * 1.0e-3 << " ms" << endl;
+
+	delete[] pLocal;
+	delete[] pWorld;
+	delete[] pParentIdx;
+	delete[] pPnts;
+}
+
+void test_sh_bench() {
+	using namespace std;
+	// synthetic 4K panorama in the source formats
+	const int w = 4096;
+	const int h = 2048;
+	GWImage* pImg = GWImage::alloc(w, h);
+	GWHalf4* pHalf = new GWHalf4[w * h];
+	uint32_t* pRGBA8 = new uint32_t[w * h];
+	for (int y = 0; y < h; ++y) {
+		for (int x = 0; x < w; ++x) {
+			float s = float(x) / w;
+			float t = float(y) / h;
+			GWColorF clr(s, t, 1.0f - t, 1.0f);
+			GWTuple4f tuple;
+			GWTuple::copy(tuple, clr);
+			pImg->set_pixel(x, y, clr);
+			pHalf[y * w + x].set(tuple);
+			pRGBA8[y * w + x] = clr.encode_rgba8();
+		}
+	}
+	GWSHCoeffsF coefs;
+	for (int par = 0; par < 2; ++par) {
+		double t0 = GWSys::time_micros();
+		coefs.calc_pano(pImg, par != 0);
+		double tFloat = GWSys::time_micros() - t0;
+		t0 = GWSys::time_micros();
+		coefs.calc_pano(pHalf, w, h, par != 0);
+		double tHalf = GWSys::time_micros() - t0;
+		t0 = GWSys::time_micros();
+		coefs.calc_pano(pRGBA8, w, h, par != 0);
+		double tRGBA8 = GWSys::time_micros() - t0;
+		cout << "SH pano " << w << "x" << h << " (" << (par ? "parallel" : "serial") << "): float " << tFloat * 1.0e-3 << " ms, half ";
+		cout << tHalf * 1.0e-3 << " ms, rgba8 " << tRGBA8 * 1.0e-3 << " ms" << endl;
+	}
+	// glossy orders
+	GWSHCoeffsBase<float, 6> coefs6;
+	GWSHCoeffsBase<float, 8> coefs8;
+	double t0 = GWSys::time_micros();
+	coefs6.calc_pano(pHalf, w, h);
+	double t6 = GWSys::time_micros() - t0;
+	t0 = GWSys::time_micros();
+	coefs8.calc_pano(pHalf, w, h);
+	double t8 = GWSys::time_micros() - t0;
+	cout << "SH pano order 6: " << t6 * 1.0e-3 << " ms, order 8: " << t8 * 1.0e-3 << " ms" << endl;
+	// probe sets turning with the sky
+	const int nprobe = 10000;
+	GWSHCoeffsF* pProbes = new GWSHCoeffsF[nprobe];
+	for (int i = 0; i < nprobe; ++i) {
+		pProbes[i] = coefs;
+	}
+	GWQuaternionF q;
+	q.set_degrees(10.0f, 35.0f, 0.0f);
+	t0 = GWSys::time_micros();
+	GWSHCoeffsF::rotate(pProbes, nprobe, q);
+	double tRot = GWSys::time_micros() - t0;
+	t0 = GWSys::time_micros();
+	coefs8.rotate(q);
+	double tRot8 = GWSys::time_micros() - t0;
+	cout << "SH rotation: " << nprobe << " order 3 sets " << tRot * 1.0e-3 << " ms, one order 8 set " << tRot8 << " us" << endl;
+	delete[] pProbes;
+
+	// ambient for many objects from a probe volume
+	const int gridRes[3] = { 32, 8, 32 };
+	const int nobj = 100000;
+	GWVectorF* pPos = new GWVectorF[nobj];
+	GWVectorF* pNrm = new GWVectorF[nobj];
+	GWColorTuple3f* pIrr = new GWColorTuple3f[nobj];
+	GWBase::Random rnd(5);
+	for (int i = 0; i < nobj; ++i) {
+		pPos[i] = GWVectorF(rnd.f01(), rnd.f01(), rnd.f01()) * 100.0f;
+		pNrm[i] = GWVectorF(rnd.f01() - 0.5f, rnd.f01() - 0.5f, rnd.f01() - 0.5f);
+		pNrm[i].normalize();
+	}
+	for (int k = 0; k < 2; ++k) {
+		GWSH::ProbeStorage storage = k ? GWSH::ProbeStorage::HALF : GWSH::ProbeStorage::FLOAT;
+		GWSH::ProbeGrid* pGrid = GWSH::ProbeGrid::create(GWVectorF(0.0f), GWVectorF(100.0f), gridRes, storage);
+		for (int iz = 0; iz < gridRes[2]; ++iz) {
+			for (int iy = 0; iy < gridRes[1]; ++iy) {
+				for (int ix = 0; ix < gridRes[0]; ++ix) {
+					pGrid->set_probe(ix, iy, iz, coefs);
+				}
+			}
+		}
+		t0 = GWSys::time_micros();
+		pGrid->eval(pPos, pNrm, pIrr, nobj, false);
+		double tGrid = GWSys::time_micros() - t0;
+		cout << "SH probes (" << (k ? "half" : "float") << "): " << nobj << " trilinear lookups " << tGrid * 1.0e-3 << " ms" << endl;
+		GWSH::ProbeGrid::destroy(pGrid);
+	}
+	delete[] pPos;
+	delete[] pNrm;
+	delete[] pIrr;
+	delete[] pHalf;
+	delete[] pRGBA8;
+	GWImage::free(pImg);
+}
+
 void test_model(const std::string& mdlPath) {
 	using namespace std;
 
@@ -551,11 +978,51 @@ void test_model(const std::string& mdlPath) {
 	*pMdlMem = 16;
 	pMdr->save_geo("out.geo");
 
+	double t0 = GWSys::time_micros();
+	GWBVH::Node* pBVH = GWBVH::build(*pMdr);
+	cout << "model BVH: " << GWBVH::calc_num_nodes(pMdr->mNumTri) << " nodes, " << (GWSys::time_micros() - t0) * 1.0e-3 << " ms" << endl;
+	GWBVH::release(pBVH);
+
 	GWSphereF* pSph = pMdr->calc_skin_spheres_of_influence();
 	GWSys::free_rsrc_mem(pSph);
 
 	GWModel* pMdl = GWModel::create(pMdr, 0x200, 0x300);
 	if (pMdl) {
+		GWBVH::ModelBVH* pMBVH = GWBVH::ModelBVH::create(pMdr);
+		if (pMBVH) {
+			for (uint32_t i = 0; i < pMdr->mNumSkinNodes; ++i) {
+				pMdl->mpSkinXforms[i].make_deg_rotation(0.0f, 10.0f + i, 0.0f);
+				pMdl->mpSkinXforms[i].set_translation(0.0f, 0.01f * i, 0.0f);
+			}
+			t0 = GWSys::time_micros();
+			pMBVH->update(*pMdl);
+			cout << "model BVH update: " << (GWSys::time_micros() - t0) * 1.0e-3 << " ms" << endl;
+			t0 = GWSys::time_micros();
+			pMBVH->refit();
+			cout << "model BVH refit: " << (GWSys::time_micros() - t0) * 1.0e-3 << " ms" << endl;
+
+			GWVectorF bbMin, bbMax;
+			if (pMBVH->calc_sphere_bounds(bbMin, bbMax)) {
+				GWVectorF ctr = (bbMin + bbMax) * 0.5f;
+				GWVectorF org = ctr + GWVectorF(0.0f, 0.0f, 10.0f);
+				GWRayF ray(org, GWVectorF(0.0f, 0.0f, -1.0f));
+				GWCollision::HitInfo hit;
+				bool found = GWCollision::ray_first_hit(*pMBVH, ray, 20.0f, &hit);
+				int sphIdx = GWCollision::ray_skin_spheres(*pMBVH, ray, 20.0f);
+				cout << "model ray: " << (found ? "hit tri " : "miss ") << hit.mPolIdx << ", skin sphere " << sphIdx << endl;
+
+				GWSDF::Field::BakeParams params;
+				params.mCellSize = (bbMax - bbMin).max_elem() / 64.0f;
+				t0 = GWSys::time_micros();
+				GWSDF::Field* pField = GWSDF::Field::bake(*pMBVH, params);
+				if (pField) {
+					cout << "model SDF: " << pField->mNumDense << " of " << pField->get_num_bricks() << " bricks, ";
+					cout << (GWSys::time_micros() - t0) * 1.0e-3 << " ms, distance at the ray origin " << pField->sample(org) << endl;
+					GWSDF::Field::destroy(pField);
+				}
+			}
+			GWBVH::ModelBVH::destroy(pMBVH);
+		}
 		GWModel::destroy(pMdl);
 	} else {
 		cout << "Couldn't create GWModel" << endl;
@@ -623,6 +1090,334 @@ void test_overlap() {
 	res = GWOverlap::seg_aabb(segBp, segBq, minA, maxA);
 }
 
+void test_cls_bench(const std::string& clsPath) {
+	using namespace std;
+	GWCollisionResource* pCls = GWCollisionResource::load(clsPath);
+	if (pCls == nullptr) {
+		cout << "Cannot load the collision file" << endl;
+		return;
+	}
+	const int nseg = 64 * 1024;
+	GWVectorF* pSegs = new GWVectorF[nseg * 2];
+	GWCollision::HitInfo* pHits = new GWCollision::HitInfo[nseg];
+	GWCollision::HitInfo* pRef = new GWCollision::HitInfo[nseg];
+	GWBase::Random rnd(1);
+	GWVectorF ext = pCls->mBBoxMax - pCls->mBBoxMin;
+	for (int i = 0; i < nseg * 2; ++i) {
+		GWVectorF r(rnd.f01(), rnd.f01(), rnd.f01());
+		pSegs[i] = pCls->mBBoxMin + r * ext;
+	}
+
+	double t0 = GWSys::time_micros();
+	for (int i = 0; i < nseg; ++i) {
+		pRef[i].reset();
+		GWCollision::seg_first_hit(*pCls, pSegs[i * 2], pSegs[i * 2 + 1], &pRef[i]);
+	}
+	double tScalar = GWSys::time_micros() - t0;
+	cout << "scalar: " << double(nseg) / tScalar << " Msegs/s" << endl;
+
+	for (int sort = 0; sort < 2; ++sort) {
+		t0 = GWSys::time_micros();
+		GWCollision::segs_first_hit(*pCls, pSegs, nseg, pHits, sort != 0);
+		double tBatch = GWSys::time_micros() - t0;
+		int ndiff = 0;
+		for (int i = 0; i < nseg; ++i) {
+			if (pHits[i].mPolIdx != pRef[i].mPolIdx || pHits[i].mT != pRef[i].mT) { ++ndiff; }
+		}
+		cout << (sort ? "sorted stream: " : "packet: ") << double(nseg) / tBatch << " Msegs/s";
+		cout << " (x" << tScalar / tBatch << ", " << ndiff << " mismatches)" << endl;
+	}
+
+	static const GWCollision::QBVHKind qkinds[] = { GWCollision::QBVHKind::FLOAT, GWCollision::QBVHKind::Q16, GWCollision::QBVHKind::Q8 };
+	static const char* qnames[] = { "float", "q16", "q8" };
+	for (int k = 0; k < 3; ++k) {
+		GWCollision::QBVH* pQBVH = GWCollision::QBVH::create(*pCls, qkinds[k]);
+		if (!pQBVH) { break; }
+		t0 = GWSys::time_micros();
+		int ndiff = 0;
+		for (int i = 0; i < nseg; ++i) {
+			pHits[i].reset();
+			GWCollision::seg_first_hit(*pQBVH, pSegs[i * 2], pSegs[i * 2 + 1], &pHits[i]);
+		}
+		double tQBVH = GWSys::time_micros() - t0;
+		for (int i = 0; i < nseg; ++i) {
+			if (pHits[i].mPolIdx != pRef[i].mPolIdx || pHits[i].mT != pRef[i].mT) { ++ndiff; }
+		}
+		cout << "QBVH " << qnames[k] << ": " << double(nseg) / tQBVH << " Msegs/s";
+		cout << " (x" << tScalar / tQBVH << ", " << ndiff << " mismatches)" << endl;
+		GWCollision::QBVH::destroy(pQBVH);
+	}
+
+	for (int par = 0; par < 2; ++par) {
+		t0 = GWSys::time_micros();
+		GWBVH::Node* pNodes = GWBVH::build(*pCls, par != 0);
+		double tBuild = GWSys::time_micros() - t0;
+		cout << "SAH build (" << (par ? "parallel" : "serial") << "): " << tBuild * 1.0e-3 << " ms" << endl;
+		GWBVH::release(pNodes);
+	}
+
+	// capsule agents stepping from the segment starts
+	const int nagent = 4096;
+	GWCollision::Capsule* pCaps = new GWCollision::Capsule[nagent];
+	GWVectorF* pMoves = new GWVectorF[nagent];
+	float agentSize = ext.length() * 0.005f;
+	for (int i = 0; i < nagent; ++i) {
+		pCaps[i].mA = pSegs[i * 2];
+		pCaps[i].mB = pSegs[i * 2] + GWVectorF(0.0f, agentSize * 4.0f, 0.0f);
+		pCaps[i].mRadius = agentSize;
+		pMoves[i] = (pSegs[i * 2 + 1] - pSegs[i * 2]) * 0.05f;
+	}
+	for (int par = 0; par < 2; ++par) {
+		t0 = GWSys::time_micros();
+		int nhit = GWCollision::capsule_sweeps(*pCls, pCaps, pMoves, nagent, pHits, par != 0);
+		double tSweep = GWSys::time_micros() - t0;
+		cout << "capsule sweeps (" << (par ? "parallel" : "serial") << "): " << tSweep * 1.0e-3 << " ms, " << nhit << "/" << nagent << " hits" << endl;
+	}
+	delete[] pCaps;
+	delete[] pMoves;
+
+	// whole-mesh pass: total area through the virtual per-poly walk and through the triangle soup
+	struct AreaFunc : public GWCollisionResource::TriFunc {
+		double mArea = 0.0;
+		virtual void operator ()(GWCollisionResource& cls, GWVectorF vtx[3], GWVectorF nrm, int polIdx, int triIdx) {
+			mArea += 0.5 * GWVector::cross(vtx[1] - vtx[0], vtx[2] - vtx[0]).length();
+		}
+	} areaFunc;
+	t0 = GWSys::time_micros();
+	pCls->for_all_tris(areaFunc);
+	double tWalk = GWSys::time_micros() - t0;
+	t0 = GWSys::time_micros();
+	GWCollisionResource::TriSoup* pSoup = GWCollisionResource::TriSoup::create(*pCls);
+	double tExpand = GWSys::time_micros() - t0;
+	if (pSoup) {
+		double area = 0.0;
+		t0 = GWSys::time_micros();
+		pSoup->for_each_tri([&area](const GWCollisionResource::TriSoup::Tri& tri) {
+			area += 0.5 * GWVector::cross(tri.mE1, tri.mE2).length();
+		});
+		double tSoup = GWSys::time_micros() - t0;
+		cout << "area pass: for_all_tris " << tWalk * 1.0e-3 << " ms, soup " << tSoup * 1.0e-3 << " ms";
+		cout << " (expanded in " << tExpand * 1.0e-3 << " ms), area " << areaFunc.mArea << " / " << area << endl;
+		GWCollisionResource::TriSoup::destroy(pSoup);
+	}
+
+	// proximity: closest point searches against lookups in a baked distance field
+	GWSDF::Field::BakeParams params;
+	params.mCellSize = ext.max_elem() / 256.0f;
+	t0 = GWSys::time_micros();
+	GWSDF::Field* pField = GWSDF::Field::bake(*pCls, params);
+	double tBake = GWSys::time_micros() - t0;
+	if (pField) {
+		const int npnt = nseg;
+		float* pDist = new float[npnt];
+		t0 = GWSys::time_micros();
+		int nnear = 0;
+		for (int i = 0; i < npnt; ++i) {
+			if (GWCollision::closest_pnt(*pCls, pSegs[i], pField->mBand)) { ++nnear; }
+		}
+		double tSearch = GWSys::time_micros() - t0;
+		t0 = GWSys::time_micros();
+		pField->sample(pSegs, pDist, nullptr, npnt, false);
+		double tLookup = GWSys::time_micros() - t0;
+		size_t memSize = pField->mNumDense * pField->get_brick_size() + pField->get_num_bricks() * (sizeof(int32_t) + sizeof(float));
+		cout << "SDF: baked in " << tBake * 1.0e-3 << " ms, " << pField->mNumDense << " of " << pField->get_num_bricks() << " bricks, ";
+		cout << memSize / 1024 << " KB" << endl;
+		cout << "proximity: closest point " << double(npnt) / tSearch << " Mq/s (" << nnear << " within the band), SDF lookup " << double(npnt) / tLookup << " Mq/s" << endl;
+		delete[] pDist;
+		GWSDF::Field::destroy(pField);
+	}
+
+	// ground under agents: a downward cast per agent against a lookup in the baked ground cache
+	GWCollision::GroundCache::BakeParams groundParams;
+	groundParams.mCellSize = std::max(ext.x, ext.z) / 512.0f;
+	t0 = GWSys::time_micros();
+	GWCollision::GroundCache* pGround = GWCollision::GroundCache::create(*pCls, groundParams);
+	tBake = GWSys::time_micros() - t0;
+	if (pGround) {
+		const int npnt = nseg;
+		const GWVectorF* pFeet = pSegs;
+		GWCollision::GroundHit* pGroundHits = new GWCollision::GroundHit[npnt];
+		float maxStep = ext.y * 0.01f;
+		t0 = GWSys::time_micros();
+		int ncast = 0;
+		for (int i = 0; i < npnt; ++i) {
+			GWVectorF top = pFeet[i] + GWVectorF(0.0f, maxStep, 0.0f);
+			GWVectorF btm(pFeet[i].x, pCls->mBBoxMin.y - 1.0f, pFeet[i].z);
+			if (GWCollision::seg_first_hit(*pCls, top, btm)) { ++ncast; }
+		}
+		double tCast = GWSys::time_micros() - t0;
+		t0 = GWSys::time_micros();
+		int nlookup = pGround->sample_ground(pFeet, maxStep, pGroundHits, nullptr, npnt, false);
+		double tLookup = GWSys::time_micros() - t0;
+		cout << "ground: baked " << pGround->mNumX << "x" << pGround->mNumZ << " in " << tBake * 1.0e-3 << " ms, ";
+		cout << "cast " << double(npnt) / tCast << " Mq/s (" << ncast << " hits), cache " << double(npnt) / tLookup << " Mq/s (" << nlookup << " hits)" << endl;
+		delete[] pGroundHits;
+		GWCollision::GroundCache::destroy(pGround);
+	}
+
+	delete[] pSegs;
+	delete[] pHits;
+	delete[] pRef;
+	GWResource::unload(pCls);
+	cout << "=====================" << endl;
+}
+
+void test_bp_bench() {
+	using namespace std;
+	GWBase::Random rnd(3);
+	// constant density, the time per object should stay flat as the count grows
+	for (int n = 10000; n <= 160000; n *= 4) {
+		float extent = 25.0f * ::cbrtf(float(n) / 1000.0f);
+		GWSphereF* pSph = new GWSphereF[n];
+		for (int i = 0; i < n; ++i) {
+			pSph[i] = GWSphereF(rnd.f01() * extent, rnd.f01() * extent, rnd.f01() * extent, 0.2f + rnd.f01() * 0.8f);
+		}
+		GWBroadphase::SpatialHash* pHash = GWBroadphase::SpatialHash::create();
+		double t0 = GWSys::time_micros();
+		pHash->build(pSph, n, false);
+		double tBuild = GWSys::time_micros() - t0;
+		t0 = GWSys::time_micros();
+		pHash->build(pSph, n, true);
+		double tBuildPar = GWSys::time_micros() - t0;
+		t0 = GWSys::time_micros();
+		int npair = pHash->find_pairs(false);
+		double tFind = GWSys::time_micros() - t0;
+		t0 = GWSys::time_micros();
+		pHash->find_pairs(true);
+		double tFindPar = GWSys::time_micros() - t0;
+		cout << "spatial hash, " << n << " spheres, " << npair << " pairs: build " << tBuild * 1.0e-3 << " / " << tBuildPar * 1.0e-3;
+		cout << " ms, pairs " << tFind * 1.0e-3 << " / " << tFindPar * 1.0e-3 << " ms (serial / parallel), ";
+		cout << (tBuild + tFind) * 1.0e3 / n << " ns per sphere" << endl;
+		if (n == 10000) {
+			t0 = GWSys::time_micros();
+			int nbrute = 0;
+			for (int i = 0; i < n; ++i) {
+				for (int j = i + 1; j < n; ++j) {
+					float r = pSph[i].r + pSph[j].r;
+					if ((pSph[i].c - pSph[j].c).length_sq() <= r * r) { ++nbrute; }
+				}
+			}
+			cout << "brute force: " << (GWSys::time_micros() - t0) * 1.0e-3 << " ms, " << nbrute << " pairs" << endl;
+		}
+		GWBroadphase::SpatialHash::destroy(pHash);
+
+		// sort-and-sweep over the same spheres, then over boxes jittered a little and resorted in place
+		GWVectorF* pMin = new GWVectorF[n];
+		GWVectorF* pMax = new GWVectorF[n];
+		for (int i = 0; i < n; ++i) {
+			pMin[i] = pSph[i].c - GWVectorF(pSph[i].r);
+			pMax[i] = pSph[i].c + GWVectorF(pSph[i].r);
+		}
+		GWBroadphase::SweepAndPrune* pSAP = GWBroadphase::SweepAndPrune::create();
+		t0 = GWSys::time_micros();
+		pSAP->build(pMin, pMax, n);
+		tBuild = GWSys::time_micros() - t0;
+		t0 = GWSys::time_micros();
+		npair = pSAP->find_pairs();
+		tFind = GWSys::time_micros() - t0;
+		for (int i = 0; i < n; ++i) {
+			GWVectorF move(rnd.f01() - 0.5f, rnd.f01() - 0.5f, rnd.f01() - 0.5f);
+			move *= 0.1f;
+			pMin[i] += move;
+			pMax[i] += move;
+		}
+		t0 = GWSys::time_micros();
+		pSAP->update(pMin, pMax);
+		double tUpdate = GWSys::time_micros() - t0;
+		cout << "sort and sweep: " << npair << " box pairs, build " << tBuild * 1.0e-3 << " ms, pairs " << tFind * 1.0e-3;
+		cout << " ms, update " << tUpdate * 1.0e-3 << " ms (" << pSAP->get_num_swaps() << " swaps)" << endl;
+		GWBroadphase::SweepAndPrune::destroy(pSAP);
+		delete[] pMin;
+		delete[] pMax;
+		delete[] pSph;
+	}
+
+	// one sphere in a hundred is large: the grid keeps them out, the sweep is not affected
+	const int n = 40000;
+	float extent = 25.0f * ::cbrtf(float(n) / 1000.0f);
+	GWSphereF* pSph = new GWSphereF[n];
+	GWVectorF* pMin = new GWVectorF[n];
+	GWVectorF* pMax = new GWVectorF[n];
+	for (int i = 0; i < n; ++i) {
+		float r = (i % 100) ? 0.2f + rnd.f01() * 0.8f : 5.0f + rnd.f01() * 10.0f;
+		pSph[i] = GWSphereF(rnd.f01() * extent, rnd.f01() * extent, rnd.f01() * extent, r);
+		pMin[i] = pSph[i].c - GWVectorF(r);
+		pMax[i] = pSph[i].c + GWVectorF(r);
+	}
+	GWBroadphase::SpatialHash* pHash = GWBroadphase::SpatialHash::create();
+	double t0 = GWSys::time_micros();
+	pHash->build(pSph, n);
+	int npair = pHash->find_pairs();
+	double tHash = GWSys::time_micros() - t0;
+	GWBroadphase::SweepAndPrune* pSAP = GWBroadphase::SweepAndPrune::create();
+	t0 = GWSys::time_micros();
+	pSAP->build(pMin, pMax, n);
+	int nboxPair = pSAP->find_pairs();
+	double tSAP = GWSys::time_micros() - t0;
+	cout << "mixed sizes, " << n << " objects: spatial hash " << tHash * 1.0e-3 << " ms (" << npair << " pairs, " << pHash->get_num_large() << " large)";
+	cout << ", sort and sweep " << tSAP * 1.0e-3 << " ms (" << nboxPair << " box pairs)" << endl;
+	GWBroadphase::SpatialHash::destroy(pHash);
+	GWBroadphase::SweepAndPrune::destroy(pSAP);
+	delete[] pSph;
+	delete[] pMin;
+	delete[] pMax;
+	cout << "=====================" << endl;
+}
+
+void test_sparse_bench() {
+	using namespace std;
+	// Laplacian smoothing (I + L) x = b over a grid mesh of 10^6 points
+	const int w = 1000;
+	const int n = w * w;
+	uint32_t* pTris = new uint32_t[(w - 1) * (w - 1) * 6];
+	int ntri = 0;
+	for (int y = 0; y < w - 1; ++y) {
+		for (int x = 0; x < w - 1; ++x) {
+			uint32_t p = uint32_t(y * w + x);
+			uint32_t quad[] = { p, p + 1, p + w + 1, p, p + w + 1, p + w };
+			std::copy_n(quad, 6, pTris + ntri * 3);
+			ntri += 2;
+		}
+	}
+	double t0 = GWSys::time_micros();
+	GWSparse::CSRMatrix* pMtx = GWSparse::CSRMatrix::from_triangles(pTris, ntri, n);
+	pMtx->set_laplacian(1.0f, 1.0f);
+	cout << "sparse " << n << " points, " << pMtx->mNumNonZero << " entries: build " << (GWSys::time_micros() - t0) * 1.0e-3 << " ms" << endl;
+	delete[] pTris;
+
+	float* pRH = new float[n];
+	float* pAns = new float[n];
+	GWBase::Random rnd(5);
+	for (int i = 0; i < n; ++i) {
+		pRH[i] = rnd.f01();
+	}
+	const GWSparse::PrecondKind kinds[] = { GWSparse::PrecondKind::JACOBI, GWSparse::PrecondKind::IC0 };
+	const char* pNames[] = { "jacobi", "ic0" };
+	for (int k = 0; k < 2; ++k) {
+		t0 = GWSys::time_micros();
+		GWSparse::Preconditioner* pPrecond = GWSparse::Preconditioner::create(*pMtx, kinds[k]);
+		double tPrecond = GWSys::time_micros() - t0;
+		std::fill_n(pAns, n, 0.0f);
+		t0 = GWSys::time_micros();
+		int iter = GWSparse::cg_solve(*pMtx, pAns, pRH, pPrecond);
+		double tSolve = GWSys::time_micros() - t0;
+		// the next frame, a small change solved from the previous answer
+		for (int i = 0; i < n; i += 7) {
+			pRH[i] += 0.01f;
+		}
+		t0 = GWSys::time_micros();
+		int warmIter = GWSparse::cg_solve(*pMtx, pAns, pRH, pPrecond);
+		double tWarm = GWSys::time_micros() - t0;
+		cout << "cg " << pNames[k] << ": setup " << tPrecond * 1.0e-3 << " ms, " << iter << " iterations " << tSolve * 1.0e-3;
+		cout << " ms, warm start " << warmIter << " iterations " << tWarm * 1.0e-3 << " ms" << endl;
+		GWSparse::Preconditioner::destroy(pPrecond);
+	}
+	GWSparse::CSRMatrix::destroy(pMtx);
+	delete[] pRH;
+	delete[] pAns;
+	cout << "=====================" << endl;
+}
+
 int main(int argc, char* argv[]) {
 
 	test_basic();
@@ -632,13 +1427,23 @@ int main(int argc, char* argv[]) {
 	test_vec();
 	test_ray();
 	test_xform();
+	test_xform_bench();
+	test_quat_bench();
+	test_math_bench();
+	test_rng_bench();
+	test_soa_bench();
+	test_bv_bench();
 	test_quat();
 	test_isect();
 	test_overlap();
+	test_bp_bench();
+	test_sparse_bench();
 	test_color();
 	test_motion("./data/walk_rn.txt");
 	test_image("./data/pano_test1_h.dds");
+	test_sh_bench();
 	if (argc > 1) { test_model(argv[1]); }
+	if (argc > 2) { test_cls_bench(argv[2]); }
 	test_gwcat("./data/cook_rb/cook_rb.gwcat");
 	//test_bundle("./data/cook_rb/","cook_rb.gwcat");
 	test_resource_registry(argv[0], "./data", "cook_rb");
@@ -10,7 +10,16 @@ static TEST_ENTRY s_tests[] = {
 	TEST_DECL(test_inner),
 	TEST_DECL(test_mtx),
 	TEST_DECL(test_xform),
-	TEST_DECL(test_isect)
+	TEST_DECL(test_isect),
+	TEST_DECL(test_cls),
+	TEST_DECL(test_task),
+	TEST_DECL(test_broadphase),
+	TEST_DECL(test_sh),
+	TEST_DECL(test_fast_math),
+	TEST_DECL(test_sparse),
+	TEST_DECL(test_rng),
+	TEST_DECL(test_soa),
+	TEST_DECL(test_bv)
 };
 
 int run_all_tests() {
@@ -13,7 +13,7 @@ template<typename T>
 bool compare_mtx(const T* mtx0, const T* mtx1, int m, int n) {
 	for (int i = 0; i < m; ++i) {
 		int ri = i * n;
-		if (!GWMatrix::tup_almost_eq(&mtx0[ri], &mtx1[ri], n, 0.001f)) { return false; }
+		if (!GWMatrix::tup_almost_eq(&mtx0[ri], &mtx1[ri], n, T(0.001f))) { return false; }
 	}
 	return true;
 }
@@ -43,5 +43,14 @@ bool test_mtx();
 bool test_xform();
 bool test_inner();
 bool test_isect();
+bool test_cls();
+bool test_task();
+bool test_broadphase();
+bool test_sh();
+bool test_fast_math();
+bool test_sparse();
+bool test_rng();
+bool test_soa();
+bool test_bv();
 
 int run_all_tests();
@@ -0,0 +1,213 @@
+/*
+ * Groundwork broadphase tests
+ * Author: Gleb Novodran <novodran@gmail.com>
+ */
+
+#include <vector>
+#include <algorithm>
+#include <groundwork.hpp>
+#include "test.hpp"
+
+static bool pair_less(const GWBroadphase::Pair& a, const GWBroadphase::Pair& b) {
+	return a.mA < b.mA || (a.mA == b.mA && a.mB < b.mB);
+}
+
+static GWSphereF gen_sphere(GWBase::Random& rnd, float extent, float maxRad) {
+	float x = float(rnd.d01()) * extent;
+	float y = float(rnd.d01()) * extent;
+	float z = float(rnd.d01()) * extent;
+	return GWSphereF(x, y, z, float(0.05 + rnd.d01()) * maxRad);
+}
+
+static std::vector<GWBroadphase::Pair> brute_pairs(const std::vector<GWSphereF>& sph) {
+	std::vector<GWBroadphase::Pair> pairs;
+	int n = int(sph.size());
+	for (int i = 0; i < n; ++i) {
+		for (int j = i + 1; j < n; ++j) {
+			float r = sph[i].r + sph[j].r;
+			if ((sph[i].c - sph[j].c).length_sq() <= r * r) {
+				GWBroadphase::Pair pair;
+				pair.mA = i;
+				pair.mB = j;
+				pairs.push_back(pair);
+			}
+		}
+	}
+	return pairs;
+}
+
+static bool check_pairs(GWBroadphase::SpatialHash* pHash, const std::vector<GWSphereF>& sph) {
+	std::vector<GWBroadphase::Pair> ref = brute_pairs(sph);
+	int npair = pHash->find_pairs(false);
+	std::vector<GWBroadphase::Pair> serial(pHash->get_pairs(), pHash->get_pairs() + npair);
+	// same pairs in the same order whether run in parallel or not
+	if (pHash->find_pairs(true) != npair) { return false; }
+	for (int i = 0; i < npair; ++i) {
+		const GWBroadphase::Pair& pair = pHash->get_pairs()[i];
+		if (pair.mA != serial[i].mA || pair.mB != serial[i].mB) { return false; }
+	}
+	if (npair != int(ref.size())) { return false; }
+	std::sort(serial.begin(), serial.end(), pair_less);
+	for (int i = 0; i < npair; ++i) {
+		if (serial[i].mA != ref[i].mA || serial[i].mB != ref[i].mB) { return false; }
+	}
+	return true;
+}
+
+static bool test_spatial_hash() {
+	const int n = 3000;
+	const float extent = 40.0f;
+	GWBase::Random rnd(5);
+	std::vector<GWSphereF> sph(n);
+	for (int i = 0; i < n; ++i) {
+		sph[i] = gen_sphere(rnd, extent, 1.0f);
+	}
+	// a few spheres spanning many cells
+	for (int i = 0; i < 5; ++i) {
+		sph[rnd.u64() % n].r = 6.0f;
+	}
+
+	GWBroadphase::SpatialHash* pHash = GWBroadphase::SpatialHash::create();
+	pHash->build(sph.data(), n);
+	bool res = pHash->get_num_large() == 5 && check_pairs(pHash, sph);
+
+	// small moves stay incremental
+	for (int step = 0; res && step < 4; ++step) {
+		std::vector<int32_t> idx;
+		std::vector<GWSphereF> moved;
+		for (int i = 0; i < 15; ++i) {
+			int32_t j = int32_t(rnd.u64() % n);
+			GWSphereF s = sph[j];
+			s.c += GWVectorF(float(rnd.d01() - 0.5), float(rnd.d01() - 0.5), float(rnd.d01() - 0.5)) * 2.0f;
+			sph[j] = s;
+			idx.push_back(j);
+			moved.push_back(s);
+		}
+		pHash->update(idx.data(), moved.data(), int(idx.size()));
+		res = pHash->get_num_moved() > 0 && check_pairs(pHash, sph);
+	}
+
+	// everything moves, the grid is rebuilt
+	if (res) {
+		std::vector<int32_t> idx(n);
+		for (int i = 0; i < n; ++i) {
+			idx[i] = i;
+			sph[i] = gen_sphere(rnd, extent, 1.0f);
+		}
+		pHash->update(idx.data(), sph.data(), n);
+		res = pHash->get_num_moved() == 0 && check_pairs(pHash, sph);
+	}
+
+	// one sphere growing out of the grid
+	if (res) {
+		sph[7].r = 10.0f;
+		pHash->update(7, sph[7]);
+		res = pHash->get_num_large() == 1 && check_pairs(pHash, sph);
+	}
+
+	GWBroadphase::SpatialHash::destroy(pHash);
+	return res;
+}
+
+static bool check_sap_pairs(GWBroadphase::SweepAndPrune* pSAP, const std::vector<GWVectorF>& bbMin, const std::vector<GWVectorF>& bbMax) {
+	std::vector<GWBroadphase::Pair> ref;
+	int n = int(bbMin.size());
+	for (int i = 0; i < n; ++i) {
+		for (int j = i + 1; j < n; ++j) {
+			if (GWOverlap::aabb_aabb(bbMin[i], bbMax[i], bbMin[j], bbMax[j])) {
+				GWBroadphase::Pair pair;
+				pair.mA = i;
+				pair.mB = j;
+				ref.push_back(pair);
+			}
+		}
+	}
+	int npair = pSAP->find_pairs(false);
+	std::vector<GWBroadphase::Pair> serial(pSAP->get_pairs(), pSAP->get_pairs() + npair);
+	if (pSAP->find_pairs(true) != npair) { return false; }
+	for (int i = 0; i < npair; ++i) {
+		const GWBroadphase::Pair& pair = pSAP->get_pairs()[i];
+		if (pair.mA != serial[i].mA || pair.mB != serial[i].mB) { return false; }
+	}
+	if (npair != int(ref.size())) { return false; }
+	std::sort(serial.begin(), serial.end(), pair_less);
+	for (int i = 0; i < npair; ++i) {
+		if (serial[i].mA != ref[i].mA || serial[i].mB != ref[i].mB) { return false; }
+	}
+	return true;
+}
+
+static void gen_box(GWBase::Random& rnd, float extent, GWVectorF& bbMin, GWVectorF& bbMax) {
+	GWVectorF pos(float(rnd.d01()), float(rnd.d01()), float(rnd.d01()));
+	GWVectorF size(float(rnd.d01()), float(rnd.d01()), float(rnd.d01()));
+	// mostly small boxes, some long and thin along one axis
+	size *= 0.5f;
+	if (rnd.u64() % 8 == 0) {
+		size.elems[rnd.u64() % 3] *= 40.0f;
+	}
+	bbMin = pos * extent;
+	bbMax = bbMin + size;
+}
+
+static bool test_sap() {
+	const int n = 3000;
+	const float extent = 30.0f;
+	GWBase::Random rnd(9);
+	std::vector<GWVectorF> bbMin(n);
+	std::vector<GWVectorF> bbMax(n);
+	for (int i = 0; i < n; ++i) {
+		gen_box(rnd, extent, bbMin[i], bbMax[i]);
+	}
+	// boxes sharing a min x and touching faces
+	bbMin[1] = bbMin[0];
+	bbMax[1] = bbMax[0];
+	bbMin[2].x = bbMax[0].x;
+
+	GWBroadphase::SweepAndPrune* pSAP = GWBroadphase::SweepAndPrune::create();
+	pSAP->build(bbMin.data(), bbMax.data(), n);
+	bool res = check_sap_pairs(pSAP, bbMin, bbMax);
+
+	// coherent motion is resorted in place
+	for (int step = 0; res && step < 4; ++step) {
+		for (int i = 0; i < n; ++i) {
+			GWVectorF move(float(rnd.d01() - 0.5), float(rnd.d01() - 0.5), float(rnd.d01() - 0.5));
+			move *= 0.2f;
+			bbMin[i] += move;
+			bbMax[i] += move;
+		}
+		pSAP->update(bbMin.data(), bbMax.data());
+		res = pSAP->get_num_swaps() <= n * 8 && check_sap_pairs(pSAP, bbMin, bbMax);
+	}
+
+	// a few objects updated by index
+	if (res) {
+		std::vector<int32_t> idx;
+		std::vector<GWVectorF> newMin;
+		std::vector<GWVectorF> newMax;
+		for (int i = 0; i < 20; ++i) {
+			int32_t j = int32_t(rnd.u64() % n);
+			gen_box(rnd, extent, bbMin[j], bbMax[j]);
+			idx.push_back(j);
+			newMin.push_back(bbMin[j]);
+			newMax.push_back(bbMax[j]);
+		}
+		pSAP->update(idx.data(), newMin.data(), newMax.data(), int(idx.size()));
+		res = check_sap_pairs(pSAP, bbMin, bbMax);
+	}
+
+	// scattered, falls back to the full sort
+	if (res) {
+		for (int i = 0; i < n; ++i) {
+			gen_box(rnd, extent, bbMin[i], bbMax[i]);
+		}
+		pSAP->update(bbMin.data(), bbMax.data());
+		res = check_sap_pairs(pSAP, bbMin, bbMax);
+	}
+
+	GWBroadphase::SweepAndPrune::destroy(pSAP);
+	return res;
+}
+
+bool test_broadphase() {
+	return test_spatial_hash() && test_sap();
+}
@@ -0,0 +1,211 @@
+/*
+ * Groundwork bounding volume tests
+ * Author: Gleb Novodran <novodran@gmail.com>
+ */
+
+#include <vector>
+#include <groundwork.hpp>
+#include "test.hpp"
+
+static std::vector<float> gen_vals(GWBase::Random& rnd, int n) {
+	std::vector<float> vals(n);
+	for (int i = 0; i < n; ++i) {
+		vals[i] = rnd.f01() * 200.0f - 100.0f;
+	}
+	return vals;
+}
+
+static std::vector<GWVectorF> gen_cloud(GWBase::Random& rnd, int n) {
+	std::vector<GWVectorF> pnts(n);
+	for (int i = 0; i < n; ++i) {
+		float x = rnd.f01() * 6.0f - 3.0f;
+		float y = rnd.f01() * 2.0f + 1.0f;
+		pnts[i] = GWVectorF(x, y, rnd.f01() * 4.0f);
+	}
+	return pnts;
+}
+
+static float max_dist(const std::vector<GWVectorF>& pnts, const GWVectorF& c) {
+	float res = 0.0f;
+	for (size_t i = 0; i < pnts.size(); ++i) {
+		res = std::max(res, (pnts[i] - c).length());
+	}
+	return res;
+}
+
+static bool test_range() {
+	GWBase::Random rnd(50);
+	const int sizes[] = { 1, 3, 7, 24, 100, 50001 };
+	for (int k = 0; k < 6; ++k) {
+		for (int ncomp = 1; ncomp <= 4; ++ncomp) {
+			int n = sizes[k];
+			std::vector<float> vals = gen_vals(rnd, n * ncomp);
+			float refMin[4], refMax[4], vmin[4], vmax[4], smin[4], smax[4];
+			std::copy(vals.begin(), vals.begin() + ncomp, refMin);
+			std::copy(vals.begin(), vals.begin() + ncomp, refMax);
+			for (int i = 0; i < n * ncomp; ++i) {
+				refMin[i % ncomp] = std::min(refMin[i % ncomp], vals[i]);
+				refMax[i % ncomp] = std::max(refMax[i % ncomp], vals[i]);
+			}
+			GWBase::calc_range(vmin, vmax, vals.data(), n, ncomp);
+			GWBase::calc_range(smin, smax, vals.data(), n, ncomp, false);
+			if (!std::equal(refMin, refMin + ncomp, vmin) || !std::equal(refMax, refMax + ncomp, vmax)) { return false; }
+			if (!std::equal(vmin, vmin + ncomp, smin) || !std::equal(vmax, vmax + ncomp, smax)) { return false; }
+		}
+	}
+
+	std::vector<GWVectorF> pnts = gen_cloud(rnd, 20000);
+	GWVectorF minVal, maxVal;
+	GWTuple::calc_bbox(pnts.data(), uint32_t(pnts.size()), minVal, maxVal);
+	for (size_t i = 0; i < pnts.size(); ++i) {
+		for (int j = 0; j < 3; ++j) {
+			if (pnts[i][j] < minVal[j] || pnts[i][j] > maxVal[j]) { return false; }
+		}
+	}
+	// nothing is written for no items
+	GWVectorF untouched = minVal;
+	GWTuple::calc_bbox(pnts.data(), 0, minVal, maxVal);
+	return minVal.x == untouched.x && minVal.y == untouched.y && minVal.z == untouched.z;
+}
+
+// The first of equal values is picked, also across the lanes and the chunks.
+static bool test_extremes() {
+	GWBase::Random rnd(51);
+	const int sizes[] = { 1, 2, 9, 33, 1000, 70000 };
+	for (int k = 0; k < 6; ++k) {
+		for (int ncomp = 1; ncomp <= 4; ++ncomp) {
+			int n = sizes[k];
+			std::vector<float> vals = gen_vals(rnd, n * ncomp);
+			if (n > 100) {
+				// copies of the extremes earlier and later than the original
+				int lo = 0;
+				int hi = 0;
+				for (int i = 1; i < n; ++i) {
+					if (vals[i * ncomp] < vals[lo * ncomp]) { lo = i; }
+					if (vals[i * ncomp] > vals[hi * ncomp]) { hi = i; }
+				}
+				vals[(n - 1) * ncomp] = vals[lo * ncomp];
+				vals[(lo / 2) * ncomp] = vals[lo * ncomp];
+				vals[(n / 2 + 3) * ncomp] = vals[hi * ncomp];
+			}
+			int refMin[4] = { 0, 0, 0, 0 };
+			int refMax[4] = { 0, 0, 0, 0 };
+			for (int i = 1; i < n; ++i) {
+				for (int j = 0; j < ncomp; ++j) {
+					if (vals[i * ncomp + j] < vals[refMin[j] * ncomp + j]) { refMin[j] = i; }
+					if (vals[i * ncomp + j] > vals[refMax[j] * ncomp + j]) { refMax[j] = i; }
+				}
+			}
+			int imin[4], imax[4], smin[4], smax[4];
+			GWBase::calc_extremes(imin, imax, vals.data(), n, ncomp);
+			GWBase::calc_extremes(smin, smax, vals.data(), n, ncomp, false);
+			if (!std::equal(refMin, refMin + ncomp, imin) || !std::equal(refMax, refMax + ncomp, imax)) { return false; }
+			if (!std::equal(imin, imin + ncomp, smin) || !std::equal(imax, imax + ncomp, smax)) { return false; }
+		}
+	}
+	return true;
+}
+
+static bool test_ritter() {
+	GWBase::Random rnd(52);
+	const int sizes[] = { 1, 2, 5, 100, 40000 };
+	for (int k = 0; k < 5; ++k) {
+		std::vector<GWVectorF> pnts = gen_cloud(rnd, sizes[k]);
+		int n = sizes[k];
+		GWSphereF sph, serial;
+		sph.ritter(pnts.data(), n);
+		serial.ritter(pnts.data(), n, false);
+		if (sph.c.x != serial.c.x || sph.c.y != serial.c.y || sph.c.z != serial.c.z || sph.r != serial.r) { return false; }
+		if (max_dist(pnts, sph.c) > sph.r) { return false; }
+
+		std::vector<GWVectorD> pntsD(n);
+		for (int i = 0; i < n; ++i) {
+			pntsD[i] = GWVectorD(pnts[i].x, pnts[i].y, pnts[i].z);
+		}
+		GWSphereD sphD;
+		sphD.ritter(pntsD.data(), n);
+		if (std::fabs(sphD.r - sph.r) > 1.0e-4 * sph.r) { return false; }
+	}
+	GWSphereF empty(1.0f, 2.0f, 3.0f, 4.0f);
+	empty.ritter(static_cast<const GWVectorF*>(nullptr), 0);
+	return empty.r == 0.0f;
+}
+
+// The max distance is a convex function of the center, so there is no better center around the minimal one.
+static bool check_minimal(const std::vector<GWVectorF>& pnts, const GWSphereF& sph) {
+	// distances in floats here
+	if (max_dist(pnts, sph.c) > sph.r * (1.0f + 1.0e-6f)) { return false; }
+	float step = std::max(sph.r * 1.0e-3f, 1.0e-6f);
+	for (int i = 0; i < 200; ++i) {
+		GWVectorF dir;
+		GWBase::Philox dirRnd(7, i);
+		dirRnd.dir_sphere(dir.x, dir.y, dir.z);
+		if (max_dist(pnts, sph.c + dir * step) < sph.r - step * 1.0e-2f) { return false; }
+	}
+	return true;
+}
+
+static bool test_welzl() {
+	GWBase::Random rnd(53);
+	for (int t = 0; t < 20; ++t) {
+		int n = 5 + t * 7;
+		std::vector<GWVectorF> pnts = gen_cloud(rnd, n);
+		GWSphereF sph, other, rit;
+		sph.welzl(pnts.data(), n);
+		other.welzl(pnts.data(), n, 12345);
+		rit.ritter(pnts.data(), n);
+		if (!check_minimal(pnts, sph)) { return false; }
+		if (std::fabs(other.r - sph.r) > 1.0e-5f * sph.r || sph.r > rit.r) { return false; }
+	}
+
+	// points over the unit sphere, a regular tetrahedron, the corners of a cube
+	const int nsph = 3000;
+	std::vector<GWVectorF> pnts(nsph);
+	GWBase::Philox dirs(3);
+	dirs.fill_sphere(pnts[0].elems, nsph);
+	GWSphereF sph;
+	sph.welzl(pnts.data(), nsph);
+	if (sph.r > 1.0f + 1.0e-5f || sph.r < 0.99f || sph.c.length() > 0.01f) { return false; }
+
+	std::vector<GWVectorF> tet = { GWVectorF(1, 1, 1), GWVectorF(1, -1, -1), GWVectorF(-1, 1, -1), GWVectorF(-1, -1, 1) };
+	sph.welzl(tet.data(), 4);
+	if (std::fabs(sph.r - std::sqrt(3.0f)) > 1.0e-6f || sph.c.length() > 1.0e-6f) { return false; }
+
+	std::vector<GWVectorF> cube;
+	for (int i = 0; i < 8; ++i) {
+		cube.push_back(GWVectorF(float(i & 1), float((i >> 1) & 1), float((i >> 2) & 1)));
+		// interior and face points don't change it
+		cube.push_back(GWVectorF(0.5f, 0.5f, float(i) / 7.0f));
+	}
+	sph.welzl(cube.data(), int(cube.size()));
+	if (std::fabs(sph.r - std::sqrt(0.75f)) > 1.0e-6f || (sph.c - GWVectorF(0.5f)).length() > 1.0e-6f) { return false; }
+
+	// degenerate sets: a single point repeated, collinear and coplanar points
+	std::vector<GWVectorF> same(10, GWVectorF(1.0f, -2.0f, 3.0f));
+	sph.welzl(same.data(), int(same.size()));
+	if (sph.r != 0.0f || sph.c.x != 1.0f) { return false; }
+	std::vector<GWVectorF> line;
+	std::vector<GWVectorF> square;
+	for (int i = 0; i <= 10; ++i) {
+		line.push_back(GWVectorF(float(i), float(i) * 2.0f, 0.0f));
+		for (int j = 0; j <= 10; ++j) {
+			square.push_back(GWVectorF(float(i), float(j), 5.0f));
+		}
+	}
+	sph.welzl(line.data(), int(line.size()));
+	if (std::fabs(sph.r - std::sqrt(125.0f)) > 1.0e-5f) { return false; }
+	sph.welzl(square.data(), int(square.size()));
+	if (std::fabs(sph.r - std::sqrt(50.0f)) > 1.0e-5f || std::fabs(sph.c.z - 5.0f) > 1.0e-5f) { return false; }
+	return true;
+}
+
+static TEST_ENTRY s_bv_tests[] = {
+	TEST_DECL(test_range),
+	TEST_DECL(test_extremes),
+	TEST_DECL(test_ritter),
+	TEST_DECL(test_welzl)
+};
+
+bool test_bv() {
+	return 0 == EXEC_TESTS(s_bv_tests);
+}
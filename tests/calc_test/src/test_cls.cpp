@@ -0,0 +1,891 @@
+/*
+ * Groundwork collision query tests
+ * Author: Gleb Novodran <novodran@gmail.com>
+ */
+
+#include <atomic>
+#include <cfloat>
+#include <vector>
+#include <algorithm>
+#include <groundwork.hpp>
+#include "test.hpp"
+
+// Builds an in-memory collision resource: a bumpy grid made of quads and triangle pairs
+// plus a number of free-floating triangles, with a median split BVH.
+struct ClsBuilder {
+	std::vector<GWVectorF> mPnts;
+	std::vector<GWCollisionResource::Poly> mPols;
+	std::vector<int32_t> mIdx;
+	std::vector<int32_t> mTris;
+	std::vector<GWCollisionResource::BVHNode> mNodes;
+	std::vector<int32_t> mPolIds;
+
+	void add_poly(const int32_t* pVtx, int nvtx) {
+		GWCollisionResource::Poly pol;
+		pol.mOffsIdx = int32_t(mIdx.size());
+		pol.mNumVtx = nvtx;
+		pol.mOffsTris = nvtx > 3 ? int32_t(mTris.size()) : -1;
+		GWVectorF v[4];
+		for (int i = 0; i < nvtx; ++i) {
+			mIdx.push_back(pVtx[i]);
+			v[i] = mPnts[pVtx[i]];
+		}
+		GWTuple::calc_bbox(v, nvtx, pol.mBBoxMin, pol.mBBoxMax);
+		pol.mNormal = GWVector::cross(v[0] - v[1], v[2] - v[1]);
+		pol.mNormal.normalize();
+		if (nvtx > 3) {
+			static const int32_t quadTris[] = { 0, 1, 2, 0, 2, 3 };
+			mTris.insert(mTris.end(), quadTris, quadTris + 6);
+		}
+		mPols.push_back(pol);
+	}
+
+	void build_geo(int gridSize, int nfloat, GWBase::Random& rnd) {
+		float cell = 1.0f;
+		for (int j = 0; j <= gridSize; ++j) {
+			for (int i = 0; i <= gridSize; ++i) {
+				float y = 0.5f * std::sin(float(i) * 0.7f) * std::cos(float(j) * 0.4f);
+				mPnts.push_back(GWVectorF(float(i) * cell, y, float(j) * cell));
+			}
+		}
+		int row = gridSize + 1;
+		for (int j = 0; j < gridSize; ++j) {
+			for (int i = 0; i < gridSize; ++i) {
+				int32_t quad[4] = { j*row + i, j*row + i + 1, (j + 1)*row + i + 1, (j + 1)*row + i };
+				if ((i + j) & 1) {
+					add_poly(quad, 4);
+				} else {
+					int32_t tri0[3] = { quad[0], quad[1], quad[2] };
+					int32_t tri1[3] = { quad[0], quad[2], quad[3] };
+					add_poly(tri0, 3);
+					add_poly(tri1, 3);
+				}
+			}
+		}
+		float ext = float(gridSize) * cell;
+		for (int i = 0; i < nfloat; ++i) {
+			GWVectorF c(rnd.f01() * ext, 1.0f + rnd.f01() * 3.0f, rnd.f01() * ext);
+			int32_t vtx[3];
+			for (int k = 0; k < 3; ++k) {
+				GWVectorF offs(rnd.f01() - 0.5f, rnd.f01() - 0.5f, rnd.f01() - 0.5f);
+				vtx[k] = int32_t(mPnts.size());
+				mPnts.push_back(c + offs * 2.0f);
+			}
+			add_poly(vtx, 3);
+		}
+	}
+
+	// Closed lat-long mesh around ctr with random radii: sharp spikes and concave pits at the vertices,
+	// front faces outwards.
+	void build_spiky(const GWVectorF& ctr, int nlat, int nlon, GWBase::Random& rnd) {
+		const float pi = 3.14159265f;
+		mPnts.push_back(ctr + GWVectorF(0.0f, 1.0f, 0.0f));
+		for (int i = 1; i < nlat; ++i) {
+			float theta = pi * float(i) / float(nlat);
+			for (int j = 0; j < nlon; ++j) {
+				float phi = 2.0f * pi * float(j) / float(nlon);
+				float r = 0.2f + rnd.f01() * 2.0f;
+				mPnts.push_back(ctr + GWVectorF(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi)) * r);
+			}
+		}
+		int32_t south = int32_t(mPnts.size());
+		mPnts.push_back(ctr - GWVectorF(0.0f, 1.0f, 0.0f));
+		std::vector<int32_t> tris;
+		for (int j = 0; j < nlon; ++j) {
+			int32_t j1 = (j + 1) % nlon;
+			int32_t tri0[3] = { 0, 1 + j, 1 + j1 };
+			tris.insert(tris.end(), tri0, tri0 + 3);
+			for (int i = 1; i < nlat - 1; ++i) {
+				int32_t a = 1 + (i - 1) * nlon;
+				int32_t b = a + nlon;
+				int32_t quad[6] = { a + j, b + j, b + j1, a + j, b + j1, a + j1 };
+				tris.insert(tris.end(), quad, quad + 6);
+			}
+			int32_t last = 1 + (nlat - 2) * nlon;
+			int32_t tri1[3] = { last + j, south, last + j1 };
+			tris.insert(tris.end(), tri1, tri1 + 3);
+		}
+		// the front normal is cross(v2 - v0, v1 - v0), which makes the volume below negative
+		float vol = 0.0f;
+		for (size_t i = 0; i < tris.size(); i += 3) {
+			vol += GWVector::dot(mPnts[tris[i]] - ctr, GWVector::cross(mPnts[tris[i + 1]] - ctr, mPnts[tris[i + 2]] - ctr));
+		}
+		for (size_t i = 0; i < tris.size(); i += 3) {
+			if (vol > 0.0f) { std::swap(tris[i + 1], tris[i + 2]); }
+			add_poly(&tris[i], 3);
+		}
+	}
+
+	int32_t build_node(int begin, int end) {
+		int32_t nodeIdx = int32_t(mNodes.size());
+		mNodes.push_back(GWCollisionResource::BVHNode());
+		GWVectorF bbMin = mPols[mPolIds[begin]].mBBoxMin;
+		GWVectorF bbMax = mPols[mPolIds[begin]].mBBoxMax;
+		for (int i = begin + 1; i < end; ++i) {
+			GWTuple::min(bbMin, bbMin, mPols[mPolIds[i]].mBBoxMin);
+			GWTuple::max(bbMax, bbMax, mPols[mPolIds[i]].mBBoxMax);
+		}
+		int32_t left, right;
+		if (end - begin == 1) {
+			left = mPolIds[begin];
+			right = -1;
+		} else {
+			GWVectorF ext = bbMax - bbMin;
+			int axis = ext.x > ext.y ? (ext.x > ext.z ? 0 : 2) : (ext.y > ext.z ? 1 : 2);
+			int mid = (begin + end) / 2;
+			const std::vector<GWCollisionResource::Poly>& pols = mPols;
+			std::nth_element(mPolIds.begin() + begin, mPolIds.begin() + mid, mPolIds.begin() + end,
+				[&pols, axis](int32_t a, int32_t b) {
+					return (pols[a].mBBoxMin[axis] + pols[a].mBBoxMax[axis]) < (pols[b].mBBoxMin[axis] + pols[b].mBBoxMax[axis]);
+				});
+			left = build_node(begin, mid);
+			right = build_node(mid, end);
+		}
+		GWCollisionResource::BVHNode& node = mNodes[nodeIdx];
+		node.mBBoxMin = bbMin;
+		node.mBBoxMax = bbMax;
+		node.mLeft = left;
+		node.mRight = right;
+		return nodeIdx;
+	}
+
+	void build_bvh() {
+		int npol = int(mPols.size());
+		mPolIds.resize(npol);
+		for (int i = 0; i < npol; ++i) { mPolIds[i] = i; }
+		mNodes.reserve(npol * 2);
+		build_node(0, npol);
+	}
+
+	template<typename T> static uint32_t put(std::vector<char>& blob, const std::vector<T>& data) {
+		uint32_t offs = uint32_t(GWBase::align(blob.size(), 0x10));
+		blob.resize(offs + data.size() * sizeof(T));
+		if (!data.empty()) {
+			std::memcpy(&blob[offs], data.data(), data.size() * sizeof(T));
+		}
+		return offs;
+	}
+
+	GWCollisionResource* create() {
+		std::vector<char> blob(sizeof(GWCollisionResource), 0);
+		uint32_t offsPnts = put(blob, mPnts);
+		uint32_t offsPols = put(blob, mPols);
+		uint32_t offsTris = put(blob, mTris);
+		uint32_t offsIdx = put(blob, mIdx);
+		uint32_t offsBVH = put(blob, mNodes);
+		uint32_t dataSize = uint32_t(blob.size());
+		blob.resize(dataSize + sizeof(GWResource::Binding), 0);
+
+		GWCollisionResource* pCls = reinterpret_cast<GWCollisionResource*>(GWSys::alloc_temp_mem(blob.size()));
+		std::memcpy(pCls, blob.data(), blob.size());
+		std::strcpy(pCls->mSignature, GW_RSRC_ID("GWCls"));
+		pCls->mVersion = 0;
+		pCls->mDataSize = dataSize;
+		pCls->mStrsTop = dataSize;
+		pCls->mStrsSize = 0;
+		pCls->mPathOffs = 0;
+		pCls->mNumPnt = int32_t(mPnts.size());
+		pCls->mNumPol = int32_t(mPols.size());
+		pCls->mOffsPnts = offsPnts;
+		pCls->mOffsPols = offsPols;
+		pCls->mOffsTris = offsTris;
+		pCls->mOffsIdx = offsIdx;
+		pCls->mOffsBVH = offsBVH;
+		pCls->mBBoxMin = mNodes[0].mBBoxMin;
+		pCls->mBBoxMax = mNodes[0].mBBoxMax;
+		return pCls;
+	}
+
+	static GWCollisionResource* create(int gridSize, int nfloat, uint64_t seed) {
+		GWBase::Random rnd(seed);
+		ClsBuilder bld;
+		bld.build_geo(gridSize, nfloat, rnd);
+		bld.build_bvh();
+		return bld.create();
+	}
+};
+
+struct ClsBruteFunc : public GWCollisionResource::TriFunc {
+	GWVectorF mP;
+	GWVectorF mQ;
+	bool mFound;
+	float mT;
+
+	ClsBruteFunc(const GWVectorF& p, const GWVectorF& q) : mP(p), mQ(q), mFound(false), mT(1.0f) {}
+
+	virtual void operator ()(GWCollisionResource& cls, GWVectorF vtx[3], GWVectorF nrm, int polIdx, int triIdx) {
+		float t;
+		if (GWIntersect::seg_tri_cw(mP, mQ, vtx[0], vtx[1], vtx[2], (GWVectorF*)nullptr, (GWVectorF*)nullptr, &t)) {
+			if (!mFound || t < mT) {
+				mFound = true;
+				mT = t;
+			}
+		}
+	}
+};
+
+static void gen_segs(GWVectorF* pSegs, int nseg, const GWCollisionResource& cls, GWBase::Random& rnd) {
+	GWVectorF ext = cls.mBBoxMax - cls.mBBoxMin;
+	for (int i = 0; i < nseg; ++i) {
+		GWVectorF p(rnd.f01(), rnd.f01(), rnd.f01());
+		GWVectorF q(rnd.f01(), rnd.f01(), rnd.f01());
+		p = cls.mBBoxMin + p * ext * 1.2f - ext * 0.1f;
+		q = cls.mBBoxMin + q * ext * 1.2f - ext * 0.1f;
+		if (i & 1) {
+			// mostly top-down segments to hit the grid front faces
+			p.y = cls.mBBoxMax.y + 1.0f;
+			q.y = cls.mBBoxMin.y - 1.0f;
+		}
+		pSegs[i * 2] = p;
+		pSegs[i * 2 + 1] = q;
+	}
+}
+
+static bool test_cls_queries(GWCollisionResource* pCls, const GWVectorF* pSegs, int nseg) {
+	int nhit = 0;
+	for (int i = 0; i < nseg; ++i) {
+		GWVectorF p = pSegs[i * 2];
+		GWVectorF q = pSegs[i * 2 + 1];
+		ClsBruteFunc brute(p, q);
+		pCls->for_all_tris(brute, false);
+
+		GWCollision::HitInfo hit;
+		hit.reset();
+		bool found = GWCollision::seg_first_hit(*pCls, p, q, &hit);
+		if (found != brute.mFound) { return false; }
+		if (found != GWCollision::seg_any_hit(*pCls, p, q)) { return false; }
+		if (!found) { continue; }
+		++nhit;
+		if (!GWBase::almost_equal(hit.mT, brute.mT, 1e-5f)) { return false; }
+		if (!pCls->check_poly_idx(hit.mPolIdx)) { return false; }
+		if (hit.mTriIdx < 0 || hit.mTriIdx >= pCls->get_poly_num_tris(hit.mPolIdx)) { return false; }
+		GWVectorF pos = p + (q - p) * hit.mT;
+		if (!COMPARE_VEC(pos, hit.mPos, 1e-4f)) { return false; }
+
+		GWVectorF dir = q - p;
+		float len = dir.length();
+		dir.scl(1.0f / len);
+		GWRayF ray(p, dir);
+		GWCollision::HitInfo rayHit;
+		if (!GWCollision::ray_first_hit(*pCls, ray, len, &rayHit)) { return false; }
+		if (!GWBase::almost_equal(rayHit.mT, hit.mT * len, 1e-3f)) { return false; }
+	}
+	return nhit > 0;
+}
+
+static bool same_hit(const GWCollision::HitInfo& a, const GWCollision::HitInfo& b) {
+	return a.mT == b.mT && a.mPolIdx == b.mPolIdx && a.mTriIdx == b.mTriIdx
+		&& GWTuple::almost_equal(a.mPos, b.mPos, 0.0f) && GWTuple::almost_equal(a.mNrm, b.mNrm, 0.0f);
+}
+
+static bool test_cls_batch(GWCollisionResource* pCls, const GWVectorF* pSegs, int nseg) {
+	GWCollision::HitInfo* pRef = new GWCollision::HitInfo[nseg];
+	GWCollision::HitInfo* pHits = new GWCollision::HitInfo[nseg];
+	GWRayF* pRays = new GWRayF[nseg];
+	bool* pAny = new bool[nseg];
+	const float maxDist = 50.0f;
+	bool res = true;
+	for (int i = 0; i < nseg; ++i) {
+		pRef[i].reset();
+		GWCollision::seg_first_hit(*pCls, pSegs[i * 2], pSegs[i * 2 + 1], &pRef[i]);
+		GWVectorF dir = pSegs[i * 2 + 1] - pSegs[i * 2];
+		dir.normalize();
+		pRays[i] = GWRayF(pSegs[i * 2], dir);
+	}
+	for (int sort = 0; sort < 2 && res; ++sort) {
+		// odd count to get a partial packet
+		int n = nseg - 3;
+		int nhit = GWCollision::segs_first_hit(*pCls, pSegs, n, pHits, sort != 0);
+		int nref = 0;
+		for (int i = 0; i < n; ++i) {
+			if (!same_hit(pHits[i], pRef[i])) { res = false; break; }
+			if (pRef[i].mPolIdx >= 0) { ++nref; }
+		}
+		if (nhit != nref) { res = false; }
+		if (!res) { break; }
+
+		GWCollision::segs_any_hit(*pCls, pSegs, n, pAny, sort != 0);
+		for (int i = 0; i < n; ++i) {
+			if (pAny[i] != (pRef[i].mPolIdx >= 0)) { res = false; break; }
+		}
+		if (!res) { break; }
+
+		GWCollision::rays_first_hit(*pCls, pRays, n, maxDist, pHits, sort != 0);
+		GWCollision::rays_any_hit(*pCls, pRays, n, maxDist, pAny, sort != 0);
+		for (int i = 0; i < n; ++i) {
+			GWCollision::HitInfo ref;
+			ref.reset();
+			bool found = GWCollision::ray_first_hit(*pCls, pRays[i], maxDist, &ref);
+			if (!same_hit(pHits[i], ref) || pAny[i] != found) { res = false; break; }
+		}
+	}
+	delete[] pRef;
+	delete[] pHits;
+	delete[] pRays;
+	delete[] pAny;
+	return res;
+}
+
+static bool test_cls_qbvh(GWCollisionResource* pCls, const GWVectorF* pSegs, int nseg) {
+	if (sizeof(GWCollision::QBVH::Node) != 0x80) { return false; }
+	if (sizeof(GWCollision::QBVH::NodeQ16) != 0x40 || sizeof(GWCollision::QBVH::NodeQ8) != 0x40) { return false; }
+	static const GWCollision::QBVHKind kinds[] = { GWCollision::QBVHKind::FLOAT, GWCollision::QBVHKind::Q16, GWCollision::QBVHKind::Q8 };
+	bool res = true;
+	for (int k = 0; k < 3 && res; ++k) {
+		GWCollision::QBVH* pQBVH = GWCollision::QBVH::create(*pCls, kinds[k]);
+		if (!pQBVH) { return false; }
+		if ((reinterpret_cast<uintptr_t>(pQBVH->mpNodes) & (GWCollision::QBVH::NODE_ALIGN - 1)) != 0) { res = false; }
+		// collapsing four-way leaves far fewer nodes than the 2n-1 binary ones
+		if (pQBVH->mNumNodes > pCls->mNumPol / 2 + 1) { res = false; }
+		for (int i = 0; i < nseg && res; ++i) {
+			GWVectorF p = pSegs[i * 2];
+			GWVectorF q = pSegs[i * 2 + 1];
+			GWCollision::HitInfo ref, hit;
+			ref.reset();
+			hit.reset();
+			bool found = GWCollision::seg_first_hit(*pCls, p, q, &ref);
+			if (found != GWCollision::seg_first_hit(*pQBVH, p, q, &hit)) { res = false; }
+			if (found != GWCollision::seg_any_hit(*pQBVH, p, q)) { res = false; }
+			if (!same_hit(ref, hit)) { res = false; }
+		}
+		GWCollision::QBVH::destroy(pQBVH);
+	}
+	return res;
+}
+
+static bool check_bvh(const GWBVH::Node* pNodes, int nprim) {
+	int nnodes = GWBVH::calc_num_nodes(nprim);
+	std::vector<int> primRefs(nprim, 0);
+	std::vector<int> nodeRefs(nnodes, 0);
+	for (int i = 0; i < nnodes; ++i) {
+		const GWBVH::Node& node = pNodes[i];
+		if (node.is_leaf()) {
+			if (node.mLeft < 0 || node.mLeft >= nprim) { return false; }
+			++primRefs[node.mLeft];
+			continue;
+		}
+		const int32_t children[2] = { node.mLeft, node.mRight };
+		for (int j = 0; j < 2; ++j) {
+			// depth-first: children always follow their parent
+			if (children[j] <= i || children[j] >= nnodes) { return false; }
+			++nodeRefs[children[j]];
+			const GWBVH::Node& child = pNodes[children[j]];
+			for (int k = 0; k < 3; ++k) {
+				if (child.mBBoxMin[k] < node.mBBoxMin[k] || child.mBBoxMax[k] > node.mBBoxMax[k]) { return false; }
+			}
+		}
+		if (node.mLeft != i + 1) { return false; }
+	}
+	for (int i = 0; i < nprim; ++i) {
+		if (primRefs[i] != 1) { return false; }
+	}
+	for (int i = 1; i < nnodes; ++i) {
+		if (nodeRefs[i] != 1) { return false; }
+	}
+	return true;
+}
+
+static bool test_cls_build(GWCollisionResource* pCls, const GWVectorF* pSegs, int nseg) {
+	// large enough to go through the parallel binning and subtree tasks
+	GWCollisionResource* pBig = ClsBuilder::create(120, 2000, 3);
+	GWBVH::Node* pParallel = GWBVH::build(*pBig, true);
+	GWBVH::Node* pSerial = GWBVH::build(*pBig, false);
+	size_t bvhSize = GWBVH::calc_num_nodes(pBig->mNumPol) * sizeof(GWBVH::Node);
+	bool res = pParallel && pSerial && check_bvh(pParallel, pBig->mNumPol) && std::memcmp(pSerial, pParallel, bvhSize) == 0;
+	GWBVH::release(pParallel);
+	GWBVH::release(pSerial);
+	GWSys::free_temp_mem(pBig);
+	if (!res) { return false; }
+
+	GWCollisionResource* pSAH = GWBVH::clone_with_bvh(*pCls, true);
+	if (!pSAH) { return false; }
+	res = pSAH->has_bvh() && check_bvh(pSAH->get_bvh_top(), pSAH->mNumPol);
+	for (int i = 0; i < nseg && res; ++i) {
+		GWVectorF p = pSegs[i * 2];
+		GWVectorF q = pSegs[i * 2 + 1];
+		GWCollision::HitInfo ref, hit;
+		ref.reset();
+		hit.reset();
+		GWCollision::seg_first_hit(*pCls, p, q, &ref);
+		GWCollision::seg_first_hit(*pSAH, p, q, &hit);
+		res = same_hit(ref, hit);
+	}
+	if (res) {
+		res = GWBVH::rebuild(*pSAH, false) && check_bvh(pSAH->get_bvh_top(), pSAH->mNumPol);
+	}
+	GWResource::unload(pSAH);
+	return res;
+}
+
+static bool test_cls_refit(const GWCollisionResource* pCls, const GWVectorF* pSegs, int nseg) {
+	// the exported node order is not depth-first, refit has to cope with it
+	GWCollisionResource* pCopy = reinterpret_cast<GWCollisionResource*>(GWSys::alloc_temp_mem(pCls->mDataSize));
+	std::memcpy(pCopy, pCls, pCls->mDataSize);
+	GWVectorF* pPnts = pCopy->get_pnts_top();
+	for (int i = 0; i < pCopy->mNumPnt; ++i) {
+		GWVectorF& pnt = pPnts[i];
+		pnt.y += 0.4f * std::sin(pnt.x * 0.7f) * std::cos(pnt.z * 0.5f);
+		pnt.x *= 1.1f;
+	}
+	int nnodes = pCopy->get_num_bvh_nodes();
+	std::vector<GWBVH::Node> ref(nnodes);
+	bool res = GWBVH::refit(*pCopy, false);
+	if (res) {
+		std::copy_n(pCopy->get_bvh_top(), nnodes, ref.data());
+		res = GWBVH::refit(*pCopy, true) && std::memcmp(ref.data(), pCopy->get_bvh_top(), nnodes * sizeof(GWBVH::Node)) == 0;
+	}
+	if (res) {
+		const GWBVH::Node* pNodes = pCopy->get_bvh_top();
+		for (int i = 0; i < nnodes && res; ++i) {
+			const GWBVH::Node& node = pNodes[i];
+			if (node.is_leaf()) {
+				const GWCollisionResource::Poly& pol = pCopy->get_pols_top()[node.get_poly_id()];
+				for (int k = 0; k < 3; ++k) {
+					res = res && node.mBBoxMin[k] == pol.mBBoxMin[k] && node.mBBoxMax[k] == pol.mBBoxMax[k];
+				}
+			} else {
+				const GWBVH::Node& l = pNodes[node.mLeft];
+				const GWBVH::Node& r = pNodes[node.mRight];
+				for (int k = 0; k < 3; ++k) {
+					res = res && node.mBBoxMin[k] == std::min(l.mBBoxMin[k], r.mBBoxMin[k]);
+					res = res && node.mBBoxMax[k] == std::max(l.mBBoxMax[k], r.mBBoxMax[k]);
+				}
+			}
+		}
+	}
+	res = res && test_cls_queries(pCopy, pSegs, nseg);
+	GWSys::free_temp_mem(pCopy);
+	return res;
+}
+
+struct ClsDistFunc : public GWCollisionResource::TriFunc {
+	GWVectorF mA;
+	GWVectorF mB;
+	float mDistSq;
+
+	ClsDistFunc(const GWVectorF& a, const GWVectorF& b) : mA(a), mB(b), mDistSq(FLT_MAX) {}
+
+	virtual void operator ()(GWCollisionResource& cls, GWVectorF vtx[3], GWVectorF nrm, int polIdx, int triIdx) {
+		mDistSq = std::min(mDistSq, GWOverlap::seg_tri_dist_sq(mA, mB, vtx[0], vtx[1], vtx[2]));
+	}
+};
+
+static float calc_cls_dist(GWCollisionResource* pCls, const GWCollision::Capsule& cap, const GWVectorF& move, float t) {
+	ClsDistFunc func(cap.mA + move * t, cap.mB + move * t);
+	pCls->for_all_tris(func, false);
+	return GWBase::tsqrt(func.mDistSq);
+}
+
+static bool test_cls_sweep(GWCollisionResource* pCls) {
+	const int num = 200;
+	const float tol = 1e-3f;
+	std::vector<GWCollision::Capsule> caps(num);
+	std::vector<GWSphereF> sphs(num);
+	std::vector<GWVectorF> moves(num);
+	GWBase::Random rnd(11);
+	GWVectorF ext = pCls->mBBoxMax - pCls->mBBoxMin;
+	for (int i = 0; i < num; ++i) {
+		GWVectorF org(rnd.f01(), rnd.f01(), rnd.f01());
+		org = pCls->mBBoxMin + org * ext;
+		org.y = pCls->mBBoxMax.y + 0.5f + rnd.f01();
+		GWVectorF axis(rnd.f01() - 0.5f, rnd.f01(), rnd.f01() - 0.5f);
+		caps[i].mA = org;
+		// every fourth one is a sphere
+		caps[i].mB = (i & 3) ? org + axis * 1.5f : org;
+		caps[i].mRadius = 0.1f + rnd.f01() * 0.4f;
+		moves[i] = GWVectorF(rnd.f01() - 0.5f, -rnd.f01(), rnd.f01() - 0.5f) * 6.0f;
+		sphs[i] = GWSphereF(caps[i].mA, caps[i].mRadius);
+	}
+	std::vector<GWCollision::HitInfo> hits(num);
+	std::vector<GWCollision::HitInfo> hitsSer(num);
+	std::vector<GWCollision::HitInfo> hitsSph(num);
+	int nhit = GWCollision::capsule_sweeps(*pCls, caps.data(), moves.data(), num, hits.data(), true);
+	if (nhit == 0 || GWCollision::capsule_sweeps(*pCls, caps.data(), moves.data(), num, hitsSer.data(), false) != nhit) { return false; }
+	GWCollision::sphere_sweeps(*pCls, sphs.data(), moves.data(), num, hitsSph.data());
+	for (int i = 0; i < num; ++i) {
+		const GWCollision::Capsule& cap = caps[i];
+		const GWCollision::HitInfo& hit = hits[i];
+		GWCollision::HitInfo ref;
+		ref.reset();
+		bool found = GWCollision::capsule_sweep(*pCls, cap, moves[i], &ref);
+		if (found != (hit.mPolIdx >= 0) || !same_hit(ref, hit) || !same_hit(hit, hitsSer[i])) { return false; }
+		if ((i & 3) == 0 && !same_hit(hit, hitsSph[i])) { return false; }
+		float tEnd = found ? hit.mT : 1.0f;
+		if (found) {
+			// touching at the time of impact, the contact is on the capsule surface
+			if (std::fabs(calc_cls_dist(pCls, cap, moves[i], hit.mT) - cap.mRadius) > tol) { return false; }
+			GWVectorF a = cap.mA + moves[i] * hit.mT;
+			GWVectorF b = cap.mB + moves[i] * hit.mT;
+			float s, u;
+			GWVectorF c0, c1;
+			float dist = GWBase::tsqrt(GWOverlap::seg_seg_closest(a, b, hit.mPos, hit.mPos, s, u, c0, c1));
+			if (std::fabs(dist - cap.mRadius) > tol) { return false; }
+			if (!GWBase::almost_equal(hit.mNrm.length(), 1.0f, 1e-3f)) { return false; }
+		}
+		// no penetration before the impact
+		for (int j = 0; j < 16; ++j) {
+			if (calc_cls_dist(pCls, cap, moves[i], tEnd * float(j) / 16.0f) < cap.mRadius - tol) { return false; }
+		}
+	}
+	return true;
+}
+
+struct ClsTriListFunc : public GWCollisionResource::TriFunc {
+	std::vector<GWCollisionResource::TriSoup::Tri> mTris;
+
+	virtual void operator ()(GWCollisionResource& cls, GWVectorF vtx[3], GWVectorF nrm, int polIdx, int triIdx) {
+		GWCollisionResource::TriSoup::Tri tri;
+		tri.mV0 = vtx[0];
+		tri.mE1 = vtx[1];
+		tri.mE2 = vtx[2];
+		tri.mNrm = nrm;
+		tri.mPolIdx = polIdx;
+		tri.mTriIdx = triIdx;
+		mTris.push_back(tri);
+	}
+};
+
+static bool test_cls_soup(GWCollisionResource* pCls) {
+	ClsTriListFunc ref;
+	int ntri = pCls->for_all_tris(ref);
+	GWCollisionResource::TriSoup* pSoup = GWCollisionResource::TriSoup::create(*pCls, true);
+	if (!pSoup || pSoup->mNumTri != ntri || pSoup->mNumSlots % GWCollisionResource::TriSoup::SOA_WIDTH != 0) { return false; }
+	bool res = true;
+	for (int i = 0; i < GWCollisionResource::TriSoup::NUM_CHANNELS; ++i) {
+		res = res && (reinterpret_cast<uintptr_t>(pSoup->mpChannels[i]) & 0x1F) == 0;
+	}
+	for (int i = ntri; i < pSoup->mNumSlots; ++i) {
+		res = res && pSoup->mpPolIdx[i] < 0;
+	}
+	int idx = 0;
+	pSoup->for_each_tri([&](const GWCollisionResource::TriSoup::Tri& tri) {
+		const GWCollisionResource::TriSoup::Tri& r = ref.mTris[idx++];
+		res = res && tri.mPolIdx == r.mPolIdx && tri.mTriIdx == r.mTriIdx;
+		res = res && COMPARE_VEC(tri.get_vtx(0), r.mV0, 1e-6f) && COMPARE_VEC(tri.get_vtx(1), r.mE1, 1e-5f) && COMPARE_VEC(tri.get_vtx(2), r.mE2, 1e-5f);
+		res = res && COMPARE_VEC(tri.mNrm, r.mNrm, 1e-5f);
+	});
+	res = res && idx == ntri;
+
+	// every triangle is visited once by the parallel pass
+	std::atomic<int64_t> key(0);
+	std::atomic<int> cnt(0);
+	pSoup->parallel_for_each_tri([&](const GWCollisionResource::TriSoup::Tri& tri) {
+		key += int64_t(tri.mPolIdx) * 8 + tri.mTriIdx;
+		++cnt;
+	});
+	int64_t refKey = 0;
+	for (int i = 0; i < ntri; ++i) {
+		refKey += int64_t(ref.mTris[i].mPolIdx) * 8 + ref.mTris[i].mTriIdx;
+	}
+	res = res && cnt == ntri && key == refKey;
+
+	GWCollisionResource::TriSoup* pSerial = GWCollisionResource::TriSoup::create(*pCls, false);
+	res = res && pSerial != nullptr;
+	for (int i = 0; i < GWCollisionResource::TriSoup::NUM_CHANNELS && res; ++i) {
+		res = std::memcmp(pSerial->mpChannels[i], pSoup->mpChannels[i], pSoup->mNumSlots * sizeof(float)) == 0;
+	}
+	GWCollisionResource::TriSoup::destroy(pSerial);
+	GWCollisionResource::TriSoup::destroy(pSoup);
+	return res;
+}
+
+static float calc_cls_pnt_dist(GWCollisionResource* pCls, const GWVectorF& pos) {
+	ClsDistFunc func(pos, pos);
+	pCls->for_all_tris(func, false);
+	return GWBase::tsqrt(func.mDistSq);
+}
+
+static bool test_cls_closest(GWCollisionResource* pCls) {
+	GWBase::Random rnd(13);
+	GWVectorF ext = pCls->mBBoxMax - pCls->mBBoxMin;
+	for (int i = 0; i < 300; ++i) {
+		GWVectorF r(rnd.f01() * 1.4f - 0.2f, rnd.f01() * 1.4f - 0.2f, rnd.f01() * 1.4f - 0.2f);
+		GWVectorF pos = pCls->mBBoxMin + r * ext;
+		float ref = calc_cls_pnt_dist(pCls, pos);
+		GWCollision::HitInfo hit;
+		if (!GWCollision::closest_pnt(*pCls, pos, 100.0f, &hit)) { return false; }
+		if (!GWBase::almost_equal(hit.mT, ref, 1e-3f)) { return false; }
+		if (!GWBase::almost_equal((hit.mPos - pos).length(), hit.mT, 1e-4f)) { return false; }
+		if (!GWBase::almost_equal(hit.mNrm.length(), 1.0f, 1e-4f)) { return false; }
+		// nothing within a shorter range
+		if (ref > 0.01f && GWCollision::closest_pnt(*pCls, pos, ref * 0.99f)) { return false; }
+	}
+	return true;
+}
+
+// Field over a bumpy grid with heights in [-0.5, 0.5], compared with the exact distances.
+static bool test_cls_sdf() {
+	GWCollisionResource* pCls = ClsBuilder::create(16, 0, 3);
+	GWSDF::Field::BakeParams params;
+	params.mCellSize = 0.125f;
+	params.mBand = 1.0f;
+	bool res = true;
+	for (int k = 0; k < 2 && res; ++k) {
+		params.mKind = k ? GWSDF::BrickKind::Q8 : GWSDF::BrickKind::Q16;
+		GWSDF::Field* pField = GWSDF::Field::bake(*pCls, params);
+		res = pField != nullptr && pField->mNumDense > 0 && pField->mNumDense < pField->get_num_bricks();
+		res = res && (reinterpret_cast<uintptr_t>(pField->mpBricks) & (GWSDF::Field::BRICK_ALIGN - 1)) == 0;
+		float tol = params.mCellSize * 0.5f + params.mBand / (k ? 127.0f : 32767.0f);
+		GWBase::Random rnd(17);
+		for (int i = 0; i < 500 && res; ++i) {
+			GWVectorF pos(1.0f + rnd.f01() * 14.0f, rnd.f01() * 4.0f - 2.0f, 1.0f + rnd.f01() * 14.0f);
+			float ref = calc_cls_pnt_dist(pCls, pos);
+			GWVectorF grad;
+			float d = pField->sample(pos, &grad);
+			if (ref < params.mBand - tol) {
+				// the distance grows towards the front side, which faces up
+				res = std::fabs(std::fabs(d) - ref) <= tol && grad.y > 0.0f;
+			} else {
+				// clamped to the band or a lower bound in the empty bricks
+				res = std::fabs(d) <= ref + tol && std::fabs(d) >= std::min(ref, params.mBand) - tol;
+			}
+			if (std::fabs(pos.y) > 0.6f) {
+				res = res && (d > 0.0f) == (pos.y > 0.0f);
+			}
+		}
+
+		// sinking spheres are pushed back to the front side
+		for (int i = 0; i < 100 && res; ++i) {
+			GWVectorF pos(2.0f + rnd.f01() * 12.0f, rnd.f01() * 0.4f - 0.2f, 2.0f + rnd.f01() * 12.0f);
+			float radius = 0.3f;
+			float depth = pField->push_out(pos, radius);
+			res = depth >= 0.0f && pField->sample(pos) >= radius - tol * 2.0f;
+			res = res && calc_cls_pnt_dist(pCls, pos) >= radius - tol * 2.0f && pos.y > -0.5f;
+		}
+
+		// the parallel bake matches the serial one
+		GWSDF::Field::BakeParams serial = params;
+		serial.mParallel = false;
+		GWSDF::Field* pSerial = GWSDF::Field::bake(*pCls, serial);
+		res = res && pSerial && pSerial->mNumDense == pField->mNumDense;
+		res = res && std::memcmp(pSerial->mpBrickIdx, pField->mpBrickIdx, pField->get_num_bricks() * sizeof(int32_t)) == 0;
+		res = res && std::memcmp(pSerial->mpBricks, pField->mpBricks, pField->mNumDense * pField->get_brick_size()) == 0;
+		GWSDF::Field::destroy(pSerial);
+		GWSDF::Field::destroy(pField);
+	}
+	GWSys::free_temp_mem(pCls);
+	return res;
+}
+
+// Solid angles of the triangles seen from pos over 4 pi, +-1 inside a closed mesh and 0 outside.
+static float calc_cls_winding(GWCollisionResource* pCls, const GWVectorF& pos) {
+	struct WindingFunc : public GWCollisionResource::TriFunc {
+		GWVectorF mPos;
+		double mSum;
+
+		virtual void operator ()(GWCollisionResource& cls, GWVectorF vtx[3], GWVectorF nrm, int polIdx, int triIdx) {
+			GWVectorF a = vtx[0] - mPos;
+			GWVectorF b = vtx[1] - mPos;
+			GWVectorF c = vtx[2] - mPos;
+			float la = a.length();
+			float lb = b.length();
+			float lc = c.length();
+			float num = a.dot(GWVector::cross(b, c));
+			float den = la * lb * lc + a.dot(b) * lc + a.dot(c) * lb + b.dot(c) * la;
+			mSum += 2.0 * std::atan2(double(num), double(den));
+		}
+	} func;
+	func.mPos = pos;
+	func.mSum = 0.0;
+	pCls->for_all_tris(func, false);
+	return float(func.mSum / (4.0 * 3.14159265358979));
+}
+
+// Sides at the samples around the spikes and pits of closed meshes, where the closest feature is mostly an edge
+// or a vertex shared by triangles at sharp angles.
+static bool test_cls_sdf_sign() {
+	GWBase::Random rnd(29);
+	GWSDF::Field::BakeParams params;
+	params.mCellSize = 0.1f;
+	params.mBand = 0.5f;
+	bool res = true;
+	int nchecked = 0;
+	for (int k = 0; k < 4 && res; ++k) {
+		ClsBuilder bld;
+		bld.build_spiky(GWVectorF(2.0f), 7, 9, rnd);
+		bld.build_bvh();
+		GWCollisionResource* pCls = bld.create();
+		GWSDF::Field* pField = GWSDF::Field::bake(*pCls, params);
+		res = pField != nullptr;
+		int nsmp[3];
+		for (int i = 0; i < 3; ++i) {
+			nsmp[i] = pField->mNumBricks[i] * GWSDF::Field::BRICK_CELLS + 1;
+		}
+		for (int z = 0; z < nsmp[2] && res; ++z) {
+			for (int y = 0; y < nsmp[1] && res; ++y) {
+				for (int x = 0; x < nsmp[0] && res; ++x) {
+					GWVectorF pos = pField->mOrg + GWVectorF(float(x), float(y), float(z)) * params.mCellSize;
+					float d = pField->sample(pos);
+					if (std::fabs(d) < 0.01f || std::fabs(d) > params.mBand * 0.9f) { continue; }
+					bool inside = std::fabs(calc_cls_winding(pCls, pos)) > 0.5f;
+					res = (d < 0.0f) == inside;
+					++nchecked;
+				}
+			}
+		}
+		GWSDF::Field::destroy(pField);
+		GWSys::free_temp_mem(pCls);
+	}
+	return res && nchecked > 1000;
+}
+
+// Cached columns against the casts they stand for, then bilinear heights over a grid with no overhangs.
+static bool test_cls_ground(GWCollisionResource* pCls) {
+	GWCollision::GroundCache::BakeParams params;
+	params.mCellSize = 0.5f;
+	params.mClearance = 0.5f;
+	GWCollision::GroundCache* pCache = GWCollision::GroundCache::create(*pCls, params);
+	bool res = pCache != nullptr;
+	float crdMax = std::max((pCls->mBBoxMax - pCls->mBBoxMin).max_elem(), 1.0f);
+	for (int i = 0; i < 3; ++i) {
+		crdMax = std::max(crdMax, std::max(std::fabs(pCls->mBBoxMin[i]), std::fabs(pCls->mBBoxMax[i])));
+	}
+	float eps = crdMax * 1.0e-5f;
+	int nmulti = 0;
+	for (int iz = 0; res && iz < pCache->mNumZ; ++iz) {
+		for (int ix = 0; res && ix < pCache->mNumX; ++ix) {
+			const GWCollision::GroundCache::Column& col = pCache->get_column(ix, iz);
+			float x = pCache->mOrg.x + float(ix) * params.mCellSize;
+			float z = pCache->mOrg.z + float(iz) * params.mCellSize;
+			float top = pCls->mBBoxMax.y + eps;
+			float last = FLT_MAX;
+			int nlayer = 0;
+			GWCollision::HitInfo hit;
+			while (nlayer < GWCollision::GroundCache::MAX_LAYERS && GWCollision::seg_first_hit(*pCls, GWVectorF(x, top, z), GWVectorF(x, pCls->mBBoxMin.y - eps, z), &hit)) {
+				if (hit.mNrm.y >= params.mMinNrmY && last - hit.mPos.y >= params.mClearance) {
+					res = res && nlayer < col.mNumLayers && std::fabs(col.mY[nlayer] - hit.mPos.y) < 1e-4f;
+					res = res && GWVector::dot(col.get_nrm(nlayer), hit.mNrm) > 0.999f;
+					++nlayer;
+				}
+				last = hit.mPos.y;
+				top = hit.mPos.y - eps;
+			}
+			res = res && nlayer == col.mNumLayers;
+			nmulti += nlayer > 1 ? 1 : 0;
+		}
+	}
+	res = res && nmulti > 0;
+
+	// never above the step limit, the batch gives the single results
+	const int npos = 1000;
+	std::vector<GWVectorF> pos(npos);
+	std::vector<GWCollision::GroundHit> hits(npos);
+	std::vector<GWCollision::GroundHit> single(npos);
+	bool* pFound = new bool[npos];
+	GWBase::Random rnd(23);
+	GWVectorF ext = pCls->mBBoxMax - pCls->mBBoxMin;
+	int nref = 0;
+	for (int i = 0; i < npos; ++i) {
+		pos[i] = pCls->mBBoxMin + GWVectorF(rnd.f01(), rnd.f01(), rnd.f01()) * ext;
+		single[i].mY = 0.0f;
+		hits[i].mY = 0.0f;
+		if (pCache->sample_ground(pos[i].x, pos[i].z, pos[i].y, 0.3f, &single[i])) {
+			res = res && single[i].mY <= pos[i].y + 0.3f + 1e-5f && single[i].mNrm.y > 0.0f;
+			++nref;
+		}
+	}
+	res = res && pCache->sample_ground(pos.data(), 0.3f, hits.data(), pFound, npos) == nref;
+	for (int i = 0; i < npos && res; ++i) {
+		res = pFound[i] == pCache->sample_ground(pos[i].x, pos[i].z, pos[i].y, 0.3f);
+		res = res && hits[i].mY == single[i].mY;
+	}
+	delete[] pFound;
+
+	// the parallel bake matches the serial one
+	GWCollision::GroundCache::BakeParams serial = params;
+	serial.mParallel = false;
+	GWCollision::GroundCache* pSerial = GWCollision::GroundCache::create(*pCls, serial);
+	res = res && pSerial && pSerial->mNumX == pCache->mNumX && pSerial->mNumZ == pCache->mNumZ;
+	res = res && std::memcmp(pSerial->mpColumns, pCache->mpColumns, pCache->mNumX * pCache->mNumZ * sizeof(GWCollision::GroundCache::Column)) == 0;
+	GWCollision::GroundCache::destroy(pSerial);
+	GWCollision::GroundCache::destroy(pCache);
+
+	GWCollisionResource* pGrid = ClsBuilder::create(16, 0, 3);
+	params.mCellSize = 0.25f;
+	pCache = GWCollision::GroundCache::create(*pGrid, params);
+	for (int i = 0; i < 500 && res; ++i) {
+		float x = rnd.f01() * 16.0f;
+		float z = rnd.f01() * 16.0f;
+		GWCollision::HitInfo ref;
+		GWCollision::GroundHit hit;
+		res = GWCollision::seg_first_hit(*pGrid, GWVectorF(x, 2.0f, z), GWVectorF(x, -2.0f, z), &ref);
+		res = res && pCache->sample_ground(x, z, &hit);
+		res = res && std::fabs(hit.mY - ref.mPos.y) < 0.02f && GWVector::dot(hit.mNrm, ref.mNrm) > 0.9f;
+	}
+	GWCollision::GroundCache::destroy(pCache);
+	GWSys::free_temp_mem(pGrid);
+
+	// a bridge at y = 3 ending at x = 4.1, between two columns: on it or below it, the other layer isn't blended in
+	GWBase::Random geoRnd(3);
+	ClsBuilder bld;
+	bld.build_geo(8, 0, geoRnd);
+	int32_t bridge[4];
+	const float bridgePnts[4][2] = { { 2.0f, 0.0f }, { 4.1f, 0.0f }, { 4.1f, 8.0f }, { 2.0f, 8.0f } };
+	for (int i = 0; i < 4; ++i) {
+		bridge[i] = int32_t(bld.mPnts.size());
+		bld.mPnts.push_back(GWVectorF(bridgePnts[i][0], 3.0f, bridgePnts[i][1]));
+	}
+	bld.add_poly(bridge, 4);
+	bld.build_bvh();
+	GWCollisionResource* pBridge = bld.create();
+	params.mCellSize = 0.5f;
+	params.mClearance = 1.8f;
+	pCache = GWCollision::GroundCache::create(*pBridge, params);
+	for (int i = 0; i < 50 && res; ++i) {
+		float x = 4.0f + rnd.f01() * 0.5f;
+		float z = 1.0f + rnd.f01() * 6.0f;
+		GWCollision::GroundHit hit;
+		res = pCache->sample_ground(x, z, 3.0f, 0.3f, &hit) && std::fabs(hit.mY - 3.0f) < 1e-5f;
+		res = res && pCache->sample_ground(x, z, &hit) && std::fabs(hit.mY - 3.0f) < 1e-5f;
+		res = res && pCache->sample_ground(x, z, 0.5f, 0.3f, &hit) && hit.mY < 0.6f;
+	}
+	GWCollision::GroundCache::destroy(pCache);
+	GWSys::free_temp_mem(pBridge);
+
+	// two small floors far above the origin, where the floats are coarser than the mesh extent
+	ClsBuilder farBld;
+	for (int k = 0; k < 2; ++k) {
+		float y = k ? 997.0f : 1000.0f;
+		int32_t quad[4];
+		for (int i = 0; i < 4; ++i) {
+			quad[i] = int32_t(farBld.mPnts.size());
+			farBld.mPnts.push_back(GWVectorF(float(((i + 1) >> 1) & 1) * 2.0f, y, float(i >> 1) * 2.0f));
+		}
+		farBld.add_poly(quad, 4);
+	}
+	farBld.build_bvh();
+	GWCollisionResource* pFar = farBld.create();
+	pCache = GWCollision::GroundCache::create(*pFar, params);
+	res = res && pCache != nullptr;
+	// the columns on the far edges miss the quads
+	for (int i = 0; i < (pCache->mNumX - 1) * (pCache->mNumZ - 1) && res; ++i) {
+		const GWCollision::GroundCache::Column& col = pCache->get_column(i % (pCache->mNumX - 1), i / (pCache->mNumX - 1));
+		res = col.mNumLayers == 2 && col.mY[0] == 1000.0f && col.mY[1] == 997.0f;
+	}
+	GWCollision::GroundCache::destroy(pCache);
+	GWSys::free_temp_mem(pFar);
+	return res;
+}
+
+bool test_cls() {
+	GWCollisionResource* pCls = ClsBuilder::create(24, 64, 1);
+	if (!pCls->has_bvh() || pCls->get_num_bvh_nodes() != pCls->mNumPol * 2 - 1) { return false; }
+
+	const int nseg = 2000;
+	GWVectorF* pSegs = new GWVectorF[nseg * 2];
+	GWBase::Random rnd(7);
+	gen_segs(pSegs, nseg, *pCls, rnd);
+
+	bool res = test_cls_queries(pCls, pSegs, nseg) && test_cls_batch(pCls, pSegs, nseg) && test_cls_qbvh(pCls, pSegs, nseg) && test_cls_build(pCls, pSegs, nseg) && test_cls_refit(pCls, pSegs, nseg) && test_cls_sweep(pCls) && test_cls_soup(pCls) && test_cls_closest(pCls) && test_cls_sdf() && test_cls_sdf_sign() && test_cls_ground(pCls);
+	if (res) {
+		// brute-force path
+		int32_t offsBVH = pCls->mOffsBVH;
+		pCls->mOffsBVH = 0;
+		res = test_cls_queries(pCls, pSegs, nseg) && test_cls_batch(pCls, pSegs, nseg) && test_cls_sweep(pCls) && test_cls_closest(pCls);
+		pCls->mOffsBVH = offsBVH;
+	}
+
+	delete[] pSegs;
+	GWSys::free_temp_mem(pCls);
+	return res;
+}
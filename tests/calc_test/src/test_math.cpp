@@ -0,0 +1,165 @@
+/*
+ * Groundwork approximate math tests
+ * Author: Gleb Novodran <novodran@gmail.com>
+ */
+
+#include <vector>
+#include <groundwork.hpp>
+#include "test.hpp"
+
+static const GWMathTier s_tiers[] = { GWMathTier::FAST, GWMathTier::COARSE };
+
+static std::vector<float> gen_range(float lo, float hi, int n) {
+	std::vector<float> v(n);
+	for (int i = 0; i < n; ++i) {
+		v[i] = lo + (hi - lo) * float(i) / float(n - 1);
+	}
+	return v;
+}
+
+// The array form goes through the same polynomials as the scalar one, only the contraction into FMAs may differ.
+static bool check_array(const std::vector<float>& scl, const std::vector<float>& ary) {
+	for (size_t i = 0; i < scl.size(); ++i) {
+		if (std::fabs(scl[i] - ary[i]) > 1.0e-6f * std::max(1.0f, std::fabs(scl[i]))) { return false; }
+	}
+	return true;
+}
+
+static bool test_sincos() {
+	const float bound[] = { 2.0e-7f, 3.0e-4f };
+	const int n = 4001;
+	std::vector<float> x = gen_range(float(-2.0 * GWBase::pi), float(2.0 * GWBase::pi), n);
+	std::vector<float> s(n), c(n), as(n), ac(n);
+	for (int t = 0; t < 2; ++t) {
+		GWMathTier tier = s_tiers[t];
+		for (int i = 0; i < n; ++i) {
+			GWBase::approx_sincos(x[i], s[i], c[i], tier);
+			if (std::fabs(s[i] - std::sin(double(x[i]))) > bound[t]) { return false; }
+			if (std::fabs(c[i] - std::cos(double(x[i]))) > bound[t]) { return false; }
+		}
+		GWBase::approx_sincos(as.data(), ac.data(), x.data(), n, tier);
+		if (!check_array(s, as) || !check_array(c, ac)) { return false; }
+		GWBase::approx_sin(as.data(), x.data(), n, tier);
+		GWBase::approx_cos(ac.data(), x.data(), n, tier);
+		if (!check_array(s, as) || !check_array(c, ac)) { return false; }
+	}
+	// FULL is the C library
+	for (int i = 0; i < n; i += 97) {
+		if (GWBase::f32_ulp_diff(GWBase::approx_sin(x[i], GWMathTier::FULL), ::sinf(x[i])) != 0) { return false; }
+	}
+	return true;
+}
+
+static bool test_exp_log() {
+	const int n = 3001;
+	std::vector<float> x = gen_range(-10.0f, 10.0f, n);
+	std::vector<float> res(n), ary(n);
+	// FAST within 6e-7 relative, about 10 ulps
+	for (int i = 0; i < n; ++i) {
+		res[i] = GWBase::approx_exp(x[i], GWMathTier::FAST);
+		if (GWBase::f32_ulp_diff(res[i], ::expf(x[i])) > 10) { return false; }
+	}
+	GWBase::approx_exp(ary.data(), x.data(), n, GWMathTier::FAST);
+	if (!check_array(res, ary)) { return false; }
+	for (int i = 0; i < n; ++i) {
+		double ref = std::exp(double(x[i]));
+		if (std::fabs(GWBase::approx_exp(x[i], GWMathTier::COARSE) - ref) > 1.5e-4 * ref) { return false; }
+	}
+	if (GWBase::approx_exp(-100.0f, GWMathTier::FAST) != 0.0f) { return false; }
+
+	const float bound[] = { 1.7e-7f, 6.1e-5f };
+	std::vector<float> pos(n);
+	for (int i = 0; i < n; ++i) {
+		pos[i] = std::exp(x[i] * 3.0f);
+	}
+	for (int t = 0; t < 2; ++t) {
+		GWMathTier tier = s_tiers[t];
+		for (int i = 0; i < n; ++i) {
+			res[i] = GWBase::approx_log(pos[i], tier);
+			double ref = std::log(double(pos[i]));
+			if (std::fabs(res[i] - ref) > bound[t] * std::max(1.0, std::fabs(ref))) { return false; }
+		}
+		GWBase::approx_log(ary.data(), pos.data(), n, tier);
+		if (!check_array(res, ary)) { return false; }
+	}
+	return true;
+}
+
+static bool test_pow_acos() {
+	const int n = 2001;
+	std::vector<float> x = gen_range(0.0f, 1.0f, n);
+	std::vector<float> res(n), ary(n);
+	const float ys[] = { 2.2f, 1.0f / 2.2f, -1.5f };
+	for (int k = 0; k < 3; ++k) {
+		for (int i = 1; i < n; ++i) {
+			res[i] = GWBase::approx_pow(x[i], ys[k], GWMathTier::FAST);
+			// the error of log is scaled by y log x
+			int32_t ulps = int32_t(5.0f * (1.0f + std::fabs(ys[k] * std::log(x[i]))));
+			if (GWBase::f32_ulp_diff(res[i], ::powf(x[i], ys[k])) > ulps) { return false; }
+		}
+		res[0] = GWBase::approx_pow(x[0], ys[k], GWMathTier::FAST);
+		GWBase::approx_pow(ary.data(), x.data(), ys[k], n, GWMathTier::FAST);
+		if (res[0] != ary[0]) { return false; }
+		// a different contraction is scaled by y log x as well
+		for (int i = 1; i < n; ++i) {
+			float tol = 1.0e-6f * (1.0f + std::fabs(ys[k] * std::log(x[i]))) * std::max(1.0f, std::fabs(res[i]));
+			if (std::fabs(res[i] - ary[i]) > tol) { return false; }
+		}
+	}
+	if (GWBase::approx_pow(0.0f, 2.0f, GWMathTier::FAST) != 0.0f) { return false; }
+	if (GWBase::approx_pow(0.0f, 0.0f, GWMathTier::COARSE) != 1.0f) { return false; }
+
+	const float bound[] = { 6.0e-7f, 7.0e-5f };
+	std::vector<float> c = gen_range(-1.0f, 1.0f, n);
+	for (int t = 0; t < 2; ++t) {
+		GWMathTier tier = s_tiers[t];
+		for (int i = 0; i < n; ++i) {
+			res[i] = GWBase::approx_acos(c[i], tier);
+			if (std::fabs(res[i] - std::acos(double(c[i]))) > bound[t]) { return false; }
+		}
+		GWBase::approx_acos(ary.data(), c.data(), n, tier);
+		if (!check_array(res, ary)) { return false; }
+	}
+	return true;
+}
+
+// The opt-in call sites stay close to their FULL results.
+static bool test_call_sites() {
+	GWBase::Random rnd(3);
+	for (int i = 0; i < 50; ++i) {
+		float rx = float(rnd.d01() * 4.0 - 2.0) * float(GWBase::pi);
+		float ry = float(rnd.d01() * 4.0 - 2.0) * float(GWBase::pi);
+		float rz = float(rnd.d01() * 4.0 - 2.0) * float(GWBase::pi);
+		GWTransformF mtx, fmtx;
+		mtx.make_rx(rx);
+		fmtx.make_rx(rx, GWMathTier::FAST);
+		if (!compare_mtx(mtx.as_tptr(), fmtx.as_tptr(), 4, 4)) { return false; }
+
+		GWQuaternionF qa, qb, fqa;
+		qa.set_radians(rx, ry, rz);
+		fqa.set_radians(rx, ry, rz, GWRotationOrder::XYZ, GWMathTier::FAST);
+		if (!COMPARE_VEC(qa.get_tuple(), fqa.get_tuple(), 1.0e-5f)) { return false; }
+		qb.set_radians(ry, rz, rx);
+		float t = rnd.f01();
+		GWQuaternionF q = GWUnitQuaternion::slerp(qa, qb, t);
+		GWQuaternionF fq = GWUnitQuaternion::slerp(qa, qb, t, GWMathTier::FAST);
+		if (!COMPARE_VEC(q.get_tuple(), fq.get_tuple(), 1.0e-5f)) { return false; }
+
+		GWRayF ray, fray;
+		ray.from_asimuth_inclination(rx, ry);
+		fray.from_asimuth_inclination(rx, ry, GWMathTier::COARSE);
+		if (!COMPARE_VEC(ray.direction(), fray.direction(), 1.0e-3f)) { return false; }
+
+		GWColorF clr, fclr;
+		clr.set(rnd.f01(), rnd.f01(), rnd.f01());
+		fclr = clr;
+		clr.to_linear();
+		fclr.to_linear(2.2f, GWMathTier::FAST);
+		if (!COMPARE_VEC(clr, fclr, 1.0e-6f)) { return false; }
+	}
+	return true;
+}
+
+bool test_fast_math() {
+	return test_sincos() && test_exp_log() && test_pow_acos() && test_call_sites();
+}
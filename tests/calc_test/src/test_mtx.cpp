@@ -3,6 +3,7 @@
  * Author: Gleb Novodran <novodran@gmail.com>
  */
 
+#include <vector>
 #include <groundwork.hpp>
 #include "test.hpp"
 
@@ -263,12 +264,399 @@ static bool test_pascal() {
 	return res;
 }
 
+static bool test_mul_blocked() {
+	const int m = 70;
+	const int n = 300;
+	const int p = 45;
+	std::vector<float> a(m * n);
+	std::vector<float> b(n * p);
+	std::vector<float> c(m * p);
+	std::vector<float> cs(m * p);
+	GWBase::Random rnd(17);
+	for (size_t i = 0; i < a.size(); ++i) { a[i] = rnd.f01() * 2.0f - 1.0f; }
+	for (size_t i = 0; i < b.size(); ++i) { b[i] = rnd.f01() * 2.0f - 1.0f; }
+
+	GWMatrix::mul_mm(c.data(), a.data(), b.data(), m, n, p);
+	GWMatrix::mul_mm_blocked(cs.data(), a.data(), b.data(), m, n, p, false);
+	for (int i = 0; i < m; ++i) {
+		for (int j = 0; j < p; ++j) {
+			double ref = 0.0;
+			for (int k = 0; k < n; ++k) {
+				ref += double(a[i * n + k]) * double(b[k * p + j]);
+			}
+			if (std::fabs(c[i * p + j] - ref) > 1.0e-4) { return false; }
+			if (c[i * p + j] != cs[i * p + j]) { return false; }
+		}
+	}
+	return true;
+}
+
+static bool test_lu_blocked() {
+	using namespace GWBase;
+	const int n = 200;
+	std::vector<float> a(n * n);
+	std::vector<float> lu(n * n);
+	std::vector<float> lus(n * n);
+	std::vector<float> tmp(n);
+	std::vector<int> perm(n);
+	std::vector<int> perms(n);
+	std::vector<float> xref(n);
+	std::vector<float> rh(n);
+	std::vector<float> ans(n);
+	Random rnd(23);
+	for (int i = 0; i < n * n; ++i) { a[i] = rnd.f01() * 2.0f - 1.0f; }
+	for (int i = 0; i < n; ++i) {
+		a[i * n + i] += 8.0f;
+		xref[i] = float(i % 7) - 3.5f;
+	}
+	for (int i = 0; i < n; ++i) {
+		rh[i] = float(GWMatrix::inner_row_vec<float, double>(a.data(), n, i, xref.data()));
+	}
+
+	int ds = 0;
+	int dss = 0;
+	if (!GWMatrix::lu_decomp(lu.data(), a.data(), n, tmp.data(), perm.data(), &ds)) { return false; }
+	if (!GWMatrix::lu_decomp(lus.data(), a.data(), n, tmp.data(), perms.data(), &dss, 0.0f, false)) { return false; }
+	// the split among the workers doesn't change the result
+	if (ds != dss || perm != perms || lu != lus) { return false; }
+
+	GWMatrix::lu_solve(ans.data(), lu.data(), n, perm.data(), rh.data());
+	GWMatrix::lu_improve(ans.data(), a.data(), lu.data(), n, perm.data(), rh.data(), tmp.data());
+	for (int i = 0; i < n; ++i) {
+		if (f32_ulp_diff(ans[i], xref[i]) > 200) { return false; }
+	}
+	return true;
+}
+
+// B B^T / n + I
+static void gen_spd_mtx(float* pMtx, int n, GWBase::Random& rnd) {
+	std::vector<float> b(n * n);
+	for (int i = 0; i < n * n; ++i) { b[i] = rnd.f01() * 2.0f - 1.0f; }
+	for (int i = 0; i < n; ++i) {
+		for (int j = 0; j <= i; ++j) {
+			double s = GWMatrix::inner_row_row<float, double>(b.data(), n, i, j) / n;
+			if (i == j) s += 1.0;
+			pMtx[i * n + j] = pMtx[j * n + i] = float(s);
+		}
+	}
+}
+
+static bool test_ldl() {
+	using namespace GWBase;
+	const int n = 200;
+	std::vector<float> a(n * n);
+	std::vector<float> ldl(n * n);
+	std::vector<float> ldls(n * n);
+	std::vector<float> tmp(n);
+	std::vector<float> xref(n);
+	std::vector<float> rh(n);
+	std::vector<float> ans(n);
+	Random rnd(29);
+	gen_spd_mtx(a.data(), n, rnd);
+	for (int i = 0; i < n; ++i) {
+		xref[i] = float(i % 5) - 2.5f;
+	}
+	for (int i = 0; i < n; ++i) {
+		rh[i] = float(GWMatrix::inner_row_vec<float, double>(a.data(), n, i, xref.data()));
+	}
+
+	if (!GWMatrix::ldl_decomp(ldl.data(), a.data(), n)) { return false; }
+	if (!GWMatrix::ldl_decomp(ldls.data(), a.data(), n, 0.0f, false)) { return false; }
+	if (ldl != ldls) { return false; }
+	GWMatrix::ldl_solve(ans.data(), ldl.data(), n, rh.data());
+	GWMatrix::ldl_improve(ans.data(), a.data(), ldl.data(), n, rh.data(), tmp.data());
+	for (int i = 0; i < n; ++i) {
+		if (f32_ulp_diff(ans[i], xref[i]) > 200) { return false; }
+	}
+
+	// L D L^T gives back the matrix
+	const int ns = 6;
+	float s[ns * ns];
+	float l[ns * ns];
+	float ld[ns * ns];
+	float d[ns];
+	float r[ns * ns];
+	gen_spd_mtx(s, ns, rnd);
+	if (!GWMatrix::ldl_decomp(ld, s, ns)) { return false; }
+	GWMatrix::ldl_get_lower(l, ld, ns);
+	GWMatrix::ldl_get_diag(d, ld, ns);
+	float det = 1.0f;
+	for (int i = 0; i < ns; ++i) {
+		det *= d[i];
+		for (int j = 0; j < ns; ++j) {
+			r[i * ns + j] = 0.0f;
+			for (int k = 0; k < ns; ++k) {
+				r[i * ns + j] += l[i * ns + k] * d[k] * l[j * ns + k];
+			}
+		}
+	}
+	if (!compare_mtx(r, s, ns, ns)) { return false; }
+	if (GWMatrix::ldl_det(ld, ns) != det) { return false; }
+
+	// not positive definite
+	s[2 * ns + 2] = -s[2 * ns + 2];
+	s[2 * ns + 3] = s[3 * ns + 2] = 0.0f;
+	float sing[] = { 1, 2, 2, 4 };
+	return !GWMatrix::ldl_decomp(ld, sing, 2) && GWMatrix::ldl_decomp(ld, s, ns);
+}
+
+static bool test_qr() {
+	const int m = 300;
+	const int n = 150;
+	std::vector<float> a(m * n);
+	std::vector<float> qr(m * n);
+	std::vector<float> qrs(m * n);
+	std::vector<float> diag(n);
+	std::vector<float> diags(n);
+	std::vector<float> tmp(m);
+	std::vector<float> xref(n);
+	std::vector<float> rh(m);
+	std::vector<float> ans(n);
+	GWBase::Random rnd(31);
+	for (int i = 0; i < m * n; ++i) { a[i] = rnd.f01() * 2.0f - 1.0f; }
+	for (int i = 0; i < n; ++i) { xref[i] = float(i % 3) - 1.5f; }
+	for (int i = 0; i < m; ++i) {
+		rh[i] = float(GWMatrix::inner_row_vec<float, double>(a.data(), n, i, xref.data()));
+	}
+	if (!GWMatrix::qr_decomp(qr.data(), a.data(), m, n, diag.data(), tmp.data())) { return false; }
+	if (!GWMatrix::qr_decomp(qrs.data(), a.data(), m, n, diags.data(), tmp.data(), 0.0f, false)) { return false; }
+	if (qr != qrs || diag != diags) { return false; }
+	// consistent system
+	GWMatrix::qr_solve(ans.data(), qr.data(), m, n, diag.data(), rh.data(), tmp.data());
+	for (int i = 0; i < n; ++i) {
+		if (std::fabs(ans[i] - xref[i]) > 1.0e-4f) { return false; }
+	}
+
+	// least squares line fit against the normal equations
+	const int np = 40;
+	float pts[np * 2];
+	float y[np];
+	float ata[4] = { 0, 0, 0, 0 };
+	float aty[2] = { 0, 0 };
+	for (int i = 0; i < np; ++i) {
+		float x = float(i) * 0.25f;
+		pts[i * 2] = x;
+		pts[i * 2 + 1] = 1.0f;
+		y[i] = 0.5f * x - 2.0f + (rnd.f01() - 0.5f);
+		ata[0] += x * x;
+		ata[1] += x;
+		ata[3] += 1.0f;
+		aty[0] += x * y[i];
+		aty[1] += y[i];
+	}
+	ata[2] = ata[1];
+	float fit[2];
+	float ne[2];
+	float ld[4];
+	GWMatrix::ldl_decomp(ld, ata, 2);
+	GWMatrix::ldl_solve(ne, ld, 2, aty);
+	if (!GWMatrix::qr_decomp(pts, pts, np, 2, diag.data(), tmp.data())) { return false; }
+	GWMatrix::qr_solve(fit, pts, np, 2, diag.data(), y, tmp.data());
+	return std::fabs(fit[0] - ne[0]) < 1.0e-4f && std::fabs(fit[1] - ne[1]) < 1.0e-4f;
+}
+
+static bool test_sym_eigen() {
+	const int n = 9;
+	float a[n * n];
+	float wrk[n * n];
+	float vals[n];
+	float vecs[n * n];
+	float tmp[n * 2];
+	GWBase::Random rnd(37);
+	for (int i = 0; i < n; ++i) {
+		for (int j = 0; j <= i; ++j) {
+			a[i * n + j] = a[j * n + i] = rnd.f01() * 2.0f - 1.0f;
+		}
+	}
+	if (!GWMatrix::sym_eigen(vals, vecs, wrk, a, n, tmp)) { return false; }
+	for (int k = 0; k < n; ++k) {
+		if (k > 0 && vals[k] > vals[k - 1]) { return false; }
+		for (int i = 0; i < n; ++i) {
+			// A v = l v
+			float av = GWMatrix::inner_row_col(a, n, i, vecs, n, k, 0, n - 1);
+			if (std::fabs(av - vals[k] * vecs[i * n + k]) > 1.0e-5f) { return false; }
+			// V^T V = I
+			float vv = GWMatrix::inner_col_col(vecs, n, i, vecs, n, k, 0, n - 1);
+			if (std::fabs(vv - (i == k ? 1.0f : 0.0f)) > 1.0e-5f) { return false; }
+		}
+	}
+	// already diagonal
+	float d3[] = { 1, 0, 0, 0, 3, 0, 0, 0, 2 };
+	float v3[9];
+	float e3[3];
+	if (!GWMatrix::sym_eigen(e3, v3, d3, d3, 3, tmp)) { return false; }
+	return e3[0] == 3.0f && e3[1] == 2.0f && e3[2] == 1.0f && v3[3] == 1.0f && v3[7] == 1.0f && v3[2] == 1.0f;
+}
+
+// the batches give the results of the single system calls, up to the contractions the compiler picks for each copy
+static bool close_batch(const float* pRes, const float* pRef, int n, float tol) {
+	for (int i = 0; i < n; ++i) {
+		if (std::fabs(pRes[i] - pRef[i]) > tol * std::max(1.0f, std::fabs(pRef[i]))) { return false; }
+	}
+	return true;
+}
+
+static bool test_solve_batch() {
+	const int n = 4;
+	const int m = 7;
+	const int num = 300;
+	GWBase::Random rnd(41);
+	std::vector<float> spd(num * n * n);
+	std::vector<float> rect(num * m * n);
+	std::vector<float> rh(num * m);
+	for (int i = 0; i < num; ++i) {
+		gen_spd_mtx(&spd[i * n * n], n, rnd);
+	}
+	for (size_t i = 0; i < rect.size(); ++i) { rect[i] = rnd.f01() * 2.0f - 1.0f; }
+	for (size_t i = 0; i < rh.size(); ++i) { rh[i] = rnd.f01() * 2.0f - 1.0f; }
+	// one singular system
+	for (int i = 0; i < n * n; ++i) { spd[7 * n * n + i] = 1.0f; }
+
+	std::vector<float> ans(num * n);
+	std::vector<float> fac(num * m * n);
+	std::vector<float> tmp(num * (m + n) * 2);
+	bool ok[num];
+	float x[n];
+	float f[m * n];
+	float t[m + n];
+	GWMatrix::ldl_solve_batch(ans.data(), fac.data(), spd.data(), rh.data(), n, num, ok);
+	for (int i = 0; i < num; ++i) {
+		if (ok[i] != (i != 7)) { return false; }
+		if (!ok[i]) continue;
+		GWMatrix::ldl_decomp(f, &spd[i * n * n], n);
+		GWMatrix::ldl_solve(x, f, n, &rh[i * n]);
+		if (!close_batch(&ans[i * n], x, n, 1.0e-5f)) { return false; }
+	}
+
+	GWMatrix::qr_solve_batch(ans.data(), fac.data(), rect.data(), rh.data(), m, n, num, tmp.data(), ok);
+	for (int i = 0; i < num; ++i) {
+		if (!ok[i]) { return false; }
+		GWMatrix::qr_decomp(f, &rect[i * m * n], m, n, t, t + n);
+		GWMatrix::qr_solve(x, f, m, n, t, &rh[i * m], t + n);
+		if (!close_batch(&ans[i * n], x, n, 1.0e-5f)) { return false; }
+	}
+
+	std::vector<float> vals(num * n);
+	std::vector<float> vecs(num * n * n);
+	float e[n];
+	float v[n * n];
+	GWMatrix::sym_eigen_batch(vals.data(), vecs.data(), fac.data(), spd.data(), n, num, tmp.data(), ok);
+	for (int i = 0; i < num; ++i) {
+		if (!ok[i]) { return false; }
+		GWMatrix::sym_eigen(e, v, f, &spd[i * n * n], n, t);
+		if (!close_batch(&vals[i * n], e, n, 1.0e-5f)) { return false; }
+		if (!close_batch(&vecs[i * n * n], v, n * n, 1.0e-4f)) { return false; }
+	}
+	return true;
+}
+
+// well conditioned, with the rows shuffled so that the pivoting has to bring the diagonal back
+template<int N>
+static void gen_shuffled_mtx(float* pMtx, GWBase::Random& rnd) {
+	int perm[N];
+	for (int i = 0; i < N; ++i) { perm[i] = i; }
+	for (int i = N; --i > 0;) { std::swap(perm[i], perm[rnd.u64() % (i + 1)]); }
+	for (int i = 0; i < N; ++i) {
+		for (int j = 0; j < N; ++j) {
+			pMtx[perm[i] * N + j] = (rnd.f01() - 0.5f) * 0.5f + (i == j ? 2.0f : 0.0f);
+		}
+	}
+}
+
+template<int N>
+static bool check_solve_n() {
+	const int num = 1001;
+	GWBase::Random rnd(43 + N);
+	std::vector<float> mtx(num * N * N);
+	std::vector<float> rh(num * N);
+	std::vector<float> xref(num * N);
+	for (int k = 0; k < num; ++k) {
+		gen_shuffled_mtx<N>(&mtx[k * N * N], rnd);
+		for (int i = 0; i < N; ++i) { xref[k * N + i] = rnd.f01() * 4.0f - 2.0f; }
+		for (int i = 0; i < N; ++i) {
+			rh[k * N + i] = float(GWMatrix::inner_row_vec<float, double>(&mtx[k * N * N], N, i, &xref[k * N]));
+		}
+	}
+	// one singular system
+	for (int i = 0; i < N; ++i) { mtx[5 * N * N + i * N + 1] = 0.0f; }
+
+	std::vector<float> ans(num * N);
+	std::vector<float> piv(num);
+	for (int k = 0; k < num; ++k) {
+		piv[k] = GWMatrix::solve_n<N>(&ans[k * N], &mtx[k * N * N], &rh[k * N]);
+		if ((piv[k] == 0.0f) != (k == 5)) { return false; }
+		if (k == 5) continue;
+		for (int i = 0; i < N; ++i) {
+			if (std::fabs(ans[k * N + i] - xref[k * N + i]) > 1.0e-5f) { return false; }
+		}
+	}
+
+	std::vector<float> bans(num * N);
+	std::vector<float> bpiv(num);
+	GWMatrix::solve_batch_n<N>(bans.data(), mtx.data(), rh.data(), num, bpiv.data());
+	if (bpiv[5] != 0.0f) { return false; }
+	for (int k = 0; k < num; ++k) {
+		if (k == 5) continue;
+		if (std::fabs(bpiv[k] - piv[k]) > 1.0e-6f) { return false; }
+		for (int i = 0; i < N; ++i) {
+			if (std::fabs(bans[k * N + i] - ans[k * N + i]) > 1.0e-6f) { return false; }
+		}
+	}
+
+	// the same systems interleaved by hand
+	const int ngroups = num / GWMatrix::SOA_BATCH;
+	const int B = GWMatrix::SOA_BATCH;
+	std::vector<float> smtx(ngroups * B * N * N);
+	std::vector<float> srh(ngroups * B * N);
+	std::vector<float> sans(ngroups * B * N);
+	for (int k = 0; k < ngroups * B; ++k) {
+		int g = k / B;
+		int l = k % B;
+		for (int i = 0; i < N * N; ++i) { smtx[(g * N * N + i) * B + l] = mtx[k * N * N + i]; }
+		for (int i = 0; i < N; ++i) { srh[(g * N + i) * B + l] = rh[k * N + i]; }
+	}
+	GWMatrix::solve_soa_n<N>(sans.data(), smtx.data(), srh.data(), ngroups);
+	for (int k = 0; k < ngroups * B; ++k) {
+		if (k == 5) continue;
+		for (int i = 0; i < N; ++i) {
+			if (sans[((k / B) * N + i) * B + k % B] != bans[k * N + i]) { return false; }
+		}
+	}
+	return true;
+}
+
+static bool test_solve_n() {
+	// a zero leading element is swapped away, it isn't a singular system
+	float swp[] = { 0, 1, 1, 0 };
+	float swpRH[] = { 2, 3 };
+	float x[2];
+	float piv = GWMatrix::solve_n<2>(x, swp, swpRH);
+	float xref[] = { 3, 2 };
+	if (piv != 1.0f || !close_batch(x, xref, 2, 1.0e-6f)) { return false; }
+	float bswp[4 * 3] = { 0, 1, 1, 0, 0, 0, 1, 0, 0, 1, 1, 0 };
+	float bRH[2 * 3] = { 2, 3, 1, 1, 5, 7 };
+	float bx[2 * 3];
+	float bpiv[3];
+	GWMatrix::solve_batch_n<2>(bx, bswp, bRH, 3, bpiv);
+	if (bpiv[0] != 1.0f || bpiv[1] != 0.0f || bpiv[2] != 1.0f) { return false; }
+	float bxref[] = { 7, 5 };
+	if (!close_batch(bx, xref, 2, 1.0e-6f) || !close_batch(&bx[4], bxref, 2, 1.0e-6f)) { return false; }
+	return check_solve_n<2>() && check_solve_n<3>() && check_solve_n<4>();
+}
+
 static TEST_ENTRY s_mtx_tests[] = {
 	TEST_DECL(test_tup),
 	TEST_DECL(test_gj3),
 	TEST_DECL(test_solve3),
 	TEST_DECL(test_distmtx),
-	TEST_DECL(test_pascal)
+	TEST_DECL(test_pascal),
+	TEST_DECL(test_mul_blocked),
+	TEST_DECL(test_lu_blocked),
+	TEST_DECL(test_ldl),
+	TEST_DECL(test_qr),
+	TEST_DECL(test_sym_eigen),
+	TEST_DECL(test_solve_batch),
+	TEST_DECL(test_solve_n)
 };
 
 bool test_mtx() {
@@ -112,6 +112,77 @@ static bool test_closest() {
 	return true;
 }
 
+static float quat_diff(const GWQuaternionF& q, const GWQuaternionF& p) {
+	float d = 0.0f;
+	for (int i = 0; i < 4; ++i) {
+		d = std::max(d, std::fabs(q.as_tptr()[i] - p.as_tptr()[i]));
+	}
+	return d;
+}
+
+static GWQuaternionF gen_quat(GWBase::Random& rnd) {
+	GWQuaternionF q(rnd.f01() - 0.5f, rnd.f01() - 0.5f, rnd.f01() - 0.5f, rnd.f01() - 0.5f);
+	q.normalize();
+	return q;
+}
+
+static bool test_quat_batch() {
+	const int n = 37;
+	GWBase::Random rnd(3);
+	GWQuaternionF qa[n];
+	GWQuaternionF qb[n];
+	GWQuaternionF res[n];
+	GWVectorF logs[n];
+	for (int i = 0; i < n; ++i) {
+		qa[i] = gen_quat(rnd);
+		qb[i] = gen_quat(rnd);
+		logs[i] = GWVectorF(rnd.f01() - 0.5f, rnd.f01() - 0.5f, rnd.f01() - 0.5f) * 6.0f;
+	}
+	// zero log, nearly parallel and opposite pairs
+	logs[0] = GWVectorF(0.0f);
+	qb[1] = qa[1];
+	qb[2] = GWQuaternionF(qa[2].V().x + 1.0e-4f, qa[2].V().y, qa[2].V().z, qa[2].S());
+	qb[2].normalize();
+	qb[3] = -qa[3];
+
+	bool res0 = true;
+	GWQuaternion::expmap_decode(res, logs, n);
+	for (int i = 0; i < n; ++i) {
+		res0 &= quat_diff(res[i], GWQuaternion::expmap_decode(logs[i])) < 1.0e-6f;
+	}
+
+	for (int i = 0; i < n; ++i) {
+		res[i].scl(qa[i], 1.0f + float(i));
+	}
+	GWQuaternion::normalize(res, res, n);
+	for (int i = 0; i < n; ++i) {
+		res0 &= quat_diff(res[i], qa[i]) < 1.0e-6f;
+	}
+
+	const float ts[] = { 0.0f, 0.3f, 0.5f, 1.0f };
+	for (float t : ts) {
+		GWUnitQuaternion::nlerp(res, qa, qb, t, n);
+		for (int i = 0; i < n; ++i) {
+			res0 &= quat_diff(res[i], GWUnitQuaternion::nlerp(qa[i], qb[i], t)) < 1.0e-6f;
+		}
+		GWUnitQuaternion::slerp(res, qa, qb, t, n);
+		for (int i = 0; i < n; ++i) {
+			GWQuaternionF ref = GWUnitQuaternion::slerp(qa[i], qb[i], t);
+			ref.normalize();
+			res0 &= quat_diff(res[i], ref) < 2.0e-6f;
+		}
+	}
+
+	GWTransform3x4F xforms[n];
+	GWUnitQuaternion::make_rotations(xforms, qa, n);
+	for (int i = 0; i < n; ++i) {
+		GWTransform3x4F ref;
+		ref.make_rotation(qa[i]);
+		res0 &= compare_mtx(xforms[i].as_tptr(), ref.as_tptr(), 3, 4);
+	}
+	return res0;
+}
+
 static TEST_ENTRY s_quat_tests[] = {
 	TEST_DECL(test_quat_set_get),
 	TEST_DECL(test_quat_set_get_rad),
@@ -119,7 +190,8 @@ static TEST_ENTRY s_quat_tests[] = {
 	TEST_DECL(test_quat_expmap),
 	TEST_DECL(test_get_transform),
 	TEST_DECL(test_to_transform),
-	TEST_DECL(test_closest)
+	TEST_DECL(test_closest),
+	TEST_DECL(test_quat_batch)
 };
 
 bool test_quat() {
@@ -0,0 +1,153 @@
+/*
+ * Groundwork random number tests
+ * Author: Gleb Novodran <novodran@gmail.com>
+ */
+
+#include <vector>
+#include <groundwork.hpp>
+#include "test.hpp"
+
+// Known answers from the Random123 distribution.
+static bool test_philox_kat() {
+	const uint32_t ctr[][4] = {
+		{ 0, 0, 0, 0 },
+		{ 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF },
+		{ 0x243F6A88, 0x85A308D3, 0x13198A2E, 0x03707344 }
+	};
+	const uint32_t key[][2] = {
+		{ 0, 0 },
+		{ 0xFFFFFFFF, 0xFFFFFFFF },
+		{ 0xA4093822, 0x299F31D0 }
+	};
+	const uint32_t ref[][4] = {
+		{ 0x6627E8D5, 0xE169C58D, 0xBC57AC4C, 0x9B00DBD8 },
+		{ 0x408F276D, 0x41C83B0E, 0xA20BC7C6, 0x6D5451FD },
+		{ 0xD16CFE09, 0x94FDCCEB, 0x5001E420, 0x24126EA1 }
+	};
+	for (int i = 0; i < 3; ++i) {
+		uint32_t blk[4];
+		GWBase::Philox::gen_block(blk, ctr[i], key[i]);
+		if (!std::equal(blk, blk + 4, ref[i])) { return false; }
+	}
+	return true;
+}
+
+static bool test_philox_streams() {
+	const uint64_t seed = 0x123456789ABCDEFULL;
+	const int n = 1000;
+	GWBase::Philox rnd(seed, 7);
+	std::vector<uint32_t> seq(n);
+	for (int i = 0; i < n; ++i) { seq[i] = rnd.u32(); }
+
+	// the bulk form gives the same sequence and leaves the generator at the next whole block
+	const int sizes[] = { 1, 3, 16, 37, 64, 250 };
+	for (int k = 0; k < 6; ++k) {
+		GWBase::Philox bulk(seed, 7);
+		std::vector<uint32_t> ary(sizes[k]);
+		bulk.fill_u32(ary.data(), sizes[k]);
+		if (!std::equal(ary.begin(), ary.end(), seq.begin())) { return false; }
+		int next = (sizes[k] + 3) / 4 * 4;
+		if (bulk.get_block() != uint64_t(next / 4) || bulk.u32() != seq[next]) { return false; }
+	}
+
+	// chunks done in any order after seek() give the serial sequence
+	const int chunk = 40;
+	std::vector<uint32_t> par(n);
+	GWTask::parallel_for(n / chunk, [&](int begin, int end) {
+		for (int i = begin; i < end; ++i) {
+			GWBase::Philox chunkRnd(seed, 7);
+			chunkRnd.seek(uint64_t(i * chunk / 4));
+			chunkRnd.fill_u32(&par[i * chunk], chunk);
+		}
+	}, 1);
+	if (par != seq) { return false; }
+
+	// the counter carries into the high word
+	GWBase::Philox wrap(seed, 7);
+	wrap.seek(0xFFFFFFFFULL);
+	std::vector<uint32_t> wrapped(32);
+	wrap.fill_u32(wrapped.data(), 32);
+	GWBase::Philox wrapRef(seed, 7);
+	wrapRef.seek(0xFFFFFFFFULL);
+	for (int i = 0; i < 32; ++i) {
+		if (wrapRef.u32() != wrapped[i]) { return false; }
+	}
+	if (wrap.get_block() != 0x100000007ULL) { return false; }
+
+	// neighbouring streams and seeds are unrelated
+	GWBase::Philox other(seed, 8);
+	GWBase::Philox otherSeed(seed + 1, 7);
+	int same = 0;
+	for (int i = 0; i < n; ++i) {
+		uint32_t a = other.u32();
+		uint32_t b = otherSeed.u32();
+		if (a == seq[i] || b == seq[i]) { ++same; }
+	}
+	return same == 0;
+}
+
+static bool test_philox_dist() {
+	const int n = 100000;
+	GWBase::Philox rnd(11);
+	std::vector<float> f(n);
+	rnd.fill_f01(f.data(), n);
+	double sum = 0.0;
+	double sum2 = 0.0;
+	for (int i = 0; i < n; ++i) {
+		if (f[i] < 0.0f || f[i] >= 1.0f) { return false; }
+		sum += f[i];
+		sum2 += double(f[i]) * f[i];
+	}
+	double mean = sum / n;
+	double var = sum2 / n - mean * mean;
+	if (std::fabs(mean - 0.5) > 0.005 || std::fabs(var - 1.0 / 12.0) > 0.002) { return false; }
+	for (int i = 0; i < 1000; ++i) {
+		double d = rnd.d01();
+		if (d < 0.0 || d >= 1.0) { return false; }
+	}
+	return true;
+}
+
+static bool test_philox_dirs() {
+	const int n = 20000;
+	std::vector<float> dirs(n * 3);
+	// mean of z: 0 over the sphere, 1/2 over the hemisphere, 2/3 with the cosine weight
+	const float meanZ[] = { 0.0f, 0.5f, 2.0f / 3.0f };
+	for (int k = 0; k < 3; ++k) {
+		GWBase::Philox rnd(19, k);
+		GWBase::Philox ref(19, k);
+		switch (k) {
+		case 0: rnd.fill_sphere(dirs.data(), n); break;
+		case 1: rnd.fill_hemisphere(dirs.data(), n); break;
+		default: rnd.fill_cosine(dirs.data(), n); break;
+		}
+		double sum[3] = { 0.0, 0.0, 0.0 };
+		for (int i = 0; i < n; ++i) {
+			float* pDir = &dirs[i * 3];
+			float x, y, z;
+			switch (k) {
+			case 0: ref.dir_sphere(x, y, z); break;
+			case 1: ref.dir_hemisphere(x, y, z); break;
+			default: ref.dir_cosine(x, y, z); break;
+			}
+			if (std::fabs(pDir[0] - x) > 1.0e-6f || std::fabs(pDir[1] - y) > 1.0e-6f || std::fabs(pDir[2] - z) > 1.0e-6f) { return false; }
+			float len = std::sqrt(pDir[0] * pDir[0] + pDir[1] * pDir[1] + pDir[2] * pDir[2]);
+			if (std::fabs(len - 1.0f) > 1.0e-5f) { return false; }
+			if (k > 0 && pDir[2] < 0.0f) { return false; }
+			for (int j = 0; j < 3; ++j) { sum[j] += pDir[j]; }
+		}
+		if (std::fabs(sum[0] / n) > 0.02 || std::fabs(sum[1] / n) > 0.02 || std::fabs(sum[2] / n - meanZ[k]) > 0.02) { return false; }
+	}
+	return true;
+}
+
+static TEST_ENTRY s_rng_tests[] = {
+	TEST_DECL(test_philox_kat),
+	TEST_DECL(test_philox_streams),
+	TEST_DECL(test_philox_dist),
+	TEST_DECL(test_philox_dirs)
+};
+
+bool test_rng() {
+	return 0 == EXEC_TESTS(s_rng_tests);
+}
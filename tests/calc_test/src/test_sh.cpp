@@ -0,0 +1,297 @@
+/*
+ * Groundwork spherical harmonics tests
+ * Author: Gleb Novodran <novodran@gmail.com>
+ */
+
+#include <vector>
+#include <groundwork.hpp>
+#include "test.hpp"
+
+// Straightforward per-pixel projection.
+static void calc_pano_ref(double* pCoefs, const GWImage* pImg) {
+	int w = pImg->get_width();
+	int h = pImg->get_height();
+	double da = (2.0 * GWBase::pi / w) * (GWBase::pi / h);
+	std::fill_n(pCoefs, 27, 0.0);
+	for (int y = 0; y < h; ++y) {
+		double v = 1.0 - (y + 0.5) / h;
+		double dw = da * std::sin(GWBase::pi * v);
+		double inclination = (v - 1.0) * GWBase::pi;
+		for (int x = 0; x < w; ++x) {
+			double azimuth = (x + 0.5) / w * 2.0 * GWBase::pi;
+			double dx = std::cos(azimuth) * std::sin(inclination);
+			double dy = std::cos(inclination);
+			double dz = std::sin(azimuth) * std::sin(inclination);
+			double dirCoefs[9];
+			GWSH::vec_project_i<double>(dirCoefs, &dx, &dy, &dz, 1);
+			GWColorF pix = pImg->get_pixel(x, y);
+			for (int i = 0; i < 9; ++i) {
+				for (int j = 0; j < 3; ++j) {
+					pCoefs[i * 3 + j] += pix[j] * dirCoefs[i] * dw;
+				}
+			}
+		}
+	}
+}
+
+static bool compare_coefs(GWSHCoeffsF& coefs, const double* pRef, float eps) {
+	const float* pData = coefs.as_raw();
+	for (int i = 0; i < 27; ++i) {
+		if (std::fabs(pData[i] - pRef[i]) > eps) { return false; }
+	}
+	return true;
+}
+
+static bool test_sh_pano() {
+	const int w = 250;
+	const int h = 125;
+	GWImage* pImg = GWImage::alloc(w, h);
+	std::vector<GWHalf4> half(w * h);
+	std::vector<uint32_t> rgba8(w * h);
+	GWBase::Random rnd(11);
+	for (int y = 0; y < h; ++y) {
+		for (int x = 0; x < w; ++x) {
+			// a bright sky over a dim ground plus noise
+			float sky = y < h / 2 ? 1.0f : 0.2f;
+			GWColorF clr(sky * 0.6f + rnd.f01() * 0.3f, sky * 0.8f + rnd.f01() * 0.1f, sky + rnd.f01() * 0.2f, 1.0f);
+			clr.clip_negative();
+			// exactly representable in all the formats
+			clr.decode_rgba8(clr.encode_rgba8());
+			pImg->set_pixel(x, y, clr);
+			GWTuple4f tuple;
+			GWTuple::copy(tuple, clr);
+			half[y * w + x].set(tuple);
+			rgba8[y * w + x] = clr.encode_rgba8();
+		}
+	}
+
+	double ref[27];
+	calc_pano_ref(ref, pImg);
+	GWSHCoeffsF coefs;
+	coefs.calc_pano(pImg, false);
+	bool res = compare_coefs(coefs, ref, 1e-4f);
+
+	// the parallel reduction adds up in the same order
+	GWSHCoeffsF par;
+	par.calc_pano(pImg, true);
+	res = res && std::memcmp(par.as_raw(), coefs.as_raw(), 27 * sizeof(float)) == 0;
+
+	GWSHCoeffsF coefsHalf;
+	coefsHalf.calc_pano(half.data(), w, h);
+	res = res && compare_coefs(coefsHalf, ref, 2e-3f);
+	GWSHCoeffsF coefs8;
+	coefs8.calc_pano(rgba8.data(), w, h);
+	res = res && compare_coefs(coefs8, ref, 1e-4f);
+
+	// uniform light comes back from the synthesis
+	for (int y = 0; y < h; ++y) {
+		for (int x = 0; x < w; ++x) {
+			pImg->set_pixel(x, y, GWColorF(0.25f, 0.5f, 1.0f));
+		}
+	}
+	coefs.calc_pano(pImg);
+	GWColorTuple3f clr = coefs.synthesize(0.0f, 1.0f, 0.0f);
+	res = res && std::fabs(clr[0] - 0.25f) < 1e-3f && std::fabs(clr[1] - 0.5f) < 1e-3f && std::fabs(clr[2] - 1.0f) < 1e-3f;
+
+	GWImage::free(pImg);
+	return res;
+}
+
+// The generated basis against the hand-expanded order 3 and the closed forms of the 4th band.
+static bool test_sh_basis() {
+	const int n = 64;
+	float x[n];
+	float y[n];
+	float z[n];
+	GWBase::Random rnd(3);
+	for (int i = 0; i < n; ++i) {
+		GWVectorF dir(rnd.f01() - 0.5f, rnd.f01() - 0.5f, rnd.f01() - 0.5f);
+		dir.normalize();
+		x[i] = dir.x;
+		y[i] = dir.y;
+		z[i] = dir.z;
+	}
+	float ref[9 * n];
+	float gen[16 * n];
+	GWSH::vec_project_i(ref, x, y, z, n);
+	GWSH::BasisBand<float, 4, 0>::calc(gen, x, y, z, n);
+	bool res = true;
+	for (int i = 0; i < 9 * n && res; ++i) {
+		res = std::fabs(ref[i] - gen[i]) < 1e-5f;
+	}
+	for (int i = 0; i < n && res; ++i) {
+		float y30 = 0.3731763325901154f * z[i] * (5.0f * z[i] * z[i] - 3.0f);
+		float y33 = -0.5900435899266435f * x[i] * (x[i] * x[i] - 3.0f * y[i] * y[i]);
+		float y3n3 = -0.5900435899266435f * y[i] * (3.0f * x[i] * x[i] - y[i] * y[i]);
+		res = std::fabs(gen[12 * n + i] - y30) < 1e-5f && std::fabs(gen[15 * n + i] - y33) < 1e-5f && std::fabs(gen[9 * n + i] - y3n3) < 1e-5f;
+	}
+
+	// the projection of a basis function picks it out
+	const int order = 6;
+	const int w = 512;
+	const int h = 256;
+	static const int pick[][2] = { { 5, 17 }, { 24, 30 }, { 35, 12 } };
+	GWImage* pImg = GWImage::alloc(w, h);
+	for (int k = 0; k < 3 && res; ++k) {
+		for (int py = 0; py < h; ++py) {
+			float v = 1.0f - (py + 0.5f) / h;
+			float inclination = (v - 1.0f) * float(GWBase::pi);
+			for (int px = 0; px < w; ++px) {
+				float azimuth = (px + 0.5f) / w * 2.0f * float(GWBase::pi);
+				float dx = std::cos(azimuth) * std::sin(inclination);
+				float dy = std::cos(inclination);
+				float dz = std::sin(azimuth) * std::sin(inclination);
+				float dirCoefs[order * order];
+				GWSH::vec_project<float, order>(dirCoefs, &dx, &dy, &dz, 1);
+				pImg->set_pixel(px, py, GWColorF(dirCoefs[pick[k][0]], dirCoefs[pick[k][1]], 1.0f));
+			}
+		}
+		GWSHCoeffsBase<float, order> coefs;
+		coefs.calc_pano(pImg);
+		for (int i = 0; i < order * order && res; ++i) {
+			GWColorTuple3f c = coefs(i);
+			res = std::fabs(c[0] - (i == pick[k][0] ? 1.0f : 0.0f)) < 2e-3f;
+			res = res && std::fabs(c[1] - (i == pick[k][1] ? 1.0f : 0.0f)) < 2e-3f;
+			res = res && std::fabs(c[2] - (i == 0 ? 3.5449077f : 0.0f)) < 2e-3f;
+		}
+	}
+	GWImage::free(pImg);
+
+	float wgt[5];
+	GWSH::calc_irradiance_weights(wgt, 1.0f, 5);
+	res = res && wgt[0] == 1.0f && std::fabs(wgt[1] - 2.0f / 3.0f) < 1e-6f && std::fabs(wgt[2] - 0.25f) < 1e-6f;
+	res = res && wgt[3] == 0.0f && std::fabs(wgt[4] + 1.0f / 24.0f) < 1e-6f;
+	return res;
+}
+
+// Rotated coefficients against the source looked up in the inversely rotated directions.
+template<int ORDER> static bool test_sh_rotate_order(const GWQuaternionF& q) {
+	GWBase::Random rnd(ORDER);
+	const int nset = 16;
+	GWSHCoeffsBase<float, ORDER> src[nset];
+	for (int k = 0; k < nset; ++k) {
+		float* pData = src[k].as_raw();
+		for (int i = 0; i < ORDER * ORDER * 3; ++i) {
+			pData[i] = rnd.f01() - 0.5f;
+		}
+	}
+	GWSHCoeffsBase<float, ORDER> rot = src[0];
+	rot.rotate(q);
+	GWVectorF axes[3] = { q.calc_axis_x(), q.calc_axis_y(), q.calc_axis_z() };
+	bool res = true;
+	for (int i = 0; i < 200 && res; ++i) {
+		GWVectorF dir(rnd.f01() - 0.5f, rnd.f01() - 0.5f, rnd.f01() - 0.5f);
+		dir.normalize();
+		GWVectorF inv(axes[0].dot(dir), axes[1].dot(dir), axes[2].dot(dir));
+		GWColorTuple3f a = rot.synthesize(dir.x, dir.y, dir.z);
+		GWColorTuple3f b = src[0].synthesize(inv.x, inv.y, inv.z);
+		for (int j = 0; j < 3; ++j) {
+			res = res && std::fabs(a[j] - b[j]) < 1e-4f * ORDER * ORDER;
+		}
+	}
+
+	// the transform form and the batch give the same
+	GWTransformF xform;
+	xform.make_rotation(q);
+	GWSHCoeffsBase<float, ORDER> rotXform = src[0];
+	rotXform.rotate(xform);
+	GWSHCoeffsBase<float, ORDER> batch[nset];
+	std::copy(src, src + nset, batch);
+	GWSHCoeffsBase<float, ORDER>::rotate(batch, nset, q);
+	for (int i = 0; i < ORDER * ORDER * 3 && res; ++i) {
+		res = std::fabs(rotXform.as_raw()[i] - rot.as_raw()[i]) < 1e-4f;
+		res = res && std::fabs(batch[0].as_raw()[i] - rot.as_raw()[i]) < 1e-6f;
+	}
+	for (int k = 1; k < nset && res; ++k) {
+		GWSHCoeffsBase<float, ORDER> single = src[k];
+		single.rotate(q);
+		for (int i = 0; i < ORDER * ORDER * 3 && res; ++i) {
+			res = std::fabs(single.as_raw()[i] - batch[k].as_raw()[i]) < 1e-6f;
+		}
+	}
+	return res;
+}
+
+static bool test_sh_rotate() {
+	GWQuaternionF q;
+	q.set_degrees(30.0f, -75.0f, 140.0f);
+	return test_sh_rotate_order<3>(q) && test_sh_rotate_order<4>(q) && test_sh_rotate_order<5>(q) && test_sh_rotate_order<8>(q);
+}
+
+// Batched grid lookups against blending the probes and synthesizing one by one.
+static bool test_sh_probes() {
+	const int gridRes[3] = { 5, 4, 3 };
+	GWVectorF bbMin(-4.0f, 0.0f, -2.0f);
+	GWVectorF bbMax(4.0f, 3.0f, 2.0f);
+	GWBase::Random rnd(21);
+	std::vector<GWSHCoeffsF> probes(gridRes[0] * gridRes[1] * gridRes[2]);
+	for (size_t i = 0; i < probes.size(); ++i) {
+		float* pData = probes[i].as_raw();
+		for (int j = 0; j < 27; ++j) {
+			pData[j] = (rnd.f01() - 0.5f) * (j < 3 ? 4.0f : 1.0f);
+		}
+	}
+	const int npos = 300;
+	std::vector<GWVectorF> pos(npos);
+	std::vector<GWVectorF> nrm(npos);
+	for (int i = 0; i < npos; ++i) {
+		// some outside the grid
+		pos[i] = bbMin + GWVectorF(rnd.f01(), rnd.f01(), rnd.f01()) * (bbMax - bbMin) * 1.2f - (bbMax - bbMin) * 0.1f;
+		nrm[i] = GWVectorF(rnd.f01() - 0.5f, rnd.f01() - 0.5f, rnd.f01() - 0.5f);
+		nrm[i].normalize();
+	}
+	float wgt[3];
+	GWSH::calc_irradiance_weights(wgt, 1.0f);
+
+	bool res = true;
+	for (int k = 0; k < 2 && res; ++k) {
+		GWSH::ProbeStorage storage = k ? GWSH::ProbeStorage::HALF : GWSH::ProbeStorage::FLOAT;
+		GWSH::ProbeGrid* pGrid = GWSH::ProbeGrid::create(bbMin, bbMax, gridRes, storage);
+		res = pGrid != nullptr;
+		for (int iz = 0; iz < gridRes[2] && res; ++iz) {
+			for (int iy = 0; iy < gridRes[1]; ++iy) {
+				for (int ix = 0; ix < gridRes[0]; ++ix) {
+					pGrid->set_probe(ix, iy, iz, probes[pGrid->get_probe_idx(ix, iy, iz)]);
+				}
+			}
+		}
+		float tol = k ? 1e-2f : 1e-5f;
+		std::vector<GWColorTuple3f> irr(npos);
+		pGrid->eval(pos.data(), nrm.data(), irr.data(), npos);
+		for (int i = 0; i < npos && res; ++i) {
+			GWSHCoeffsF blend;
+			blend.clear();
+			GWVectorF g = (pos[i] - bbMin) * pGrid->mInvCellSize;
+			int i0[3];
+			float f[3];
+			for (int j = 0; j < 3; ++j) {
+				float gc = GWBase::clamp(g[j], 0.0f, float(gridRes[j] - 1));
+				i0[j] = std::min(int(gc), gridRes[j] - 2);
+				f[j] = gc - float(i0[j]);
+			}
+			for (int c = 0; c < 8; ++c) {
+				int ix = i0[0] + (c & 1);
+				int iy = i0[1] + ((c >> 1) & 1);
+				int iz = i0[2] + ((c >> 2) & 1);
+				float w = (c & 1 ? f[0] : 1.0f - f[0]) * (c & 2 ? f[1] : 1.0f - f[1]) * (c & 4 ? f[2] : 1.0f - f[2]);
+				const float* pSrc = probes[pGrid->get_probe_idx(ix, iy, iz)].as_raw();
+				for (int j = 0; j < 27; ++j) {
+					blend.as_raw()[j] += pSrc[j] * w;
+				}
+			}
+			blend.apply_weights(wgt);
+			GWColorTuple3f ref = blend.synthesize(nrm[i].x, nrm[i].y, nrm[i].z);
+			GWColorTuple3f single = pGrid->eval(pos[i], nrm[i]);
+			for (int j = 0; j < 3; ++j) {
+				res = res && std::fabs(irr[i][j] - ref[j]) < tol * (1.0f + std::fabs(ref[j]));
+				res = res && std::fabs(irr[i][j] - single[j]) < 1e-6f;
+			}
+		}
+		GWSH::ProbeGrid::destroy(pGrid);
+	}
+	return res;
+}
+
+bool test_sh() {
+	return test_sh_pano() && test_sh_basis() && test_sh_rotate() && test_sh_probes();
+}
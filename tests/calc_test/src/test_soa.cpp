@@ -0,0 +1,187 @@
+/*
+ * Groundwork structure of arrays tests
+ * Author: Gleb Novodran <novodran@gmail.com>
+ */
+
+#include <vector>
+#include <groundwork.hpp>
+#include "test.hpp"
+
+static std::vector<GWVectorF> gen_pnts(GWBase::Random& rnd, int n) {
+	std::vector<GWVectorF> pnts(n);
+	for (int i = 0; i < n; ++i) {
+		float x = rnd.f01() * 20.0f - 10.0f;
+		float y = rnd.f01() * 4.0f - 1.0f;
+		pnts[i] = GWVectorF(x, y, rnd.f01() * 8.0f - 6.0f);
+	}
+	return pnts;
+}
+
+static bool same_vec(const GWVectorF& a, const GWVectorF& b) {
+	return a.x == b.x && a.y == b.y && a.z == b.z;
+}
+
+static bool test_soa_convert() {
+	GWBase::Random rnd(49);
+	const int sizes[] = { 1, 7, 8, 13, 100 };
+	for (int k = 0; k < 5; ++k) {
+		int n = sizes[k];
+		std::vector<GWVectorF> pnts = gen_pnts(rnd, n);
+		GWSoA3* pSoA = GWSoA3::create(pnts.data(), n);
+		bool res = pSoA->mNum == n && pSoA->mNumBlocks == (n + 7) / 8;
+		res = res && (reinterpret_cast<uintptr_t>(pSoA->mpData) & 0x1F) == 0;
+		std::vector<GWVectorF> back(n);
+		pSoA->to_aos(back.data());
+		for (int i = 0; res && i < n; ++i) {
+			res = same_vec(back[i], pnts[i]) && pSoA->get(i, 1) == pnts[i].y;
+		}
+		// the tail repeats the last item
+		for (int i = n; res && i < pSoA->mNumBlocks * GWSoA3::BLOCK_SIZE; ++i) {
+			res = pSoA->get(i, 0) == pnts[n - 1].x && pSoA->get(i, 2) == pnts[n - 1].z;
+		}
+		// groups are GWLane::WIDTH consecutive items
+		for (int g = 0; res && g < pSoA->get_num_groups(); ++g) {
+			GWLane::V3 v;
+			pSoA->load(g, v);
+			float x[GWLane::WIDTH];
+			GWLane::store(x, v[0]);
+			for (int i = 0; i < GWLane::WIDTH; ++i) {
+				res = res && x[i] == pSoA->get(g * GWLane::WIDTH + i, 0);
+			}
+			GWLane::scl(v, v, GWLane::F(2.0f));
+			pSoA->store(g, v);
+		}
+		for (int i = 0; res && i < n; ++i) {
+			res = pSoA->get(i, 2) == pnts[i].z * 2.0f;
+		}
+		GWSoA3::destroy(pSoA);
+		if (!res) { return false; }
+	}
+
+	std::vector<GWColorF> clrs(11);
+	for (size_t i = 0; i < clrs.size(); ++i) {
+		clrs[i].set(rnd.f01(), rnd.f01(), rnd.f01(), rnd.f01());
+	}
+	GWSoA4* pClr = GWSoA4::create(clrs.data(), int(clrs.size()));
+	std::vector<GWColorF> back(clrs.size());
+	pClr->to_aos(back.data());
+	bool res = true;
+	for (size_t i = 0; i < clrs.size(); ++i) {
+		res = res && std::equal(clrs[i].elems, clrs[i].elems + 4, back[i].elems);
+	}
+	GWSoA4::destroy(pClr);
+
+	GWSoA3* pEmpty = GWSoA3::create(0);
+	res = res && pEmpty->mNumBlocks == 0 && pEmpty->get_num_groups() == 0;
+	GWSoA3::destroy(pEmpty);
+	return res;
+}
+
+static bool test_soa_ops() {
+	GWBase::Random rnd(50);
+	const int n = GWLane::WIDTH * 16;
+	std::vector<GWVectorF> a = gen_pnts(rnd, n);
+	std::vector<GWVectorF> b = gen_pnts(rnd, n);
+	GWSoA3* pA = GWSoA3::create(a.data(), n);
+	GWSoA3* pB = GWSoA3::create(b.data(), n);
+	bool res = true;
+	for (int g = 0; res && g < pA->get_num_groups(); ++g) {
+		GWLane::V3 va, vb, vcross, vmin, vmax, vlerp, vsum;
+		pA->load(g, va);
+		pB->load(g, vb);
+		GWLane::cross(vcross, va, vb);
+		GWLane::min(vmin, va, vb);
+		GWLane::max(vmax, va, vb);
+		GWLane::lerp(vlerp, va, vb, GWLane::F(0.25f));
+		GWLane::add(vsum, va, vb);
+		float dot[GWLane::WIDTH];
+		float lanes[5][3][GWLane::WIDTH];
+		GWLane::store(dot, GWLane::dot(va, vb));
+		for (int j = 0; j < 3; ++j) {
+			GWLane::store(lanes[0][j], vcross[j]);
+			GWLane::store(lanes[1][j], vmin[j]);
+			GWLane::store(lanes[2][j], vmax[j]);
+			GWLane::store(lanes[3][j], vlerp[j]);
+			GWLane::store(lanes[4][j], vsum[j]);
+		}
+		for (int i = 0; res && i < GWLane::WIDTH; ++i) {
+			int idx = g * GWLane::WIDTH + i;
+			GWVectorF refCross = GWVector::cross(a[idx], b[idx]);
+			GWVectorF refLerp = a[idx];
+			GWTuple::lerp(refLerp, b[idx], 0.25f);
+			res = std::fabs(dot[i] - GWVector::dot(a[idx], b[idx])) < 1.0e-4f;
+			for (int j = 0; res && j < 3; ++j) {
+				res = std::fabs(lanes[0][j][i] - refCross[j]) < 1.0e-4f;
+				res = res && lanes[1][j][i] == std::min(a[idx][j], b[idx][j]);
+				res = res && lanes[2][j][i] == std::max(a[idx][j], b[idx][j]);
+				res = res && std::fabs(lanes[3][j][i] - refLerp[j]) < 1.0e-5f;
+				res = res && lanes[4][j][i] == a[idx][j] + b[idx][j];
+			}
+		}
+	}
+
+	// bulk lerp in place
+	GWSoA3::lerp(*pA, *pA, *pB, 0.75f);
+	for (int i = 0; res && i < n; ++i) {
+		for (int j = 0; res && j < 3; ++j) {
+			res = std::fabs(pA->get(i, j) - GWBase::lerp(a[i][j], b[i][j], 0.75f)) < 1.0e-5f;
+		}
+	}
+	GWSoA3::destroy(pA);
+	GWSoA3::destroy(pB);
+	return res;
+}
+
+static bool test_soa_bbox() {
+	GWBase::Random rnd(51);
+	const int sizes[] = { 1, 5, 9, 64, 1001 };
+	for (int k = 0; k < 5; ++k) {
+		int n = sizes[k];
+		std::vector<GWVectorF> pnts = gen_pnts(rnd, n);
+		GWSoA3* pSoA = GWSoA3::create(pnts.data(), n);
+		GWVectorF minRef, maxRef, minVal, maxVal;
+		GWTuple::calc_bbox(pnts.data(), uint32_t(n), minRef, maxRef);
+		pSoA->calc_bbox(minVal, maxVal);
+		GWSoA3::destroy(pSoA);
+		if (!same_vec(minVal, minRef) || !same_vec(maxVal, maxRef)) { return false; }
+	}
+	return true;
+}
+
+// The same points are picked and the same per point code grows the sphere, fast math may contract
+// the distances differently, so a point on the surface can bump the radius by 1e-5 in one of them.
+static bool test_soa_ritter() {
+	GWBase::Random rnd(52);
+	const int sizes[] = { 1, 2, 7, 8, 33, 1000, 20000 };
+	for (int k = 0; k < 7; ++k) {
+		int n = sizes[k];
+		std::vector<GWVectorF> pnts = gen_pnts(rnd, n);
+		if (n > 10) {
+			// ties on the extremes
+			pnts[n - 1] = pnts[3];
+			pnts[n / 2] = pnts[5];
+		}
+		GWSoA3* pSoA = GWSoA3::create(pnts.data(), n);
+		GWSphereF ref, sph;
+		ref.ritter(pnts.data(), n);
+		sph.ritter(*pSoA);
+		GWSoA3::destroy(pSoA);
+		float tol = ref.r * 3.0e-5f;
+		if (!GWTuple::almost_equal(sph.c, ref.c, tol) || std::fabs(sph.r - ref.r) > tol) { return false; }
+		for (int i = 0; i < n; ++i) {
+			if ((pnts[i] - sph.c).length() > sph.r) { return false; }
+		}
+	}
+	return true;
+}
+
+static TEST_ENTRY s_soa_tests[] = {
+	TEST_DECL(test_soa_convert),
+	TEST_DECL(test_soa_ops),
+	TEST_DECL(test_soa_bbox),
+	TEST_DECL(test_soa_ritter)
+};
+
+bool test_soa() {
+	return 0 == EXEC_TESTS(s_soa_tests);
+}
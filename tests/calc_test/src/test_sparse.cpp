@@ -0,0 +1,121 @@
+/*
+ * Groundwork sparse matrix tests
+ * Author: Gleb Novodran <novodran@gmail.com>
+ */
+
+#include <vector>
+#include <groundwork.hpp>
+#include "test.hpp"
+
+// w x h points, two triangles per quad
+static std::vector<uint32_t> gen_grid_tris(int w, int h) {
+	std::vector<uint32_t> tris;
+	for (int y = 0; y < h - 1; ++y) {
+		for (int x = 0; x < w - 1; ++x) {
+			uint32_t p = uint32_t(y * w + x);
+			uint32_t quad[] = { p, p + 1, p + w + 1, p, p + w + 1, p + w };
+			tris.insert(tris.end(), quad, quad + 6);
+		}
+	}
+	return tris;
+}
+
+static bool test_csr() {
+	const int w = 30;
+	const int h = 20;
+	const int n = w * h;
+	std::vector<uint32_t> tris = gen_grid_tris(w, h);
+	int ntri = int(tris.size() / 3);
+	GWSparse::CSRMatrix* pMtx = GWSparse::CSRMatrix::from_triangles(tris.data(), ntri, n);
+	GWSparse::CSRMatrix* pSerial = GWSparse::CSRMatrix::from_triangles(tris.data(), ntri, n, false);
+	bool res = pMtx->mNumNonZero == pSerial->mNumNonZero;
+	res = res && std::equal(pMtx->mpRowOrg, pMtx->mpRowOrg + n + 1, pSerial->mpRowOrg);
+	res = res && std::equal(pMtx->mpCols, pMtx->mpCols + pMtx->mNumNonZero, pSerial->mpCols);
+	// interior points have 6 neighbours, the corners 2 or 3
+	res = res && pMtx->get_row_size(w + 1) == 7 && pMtx->get_row_size(0) == 4 && pMtx->get_row_size(w - 1) == 3;
+	for (int i = 0; res && i < n; ++i) {
+		for (int j = pMtx->mpRowOrg[i]; j < pMtx->mpRowOrg[i + 1]; ++j) {
+			int col = pMtx->mpCols[j];
+			if (j > pMtx->mpRowOrg[i] && col <= pMtx->mpCols[j - 1]) { res = false; }
+			if (pMtx->find(col, i) < 0) { res = false; }
+		}
+	}
+
+	pMtx->set_laplacian(2.0f, 0.5f);
+	std::vector<float> vec(n);
+	std::vector<float> prod(n);
+	std::vector<float> diag(n);
+	GWBase::Random rnd(47);
+	for (int i = 0; i < n; ++i) { vec[i] = rnd.f01() * 2.0f - 1.0f; }
+	pMtx->mul(prod.data(), vec.data());
+	pMtx->get_diag(diag.data());
+	for (int i = 0; res && i < n; ++i) {
+		double ref = 0.0;
+		for (int j = 0; j < n; ++j) {
+			ref += double(pMtx->get(i, j)) * vec[j];
+		}
+		// rows sum to the diagonal shift
+		res = std::fabs(prod[i] - ref) < 1.0e-5 && diag[i] == 2.0f * float(pMtx->get_row_size(i) - 1) + 0.5f;
+	}
+	GWSparse::CSRMatrix::destroy(pMtx);
+	GWSparse::CSRMatrix::destroy(pSerial);
+	return res;
+}
+
+static bool test_cg() {
+	const int w = 60;
+	const int h = 50;
+	const int n = w * h;
+	std::vector<uint32_t> tris = gen_grid_tris(w, h);
+	GWSparse::CSRMatrix* pMtx = GWSparse::CSRMatrix::from_triangles(tris.data(), int(tris.size() / 3), n);
+	pMtx->set_laplacian(1.0f, 0.05f);
+	std::vector<float> xref(n);
+	std::vector<float> rh(n);
+	GWBase::Random rnd(53);
+	for (int i = 0; i < n; ++i) { xref[i] = rnd.f01() * 2.0f - 1.0f; }
+	pMtx->mul(rh.data(), xref.data());
+
+	const GWSparse::PrecondKind kinds[] = { GWSparse::PrecondKind::NONE, GWSparse::PrecondKind::JACOBI, GWSparse::PrecondKind::IC0 };
+	int iters[3];
+	bool res = true;
+	GWSparse::CGParams params;
+	for (int k = 0; res && k < 3; ++k) {
+		GWSparse::Preconditioner* pPrecond = GWSparse::Preconditioner::create(*pMtx, kinds[k]);
+		res = pPrecond->mKind == kinds[k];
+		std::vector<float> ans(n, 0.0f);
+		std::vector<float> serial(n, 0.0f);
+		float resid = 1.0f;
+		params.mParallel = true;
+		iters[k] = GWSparse::cg_solve(*pMtx, ans.data(), rh.data(), pPrecond, params, &resid);
+		params.mParallel = false;
+		int siters = GWSparse::cg_solve(*pMtx, serial.data(), rh.data(), pPrecond, params);
+		res = res && resid <= params.mTolerance && siters == iters[k] && ans == serial;
+		for (int i = 0; res && i < n; ++i) {
+			res = std::fabs(ans[i] - xref[i]) < 1.0e-3f;
+		}
+
+		// warm start close to the solution
+		for (int i = 0; res && i < n; ++i) {
+			ans[i] = xref[i] + (rnd.f01() - 0.5f) * 0.01f;
+		}
+		res = res && GWSparse::cg_solve(*pMtx, ans.data(), rh.data(), pPrecond, params) < iters[k];
+		GWSparse::Preconditioner::destroy(pPrecond);
+	}
+	res = res && iters[2] < iters[1] && iters[1] <= iters[0];
+
+	// no right-hand side
+	std::vector<float> zero(n, 0.0f);
+	std::vector<float> ans(xref);
+	res = res && GWSparse::cg_solve(*pMtx, ans.data(), zero.data()) == 0 && ans == zero;
+	GWSparse::CSRMatrix::destroy(pMtx);
+	return res;
+}
+
+static TEST_ENTRY s_sparse_tests[] = {
+	TEST_DECL(test_csr),
+	TEST_DECL(test_cg)
+};
+
+bool test_sparse() {
+	return 0 == EXEC_TESTS(s_sparse_tests);
+}
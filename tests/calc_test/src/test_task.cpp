@@ -0,0 +1,63 @@
+/*
+ * Groundwork task pool tests
+ * Author: Gleb Novodran <novodran@gmail.com>
+ */
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <groundwork.hpp>
+#include "test.hpp"
+
+static void sum_range(void* pCtx, int begin, int end) {
+	std::atomic<int64_t>* pSum = reinterpret_cast<std::atomic<int64_t>*>(pCtx);
+	int64_t sum = 0;
+	for (int i = begin; i < end; ++i) {
+		sum += i;
+	}
+	pSum->fetch_add(sum);
+}
+
+bool test_task() {
+	const int n = 100000;
+	std::atomic<int64_t> sum(0);
+	GWTask::parallel_for(n, sum_range, &sum);
+	if (sum.load() != int64_t(n) * (n - 1) / 2) { return false; }
+
+	// every item visited exactly once, nested loops run inline
+	std::vector<int> visits(n, 0);
+	const int nouter = 64;
+	GWTask::parallel_for(nouter, [&](int o0, int o1) {
+		for (int o = o0; o < o1; ++o) {
+			int begin = o * (n / nouter);
+			int end = o == nouter - 1 ? n : begin + n / nouter;
+			GWTask::parallel_for(end - begin, [&](int i0, int i1) {
+				for (int i = i0; i < i1; ++i) {
+					++visits[begin + i];
+				}
+			});
+		}
+	}, 1);
+	for (int i = 0; i < n; ++i) {
+		if (visits[i] != 1) { return false; }
+	}
+
+	// several threads starting the pool at once
+	GWTask::reset();
+	const int nthr = 4;
+	std::atomic<int64_t> sums[nthr];
+	std::vector<std::thread> threads;
+	for (int t = 0; t < nthr; ++t) {
+		sums[t] = 0;
+		threads.push_back(std::thread([&sums, t] { GWTask::parallel_for(n, sum_range, &sums[t]); }));
+	}
+	for (int t = 0; t < nthr; ++t) {
+		threads[t].join();
+		if (sums[t].load() != int64_t(n) * (n - 1) / 2) { return false; }
+	}
+
+	sum = 0;
+	GWTask::parallel_for(0, sum_range, &sum);
+	GWTask::parallel_for(1, sum_range, &sum);
+	return sum.load() == 0;
+}
@@ -200,11 +200,102 @@ static bool test_3x4_get_quat() {
 	return d < 0.0001;
 }
 
+template<typename T> static GWTransform3x4<T> gen_3x4(GWBase::Random& rnd) {
+	GWQuaternionBase<T> q;
+	q.set_degrees(T(rnd.d01() * 360.0), T(rnd.d01() * 360.0), T(rnd.d01() * 360.0));
+	GWVectorBase<T> trn(T(rnd.d01() * 10.0 - 5.0), T(rnd.d01() * 10.0 - 5.0), T(rnd.d01() * 10.0 - 5.0));
+	GWVectorBase<T> scl(T(0.5 + rnd.d01()), T(0.5 + rnd.d01()), T(0.5 + rnd.d01()));
+	GWTransform3x4<T> xform;
+	xform.make_transform(q, trn, scl);
+	return xform;
+}
+
+template<typename T> static bool test_3x4_concat_invert_t() {
+	GWBase::Random rnd(13);
+	for (int i = 0; i < 100; ++i) {
+		GWTransform3x4<T> child = gen_3x4<T>(rnd);
+		GWTransform3x4<T> parent = gen_3x4<T>(rnd);
+		// against the product of the 4x4 forms
+		GWTransform3x4<T> ref = GWXformCvt::get_3x4(GWXform::concatenate(GWXformCvt::get_4x4(child), GWXformCvt::get_4x4(parent)));
+		GWTransform3x4<T> res = GWXform::concatenate(child, parent);
+		if (!compare_mtx(ref.as_tptr(), res.as_tptr(), 3, 4)) { return false; }
+		GWXform::concatenate(child, child, parent);
+		if (!compare_mtx(ref.as_tptr(), child.as_tptr(), 3, 4)) { return false; }
+
+		GWTransform3x4<T> inv;
+		if (!GWXform::invert(inv, res)) { return false; }
+		GWTransform3x4<T> ident = GWXform::concatenate(inv, res);
+		GWTransform3x4<T> ref1;
+		ref1.set_identity();
+		if (!compare_mtx(ident.as_tptr(), ref1.as_tptr(), 3, 4)) { return false; }
+	}
+	GWTransform3x4<T> flat;
+	flat.make_scaling(T(1), T(0), T(1));
+	GWTransform3x4<T> inv;
+	return !GWXform::invert(inv, flat);
+}
+
+static bool test_3x4_concat_invert() {
+	return test_3x4_concat_invert_t<float>() && test_3x4_concat_invert_t<double>();
+}
+
+static bool test_3x4_batch() {
+	GWBase::Random rnd(17);
+	GWTransform3x4F xform = gen_3x4<float>(rnd);
+	// odd counts for the tails of the SIMD loops
+	const int num = 37;
+	GWVectorF src[num];
+	GWVectorF pnts[num];
+	GWVectorF vecs[num];
+	for (int i = 0; i < num; ++i) {
+		src[i] = GWVectorF(float(rnd.d01() * 8.0 - 4.0), float(rnd.d01() * 8.0 - 4.0), float(rnd.d01() * 8.0 - 4.0));
+	}
+	for (int n = 0; n <= num; n += 9) {
+		GWXform::calc_pnts(xform, pnts, src, n);
+		GWXform::calc_vecs(xform, vecs, src, n);
+		for (int i = 0; i < n; ++i) {
+			if (!COMPARE_VEC(pnts[i], xform.calc_pnt(src[i]), 1e-5f)) { return false; }
+			if (!COMPARE_VEC(vecs[i], xform.calc_vec(src[i]), 1e-5f)) { return false; }
+		}
+	}
+	std::copy(src, src + num, pnts);
+	GWXform::calc_pnts(xform, pnts, pnts, num);
+	for (int i = 0; i < num; ++i) {
+		if (!COMPARE_VEC(pnts[i], xform.calc_pnt(src[i]), 1e-5f)) { return false; }
+	}
+
+	// a chain with two roots, parents first
+	const int nnode = 12;
+	int32_t parentIdx[nnode] = { -1, 0, 1, 1, 3, -1, 5, 6, 0, 8, 2, 10 };
+	GWTransform3x4F local[nnode];
+	GWTransform3x4F world[nnode];
+	GWTransform3x4F pairs[nnode];
+	for (int i = 0; i < nnode; ++i) {
+		local[i] = gen_3x4<float>(rnd);
+	}
+	GWXform::calc_world(world, local, parentIdx, nnode);
+	for (int i = 0; i < nnode; ++i) {
+		GWTransform3x4F ref = local[i];
+		for (int j = parentIdx[i]; j >= 0; j = parentIdx[j]) {
+			ref = GWXform::concatenate(ref, local[j]);
+		}
+		if (!compare_mtx(ref.as_tptr(), world[i].as_tptr(), 3, 4)) { return false; }
+	}
+	GWXform::concatenate(pairs, local, world, nnode);
+	for (int i = 0; i < nnode; ++i) {
+		GWTransform3x4F ref = GWXform::concatenate(local[i], world[i]);
+		if (!compare_mtx(ref.as_tptr(), pairs[i].as_tptr(), 3, 4)) { return false; }
+	}
+	return true;
+}
+
 static TEST_ENTRY s_xform3x4_tests[] = {
 	TEST_DECL(test_3x4_apply),
 	TEST_DECL(test_3x4_rotation),
 	TEST_DECL(test_3x4_concat),
-	TEST_DECL(test_3x4_get_quat)
+	TEST_DECL(test_3x4_get_quat),
+	TEST_DECL(test_3x4_concat_invert),
+	TEST_DECL(test_3x4_batch)
 };
 
 static bool test_3x4() {